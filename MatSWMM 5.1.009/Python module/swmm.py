@@ -19,10 +19,11 @@
 
 # ------------------------- MODULES ---------------------------
 
-from ctypes import c_double, WinDLL, c_float, pointer # Required to handle with DLL variables
+from ctypes import c_double, c_int, WinDLL, c_float, pointer # Required to handle with DLL variables
 from time import time # Required to get computational times.
 from os import remove # Required to clear info file.
 import math, re # Used to create .rpt and .out paths
+import mmap, struct # Used to read columnar results files
 
 # ------------------------ CONSTANTS ---------------------------
 
@@ -83,6 +84,8 @@ _ERROR_NFOUND = -297
 _ERROR_INCOHERENT = -296
 _ERROR_IS_NUMERIC = -295
 
+_COLUMNS_MAGIC = 516114600 # Identifies a columnar results file
+
 _ERROR_MSG_NFOUND = AttributeError("Error: Object not found")
 _ERROR_MSG_TYPE = AttributeError("Error: Type of object not compatible")
 _ERROR_MSG_ATR = AttributeError("Error: Attribute not compatible")
@@ -95,6 +98,9 @@ _ERROR_MSG_IS_NUMERIC = TypeError("Error: This function just handle numerical at
 _swmmDLL = WinDLL("swmm5.dll") # Loads the DLL
 _swmmDLL.swmm_get.restype = c_double # Define the return type of the DLL function swmm_get
 _swmmDLL.swmm_get_from_input.restype = c_double # Define the return type of the DLL function swmm_get_from_input
+_HAS_GET_MANY = hasattr(_swmmDLL, 'swmm_get_many') # Batched getters are only exported by newer DLLs
+_HAS_SAVE_COLUMNS = hasattr(_swmmDLL, 'swmm_save_results_columns') # Columnar export is only in newer DLLs
+_index_cache = {} # ID -> (type, index) of the objects already resolved in the DLL
 _elapsedTime = c_double(0.000001) # Elapsed time in decimal days
 _ptrTime = pointer( _elapsedTime ) # Pointer to elapsed time
 _start_time = time() # Simulation start time
@@ -306,6 +312,7 @@ def open_file(inp, msg=False):
 	error = _swmmDLL.swmm_open(inp, rpt, out)
 	if (error != 0):
 		raise _ERROR_MSG_PATH
+	_index_cache.clear()
 	if msg:
 		print "Openning SWMM  -  OK"
 
@@ -452,6 +459,77 @@ def get(object_id, attribute, unit_system):
 
 	return value
 
+def get_index(object_id):
+
+	'''
+	Inputs:  object_id (str) -> ID of the object, as saved in SWMM.
+	Outputs: _ (tuple) -> (type, index) of the object in the DLL.
+						  [0] -> swmm.py constant (SUBCATCH, NODE or LINK)
+						  [1] -> Index of the object
+	Purpose: resolves the ID of an object once. The result is cached until
+			 another input file is opened.
+	'''
+
+	if object_id not in _index_cache:
+		object_type = c_int(-1)
+		index = _swmmDLL.swmm_get_index(object_id, pointer(object_type))
+		if index < 0:
+			raise _ERROR_MSG_NFOUND
+		_index_cache[object_id] = (object_type.value, index)
+
+	return _index_cache[object_id]
+
+
+def get_many(object_ids, attribute, unit_system):
+
+	'''
+	Inputs:  object_ids	 (list) -> IDs of the objects, as saved in SWMM.
+			 attribute 	 (int)  -> swmm.py constant, related to the attribute of the objects.
+			 unit_system (int)  -> swmm.py constant, related to the units of the attribute that is going
+			 					   to be retrieved.
+	Outputs: values (list) -> Values of the attribute, in the same order as object_ids.
+	Purpose: returns the value of the attribute for several objects, with one DLL call
+			 per type of object. Falls back to get() if the DLL does not export swmm_get_many.
+	'''
+
+	# Parameter error
+	if attribute not in _attribute_constants:
+		raise _ERROR_MSG_INCOHERENT
+	elif unit_system not in _unit_constants:
+		raise _ERROR_MSG_INCOHERENT
+
+	if not _HAS_GET_MANY:
+		return [get(object_id, attribute, unit_system) for object_id in object_ids]
+
+	# Groups the positions of the objects by type
+	groups = {}
+	for i in range(len(object_ids)):
+		object_type, index = get_index(object_ids[i])
+		groups.setdefault(object_type, []).append((i, index))
+
+	values = [0.0] * len(object_ids)
+	for object_type in groups:
+		group = groups[object_type]
+		n = len(group)
+		indices = (c_int * n)(*[index for (i, index) in group])
+		result = (c_double * n)()
+		error = _swmmDLL.swmm_get_many(object_type, indices, n, attribute, unit_system, result)
+
+		# Handling errors
+		if error == _ERROR_NFOUND:
+			raise _ERROR_MSG_NFOUND
+		elif error == _ERROR_TYPE:
+			raise _ERROR_MSG_TYPE
+		elif error == _ERROR_ATR:
+			raise _ERROR_MSG_ATR
+		elif error != 0:
+			raise _ERROR_MSG_INCOHERENT
+
+		for k in range(n):
+			values[group[k][0]] = result[k]
+
+	return values
+
 def get_from_input(input_file, object_id, attribute):
 	'''
 	Inputs:  input_file  (str) -> Path to input file.
@@ -549,14 +627,16 @@ def get_all(input_file, object_type, attribute=-1, save_file=False):
 def modify_settings(orifices_ids, new_settings):
 
 	'''
-	Inputs:  orifices_ids	(str)    -> List of orifices IDs, as saved in SWMM.
-			 new_setting 	(double) -> List of Percentage of openning of the orifices.
+	Inputs:  orifices_ids	(str)    -> List of IDs of control actuators (orifices, weirs,
+									outlets and pumps), as saved in SWMM.
+			 new_setting 	(double) -> List of settings of the actuators.
 	Outputs: None.
-	Purpose: modifies the setting of an orifice during the simulation.
+	Purpose: modifies the settings of several actuators during the simulation, with a
+			 single DLL call if the DLL exports swmm_modify_settings.
 	'''
 
 	if type(orifices_ids) in (tuple, list):
-		if len(orifices_ids) > 0:
+		if len(orifices_ids) > 0 and len(orifices_ids) == len(new_settings):
 			if type(orifices_ids[0]) == str:
 				pass
 			else:
@@ -565,12 +645,30 @@ def modify_settings(orifices_ids, new_settings):
 			raise _ERROR_MSG_INCOHERENT
 	elif type(orifices_ids) is str:
 		modify_setting(orifices_ids, new_settings)
+		return
 	else:
 		raise _ERROR_MSG_INCOHERENT
 
-
-	for i in range(len(orifices_ids)):
+	if not _HAS_GET_MANY:
+		for i in range(len(orifices_ids)):
 			modify_setting(orifices_ids[i], new_settings[i])
+		return
+
+	n = len(orifices_ids)
+	indices = (c_int * n)()
+	for i in range(n):
+		object_type, indices[i] = get_index(orifices_ids[i])
+		if object_type != LINK:
+			raise _ERROR_MSG_TYPE
+	settings = (c_double * n)(*new_settings)
+
+	error = _swmmDLL.swmm_modify_settings(indices, settings, n, c_double(0))
+	if error == _ERROR_INCOHERENT:
+		raise _ERROR_MSG_INCOHERENT
+	elif error == _ERROR_NFOUND:
+		raise _ERROR_MSG_NFOUND
+	elif error == _ERROR_TYPE:
+		raise _ERROR_MSG_TYPE
 
 def modify_input(input_file, object_id, attribute, value):
 
@@ -612,6 +710,93 @@ def finish():
 	close()  # Step 7
 	return errors
 
+def save_results_columns(path):
+	'''
+	Inputs:  path (str) -> Path of the binary file that is going to be written.
+	Outputs: None
+	Purpose: saves all the results of the simulation in a single binary file, with one
+			 contiguous block of values per variable. It must be called after end() and
+			 before close(). The file can be read with read_results_columns.
+	'''
+
+	if not _HAS_SAVE_COLUMNS:
+		raise SystemError ("Error: The loaded swmm5.dll does not export swmm_save_results_columns")
+
+	error = _swmmDLL.swmm_save_results_columns(path)
+	if (error != 0):
+		raise SystemError ("Error %d: The results could not be saved" % error)
+
+
+def read_results_columns(path, object_ids, object_type, attribute):
+	'''
+	Inputs:  path		 (str)		-> Path of a file written by save_results_columns.
+			 object_ids	 (str/list)	-> ID(s) of the objects, as saved in SWMM.
+			 object_type (int)		-> swmm.py constant (SUBCATCH, NODE or LINK).
+			 attribute	 (int)		-> swmm.py constant, related to the attribute of the objects.
+									   SUBCATCH: PRECIPITATION | RUNOFF
+									   NODE: INFLOW | FLOODING | DEPTH | VOLUME
+									   LINK: FLOW | DEPTH | VOLUME
+	Outputs: time	(list) -> Time of each reporting period in hours.
+			 values	(list) -> One list of values per object.
+	Purpose: retrieves the results of several objects after the simulation. The file is
+			 memory-mapped, so only the requested values are read.
+	'''
+
+	# Position of the attribute among the variables of each type of object
+	variables = {SUBCATCH: (0, {PRECIPITATION: 0, RUNOFF: 4}),
+				 NODE: (1, {DEPTH: 0, VOLUME: 2, INFLOW: 4, FLOODING: 5}),
+				 LINK: (2, {FLOW: 0, DEPTH: 1, VOLUME: 3})}
+	if object_type not in variables:
+		raise _ERROR_MSG_TYPE
+	k, columns = variables[object_type]
+	if attribute not in columns:
+		raise _ERROR_MSG_ATR
+	if type(object_ids) is str:
+		object_ids = [object_ids]
+
+	try:
+		f = open(path, 'rb')
+	except IOError:
+		raise _ERROR_MSG_PATH
+	data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+	try:
+		header = struct.unpack_from('<14i', data, 0)
+		start_date = struct.unpack_from('<d', data, 56)[0]
+		if header[0] != _COLUMNS_MAGIC:
+			raise _ERROR_MSG_PATH
+		n_periods = header[2]
+		counts = (header[4], header[6], header[8])
+		n_variables = (header[5], header[7], header[9])
+		data_pos = header[13]
+
+		# IDs of the reported objects
+		ids = []
+		pos = 64
+		for i in range(sum(counts)):
+			n = struct.unpack_from('<i', data, pos)[0]
+			ids.append(data[pos + 4:pos + 4 + n].decode('ascii'))
+			pos += 4 + n
+		first = sum(counts[:k])
+		index = dict((ids[first + j], j) for j in range(counts[k]))
+
+		# Block of the requested variable
+		block = data_pos + 8*n_periods + 4*n_periods*(
+			sum(counts[i]*n_variables[i] for i in range(k)) + columns[attribute]*counts[k])
+		values = []
+		for object_id in object_ids:
+			if object_id not in index:
+				raise _ERROR_MSG_NFOUND
+			values.append(list(struct.unpack_from('<%df' % n_periods, data,
+				block + 4*n_periods*index[object_id])))
+		dates = struct.unpack_from('<%dd' % n_periods, data, data_pos)
+		time = [(d - start_date)*24 for d in dates]
+	finally:
+		data.close()
+		f.close()
+
+	return time, values
+
+
 def cosimulate(input_file, step_actions, variables_iterable, attributes, units, time_resolution = 1, show_error = False):
 	'''
 	Inputs:  input_file   		(str) 			-> Path to input file.
@@ -689,13 +874,16 @@ def cosimulate(input_file, step_actions, variables_iterable, attributes, units,
 		# The variables are saved in accordance with the time resolution variable
 		if ( int(time_step % time_resolution) == 0): # Checks sampling time
 			if (variables_iterable != None):
-				for i in range(len(variables)):
-					# Dynamic handling
-					if ATTRIBUTE_ITERABLE:
-						for j in range(len(attributes)):
-							vectors[j][i].append(  get(variables[i], attributes[j], units) )
-					else:
-						vectors[i].append( get(variables[i], attributes, units) )
+				# Dynamic handling
+				if ATTRIBUTE_ITERABLE:
+					for j in range(len(attributes)):
+						values = get_many(variables, attributes[j], units)
+						for i in range(len(variables)):
+							vectors[j][i].append( values[i] )
+				else:
+					values = get_many(variables, attributes, units)
+					for i in range(len(variables)):
+						vectors[i].append( values[i] )
 
 		# -------- Implements Control Actions if exist -----------
 		if (step_actions != None):
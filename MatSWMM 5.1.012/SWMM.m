@@ -52,6 +52,10 @@ classdef SWMM < handle
     is_initialized = false;
   end
   properties (Hidden = true)
+    % ID -> [type, index] of the objects already resolved in the DLL
+    index_cache;
+    % Binary output file of the current project
+    out_file;
     % Error codes
     ERROR_PATH = -300;
     ERROR_ATR = -299;
@@ -94,8 +98,10 @@ classdef SWMM < handle
       loadlibrary('swmm5');
     end
 
+    obj.index_cache = containers.Map();
     rpt_file = strrep(lower(input_file), '.inp', '.rpt');
     out_file = strrep(lower(input_file), '.inp', '.out');
+    obj.out_file = out_file;
     error = calllib('swmm5','swmm_open',input_file, rpt_file, out_file);
     if error ~= 0
       if (libisloaded('swmm5'))
@@ -105,6 +111,38 @@ classdef SWMM < handle
     end
   end
   %%
+  function open_from_text(obj, inp_text, out_file)
+  %* swmm_openFromBuffer *
+  %
+  % This SWMM function opens a swmm simulation whose input file is
+  % held in memory (e.g. a candidate design generated by an
+  % optimisation), without writing it to disk. The report goes to a
+  % temporary file
+  %
+  % swmm.open_from_text(txt, out)
+  %
+  % txt: contents of an input file .inp
+  % out: path of the binary output file (optional, a scratch file
+  % is used if it is missing)
+    if ~(libisloaded('swmm5'))
+      loadlibrary('swmm5');
+    end
+    if nargin < 3
+      out_file = '';
+    end
+
+    obj.index_cache = containers.Map();
+    obj.out_file = out_file;
+    error = calllib('swmm5','swmm_openFromBuffer', inp_text, ...
+      length(inp_text), '', out_file);
+    if error ~= 0
+      if (libisloaded('swmm5'))
+        unloadlibrary swmm5;
+      end
+      throw(obj.ERROR_MSG_INCOHERENT);
+    end
+  end
+  %%
   function start(obj, write_report)
   %* swmm_start *
   %
@@ -167,6 +205,91 @@ classdef SWMM < handle
     end
   end
   %%
+  function time = run_until(obj, target_time)
+  %* swmm_stepUntil *
+  %
+  % This SWMM function advances the simulation by as many routing
+  % time steps as are needed to reach target_time, in a single DLL
+  % call. Raise Exception if there is an error
+  %
+  % t = swmm.run_until(target_time)
+  %
+  % target_time: elapsed time to reach, in hours
+  % t: elapsed time in hours (0 if the simulation is over)
+
+    if ~(libisloaded('swmm5'))
+      loadlibrary('swmm5');
+    end
+    error = calllib('swmm5','swmm_stepUntil', target_time/24, obj.timePtr);
+    time  = obj.timePtr.value*24;
+
+    if error ~= 0
+      exception = MException('SystemFailure:CheckErrorCode',...
+      sprintf('Error %d ocurred at time %.2f hours', error, time));
+      if libisloaded('swmm5')
+        unloadlibrary swmm5;
+      end
+      throw(exception);
+    end
+  end
+  %%
+  function [time, event] = run_until_event(obj, target_time, list_ids, attributes, thresholds, unit_system)
+  %* swmm_stepUntilEvent *
+  %
+  % This SWMM function advances the simulation like run_until, but
+  % stops after the first routing step in which a watched value
+  % (e.g. a node depth, a link flow or a node flooding) crosses its
+  % threshold, in either direction
+  %
+  % [t, ev] = swmm.run_until_event(target_time, ids, attrs, thresholds, un)
+  %
+  % target_time: elapsed time to reach, in hours
+  % ids: string(cell) with the IDs of the watched objects
+  % attrs: attribute watched on each object (scalar or vector)
+  % thresholds: threshold of each watched value
+  % un: constant related to the units of the thresholds
+  % t: elapsed time in hours (0 if the simulation is over)
+  % ev: position in ids of the watch that stopped the simulation,
+  % 0 if no threshold was crossed
+    if ischar(list_ids)
+      list_ids = {list_ids};
+    end
+    n = length(list_ids);
+    if isscalar(attributes)
+      attributes = repmat(attributes, 1, n);
+    end
+    if length(attributes) ~= n || length(thresholds) ~= n
+      throw(obj.ERROR_MSG_INCOHERENT);
+    elseif ~ismember(unit_system, [obj.SI, obj.US, obj.DIMENTIONLESS])
+      throw(obj.ERROR_MSG_INCOHERENT);
+    end
+
+    [types, indices] = obj.get_indices(list_ids);
+    eventPtr = libpointer('int32Ptr', -1);
+    error = calllib('swmm5','swmm_stepUntilEvent', target_time/24, n, ...
+      int32(types), indices, int32(attributes), double(thresholds), ...
+      unit_system, obj.timePtr, eventPtr);
+    time  = obj.timePtr.value*24;
+    event = double(eventPtr.Value) + 1;
+
+    if (error == obj.ERROR_NFOUND)
+      throw(obj.ERROR_MSG_NFOUND);
+    elseif (error == obj.ERROR_TYPE)
+      throw(obj.ERROR_MSG_TYPE);
+    elseif (error == obj.ERROR_ATR)
+      throw(obj.ERROR_MSG_ATR);
+    elseif (error == obj.ERROR_INCOHERENT)
+      throw(obj.ERROR_MSG_INCOHERENT);
+    elseif error ~= 0
+      exception = MException('SystemFailure:CheckErrorCode',...
+      sprintf('Error %d ocurred at time %.2f hours', error, time));
+      if libisloaded('swmm5')
+        unloadlibrary swmm5;
+      end
+      throw(exception);
+    end
+  end
+  %%
   function duration = end_sim(obj)
   %* swmm_end_sim *
   %
@@ -291,6 +414,70 @@ classdef SWMM < handle
     bool_ans = obj.timePtr.value == 0;
   end
   %%
+  function state = save_state(obj, state)
+  %* swmm_saveState *
+  %
+  % This SWMM function keeps a copy of the current state of the
+  % simulation in memory, so that the simulation can go back to it
+  % with restore_state (e.g., to try several control sequences from
+  % the same starting point). The memory of a state saved before
+  % can be reused by passing it as an argument
+  %
+  % s = swmm.save_state
+  % s = swmm.save_state(s)
+  %
+  % s: saved state (release it with delete_state)
+    if ~(libisloaded('swmm5'))
+      loadlibrary('swmm5');
+    end
+    if nargin < 2
+      state.ptr = libpointer('voidPtrPtr');
+    end
+    error = calllib('swmm5','swmm_saveState', state.ptr);
+    if error ~= 0
+      exception = MException('SystemFailure:CheckErrorCode',...
+      sprintf('Error %d: The state could not be saved', error));
+      throw(exception);
+    end
+    state.time = obj.timePtr.value;
+  end
+  %%
+  function restore_state(obj, state)
+  %* swmm_restoreState *
+  %
+  % This SWMM function returns the simulation to a state saved with
+  % save_state during the current simulation
+  %
+  % swmm.restore_state(s)
+  %
+  % s: saved state
+    if ~(libisloaded('swmm5'))
+      loadlibrary('swmm5');
+    end
+    error = calllib('swmm5','swmm_restoreState', state.ptr.Value);
+    if error ~= 0
+      exception = MException('SystemFailure:CheckErrorCode',...
+      sprintf('Error %d: The state could not be restored', error));
+      throw(exception);
+    end
+    obj.timePtr.value = state.time;
+  end
+  %%
+  function delete_state(obj, state)
+  %* swmm_deleteState *
+  %
+  % This SWMM function frees the memory of a state saved with
+  % save_state
+  %
+  % swmm.delete_state(s)
+  %
+  % s: saved state
+    if ~(libisloaded('swmm5'))
+      loadlibrary('swmm5');
+    end
+    calllib('swmm5','swmm_deleteState', state.ptr.Value);
+  end
+  %%
   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
   % Getters & Setters
   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -299,7 +486,9 @@ classdef SWMM < handle
   %* swmm_step_get *
   %
   %	This MatSWMM function retrieves the values of an specific
-  % property of multiple objects while running the simulation
+  % property of multiple objects while running the simulation.
+  % The IDs are resolved only once, and the values of all the
+  % objects of the same type are retrieved in a single DLL call
   %
   %	val = swmm.step_get(ids, attr, un)
   %
@@ -310,11 +499,74 @@ classdef SWMM < handle
   % val: requested value
     if isa(list_ids, 'char')
       values = obj.get(list_ids, attribute, unit_system);
-    else
-      values = zeros(1, length(list_ids));
-      for i=1 : length(list_ids)
-        values(i) = obj.get(list_ids{i}, attribute, unit_system);
+      return;
+    end
+
+    if ~ismember(attribute, [obj.DEPTH, obj.VOLUME, obj.FLOW, obj.SETTING, obj.FROUDE, obj.INFLOW, obj.FLOODING, ...
+        obj.PRECIPITATION, obj.RUNOFF, obj.MAX_AREA])
+      throw(obj.ERROR_MSG_INCOHERENT);
+    elseif ~ismember(unit_system, [obj.SI, obj.US, obj.DIMENTIONLESS])
+      throw(obj.ERROR_MSG_INCOHERENT);
+    end
+
+    [types, indices] = obj.get_indices(list_ids);
+    values = zeros(1, length(list_ids));
+    for t = unique(types)
+      selected = (types == t);
+      n = nnz(selected);
+      valuesPtr = libpointer('doublePtr', zeros(1, n));
+      error = calllib('swmm5','swmm_get_many', t, indices(selected), n, ...
+        attribute, unit_system, valuesPtr);
+      if (error == obj.ERROR_NFOUND)
+        throw(obj.ERROR_MSG_NFOUND);
+      elseif (error == obj.ERROR_TYPE)
+        throw(obj.ERROR_MSG_TYPE);
+      elseif (error == obj.ERROR_ATR)
+        throw(obj.ERROR_MSG_ATR);
+      elseif (error ~= 0)
+        throw(obj.ERROR_MSG_INCOHERENT);
+      end
+      values(selected) = valuesPtr.Value;
+    end
+  end
+  %%
+  function [types, indices] = get_indices(obj, list_ids)
+  %* swmm_get_index *
+  %
+  %	This MatSWMM function resolves the IDs of several objects into
+  % their types (SUBCATCH, NODE or LINK) and their indices in the
+  % DLL. Each ID is looked up once per opened project and then
+  % cached
+  %
+  %	[t, idx] = swmm.get_indices(ids)
+  %
+  %	ids: string(cell) with ID(s) of the object(s), as saved in SWMM
+  %	t: types of the objects
+  %	idx: indices of the objects (int32)
+    if ischar(list_ids)
+      list_ids = {list_ids};
+    end
+    if isempty(obj.index_cache)
+      obj.index_cache = containers.Map();
+    end
+    if ~(libisloaded('swmm5'))
+      loadlibrary('swmm5');
+    end
+
+    types = zeros(1, length(list_ids));
+    indices = zeros(1, length(list_ids), 'int32');
+    for i=1 : length(list_ids)
+      if ~isKey(obj.index_cache, list_ids{i})
+        typePtr = libpointer('int32Ptr', -1);
+        index = calllib('swmm5','swmm_get_index', list_ids{i}, typePtr);
+        if (index < 0)
+          throw(obj.ERROR_MSG_NFOUND);
+        end
+        obj.index_cache(list_ids{i}) = [double(typePtr.Value), double(index)];
       end
+      entry = obj.index_cache(list_ids{i});
+      types(i) = entry(1);
+      indices(i) = entry(2);
     end
   end
   %%
@@ -495,15 +747,65 @@ classdef SWMM < handle
   function modify_settings(obj, orifices_ids, new_settings)
   %* swmm_modify_settings *
   %
-  % This MatSWMM function modifies the setting of several orifices
-  % during the simulation
+  % This MatSWMM function modifies the setting of several control
+  % actuators (orifices, weirs, outlets and pumps) during the
+  % simulation, with a single DLL call
   %
   % swmm.modify_settings(ids, settings)
   %
-  % ids: IDs of the orifices as saved in SWMM
+  % ids: IDs of the actuators as saved in SWMM
   % settings: vector with the values of the settings
-  for i=1:length(orifices_ids)
-  obj.modify_setting(orifices_ids{i}, new_settings(i));
+  if isa(orifices_ids, 'char')
+  obj.modify_setting(orifices_ids, new_settings);
+  return;
+  end
+  if length(orifices_ids) ~= length(new_settings)
+  throw(obj.ERROR_MSG_INCOHERENT);
+  end
+
+  [types, indices] = obj.get_indices(orifices_ids);
+  if any(types ~= obj.LINK)
+  throw(obj.ERROR_MSG_TYPE);
+  end
+
+  error = calllib('swmm5','swmm_modify_settings', indices, ...
+    double(new_settings), length(indices), 0);
+  if error == obj.ERROR_INCOHERENT
+  throw(obj.ERROR_MSG_INCOHERENT);
+  elseif error == obj.ERROR_NFOUND
+  throw(obj.ERROR_MSG_NFOUND);
+  elseif error == obj.ERROR_TYPE
+  throw(obj.ERROR_MSG_TYPE);
+  end
+  end
+  %%
+  function load_controller(obj, library, function_name, interval)
+  %* swmm_load_controller *
+  %
+  % This MatSWMM function loads a controller compiled into a shared
+  % library (see SWMM_Controller in swmm5.h). SWMM calls it inside
+  % run_step every interval routing steps, before routing, so the
+  % control loop runs without leaving the DLL
+  %
+  % swmm.load_controller(library, function_name, interval)
+  %
+  % library: path of the shared library
+  % function_name: name of the controller function in the library
+  % interval: number of routing steps between controller calls
+  if ~(libisloaded('swmm5'))
+    loadlibrary('swmm5');
+  end
+  if nargin < 4
+    interval = 1;
+  end
+  error = calllib('swmm5','swmm_load_controller', library, ...
+    function_name, interval);
+  if error == obj.ERROR_PATH
+  throw(obj.ERROR_MSG_PATH);
+  elseif error == obj.ERROR_NFOUND
+  throw(obj.ERROR_MSG_NFOUND);
+  elseif error == obj.ERROR_INCOHERENT
+  throw(obj.ERROR_MSG_INCOHERENT);
   end
   end
   %%
@@ -553,6 +855,28 @@ classdef SWMM < handle
   error = calllib('swmm5','swmm_save_results');
   end
   %%
+  function save_results_columns(obj, file)
+  %* swmm_save_results_columns *
+  %
+  % This MatSWMM function saves all the results of the simulation
+  % in a single binary file, with one contiguous block of values per
+  % variable. It must be called after end_sim and before close. The
+  % file can be read with read_results_columns
+  %
+  % swmm.save_results_columns(f)
+  %
+  % f: path of the binary file
+  if ~(libisloaded('swmm5'))
+  loadlibrary('swmm5');
+  end
+  error = calllib('swmm5','swmm_save_results_columns', file);
+  if error ~= 0
+  exception = MException('SystemFailure:CheckErrorCode',...
+  sprintf('Error %d: The results could not be saved', error));
+  throw(exception);
+  end
+  end
+  %%
   function [errors, duration] = finish(obj)
   %* swmm_finish *
   %
@@ -594,21 +918,28 @@ classdef SWMM < handle
   % f = swmm.total_flooding
   %
   % f: total flooding [m^3/s]
-  nodes = obj.getAllFiles('Nodes');
+  if ~(libisloaded('swmm5'))
+  loadlibrary('swmm5');
+  end
+  [rh, time] = obj.open_results;
+  n_periods = length(time) - 1;
+  n_nodes = calllib('swmm5','swmm_results_count', rh, obj.NODE);
+  values = libpointer('singlePtr', zeros(1, n_periods));
   tflooding = 0;
-  for i=1 : length(nodes)
-  current = strrep(nodes{i},'Nodes\','');
-  current = strrep(current,'.csv','');
-  [t,r] = obj.read_results(current, obj.NODE, obj.FLOODING);
-  tflooding = tflooding + trapz(t*3600,r);
+  for i=0 : n_nodes-1
+  calllib('swmm5','swmm_results_series', rh, obj.NODE, i, 5, 0, n_periods, values);
+  tflooding = tflooding + trapz(time*3600, [0; double(values.Value(:))]);
   end
+  calllib('swmm5','swmm_close_results', rh);
   end
   %%
   function [time, result] = read_results(obj, object_id, object_type, attribute)
   %* swmm_read_results *
   %
   % This MatSWMM function retrieves the results of an specific type
-  % of object after the simulation
+  % of object after the simulation. The values are read from the
+  % binary output file of the last project opened, which is
+  % memory-mapped by the DLL
   %
   % Compatible attributes with Subcatchments
   %  PRECIPITATION | RUNOFF
@@ -624,17 +955,14 @@ classdef SWMM < handle
   %	t: vector with time in hours
   %	val: vector with the requested data
   if object_type == obj.LINK
-  folder = 'Links/';
   compatible = [obj.FLOW, obj.DEPTH, obj.VOLUME, obj.CAPACITY];
-  columns = [1, 3, 4, 5];
+  variables = [0, 1, 3, 4];
   elseif object_type == obj.NODE
-  folder = 'Nodes/';
   compatible = [obj.INFLOW, obj.FLOODING, obj.DEPTH, obj.VOLUME];
-  columns = [1, 2, 3, 5];
+  variables = [4, 5, 0, 2];
   elseif object_type == obj.SUBCATCH
-  folder = 'Subcatchments/';
   compatible = [obj.PRECIPITATION, obj.RUNOFF];
-  columns = [1, 3];
+  variables = [0, 4];
   else
   throw(obj.ERROR_MSG_TYPE);
   end
@@ -646,20 +974,124 @@ classdef SWMM < handle
   if ~iscell(object_id)
   object_id = {object_id};
   end
-  result = [];
+  if ~(libisloaded('swmm5'))
+  loadlibrary('swmm5');
+  end
+  [rh, time] = obj.open_results;
+  n_periods = length(time) - 1;
+  values = libpointer('singlePtr', zeros(1, n_periods));
+  result = zeros(n_periods+1, length(object_id));
   for i=1 : length(object_id)
-  path = strcat(folder, object_id{i}, '.csv');
-  if exist(path) ~= 2
+  index = calllib('swmm5','swmm_results_index', rh, object_type, object_id{i});
+  if index < 0
+  calllib('swmm5','swmm_close_results', rh);
   throw(obj.ERROR_MSG_NFOUND);
   end
-  data = csvread(path);
-  result(:,i) = [0;data(:,columns(position))];
+  calllib('swmm5','swmm_results_series', rh, object_type, index, ...
+    variables(position), 0, n_periods, values);
+  result(:,i) = [0; double(values.Value(:))];
   end
-  info = csvread('Time/time.txt');
-  time = zeros(info(2),1);
-  for i=2 : info(2)+1
-  time(i) = info(1)/3600 + time(i-1);
+  calllib('swmm5','swmm_close_results', rh);
   end
+  %%
+  function [rh, time] = open_results(obj)
+  % Auxiliar function
+  % Opens the binary output file of the last
+  % project and returns its handle with the reporting times [h]
+  rh = libpointer('voidPtrPtr');
+  error = calllib('swmm5','swmm_open_results', obj.out_file, rh);
+  if error ~= 0
+  throw(obj.ERROR_MSG_PATH);
+  end
+  rh = rh.Value;
+  n_periods = libpointer('int32Ptr', 0);
+  report_step = libpointer('int32Ptr', 0);
+  start_date = libpointer('doublePtr', 0);
+  calllib('swmm5','swmm_results_info', rh, n_periods, report_step, start_date);
+  time = (0 : double(n_periods.Value))' * double(report_step.Value)/3600;
+  end
+  %%
+  function [time, result] = read_results_columns(obj, file, object_id, object_type, attribute)
+  %* swmm_read_results_columns *
+  %
+  % This MatSWMM function retrieves the results of an specific type
+  % of object from a file written by save_results_columns. The file
+  % is memory-mapped, so only the requested values are read
+  %
+  % Compatible attributes with Subcatchments
+  %  PRECIPITATION | RUNOFF
+  % Compatible attributes with Nodes
+  %  INFLOW | FLOODING | DEPTH | VOLUME
+  % Compatible attributes with Links
+  %  FLOW | DEPTH | VOLUME | CAPACITY
+  %
+  % [t, val] = swmm.read_results_columns(f, id, type, attr)
+  %
+  % f: path of the binary file
+  % id: IDs of the objects
+  % attr: constant related to the attribute of the requested object
+  %	t: vector with time in hours
+  %	val: matrix with the requested data (one column per object)
+  if object_type == obj.SUBCATCH
+  k = 1;
+  compatible = [obj.PRECIPITATION, obj.RUNOFF];
+  variables = [1, 5];
+  elseif object_type == obj.NODE
+  k = 2;
+  compatible = [obj.INFLOW, obj.FLOODING, obj.DEPTH, obj.VOLUME];
+  variables = [5, 6, 1, 3];
+  elseif object_type == obj.LINK
+  k = 3;
+  compatible = [obj.FLOW, obj.DEPTH, obj.VOLUME, obj.CAPACITY];
+  variables = [1, 2, 4, 5];
+  else
+  throw(obj.ERROR_MSG_TYPE);
+  end
+  [a, position] = ismember(attribute, compatible);
+  if a ~= 1
+  throw(obj.ERROR_MSG_ATR);
+  end
+  if ~iscell(object_id)
+  object_id = {object_id};
+  end
+
+  % Header and IDs of the reported objects
+  fid = fopen(file, 'r');
+  if fid < 0
+  throw(obj.ERROR_MSG_PATH);
+  end
+  header = fread(fid, 14, 'int32');
+  start_date = fread(fid, 1, 'double');
+  if header(1) ~= 516114600
+  fclose(fid);
+  throw(obj.ERROR_MSG_PATH);
+  end
+  n_periods = header(3);
+  counts = header([5, 7, 9]);
+  n_variables = header([6, 8, 10]);
+  ids = cell(1, sum(counts));
+  for i=1 : sum(counts)
+  n = fread(fid, 1, 'int32');
+  ids{i} = fread(fid, [1, n], '*char');
+  end
+  fclose(fid);
+
+  first = sum(counts(1:k-1));
+  [found, columns] = ismember(object_id, ids(first+1 : first+counts(k)));
+  if ~all(found)
+  throw(obj.ERROR_MSG_NFOUND);
+  end
+
+  % Block of the requested variable: one column per object
+  data_pos = header(14);
+  offset = data_pos + 8*n_periods + 4*n_periods*(sum(counts(1:k-1).*n_variables(1:k-1)) ...
+    + (variables(position)-1)*counts(k));
+  values = memmapfile(file, 'Offset', offset, ...
+    'Format', {'single', [n_periods, counts(k)], 'x'}, 'Repeat', 1);
+  result = double(values.Data.x(:, columns));
+  dates = memmapfile(file, 'Offset', data_pos, ...
+    'Format', {'double', [n_periods, 1], 'x'}, 'Repeat', 1);
+  time = (dates.Data.x - start_date)*24;
   end
   %%
   function modify_setting(obj, orifice_id, new_setting)
@@ -35,6 +35,8 @@
 #define   GRAVITY            32.2           // accel. of gravity in US units
 #define   SI_GRAVITY         9.81           // accel of gravity in SI units
 #define   MAXFILESIZE        2147483647L    // largest file size in bytes
+#define   MAX_STATS          5              // Max. # entries in max. stats lists
+#define   MAX_STEP_CLASSES   8              // Max. # DW routing time step classes
 
 //-----------------------------
 // Units factor in Manning Eqn.
@@ -50,9 +50,21 @@
 //  - Support added for DAYOFYEAR attribute.
 //  - Modulated controls no longer included in reported control actions.
 //
+//   Rules are indexed by the variables their premises watch. On each time
+//   step a rule's premises are re-evaluated only if the value of one of
+//   its variables has changed or, for time-varying variables (simulation
+//   time, clock time and link time open/closed), if the outcome of one of
+//   its time premises has changed (i.e., a time threshold was crossed).
+//   Otherwise the rule's previous result is re-used. The list of actions
+//   is still rebuilt on every step so priorities and modulated (curve,
+//   time series and PID) settings are handled exactly as before. Rules
+//   with curve or PID actions, which use the controller value left by
+//   their premises, are evaluated on every step.
+//
 //-----------------------------------------------------------------------------
 #define _CRT_SECURE_NO_DEPRECATE
 
+#include <stdlib.h>
 #include <string.h>
 #include <malloc.h>
 #include <math.h>
@@ -102,9 +114,21 @@ struct  TPremise
     struct  TVariable rhsVar;     // right hand side variable                  //(5.1.008)
     int     relation;             // relational operator (>, <, =, etc)
     double  value;                // right hand side value
+    int     lhsIndex;             // index of LHS variable in RuleVars
+    int     rhsIndex;             // index of RHS variable (-1 if N/A)
+    int     timed;                // TRUE if premise watches a time variable
+    int     lastResult;           // result at last check of a timed premise
     struct  TPremise *next;       // next premise clause of rule
 };
 
+// Variable watched by rule premises
+struct  TRuleVar
+{
+    struct  TVariable var;        // premise variable
+    double  value;                // value on current time step
+    int     timed;                // TRUE if value changes with time
+};
+
 // Rule Action Clause
 struct  TAction              
 {
@@ -135,20 +159,37 @@ struct  TRule
    struct   TPremise* lastPremise;     // pointer to last premise of rule
    struct   TAction*  thenActions;     // linked list of actions if true
    struct   TAction*  elseActions;     // linked list of actions if false
+   int      result;                    // result of last premise evaluation
+   int      changed;                   // TRUE if premises need evaluating
+   int      alwaysEval;                // TRUE if premises evaluated each step
+};
+
+// Reference to a premise variable (used to index the variables)
+struct  TVarRef
+{
+    struct  TVariable var;        // premise variable
+    int*    index;                // where the variable's index is stored
 };
 
 //-----------------------------------------------------------------------------
 //  Shared variables
 //-----------------------------------------------------------------------------
-struct   TRule*       Rules;           // array of control rules
-struct   TActionList* ActionList;      // linked list of control actions
-int      InputState;                   // state of rule interpreter
-int      RuleCount;                    // total number of rules
-double   ControlValue;                 // value of controller variable
-double   SetPoint;                     // value of controller setpoint
-DateTime CurrentDate;                  // current date in whole days 
-DateTime CurrentTime;                  // current time of day (decimal)
-DateTime ElapsedTime;                  // elasped simulation time (decimal days)
+#define Rules        (Project->Rules)        // array of control rules
+#define ActionList   (Project->ActionList)   // linked list of control actions
+#define InputState   (Project->InputState)   // state of rule interpreter
+#define RuleCount    (Project->RuleCount)    // total number of rules
+#define ControlValue (Project->ControlValue) // value of controller variable
+#define SetPoint     (Project->SetPoint)     // value of controller setpoint
+#define CurrentDate  (Project->CurrentDate)  // current date in whole days
+#define CurrentTime  (Project->CurrentTime)  // current time of day (decimal)
+#define RuleVars     (Project->RuleVars)     // variables watched by premises
+#define RuleVarCount (Project->RuleVarCount) // number of watched variables
+#define RuleVarStart (Project->RuleVarStart) // start of each variable's rules
+#define RuleVarRules (Project->RuleVarRules) // rules watching each variable
+#define TimedRules   (Project->TimedRules)   // rules with timed premises
+#define TimedRuleCount (Project->TimedRuleCount) // number of such rules
+#define LinkActions  (Project->LinkActions)  // action list item of each link
+#define NextActionItem (Project->NextActionItem) // first unused list item
 
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)
@@ -156,7 +197,11 @@ DateTime ElapsedTime;                  // elasped simulation time (decimal days)
 //     controls_create
 //     controls_delete
 //     controls_addRuleClause
+//     controls_renumber
+//     controls_open
+//     controls_close
 //     controls_evaluate
+//     controls_copyState
 
 //-----------------------------------------------------------------------------
 //  Local functions
@@ -166,6 +211,16 @@ int    getPremiseVariable(char* tok[], int* k, struct TVariable* v);
 int    getPremiseValue(char* token, int attrib, double* value);
 int    addAction(int r, char* Tok[], int nToks);
 
+int    indexVariables(void);
+int    indexRules(void);
+int    compareVarRefs(const void* a, const void* b);
+int    isTimedVariable(struct TVariable* v);
+void   updateRuleVars(void);
+void   checkTimedRules(double tStep);
+int    hasModulatedAction(int r);
+int    canBeMissing(struct TVariable* v);
+int    evaluateRule(int r, double tStep);
+
 int    evaluatePremise(struct TPremise* p, double tStep);
 double getVariableValue(struct TVariable v);
 int    compareTimes(double lhsValue, int relation, double rhsValue,
@@ -183,6 +238,7 @@ int    setActionSetting(char* tok[], int nToks, int* curve, int* tseries,
        int* attrib, double* value);
 void   updateActionValue(struct TAction* a, DateTime currentTime, double dt);
 double getPIDSetting(struct TAction* a, double dt);
+void   copyActionState(struct TAction* a);
 
 //=============================================================================
 
@@ -195,6 +251,14 @@ int  controls_create(int n)
 {
    int r;
    ActionList = NULL;
+   NextActionItem = NULL;
+   LinkActions = NULL;
+   RuleVars = NULL;
+   RuleVarCount = 0;
+   RuleVarStart = NULL;
+   RuleVarRules = NULL;
+   TimedRules = NULL;
+   TimedRuleCount = 0;
    InputState = r_PRIORITY;
    RuleCount = n;
    if ( n == 0 ) return 0;
@@ -228,6 +292,139 @@ void controls_delete(void)
 
 //=============================================================================
 
+void controls_renumber(int nodeIndex[], int linkIndex[])
+//
+//  Input:   nodeIndex = new index of each node
+//           linkIndex = new index of each link
+//  Output:  none
+//  Purpose: updates the nodes and links named in all control rules after
+//           the project's nodes and links have been renumbered.
+//
+{
+   int r;
+   struct TPremise* p;
+   struct TAction*  a;
+
+   for ( r=0; r<RuleCount; r++ )
+   {
+       for ( p = Rules[r].firstPremise; p != NULL; p = p->next )
+       {
+           if ( p->lhsVar.node >= 0 ) p->lhsVar.node = nodeIndex[p->lhsVar.node];
+           if ( p->lhsVar.link >= 0 ) p->lhsVar.link = linkIndex[p->lhsVar.link];
+           if ( p->rhsVar.node >= 0 ) p->rhsVar.node = nodeIndex[p->rhsVar.node];
+           if ( p->rhsVar.link >= 0 ) p->rhsVar.link = linkIndex[p->rhsVar.link];
+       }
+       for ( a = Rules[r].thenActions; a != NULL; a = a->next )
+       {
+           if ( a->link >= 0 ) a->link = linkIndex[a->link];
+       }
+       for ( a = Rules[r].elseActions; a != NULL; a = a->next )
+       {
+           if ( a->link >= 0 ) a->link = linkIndex[a->link];
+       }
+   }
+}
+
+//=============================================================================
+
+int controls_open()
+//
+//  Input:   none
+//  Output:  returns an error code
+//  Purpose: indexes the control rules by the variables their premises watch.
+//
+{
+    int r;
+
+    LinkActions = NULL;
+    RuleVars = NULL;
+    RuleVarCount = 0;
+    RuleVarStart = NULL;
+    RuleVarRules = NULL;
+    TimedRules = NULL;
+    TimedRuleCount = 0;
+    if ( RuleCount == 0 ) return ErrorCode;
+
+    // --- index the premise variables and the rules that watch them
+    LinkActions = (struct TActionList **) calloc(MAX(Nobjects[LINK], 1),
+                  sizeof(struct TActionList *));
+    if ( LinkActions == NULL || !indexVariables() || !indexRules() )
+    {
+        report_writeErrorMsg(ERR_MEMORY, "");
+        return ErrorCode;
+    }
+    clearActionList();
+
+    // --- all rules are evaluated on the first time step
+    for (r = 0; r < RuleCount; r++) Rules[r].changed = TRUE;
+    return ErrorCode;
+}
+
+//=============================================================================
+
+void controls_close()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: frees the memory used to index the control rules.
+//
+{
+    FREE(LinkActions);
+    FREE(RuleVars);
+    FREE(RuleVarStart);
+    FREE(RuleVarRules);
+    FREE(TimedRules);
+    RuleVarCount = 0;
+    TimedRuleCount = 0;
+}
+
+//=============================================================================
+
+void controls_copyState()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: copies the state that rules carry between time steps (PID
+//           errors and the indexed results of premises) to or from an
+//           in-memory simulation state.
+//
+{
+    int    r;
+    struct TPremise* p;
+
+    for (r = 0; r < RuleCount; r++)
+    {
+        hotstart_copyState(&Rules[r].result, sizeof(int));
+        hotstart_copyState(&Rules[r].changed, sizeof(int));
+        for (p = Rules[r].firstPremise; p != NULL; p = p->next)
+            hotstart_copyState(&p->lastResult, sizeof(int));
+        copyActionState(Rules[r].thenActions);
+        copyActionState(Rules[r].elseActions);
+    }
+    if ( RuleVars )
+        hotstart_copyState(RuleVars, RuleVarCount * sizeof(struct TRuleVar));
+}
+
+//=============================================================================
+
+void copyActionState(struct TAction* a)
+//
+//  Input:   a = first action of a list of rule actions
+//  Output:  none
+//  Purpose: copies the PID set point errors of a list of actions to or
+//           from an in-memory simulation state.
+//
+{
+    while ( a )
+    {
+        hotstart_copyState(&a->e1, sizeof(double));
+        hotstart_copyState(&a->e2, sizeof(double));
+        a = a->next;
+    }
+}
+
+//=============================================================================
+
 int  controls_addRuleClause(int r, int keyword, char* tok[], int nToks)
 //
 //  Input:   r = rule index
@@ -295,7 +492,6 @@ int controls_evaluate(DateTime currentTime, DateTime elapsedTime, double tStep)
 {
     int    r;                          // control rule index
     int    result;                     // TRUE if rule premises satisfied
-    struct TPremise* p;                // pointer to rule premise clause
     struct TAction*  a;                // pointer to rule action clause
 
     // --- save date and time to shared variables
@@ -303,28 +499,26 @@ int controls_evaluate(DateTime currentTime, DateTime elapsedTime, double tStep)
     CurrentTime = currentTime - floor(currentTime);
     ElapsedTime = elapsedTime;
 
-    // --- evaluate each rule
+    // --- find the rules whose premises need evaluating
     if ( RuleCount == 0 ) return 0;
     clearActionList();
+    if ( RuleVars )
+    {
+        updateRuleVars();
+        checkTimedRules(tStep);
+    }
+
+    // --- evaluate each rule
     for (r=0; r<RuleCount; r++)
     {
-        // --- evaluate rule's premises
-        result = TRUE;
-        p = Rules[r].firstPremise;
-        while (p)
+        // --- evaluate rule's premises (or re-use their last result)
+        if ( RuleVars == NULL || Rules[r].changed || Rules[r].alwaysEval )
         {
-            if ( p->type == r_OR )
-            {
-                if ( result == FALSE )
-                    result = evaluatePremise(p, tStep);
-            }
-            else
-            {
-                if ( result == FALSE ) break;
-                result = evaluatePremise(p, tStep);
-            }
-            p = p->next;
-        }    
+            result = evaluateRule(r, tStep);
+            Rules[r].result = result;
+            Rules[r].changed = FALSE;
+        }
+        else result = Rules[r].result;
 
         // --- if premises true, add THEN clauses to action list
         //     else add ELSE clauses to action list
@@ -345,6 +539,344 @@ int controls_evaluate(DateTime currentTime, DateTime elapsedTime, double tStep)
 
 //=============================================================================
 
+int indexVariables()
+//
+//  Input:   none
+//  Output:  returns FALSE if memory runs out
+//  Purpose: lists the different variables watched by rule premises and
+//           assigns each premise the indexes of its variables.
+//
+{
+    int    r, k, n = 0;
+    struct TPremise* p;
+    struct TVarRef*  refs;
+
+    // --- list a reference to each premise variable
+    for (r = 0; r < RuleCount; r++)
+    {
+        for (p = Rules[r].firstPremise; p != NULL; p = p->next)
+        {
+            n++;
+            if ( p->value == MISSING ) n++;
+        }
+    }
+    refs = (struct TVarRef *) calloc(MAX(n, 1), sizeof(struct TVarRef));
+    RuleVars = (struct TRuleVar *) calloc(MAX(n, 1), sizeof(struct TRuleVar));
+    if ( refs == NULL || RuleVars == NULL )
+    {
+        FREE(refs);
+        return FALSE;
+    }
+    n = 0;
+    for (r = 0; r < RuleCount; r++)
+    {
+        for (p = Rules[r].firstPremise; p != NULL; p = p->next)
+        {
+            refs[n].var = p->lhsVar;
+            refs[n].index = &p->lhsIndex;
+            n++;
+            p->rhsIndex = -1;
+            if ( p->value == MISSING )
+            {
+                refs[n].var = p->rhsVar;
+                refs[n].index = &p->rhsIndex;
+                n++;
+            }
+        }
+    }
+
+    // --- sort the references so that those to the same variable are
+    //     adjacent and give each different variable an index
+    qsort(refs, n, sizeof(struct TVarRef), compareVarRefs);
+    RuleVarCount = 0;
+    for (k = 0; k < n; k++)
+    {
+        if ( k == 0 || compareVarRefs(&refs[k-1], &refs[k]) != 0 )
+        {
+            RuleVars[RuleVarCount].var = refs[k].var;
+            RuleVars[RuleVarCount].value = MISSING;
+            RuleVars[RuleVarCount].timed = isTimedVariable(&refs[k].var);
+            RuleVarCount++;
+        }
+        *(refs[k].index) = RuleVarCount - 1;
+    }
+    FREE(refs);
+    return TRUE;
+}
+
+//=============================================================================
+
+int indexRules()
+//
+//  Input:   none
+//  Output:  returns FALSE if memory runs out
+//  Purpose: lists the rules that watch each premise variable and the rules
+//           whose premises watch time-varying variables.
+//
+//  Rules with curve or PID actions are evaluated on every time step. If
+//  such a rule's first premise can have a missing value, its actions may
+//  use the controller value left by the rule before it, so all rules are
+//  then evaluated on every step.
+//
+{
+    int    r, k, i, pass;
+    int    hasTimed, leaky = FALSE;
+    int*   lastRule;
+    struct TPremise* p;
+
+    RuleVarStart = (int *) calloc(RuleVarCount + 1, sizeof(int));
+    TimedRules = (int *) calloc(RuleCount, sizeof(int));
+    lastRule = (int *) calloc(MAX(RuleVarCount, 1), sizeof(int));
+    if ( RuleVarStart == NULL || TimedRules == NULL || lastRule == NULL )
+    {
+        FREE(lastRule);
+        return FALSE;
+    }
+
+    // --- see if a modulated rule can leave the controller value unchanged
+    for (r = 0; r < RuleCount; r++)
+    {
+        if ( !hasModulatedAction(r) ) continue;
+        p = Rules[r].firstPremise;
+        if ( p == NULL || canBeMissing(&p->lhsVar) ||
+             (p->value == MISSING && canBeMissing(&p->rhsVar)) ) leaky = TRUE;
+    }
+
+    // --- classify each rule
+    for (r = 0; r < RuleCount; r++)
+    {
+        hasTimed = FALSE;
+        Rules[r].alwaysEval = leaky || hasModulatedAction(r);
+        for (p = Rules[r].firstPremise; p != NULL; p = p->next)
+        {
+            p->timed = RuleVars[p->lhsIndex].timed;
+            if ( p->rhsIndex >= 0 && RuleVars[p->rhsIndex].timed )
+                p->timed = TRUE;
+            if ( p->timed ) hasTimed = TRUE;
+        }
+        if ( hasTimed && !Rules[r].alwaysEval )
+            TimedRules[TimedRuleCount++] = r;
+    }
+
+    // --- list the rules that watch each variable whose value changes
+    //     only when the system's state does (counting them on the first
+    //     pass and listing them on the second)
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (k = 0; k < RuleVarCount; k++) lastRule[k] = -1;
+        for (r = 0; r < RuleCount; r++)
+        {
+            if ( Rules[r].alwaysEval ) continue;
+            for (p = Rules[r].firstPremise; p != NULL; p = p->next)
+            {
+                for (i = 0; i < 2; i++)
+                {
+                    k = (i == 0) ? p->lhsIndex : p->rhsIndex;
+                    if ( k < 0 || RuleVars[k].timed || lastRule[k] == r )
+                        continue;
+                    lastRule[k] = r;
+                    if ( pass == 0 ) RuleVarStart[k+1]++;
+                    else RuleVarRules[RuleVarStart[k]++] = r;
+                }
+            }
+        }
+        if ( pass == 0 )
+        {
+            for (k = 0; k < RuleVarCount; k++)
+                RuleVarStart[k+1] += RuleVarStart[k];
+            RuleVarRules = (int *) calloc(MAX(RuleVarStart[RuleVarCount], 1),
+                           sizeof(int));
+            if ( RuleVarRules == NULL )
+            {
+                FREE(lastRule);
+                return FALSE;
+            }
+        }
+    }
+
+    // --- listing the rules advanced each variable's start to the start
+    //     of the next variable, so shift the starts back
+    for (k = RuleVarCount; k > 0; k--) RuleVarStart[k] = RuleVarStart[k-1];
+    RuleVarStart[0] = 0;
+    FREE(lastRule);
+    return TRUE;
+}
+
+//=============================================================================
+
+int compareVarRefs(const void* a, const void* b)
+//
+//  Input:   a, b = pointers to two premise variable references
+//  Output:  returns -1, 0 or 1 as a's variable is ordered before, the same
+//           as, or after b's variable
+//  Purpose: orders premise variables by attribute, node and link.
+//
+{
+    const struct TVariable* v1 = &((const struct TVarRef *)a)->var;
+    const struct TVariable* v2 = &((const struct TVarRef *)b)->var;
+
+    if ( v1->attribute != v2->attribute )
+        return (v1->attribute < v2->attribute) ? -1 : 1;
+    if ( v1->node != v2->node ) return (v1->node < v2->node) ? -1 : 1;
+    if ( v1->link != v2->link ) return (v1->link < v2->link) ? -1 : 1;
+    return 0;
+}
+
+//=============================================================================
+
+int hasModulatedAction(int r)
+//
+//  Input:   r = control rule index
+//  Output:  returns TRUE if the rule has a curve or PID action
+//
+{
+    struct TAction* a;
+
+    for (a = Rules[r].thenActions; a != NULL; a = a->next)
+    {
+        if ( a->curve >= 0 || a->attribute == r_PID ) return TRUE;
+    }
+    for (a = Rules[r].elseActions; a != NULL; a = a->next)
+    {
+        if ( a->curve >= 0 || a->attribute == r_PID ) return TRUE;
+    }
+    return FALSE;
+}
+
+//=============================================================================
+
+int canBeMissing(struct TVariable* v)
+//
+//  Input:   v = a premise variable
+//  Output:  returns TRUE if getVariableValue can return MISSING for v
+//
+{
+    int i = v->node;
+    int j = v->link;
+
+    switch ( v->attribute )
+    {
+      case r_TIME:
+      case r_DATE:
+      case r_CLOCKTIME:
+      case r_DAY:
+      case r_MONTH:
+      case r_DAYOFYEAR: return FALSE;
+      case r_STATUS:
+        return ( j < 0 || (Link[j].type != CONDUIT && Link[j].type != PUMP) );
+      case r_SETTING:
+        return ( j < 0 || (Link[j].type != ORIFICE && Link[j].type != WEIR) );
+      case r_FLOW:      return ( j < 0 );
+      case r_DEPTH:     return ( j < 0 && i < 0 );
+      case r_HEAD:
+      case r_VOLUME:
+      case r_INFLOW:    return ( i < 0 );
+      default:          return TRUE;
+    }
+}
+
+//=============================================================================
+
+int isTimedVariable(struct TVariable* v)
+//
+//  Input:   v = a premise variable
+//  Output:  returns TRUE if the variable's value changes with time alone
+//
+{
+    switch ( v->attribute )
+    {
+      case r_TIME:
+      case r_CLOCKTIME:
+      case r_TIMEOPEN:
+      case r_TIMECLOSED: return TRUE;
+      default:           return FALSE;
+    }
+}
+
+//=============================================================================
+
+void updateRuleVars()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: finds the current value of each premise variable and marks the
+//           rules watching a variable whose value has changed.
+//
+{
+    int    k, m;
+    double value;
+
+    for (k = 0; k < RuleVarCount; k++)
+    {
+        value = getVariableValue(RuleVars[k].var);
+        if ( value != RuleVars[k].value )
+        {
+            for (m = RuleVarStart[k]; m < RuleVarStart[k+1]; m++)
+                Rules[RuleVarRules[m]].changed = TRUE;
+        }
+        RuleVars[k].value = value;
+    }
+}
+
+//=============================================================================
+
+void checkTimedRules(double tStep)
+//
+//  Input:   tStep = simulation time step (days)
+//  Output:  none
+//  Purpose: marks the rules for which the outcome of a premise on a
+//           time-varying variable has changed (i.e., a time threshold
+//           was crossed).
+//
+{
+    int    k, r, result;
+    struct TPremise* p;
+
+    for (k = 0; k < TimedRuleCount; k++)
+    {
+        r = TimedRules[k];
+        for (p = Rules[r].firstPremise; p != NULL; p = p->next)
+        {
+            if ( !p->timed ) continue;
+            result = evaluatePremise(p, tStep);
+            if ( result != p->lastResult ) Rules[r].changed = TRUE;
+            p->lastResult = result;
+        }
+    }
+}
+
+//=============================================================================
+
+int evaluateRule(int r, double tStep)
+//
+//  Input:   r = control rule index
+//           tStep = simulation time step (days)
+//  Output:  returns TRUE if the rule's premises are satisfied
+//  Purpose: evaluates the premises of a control rule.
+//
+{
+    int    result = TRUE;
+    struct TPremise* p = Rules[r].firstPremise;
+
+    while (p)
+    {
+        if ( p->type == r_OR )
+        {
+            if ( result == FALSE )
+                result = evaluatePremise(p, tStep);
+        }
+        else
+        {
+            if ( result == FALSE ) break;
+            result = evaluatePremise(p, tStep);
+        }
+        p = p->next;
+    }
+    return result;
+}
+
+//=============================================================================
+
 //  This function was revised to add support for r.h.s. premise variables. //  //(5.1.008)
 
 int  addPremise(int r, int type, char* tok[], int nToks)
@@ -413,6 +945,10 @@ int  addPremise(int r, int type, char* tok[], int nToks)
     p->rhsVar    = v2;
     p->relation  = relation;
     p->value     = value;
+    p->lhsIndex  = -1;
+    p->rhsIndex  = -1;
+    p->timed     = FALSE;
+    p->lastResult = FALSE;
     p->next      = NULL;
     if ( Rules[r].firstPremise == NULL )
     {
@@ -888,32 +1424,32 @@ void updateActionList(struct TAction* a)
 //
 {
     struct TActionList* listItem;
-    struct TAction* a1;
     double priority = Rules[a->rule].priority;
 
     // --- check if link referred to in action is already listed
-    listItem = ActionList;
-    while ( listItem )
+    listItem = LinkActions[a->link];
+    if ( listItem )
     {
-        a1 = listItem->action;
-        if ( !a1 ) break;
-        if ( a1->link == a->link )
+        // --- replace old action if new action has higher priority
+        if ( priority > Rules[listItem->action->rule].priority )
         {
-            // --- replace old action if new action has higher priority
-            if ( priority > Rules[a1->rule].priority ) listItem->action = a;
-            return;
+            listItem->action = a;
         }
-        listItem = listItem->next;
+        return;
     }
 
     // --- action not listed so add it to ActionList
-    if ( !listItem )
+    //     (re-using the first item not yet used on this time step)
+    listItem = NextActionItem;
+    if ( listItem ) NextActionItem = listItem->next;
+    else
     {
         listItem = (struct TActionList *) malloc(sizeof(struct TActionList));
         listItem->next = ActionList;
         ActionList = listItem;
     }
     listItem->action = a;
+    LinkActions[a->link] = listItem;
 }
 
 //=============================================================================
@@ -968,9 +1504,13 @@ int evaluatePremise(struct TPremise* p, double tStep)
     double lhsValue, rhsValue;
     int    result = FALSE;
 
-    lhsValue = getVariableValue(p->lhsVar);
-    if ( p->value == MISSING ) rhsValue = getVariableValue(p->rhsVar);
-    else                       rhsValue = p->value;
+    // --- variable values were found at the start of the time step
+    //     if the rules have been indexed
+    if ( RuleVars ) lhsValue = RuleVars[p->lhsIndex].value;
+    else            lhsValue = getVariableValue(p->lhsVar);
+    if ( p->value != MISSING ) rhsValue = p->value;
+    else if ( RuleVars )       rhsValue = RuleVars[p->rhsIndex].value;
+    else                       rhsValue = getVariableValue(p->rhsVar);
     if ( lhsValue == MISSING || rhsValue == MISSING ) return FALSE;
     switch (p->lhsVar.attribute)
     {
@@ -1125,9 +1665,12 @@ void clearActionList(void)
     listItem = ActionList;
     while ( listItem )
     {
+        if ( listItem->action && LinkActions )
+            LinkActions[listItem->action->link] = NULL;
         listItem->action = NULL;
         listItem = listItem->next;
     }
+    NextActionItem = ActionList;
 }
 
 //=============================================================================
@@ -1149,6 +1692,7 @@ void  deleteActionList(void)
         listItem = nextItem;
     }
     ActionList = NULL;
+    NextActionItem = NULL;
 }
 
 //=============================================================================
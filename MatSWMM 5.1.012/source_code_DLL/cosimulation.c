@@ -25,9 +25,6 @@
 //  Imported variables
 //-----------------------------------------------------------------------------
 #define REAL4 float
-extern REAL4* SubcatchResults;         // Results vectors defined in OUTPUT.C
-extern REAL4* NodeResults;             //  "
-extern REAL4* LinkResults;             //  "
 
 /****************************************************************************
  *
@@ -86,7 +83,7 @@ int c_saveResults()
 	for ( j = 0; j < Nobjects[LINK]; j++ ) {
 		/* File path writing */
 		strcpy(path, "Links/");
-		strcat(path, Link[j].ID);
+		strcat(path, Link[LinkOrder[j]].ID);
 		strcat(path, extention);
 
 		temporal = fopen(path, "w");
@@ -105,7 +102,7 @@ int c_saveResults()
 	for ( j = 0; j < Nobjects[NODE]; j++ ) {
 		/* File path writing */
 		strcpy(path, "Nodes/");
-		strcat(path, Node[j].ID);
+		strcat(path, Node[NodeOrder[j]].ID);
 		strcat(path, extention);
 
 		temporal = fopen(path, "w");
@@ -124,90 +121,248 @@ int c_saveResults()
 }
 
 /*
- * Inputs: id        (str) -> ID of the object whose attribute is going to be retrieved.
-   	       attribute (int) -> Attribute that needs to be known.
- 		   units     (int) -> Unit system that must be used to calculate the attribute (SI/US).
- * Output: Value of the attribute (double) - If the attribute or the type are incoherent return negative value.
-		   Returns error code if there is an error.
- * Purpose: Retrieves information of a specific object.
- * Notes: [IT MUST BE USED WHILE A SIMULATION IS RUNNING]
+ * Inputs: path (str) -> Path of the file that is going to be written.
+ * Purpose: Save the results at the end of the simulation of all the objects
+ 	in a single binary file, with one contiguous block of floats per variable
+ 	(all the periods of the first object, then all the periods of the next
+ 	one, and so on). The file is written in one sequential pass over the
+ 	binary output file, and it can be memory-mapped by the MatSWMM readers.
+ * Outputs: Returns error code if there is an error, 0 otherwise.
+ * Notes: [IT MUST BE USED AFTER swmm_end AND BEFORE swmm_close]
  */
-double c_get( char* id, int attribute, int units )
+int c_saveResultsColumns(char* path)
+{
+	return output_exportColumns(path);
+}
+
+/*
+ * Inputs: type      (int)    -> Type of the object (NODE, LINK or SUBCATCH).
+ 		   j         (int)    -> Index of the object.
+   	       attribute (int)    -> Attribute that needs to be known.
+ 		   units     (int)    -> Unit system that must be used to calculate the attribute (SI/US).
+ 		   value     (double*)-> Value of the attribute.
+ * Output: Returns error code if the attribute or the type are incoherent, 0 otherwise.
+ * Purpose: Retrieves information of an object whose index is already known.
+ */
+static int c_get_value(int type, int j, int attribute, int units, double* value)
+{
+	switch(type)
+	{
+		case NODE:
+			switch(attribute)
+			{
+				case C_DEPTH:
+					if (units == SI) *value = FTTOM(Node[j].newDepth);
+					else *value = Node[j].newDepth;
+					return 0;
+				case C_INFLOW:
+					if (units == SI) *value = CFTOCM(Node[j].inflow);
+					else *value = Node[j].inflow;
+					return 0;
+				case C_VOLUME:
+					if (units == SI) *value = CFTOCM(Node[j].newVolume);
+					else *value = Node[j].newVolume;
+					return 0;
+				case C_FLOODING:
+					if (units == SI) *value = CFTOCM(Node[j].overflow);
+					else *value = Node[j].overflow;
+					return 0;
+				default: return C_ERROR_ATR; /* Attribute not compatible */
+			}
+		case LINK:
+			switch(attribute)
+			{
+				case C_FLOW:
+					if (units == SI) *value = CFTOCM(Link[j].newFlow);
+					else *value = Link[j].newFlow;
+					return 0;
+				case C_DEPTH:
+					if (units == SI) *value = FTTOM(Link[j].newDepth);
+					else *value = Link[j].newDepth;
+					return 0;
+				case C_VOLUME:
+					if (units == SI) *value = CFTOCM(Link[j].newVolume);
+					else *value = Link[j].newVolume;
+					return 0;
+				case C_FROUDE: *value = Link[j].froude; return 0;
+				case C_SETTING: *value = Link[j].setting; return 0;
+				case C_LINK_AREA:
+					if (units == SI) *value = FT2TOM2(Link[j].xsect.aFull);
+					else *value = Link[j].xsect.aFull;
+					return 0;
+				default: return C_ERROR_ATR; /* Attribute not compatible */
+			}
+		case SUBCATCH:
+			switch(attribute)
+			{
+				case C_PRECIPITATION:
+					if (units == SI) *value = FTPERSTOMMPERHR(Subcatch[j].rainfall);
+					else *value = Subcatch[j].rainfall;
+					return 0;
+				case C_RUNOFF:
+					if (units == SI) *value = CFTOCM(Subcatch[j].newRunoff);
+					else *value = Subcatch[j].newRunoff;
+					return 0;
+				default: return C_ERROR_ATR; /* Attribute not compatible */
+			}
+		default: return C_ERROR_TYPE; /* Type of object not compatible */
+	}
+}
+
+/*
+ * Inputs: type (int) -> Type of the object (NODE, LINK or SUBCATCH).
+ 		   j    (int) -> Index of the object.
+ * Output: Index of the object seen by the cosimulation functions (int).
+ * Purpose: Nodes and links may be renumbered after the project is read (see renumber.c);
+ 			the cosimulation functions keep indexing them in the order of the input file.
+ */
+static int c_input_index(int type, int j)
+{
+	if ( type == NODE ) return NodePosition[j];
+	if ( type == LINK ) return LinkPosition[j];
+	return j;
+}
+
+/*
+ * Inputs: type (int) -> Type of the object (NODE, LINK or SUBCATCH).
+ 		   k    (int) -> Index of the object seen by the cosimulation functions.
+ * Output: Index of the object (int).
+ * Purpose: Inverse of c_input_index.
+ */
+static int c_object_index(int type, int k)
 {
-	int j, i, type;
+	if ( type == NODE ) return NodeOrder[k];
+	if ( type == LINK ) return LinkOrder[k];
+	return k;
+}
+
+/*
+ * Inputs: id          (str)  -> ID of the object whose index is going to be retrieved.
+ 		   object_type (int*) -> Type of the object (NODE, LINK or SUBCATCH). Any other
+ 		                         value means that the type is unknown; in that case the
+ 		                         object is sought among nodes, links and subcatchments
+ 		                         (in that order) and the type found is returned here.
+ * Output: Index of the object (int) - Returns error code if the object was not found.
+ * Purpose: Resolves the ID of an object into the index used by c_get_many, so that
+ 			the hash tables are only searched once per object.
+ */
+int c_get_index(char* id, int* object_type)
+{
+	int j, i;
 	int object_types[] = {NODE, LINK, SUBCATCH};
 	int len = sizeof(object_types)/sizeof(object_types[0]);
 
-	// Defines the type of the object and looks for the object
+	// The type is known: only its hash table is searched
 	for(i=0; i<len; i++)
 	{
-		j = project_findObject(object_types[i], id); // Index for the object being sought in the hash table.
-		if( j>=0 )
+		if( *object_type == object_types[i] )
 		{
-			type = object_types[i];
-			break;
+			j = project_findObject(*object_type, id);
+			if( j < 0 ) return C_ERROR_NFOUND; /*Object not found*/
+			return c_input_index(*object_type, j);
 		}
 	}
 
-	// Do if the object was found
-	if( j >= 0 )
+	// Defines the type of the object and looks for the object
+	for(i=0; i<len; i++)
 	{
-		switch(type)
+		j = project_findObject(object_types[i], id); // Index for the object being sought in the hash table.
+		if( j>=0 )
 		{
-			case NODE:
-				switch(attribute)
-				{
-					case C_DEPTH:
-						if (units == SI) return FTTOM(Node[j].newDepth);
-						else return Node[j].newDepth;
-					case C_INFLOW:
-						if (units == SI) return CFTOCM(Node[j].inflow);
-						else return Node[j].inflow;
-					case C_VOLUME:
-						if (units == SI) return CFTOCM(Node[j].newVolume);
-						else return Node[j].newVolume;
-					case C_FLOODING:
-						if (units == SI) return CFTOCM(Node[j].overflow);
-						else return Node[j].overflow;
-					default: return C_ERROR_ATR; /* Attribute not compatible */
-				}
-			case LINK:
-				switch(attribute)
-				{
-					case C_FLOW:
-						if (units == SI) return CFTOCM(Link[j].newFlow);
-						else return Link[j].newFlow;
-					case C_DEPTH:
-						if (units == SI) return FTTOM(Link[j].newDepth);
-						else return Link[j].newDepth;
-					case C_VOLUME:
-						if (units == SI) return CFTOCM(Link[j].newVolume);
-						else return Link[j].newVolume;
-					case C_FROUDE: return Link[j].froude;
-					case C_SETTING: return Link[j].setting;
-					case C_LINK_AREA:
-						if (units == SI) return FT2TOM2(Link[j].xsect.aFull);
-						else return Link[j].xsect.aFull;
-					default: return C_ERROR_ATR; /* Attribute not compatible */
-				}
-			case SUBCATCH:
-				switch(attribute)
-				{
-					case C_PRECIPITATION:
-						if (units == SI) return FTPERSTOMMPERHR(Subcatch[j].rainfall);
-						else return Subcatch[j].rainfall;
-					case C_RUNOFF:
-						if (units == SI) return CFTOCM(Subcatch[j].newRunoff);
-						else return Subcatch[j].newRunoff;
-					default: return C_ERROR_ATR; /* Attribute not compatible */
-				}
-			default: return C_ERROR_TYPE; /* Type of object not compatible */
+			*object_type = object_types[i];
+			return c_input_index(*object_type, j);
 		}
 	}
 
 	return C_ERROR_NFOUND; /*Object not found*/
 }
 
+/*
+ * Inputs: id        (str) -> ID of the object whose attribute is going to be retrieved.
+   	       attribute (int) -> Attribute that needs to be known.
+ 		   units     (int) -> Unit system that must be used to calculate the attribute (SI/US).
+ * Output: Value of the attribute (double) - If the attribute or the type are incoherent return negative value.
+		   Returns error code if there is an error.
+ * Purpose: Retrieves information of a specific object.
+ * Notes: [IT MUST BE USED WHILE A SIMULATION IS RUNNING]
+ */
+double c_get( char* id, int attribute, int units )
+{
+	int j, error;
+	int type = -1;
+	double value;
+
+	j = c_get_index(id, &type);
+	if( j < 0 ) return j; /*Object not found*/
+
+	error = c_get_value(type, c_object_index(type, j), attribute, units, &value);
+	if( error ) return error;
+	return value;
+}
+
+/*
+ * Inputs: object_type (int)     -> Type of the objects (NODE, LINK or SUBCATCH).
+ 		   indices     (int*)    -> Indices of the objects, as returned by c_get_index.
+ 		   n           (int)     -> Number of objects.
+   	       attribute   (int)     -> Attribute that needs to be known.
+ 		   units       (int)     -> Unit system that must be used to calculate the attribute (SI/US).
+ 		   values      (double*) -> Array of n elements where the values are written.
+ * Output: Returns error code if there is an error, 0 otherwise.
+ * Purpose: Retrieves the same attribute of several objects of the same type in one call.
+ * Notes: [IT MUST BE USED WHILE A SIMULATION IS RUNNING]
+ */
+int c_get_many(int object_type, int* indices, int n, int attribute, int units, double* values)
+{
+	int i, error;
+
+	if ( object_type != NODE && object_type != LINK && object_type != SUBCATCH )
+		return C_ERROR_TYPE; /* Type of object not compatible */
+	if ( n < 0 || (n > 0 && (indices == NULL || values == NULL)) )
+		return C_ERROR_INCOHERENT;
+
+	for ( i = 0; i < n; i++ )
+	{
+		if ( indices[i] < 0 || indices[i] >= Nobjects[object_type] )
+			return C_ERROR_NFOUND; /* Invalid index */
+		error = c_get_value(object_type, c_object_index(object_type, indices[i]),
+		                    attribute, units, &values[i]);
+		if ( error ) return error;
+	}
+	return 0;
+}
+
+/*
+ * Inputs: n           (int)     -> Number of watched objects.
+ 		   types       (int*)    -> Type of each object (NODE, LINK or SUBCATCH).
+ 		   indices     (int*)    -> Index of each object, as returned by c_get_index.
+   	       attributes  (int*)    -> Attribute read from each object.
+ 		   units       (int)     -> Unit system that must be used to calculate the attributes (SI/US).
+ 		   values      (double*) -> Array of n elements where the values are written.
+ * Output: Returns error code if there is an error, 0 otherwise.
+ * Purpose: Retrieves one attribute of each of several objects of any type in one call.
+ * Notes: [IT MUST BE USED WHILE A SIMULATION IS RUNNING]
+ */
+int c_get_watched(int n, int* types, int* indices, int* attributes, int units, double* values)
+{
+	int i, error;
+
+	if ( n < 0 || (n > 0 && (types == NULL || indices == NULL ||
+	                         attributes == NULL || values == NULL)) )
+		return C_ERROR_INCOHERENT;
+
+	for ( i = 0; i < n; i++ )
+	{
+		if ( types[i] != NODE && types[i] != LINK && types[i] != SUBCATCH )
+			return C_ERROR_TYPE; /* Type of object not compatible */
+		if ( indices[i] < 0 || indices[i] >= Nobjects[types[i]] )
+			return C_ERROR_NFOUND; /* Invalid index */
+		error = c_get_value(types[i], c_object_index(types[i], indices[i]),
+		                    attributes[i], units, &values[i]);
+		if ( error ) return error;
+	}
+	return 0;
+}
+
 /*
  * Inputs:  input_file 	(str)    -> Path to the input file.
  			id 			(str)    -> ID of the object that is going to be changed.
@@ -286,6 +441,61 @@ int  c_modify_setting(char* id, double new_setting, double tstep)
 }
 
 
+/*
+ * Inputs:  indices     (int*)    -> Indices of the links, as returned by c_get_index.
+ 			new_settings(double*) -> New values of the settings, one per link.
+ 			n           (int)     -> Number of links.
+ 			tstep		(double)  -> Time in seconds over which settings are adjusted.
+ 									 0.0 means that orifices are adjusted automatically.
+ * Purpose: Modifies the settings of several control actuators (orifices, weirs,
+  			outlets and pumps) in one call. Every index and setting is validated
+  			before any of them is applied, so the control vector is applied either
+  			completely or not at all. Pump settings must be non-negative; the other
+  			actuators take a decimal percentage.
+ * Outputs: Returns error code if there is an error.
+ * Notes: 	[IT MUST BE USED WHILE A SIMULATION IS RUNNING]
+ * Time Complexity: O(n)
+ */
+int c_modify_settings(int* indices, double* new_settings, int n, double tstep)
+{
+	int i, j;
+
+	if ( n < 0 || (n > 0 && (indices == NULL || new_settings == NULL)) )
+		return C_ERROR_INCOHERENT;
+
+	// Validates the whole control vector
+	for ( i = 0; i < n; i++ )
+	{
+		j = indices[i];
+		if ( j < 0 || j >= Nobjects[LINK] )
+			return C_ERROR_NFOUND; /* Invalid index */
+		j = LinkOrder[j];
+		switch ( Link[j].type )
+		{
+			case PUMP:
+				if ( new_settings[i] < 0 ) return C_ERROR_INCOHERENT;
+				break;
+			case ORIFICE:
+			case WEIR:
+			case OUTLET:
+				if ( (new_settings[i] < 0) || (new_settings[i] > 1) )
+					return C_ERROR_INCOHERENT; /* Incoherent setting value */
+				break;
+			default: return C_ERROR_TYPE; /* Link is not a control actuator */
+		}
+	}
+
+	// Applies it
+	for ( i = 0; i < n; i++ )
+	{
+		j = LinkOrder[indices[i]];
+		Link[j].targetSetting = new_settings[i];
+		link_setSetting(j, tstep);
+	}
+
+	return 0; /* Success */
+}
+
 /*
  * Inputs:  input_file 	(str)    -> Path to the input file.
  			id 			(str)    -> ID of the object that is going to be changed.
@@ -96,14 +96,19 @@ typedef struct
 
 // Getters
 double c_get( char* id, int attribute, int units );
+int c_get_index(char* id, int* object_type);
+int c_get_many(int object_type, int* indices, int n, int attribute, int units, double* values);
+int c_get_watched(int n, int* types, int* indices, int* attributes, int units, double* values);
 double c_get_from_input(char* input_file, char *id, int attribute);
 int c_look4all(char* input_file, int object_type, int attribute);
 // Setters
 int  c_modify_setting(char* id, double new_setting, double tstep);
+int c_modify_settings(int* indices, double* new_settings, int n, double tstep);
 int c_modify_input_value(char* filename, char *id, int attribute, double value);
 // Aux (parsers)
 int c_look4inputID(FILE** input_file, int* object_type, char* line, char* id);
 int c_get_key_column(InputInfo* new_i, int object_type, int attribute);
 int c_in_list(char** list, char* key);
 // Savers
-int c_saveResults();
\ No newline at end of file
+int c_saveResults();
+int c_saveResultsColumns(char* path);
\ No newline at end of file
@@ -18,6 +18,10 @@
 //
 //   Build 5.1.012:
 //   - Modified uniform loss rate term of conduit momentum equation.
+//
+//   When the XSECT_TABLES option is used, flow areas, hydraulic radii and
+//   top widths are interpolated from each conduit's geometry table (see
+//   xsect_getTableValues) instead of being computed for its shape.
 //-----------------------------------------------------------------------------
 #define _CRT_SECURE_NO_DEPRECATE
 
@@ -75,6 +79,8 @@ void  dwflow_findConduitFlow(int j, int steps, double omega, double dt)
     double denom;                      // denominator of flow update formula
     double q;                          // new flow value (cfs)
     double barrels;                    // number of barrels in conduit
+    double yTbl[3];                    // depths looked up in geometry table
+    double gTbl[3*XT_COLUMNS];         // geometry values at these depths
     TXsect* xsect = &Link[j].xsect;    // ptr. to conduit's cross section data
     char   isFull = FALSE;             // TRUE if conduit flowing full
     char   isClosed = FALSE;           // TRUE if conduit closed
@@ -122,15 +128,32 @@ void  dwflow_findConduitFlow(int j, int steps, double omega, double dt)
     //     based on previous iteration's flow estimate
     findSurfArea(j, qLast, length, &h1, &h2, &y1, &y2);
 
-    // --- compute area at each end of conduit & hyd. radius at upstream end
-    a1 = getArea(xsect, y1);
-    a2 = getArea(xsect, y2);
-    r1 = getHydRad(xsect, y1);
-
-    // --- compute area & hyd. radius at midpoint
+    // --- compute area & hyd. radius at each end of conduit and at
+    //     its midpoint with a single look up of its geometry table
     yMid = 0.5 * (y1 + y2);
-    aMid = getArea(xsect, yMid);
-    rMid = getHydRad(xsect, yMid);
+    if ( xsect->geomTbl )
+    {
+        yTbl[0] = MIN(y1, xsect->yFull);
+        yTbl[1] = MIN(y2, xsect->yFull);
+        yTbl[2] = MIN(yMid, xsect->yFull);
+        xsect_getTableValues(xsect, 3, yTbl, gTbl);
+        a1 = gTbl[XT_AREA];
+        r1 = gTbl[XT_HRAD];
+        a2 = gTbl[XT_COLUMNS + XT_AREA];
+        aMid = gTbl[2*XT_COLUMNS + XT_AREA];
+        rMid = gTbl[2*XT_COLUMNS + XT_HRAD];
+    }
+    else
+    {
+        // --- compute area at each end of conduit & hyd. radius at upstream end
+        a1 = getArea(xsect, y1);
+        a2 = getArea(xsect, y2);
+        r1 = getHydRad(xsect, y1);
+
+        // --- compute area & hyd. radius at midpoint
+        aMid = getArea(xsect, yMid);
+        rMid = getHydRad(xsect, yMid);
+    }
 
     // --- alternate approach not currently used, but might produce better
     //     Bernoulli energy balance for steady flows
@@ -556,8 +579,14 @@ double getWidth(TXsect* xsect, double y)
 //
 {
     double yNorm = y/xsect->yFull;
+    double g[XT_COLUMNS];
     if ( yNorm > 0.96 &&
          !xsect_isOpen(xsect->type) ) y = 0.96*xsect->yFull;
+    if ( xsect->geomTbl )
+    {
+        xsect_getTableValues(xsect, 1, &y, g);
+        return g[XT_WIDTH];
+    }
     return xsect_getWofY(xsect, y);
 }
 
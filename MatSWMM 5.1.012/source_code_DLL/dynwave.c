@@ -19,6 +19,61 @@
 //   to solve the explicit form of the continuity and momentum equations
 //   for conduits.
 //
+//   Alternatively (DYNWAVE_METHOD NEWTON option, still experimental) each
+//   iteration updates all node depths at once by solving the linearized
+//   nodal continuity equations, whose coefficients come from the dqdh
+//   terms of the links attached to each node. Flooded nodes are held at
+//   their maximum depth, and nodes that are dry or about to run dry change
+//   depth as in a Picard iteration. If the equations cannot be factored
+//   reliably the rest of the time step uses Picard iterations. On the
+//   networks tried so far Newton iterations leave fewer time steps
+//   unconverged but do not run faster than Picard iterations, since they
+//   skip fewer converged links and each one may factor a sparse matrix.
+//   The DYNWAVE_METHOD ANDERSON option adds Anderson acceleration to the
+//   under-relaxed Picard iterations: each new set of (non-surcharged)
+//   node depths is the combination of the last few iterates that best
+//   cancels the change between iterations. The sequence of iterates is
+//   restarted whenever that change grows.
+//
+//   With the DYNWAVE_PREDICTOR option the iterations of a time step start
+//   from node depths and conduit flows extrapolated (linearly or
+//   quadratically) from the last time steps instead of from the last
+//   solution, and may converge after a single iteration. If the first
+//   iteration moves further from the predicted state than from the last
+//   one the prediction is discarded and the iterations start over from
+//   the last solution. No prediction follows a time step that did not
+//   converge.
+//
+//   With the STEP_CLASSES option (and a variable time step) nodes and links
+//   are not all advanced with the network's smallest stable time step.
+//   Each one is placed in the class whose step (the routing step divided
+//   by 1, 2, 4, ...) satisfies its own Courant limit, and the routing step
+//   grows accordingly. A routing step is then made of substeps of the
+//   finest class in use; an object is updated only on the substep that
+//   ends its own step, while the flows of links not being updated are
+//   held at their last values. A node's class is never coarser than that
+//   of the links attached to it, so all classes meet at the end of each
+//   coarser step, where the nodes there take up the links' new flows.
+//   Non-conduit links and links attached to surcharged nodes share the
+//   class of their end nodes. A routing step counts as not converging if
+//   any of its substeps does not, so the report also lists the iterations
+//   & convergence of the substeps and of the steps taken by each class.
+//   Surcharged nodes have no stability limit of their own and usually fall
+//   in the coarsest class, whose steps are several times the single class
+//   step and so fail to converge more often than the finer classes' steps.
+//
+//   With the ACTIVE_SET_TOL option, nodes and conduits whose state is not
+//   changing are left out of the routing computations and keep their last
+//   state. A node or conduit is routed on a time step only if its own
+//   volume, flow or lateral inflow, or that of a neighbour, changed by more
+//   than the tolerance on the previous step, so that a disturbance wakes
+//   up the network one node at a time, moving both up and downstream.
+//   A skipped node is routed again once the volume change it has missed
+//   adds up to more than one step's worth of the tolerance. Outfalls,
+//   surcharged or flooded nodes and the end nodes of non-conduit links are
+//   always routed. The share of nodes & links routed over time is listed
+//   in the report's routing time step summary.
+//
 //   Build 5.1.002:
 //   - Only non-ponded nodal surface area is saved for use in
 //     surcharge algorithm.
@@ -42,6 +97,7 @@
 #define _CRT_SECURE_NO_DEPRECATE
 
 #include "headers.h"
+#include "linsolve.h"
 #include <malloc.h>
 #include <math.h>
 #include <omp.h>                                                               //(5.1.008)
@@ -51,6 +107,8 @@
 //-----------------------------------------------------------------------------
 static const double MINTIMESTEP =  0.001;   // min. time step (sec)            //(5.1.008)
 static const double OMEGA       =  0.5;     // under-relaxation parameter
+static const int    ANDERSON_DEPTH = 3;     // iterates combined by Anderson
+                                            //   acceleration (max. 4)
 
 //  Constants moved here from project.c  //                                    //(5.1.008)
 const double DEFAULT_SURFAREA  = 12.566; // Min. nodal surface area (~4 ft diam.)
@@ -61,31 +119,169 @@ const int    DEFAULT_MAXTRIALS = 8;      // Max. trials per time step
 //-----------------------------------------------------------------------------
 //  Data Structures
 //-----------------------------------------------------------------------------
-typedef struct 
+typedef struct TXnode
 {
-    char    converged;                 // TRUE if iterations for a node done
     double  newSurfArea;               // current surface area (ft2)
     double  oldSurfArea;               // previous surface area (ft2)
-    double  sumdqdh;                   // sum of dqdh from adjoining links
     double  dYdT;                      // change in depth w.r.t. time (ft/sec)
 } TXnode;
 
+typedef struct THotState               // node & link state used on every
+{                                      //   iteration, one array per variable
+    double* newDepth;                  // node depth (ft)
+    double* sumdqdh;                   // sum of dqdh from adjoining links
+    char*   converged;                 // TRUE if iterations for a node done
+    double* newFlow;                   // link flow (cfs)
+    double* dqdh;                      // change in flow w.r.t. head (ft2/sec)
+    double* surfArea1;                 // surf. area of all barrels at link's
+    double* surfArea2;                 //   upstream & downstream ends (ft2)
+    double* lossRate;                  // conduit evap. + seepage loss (cfs)
+    char*   bypassed;                  // TRUE if link's flow not recomputed
+} THotState;
+
+typedef struct TNewton                 // linearized nodal continuity equations
+{
+    TSparseMatrix jacobian;            // coeffs. of node depth changes
+    int*    diag;                      // position of each node's own coeff.
+    int*    pos1;                      // position of each link's coeff. in
+                                       //   the row of its upstream node
+    int*    pos2;                      //   and of its downstream node
+    double* weight;                    // weight of flow terms in each row
+    double* rhs;                       // continuity error at each node (cfs)
+    double* step;                      // change in each node depth (ft)
+    double* lastStep;                  // change found by last iteration (ft)
+    double* damping;                   // fraction of change applied
+    char*   flooded;                   // TRUE if node held at max. depth
+    char*   dry;                       // TRUE if node's change is found as
+                                       //   in a Picard iteration
+    int     picard;                    // TRUE if Picard iterations are used
+                                       //   for the rest of the time step
+} TNewton;
+
+typedef struct TMultirate              // time step classes of nodes & links
+{
+    int     substeps;                  // substeps in current routing step
+    char*   nodeClass;                 // time step class of each node
+    char*   linkClass;                 // time step class of each link
+    char*   nodeActive;                // TRUE if node updated in substep
+    char*   linkActive;                // TRUE if link updated in substep
+    int*    adjStart;                  // start of each node's entries in adjLinks
+    int*    adjLinks;                  // all links attached to each node
+    int*    stack;                     // nodes whose class was raised
+    double* nodeLimit;                 // stable time step of each node (sec)
+    double* linkLimit;                 // stable time step of each link (sec)
+    double* oldDepth;                  // node depth at start of routing step (ft)
+    double* oldVolume;                 // node volume at start of step (ft3)
+    double* oldNetInflow;              // node net inflow at start of step (cfs)
+    double* oldFlow;                   // link flow at start of step (cfs)
+} TMultirate;
+
+typedef struct TActiveSet              // nodes & links routed on each step
+{
+    char*   nodeIdle;                  // TRUE if node skipped on this step
+    char*   nodeFixed;                 // TRUE if node is never skipped
+    char*   nodeChanged;               // TRUE if node changed on last step
+    char*   linkChanged;               // TRUE if link changed on last step
+    char*   linkIdle;                  // TRUE if link skipped on this step
+    int     nodeCount;                 // number of nodes routed on this step
+    int     linkCount;                 // number of links routed on this step
+    int*    nodes;                     // nodes routed on this step
+    int*    links;                     // links routed on this step
+    double* refInflow;                 // lateral inflow - losses when node
+                                       //   was last routed (cfs)
+    double* drift;                     // volume change missed by a node
+                                       //   since it was last routed (ft3)
+} TActiveSet;
+
+typedef struct TPredictor              // past states used to start iterations
+{
+    int     count;                     // number of past states saved (0 - 2)
+    double  lastTime;                  // time of last saved state (msec)
+    double  dt1;                       // time between last two states (sec)
+    double  dt2;                       // time between the two before (sec)
+    double* depth1;                    // node depths one step back (ft)
+    double* depth2;                    // node depths two steps back (ft)
+    double* flow1;                     // link flows one step back (cfs)
+    double* flow2;                     // link flows two steps back (cfs)
+    double* guess;                     // predicted node depths (ft)
+} TPredictor;
+
+typedef struct TAnderson               // Anderson acceleration of node depths
+{
+    int     count;                     // number of differences saved
+    int     next;                      // slot for the next difference
+    double  lastNorm;                  // size of last change in depths
+                                       //   (< 0 before the first iterate)
+    double* x;                         // depths an iteration started from (ft)
+    double* f;                         // last change in depths (ft)
+    double* g;                         // last unaccelerated depths (ft)
+    double* dF;                        // differences between changes
+    double* dG;                        // differences between depths
+} TAnderson;
+
 //-----------------------------------------------------------------------------
 //  Shared Variables
 //-----------------------------------------------------------------------------
-static double  VariableStep;           // size of variable time step (sec)
-static TXnode* Xnode;                  // extended nodal information
+#define VariableStep (Project->VariableStep) // size of variable time step (sec)
+#define Xnode        (Project->Xnode)        // extended nodal information
+#define Hot          (Project->HotState)     // packed iteration state
 
-static double  Omega;                  // actual under-relaxation parameter
-static int     Steps;                  // number of Picard iterations
+#define Omega (Project->Omega) // actual under-relaxation parameter
+#define Steps (Project->Steps) // number of Picard iterations
+
+#define NodeLinkStart (Project->NodeLinkStart) // start of node's entries in NodeLinks
+#define NodeLinks     (Project->NodeLinks)     // conduit ends at each node
+#define Newton        (Project->Newton)        // Newton iteration equations
+#define Multirate     (Project->Multirate)     // time step classes
+#define ActiveSet     (Project->ActiveSet)     // nodes & links being routed
+#define Predictor     (Project->Predictor)     // past states of nodes & links
+#define Anderson      (Project->Anderson)      // Anderson acceleration
 
 //-----------------------------------------------------------------------------
 //  Function declarations
 //-----------------------------------------------------------------------------
 static void   initRoutingStep(void);
 static void   initNodeStates(void);
+static int    createNodeLinks(void);
+static int    createHotState(void);
+static void   freeHotState(void);
+static void   loadHotState(void);
+static void   storeHotState(void);
+static void   saveConduitState(int link);
 static void   findBypassedLinks();
 static void   findLimitedLinks();
+static int    createNewton(void);
+static void   freeNewton(void);
+static int    hasNewtonCoeff(int link);
+static int    createMultirate(void);
+static void   freeMultirate(void);
+static void   setStepClasses(double tStep);
+static int    getStepClass(double limit, double tStep, int maxClass);
+static int    isCouplingLink(int link);
+static void   initSubstep(int substep);
+static void   restoreOldState(void);
+static void   findFailedClasses(int classFailures[]);
+static double getNodeDt(int node, double tStep);
+static double getLinkDt(int link, double tStep);
+static int    createActiveSet(void);
+static void   freeActiveSet(void);
+static void   findActiveSet(double tStep);
+static void   updateActiveSet(double tStep);
+static int    isNodeSkipped(int node);
+static int    isLinkSkipped(int link);
+static int    getRoutedNodes(void);
+static int    getRoutedNode(int k);
+static int    getRoutedLinks(void);
+static int    getRoutedLink(int k);
+static int    createPredictor(void);
+static void   freePredictor(void);
+static int    predictState(double tStep);
+static int    checkPrediction(void);
+static void   savePastState(double tStep, int failed);
+static int    createAnderson(void);
+static void   freeAnderson(void);
+static void   accelerateDepths(double tStep);
+static int    solveNormalEqns(double a[][4], double b[], int n);
 
 static void   findLinkFlows(double dt);
 static int    isTrueConduit(int link);
@@ -93,8 +289,13 @@ static void   findNonConduitFlow(int link, double dt);
 static void   findNonConduitSurfArea(int link);
 static double getModPumpFlow(int link, double q, double dt);
 static void   updateNodeFlows(int link);
+static void   updateEndNodeFlows(int link, int end);
+static void   gatherNodeFlows(int node);
 
-static int    findNodeDepths(double dt);
+static void   findNodeDepths(double dt, int* converged);
+static void   findNewtonSteps(double tStep);
+static void   setNewtonEquation(int i, double dt);
+static int    isSurcharged(int node, int* canPond, int* isPonded);
 static void   setNodeDepth(int node, double dt);
 static double getFloodedDepth(int node, int canPond, double dV, double yNew,
               double yMax, double dt);
@@ -121,7 +322,7 @@ void dynwave_init()
     Xnode = (TXnode *) calloc(Nobjects[NODE], sizeof(TXnode));
 
 ////  Added to release 5.1.011.  ////                                          //(5.1.011)
-    if ( Xnode == NULL )
+    if ( Xnode == NULL || !createHotState() )
     {
         report_writeErrorMsg(ERR_MEMORY,
             " Not enough memory for dynamic wave routing.");
@@ -149,130 +350,1605 @@ void dynwave_init()
         Link[i].flowClass = DRY;
         Link[i].dqdh = 0.0;
     }
+
+    // --- build list of conduits incident to each node
+    if ( !createNodeLinks() )
+    {
+        report_writeErrorMsg(ERR_MEMORY,
+            " Not enough memory for dynamic wave routing.");
+        return;
+    }
+
+    // --- build equations solved by Newton iterations
+    if ( DynWaveMethod == NEWTON && !createNewton() )
+    {
+        report_writeErrorMsg(ERR_MEMORY,
+            " Not enough memory for dynamic wave routing.");
+        return;
+    }
+
+    // --- allocate time step classes
+    if ( StepClasses > 1 && !createMultirate() )
+    {
+        report_writeErrorMsg(ERR_MEMORY,
+            " Not enough memory for dynamic wave routing.");
+        return;
+    }
+
+    // --- allocate active set of nodes & links
+    if ( ActiveSetTol > 0.0 && !createActiveSet() )
+    {
+        report_writeErrorMsg(ERR_MEMORY,
+            " Not enough memory for dynamic wave routing.");
+        return;
+    }
+
+    // --- allocate past states & iterates used to speed up iterations
+    if ( (DynWavePredictor != NO_PREDICTOR && !createPredictor()) ||
+         (DynWaveMethod == ANDERSON && !createAnderson()) )
+    {
+        report_writeErrorMsg(ERR_MEMORY,
+            " Not enough memory for dynamic wave routing.");
+    }
+}
+
+//=============================================================================
+
+int createNodeLinks()
+//
+//  Input:   none
+//  Output:  returns FALSE if memory could not be allocated
+//  Purpose: builds a compressed list of the non-dummy conduit ends attached
+//           to each node, ordered by link index (upstream end first), which
+//           lets node flows be gathered in parallel in the same order as
+//           the serial link loop would accumulate them.
+//
+{
+    int i, n;
+    int nNodes = Nobjects[NODE];
+    int* next;
+
+    NodeLinkStart = (int *) calloc(nNodes + 1, sizeof(int));
+    NodeLinks = (int *) calloc(2 * Nobjects[LINK] + 1, sizeof(int));
+    next = (int *) calloc(nNodes + 1, sizeof(int));
+    if ( NodeLinkStart == NULL || NodeLinks == NULL || next == NULL )
+    {
+        FREE(next);
+        return FALSE;
+    }
+
+    // --- count conduit ends at each node
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        if ( !isTrueConduit(i) ) continue;
+        NodeLinkStart[Link[i].node1 + 1]++;
+        NodeLinkStart[Link[i].node2 + 1]++;
+    }
+    for (n = 0; n < nNodes; n++) NodeLinkStart[n+1] += NodeLinkStart[n];
+
+    // --- fill in entries in increasing link order
+    for (n = 0; n < nNodes; n++) next[n] = NodeLinkStart[n];
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        if ( !isTrueConduit(i) ) continue;
+        NodeLinks[next[Link[i].node1]++] = 2 * i;
+        NodeLinks[next[Link[i].node2]++] = 2 * i + 1;
+    }
+    free(next);
+    return TRUE;
+}
+
+//=============================================================================
+
+int createHotState()
+//
+//  Input:   none
+//  Output:  returns FALSE if memory could not be allocated
+//  Purpose: allocates the packed arrays of node & link state that the
+//           iterations of a time step work on.
+//
+{
+    int nNodes = Nobjects[NODE];
+    int nLinks = Nobjects[LINK];
+    double* x;
+    char*   c;
+
+    Hot = (THotState *) calloc(1, sizeof(THotState));
+    if ( Hot == NULL ) return FALSE;
+    x = (double *) calloc(2 * nNodes + 5 * nLinks + 1, sizeof(double));
+    c = (char *) calloc(nNodes + nLinks + 1, sizeof(char));
+    Hot->newDepth = x;
+    Hot->converged = c;
+    if ( x == NULL || c == NULL ) return FALSE;
+    Hot->sumdqdh   = x + nNodes;
+    Hot->newFlow   = x + 2 * nNodes;
+    Hot->dqdh      = x + 2 * nNodes + nLinks;
+    Hot->surfArea1 = x + 2 * nNodes + 2 * nLinks;
+    Hot->surfArea2 = x + 2 * nNodes + 3 * nLinks;
+    Hot->lossRate  = x + 2 * nNodes + 4 * nLinks;
+    Hot->bypassed  = c + nNodes;
+    return TRUE;
+}
+
+//=============================================================================
+
+void freeHotState()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: frees the packed arrays of node & link state.
+//
+{
+    if ( Hot == NULL ) return;
+    FREE(Hot->newDepth);
+    FREE(Hot->converged);
+    FREE(Hot);
+}
+
+//=============================================================================
+
+void loadHotState()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: copies the state of nodes & links at the start of a time step
+//           into the packed arrays.
+//
+{
+    int i;
+
+    for (i = 0; i < Nobjects[NODE]; i++)
+    {
+        Hot->newDepth[i] = Node[i].newDepth;
+        Hot->converged[i] = FALSE;
+    }
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        Hot->bypassed[i] = FALSE;
+        if ( isTrueConduit(i) ) saveConduitState(i);
+    }
+}
+
+//=============================================================================
+
+void storeHotState()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: copies the packed state of links found over a time step back
+//           to their records.
+//
+//  Node depths & volumes are saved to Node[] as soon as they are found,
+//  since the flows that link.c & dwflow.c compute on the same iteration
+//  (e.g., pumps drawing on a wet well) read them from there.
+//
+{
+    int i;
+    for (i = 0; i < Nobjects[LINK]; i++) Link[i].bypassed = Hot->bypassed[i];
+}
+
+//=============================================================================
+
+void saveConduitState(int i)
+//
+//  Input:   i = link index of a conduit
+//  Output:  none
+//  Purpose: copies the flow state of a conduit that is needed to update
+//           its end nodes into the packed arrays.
+//
+{
+    int k = Link[i].subIndex;
+
+    Hot->newFlow[i] = Link[i].newFlow;
+    Hot->dqdh[i] = Link[i].dqdh;
+    Hot->surfArea1[i] = Link[i].surfArea1 * Conduit[k].barrels;
+    Hot->surfArea2[i] = Link[i].surfArea2 * Conduit[k].barrels;
+    Hot->lossRate[i] = Conduit[k].evapLossRate + Conduit[k].seepLossRate;
+}
+
+//=============================================================================
+
+int createNewton()
+//
+//  Input:   none
+//  Output:  returns FALSE if memory could not be allocated
+//  Purpose: allocates the equations solved by Newton iterations and builds
+//           their sparsity pattern, with one row per node and a coefficient
+//           for each pair of nodes joined by a link.
+//
+{
+    int    i, j, k, m, n, c;
+    int    nNodes = Nobjects[NODE];
+    int    nLinks = Nobjects[LINK];
+    int    nEntries = nNodes;
+    int*   next;
+    double* x;
+    TSparseMatrix* a;
+
+    Newton = (TNewton *) calloc(1, sizeof(TNewton));
+    if ( Newton == NULL ) return FALSE;
+    Newton->diag = (int *) calloc(nNodes + 1, sizeof(int));
+    Newton->pos1 = (int *) calloc(nLinks + 1, sizeof(int));
+    Newton->pos2 = (int *) calloc(nLinks + 1, sizeof(int));
+    Newton->flooded = (char *) calloc(2 * nNodes + 1, sizeof(char));
+    x = (double *) calloc(5 * nNodes + 1, sizeof(double));
+    if ( !Newton->diag || !Newton->pos1 || !Newton->pos2 ||
+         !Newton->flooded || !x )
+    {
+        FREE(x);
+        return FALSE;
+    }
+    Newton->dry = Newton->flooded + nNodes;
+    Newton->weight = x;
+    Newton->rhs    = x + nNodes;
+    Newton->step   = x + 2 * nNodes;
+    Newton->lastStep = x + 3 * nNodes;
+    Newton->damping  = x + 4 * nNodes;
+
+    // --- allocate room for each node's diagonal plus one coeff. per link end
+    for (i = 0; i < nLinks; i++) if ( hasNewtonCoeff(i) ) nEntries += 2;
+    a = &Newton->jacobian;
+    if ( !linsolve_open(a, nNodes, nEntries) ) return FALSE;
+    next = (int *) calloc(nNodes + 1, sizeof(int));
+    if ( next == NULL ) return FALSE;
+
+    // --- list the columns of each row
+    for (n = 0; n < nNodes; n++) a->start[n+1] = 1;
+    for (i = 0; i < nLinks; i++)
+    {
+        if ( !hasNewtonCoeff(i) ) continue;
+        a->start[Link[i].node1 + 1]++;
+        a->start[Link[i].node2 + 1]++;
+    }
+    for (n = 0; n < nNodes; n++)
+    {
+        a->start[n+1] += a->start[n];
+        next[n] = a->start[n];
+        a->index[next[n]++] = n;
+    }
+    for (i = 0; i < nLinks; i++)
+    {
+        if ( !hasNewtonCoeff(i) ) continue;
+        a->index[next[Link[i].node1]++] = Link[i].node2;
+        a->index[next[Link[i].node2]++] = Link[i].node1;
+    }
+
+    // --- sort each row's columns and remove duplicates (from parallel links)
+    m = 0;
+    for (n = 0; n < nNodes; n++)
+    {
+        j = a->start[n];
+        a->start[n] = m;
+        for (k = j; k < next[n]; k++)
+        {
+            c = a->index[k];
+            for (i = m; i > a->start[n] && a->index[i-1] > c; i--)
+                a->index[i] = a->index[i-1];
+            if ( i > a->start[n] && a->index[i-1] == c )
+            {
+                for ( ; i < m; i++) a->index[i] = a->index[i+1];
+                continue;
+            }
+            a->index[i] = c;
+            m++;
+        }
+    }
+    a->start[nNodes] = m;
+    free(next);
+    if ( !linsolve_init(a) ) return FALSE;
+
+    // --- locate each node's own coeff. & each link's coeff. in the rows
+    //     of its end nodes
+    for (n = 0; n < nNodes; n++)
+    {
+        for (k = a->start[n]; k < a->start[n+1]; k++)
+            if ( a->index[k] == n ) Newton->diag[n] = k;
+    }
+    for (i = 0; i < nLinks; i++)
+    {
+        Newton->pos1[i] = -1;
+        Newton->pos2[i] = -1;
+        if ( !hasNewtonCoeff(i) ) continue;
+        n = Link[i].node1;
+        for (k = a->start[n]; k < a->start[n+1]; k++)
+            if ( a->index[k] == Link[i].node2 ) Newton->pos1[i] = k;
+        n = Link[i].node2;
+        for (k = a->start[n]; k < a->start[n+1]; k++)
+            if ( a->index[k] == Link[i].node1 ) Newton->pos2[i] = k;
+    }
+    return TRUE;
+}
+
+//=============================================================================
+
+void freeNewton()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: frees the equations solved by Newton iterations.
+//
+{
+    if ( Newton == NULL ) return;
+    linsolve_close(&Newton->jacobian);
+    FREE(Newton->diag);
+    FREE(Newton->pos1);
+    FREE(Newton->pos2);
+    FREE(Newton->flooded);
+    FREE(Newton->weight);
+    FREE(Newton);
+}
+
+//=============================================================================
+
+int hasNewtonCoeff(int i)
+//
+//  Input:   i = link index
+//  Output:  returns TRUE if link's flow is a function of the heads at both
+//           of its end nodes
+//  Purpose: identifies the links that couple the depths of two nodes in
+//           the equations solved by Newton iterations.
+//
+{
+    return ( Link[i].type != PUMP && Link[i].node1 != Link[i].node2 );
+}
+
+//=============================================================================
+
+int createMultirate()
+//
+//  Input:   none
+//  Output:  returns FALSE if memory could not be allocated
+//  Purpose: allocates the time step classes of nodes & links and lists
+//           the links attached to each node.
+//
+{
+    int i, n;
+    int nNodes = Nobjects[NODE];
+    int nLinks = Nobjects[LINK];
+    char* c;
+    double* x;
+
+    Multirate = (TMultirate *) calloc(1, sizeof(TMultirate));
+    if ( Multirate == NULL ) return FALSE;
+    c = (char *) calloc(2 * (nNodes + nLinks) + 1, sizeof(char));
+    x = (double *) calloc(4 * nNodes + 2 * nLinks + 1, sizeof(double));
+    Multirate->adjStart = (int *) calloc(nNodes + 1, sizeof(int));
+    Multirate->adjLinks = (int *) calloc(2 * nLinks + 1, sizeof(int));
+    Multirate->stack = (int *) calloc(nNodes + 1, sizeof(int));
+    if ( c == NULL || x == NULL || Multirate->adjStart == NULL ||
+         Multirate->adjLinks == NULL || Multirate->stack == NULL )
+    {
+        FREE(c);
+        FREE(x);
+        return FALSE;
+    }
+    Multirate->substeps     = 1;
+    Multirate->nodeClass    = c;
+    Multirate->nodeActive   = c + nNodes;
+    Multirate->linkClass    = c + 2 * nNodes;
+    Multirate->linkActive   = c + 2 * nNodes + nLinks;
+    Multirate->nodeLimit    = x;
+    Multirate->oldDepth     = x + nNodes;
+    Multirate->oldVolume    = x + 2 * nNodes;
+    Multirate->oldNetInflow = x + 3 * nNodes;
+    Multirate->linkLimit    = x + 4 * nNodes;
+    Multirate->oldFlow      = x + 4 * nNodes + nLinks;
+
+    // --- every object starts out being updated on every substep
+    for (i = 0; i < nNodes; i++)
+    {
+        Multirate->nodeActive[i] = TRUE;
+        Multirate->nodeLimit[i] = BIG;
+    }
+    for (i = 0; i < nLinks; i++)
+    {
+        Multirate->linkActive[i] = TRUE;
+        Multirate->linkLimit[i] = BIG;
+    }
+
+    // --- list the links attached to each node
+    for (i = 0; i < nLinks; i++)
+    {
+        Multirate->adjStart[Link[i].node1 + 1]++;
+        Multirate->adjStart[Link[i].node2 + 1]++;
+    }
+    for (n = 0; n < nNodes; n++)
+        Multirate->adjStart[n+1] += Multirate->adjStart[n];
+    for (n = 0; n < nNodes; n++) Multirate->stack[n] = Multirate->adjStart[n];
+    for (i = 0; i < nLinks; i++)
+    {
+        Multirate->adjLinks[Multirate->stack[Link[i].node1]++] = i;
+        Multirate->adjLinks[Multirate->stack[Link[i].node2]++] = i;
+    }
+    return TRUE;
+}
+
+//=============================================================================
+
+void freeMultirate()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: frees the time step classes of nodes & links.
+//
+{
+    if ( Multirate == NULL ) return;
+    FREE(Multirate->nodeClass);
+    FREE(Multirate->nodeLimit);
+    FREE(Multirate->adjStart);
+    FREE(Multirate->adjLinks);
+    FREE(Multirate->stack);
+    FREE(Multirate);
+}
+
+//=============================================================================
+
+int createActiveSet()
+//
+//  Input:   none
+//  Output:  returns FALSE if memory could not be allocated
+//  Purpose: allocates the active set of nodes & links and finds the nodes
+//           that are always routed.
+//
+{
+    int i;
+    int nNodes = Nobjects[NODE];
+    int nLinks = Nobjects[LINK];
+    char* c;
+
+    ActiveSet = (TActiveSet *) calloc(1, sizeof(TActiveSet));
+    if ( ActiveSet == NULL ) return FALSE;
+    c = (char *) calloc(3 * nNodes + 2 * nLinks + 1, sizeof(char));
+    ActiveSet->refInflow = (double *) calloc(2 * nNodes + 1, sizeof(double));
+    ActiveSet->nodes = (int *) calloc(nNodes + nLinks + 1, sizeof(int));
+    if ( c == NULL || ActiveSet->refInflow == NULL || ActiveSet->nodes == NULL )
+    {
+        FREE(c);
+        return FALSE;
+    }
+    ActiveSet->nodeIdle    = c;
+    ActiveSet->nodeFixed   = c + nNodes;
+    ActiveSet->nodeChanged = c + 2 * nNodes;
+    ActiveSet->linkChanged = c + 3 * nNodes;
+    ActiveSet->linkIdle    = c + 3 * nNodes + nLinks;
+    ActiveSet->links       = ActiveSet->nodes + nNodes;
+    ActiveSet->drift       = ActiveSet->refInflow + nNodes;
+
+    // --- everything is routed on the first time step
+    for (i = 0; i < nNodes; i++)
+    {
+        ActiveSet->nodeChanged[i] = TRUE;
+        if ( Node[i].type == OUTFALL ) ActiveSet->nodeFixed[i] = TRUE;
+    }
+    for (i = 0; i < nLinks; i++)
+    {
+        ActiveSet->linkChanged[i] = TRUE;
+
+        // --- non-conduit links are found from their end nodes' state
+        //     on every step, so those nodes can't be skipped
+        if ( !isTrueConduit(i) )
+        {
+            ActiveSet->nodeFixed[Link[i].node1] = TRUE;
+            ActiveSet->nodeFixed[Link[i].node2] = TRUE;
+        }
+    }
+    return TRUE;
+}
+
+//=============================================================================
+
+void freeActiveSet()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: frees the active set of nodes & links.
+//
+{
+    if ( ActiveSet == NULL ) return;
+    FREE(ActiveSet->nodeIdle);
+    FREE(ActiveSet->refInflow);
+    FREE(ActiveSet->nodes);
+    FREE(ActiveSet);
+}
+
+//=============================================================================
+
+void  dynwave_close()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: frees memory allocated for dynamic wave routing method.
+//
+{
+    FREE(Xnode);
+    freeHotState();
+    freeNewton();
+    freeMultirate();
+    freeActiveSet();
+    freePredictor();
+    freeAnderson();
+    FREE(NodeLinkStart);
+    FREE(NodeLinks);
+}
+
+//=============================================================================
+
+int createPredictor()
+//
+//  Input:   none
+//  Output:  returns FALSE if memory could not be allocated
+//  Purpose: allocates the past states of nodes & links used to predict
+//           the state that iterations start from.
+//
+{
+    int nNodes = Nobjects[NODE];
+    int nLinks = Nobjects[LINK];
+    double* x;
+
+    Predictor = (TPredictor *) calloc(1, sizeof(TPredictor));
+    if ( Predictor == NULL ) return FALSE;
+    x = (double *) calloc(3 * nNodes + 2 * nLinks + 1, sizeof(double));
+    if ( x == NULL ) return FALSE;
+    Predictor->depth1 = x;
+    Predictor->depth2 = x + nNodes;
+    Predictor->flow1  = x + 2 * nNodes;
+    Predictor->flow2  = x + 2 * nNodes + nLinks;
+    Predictor->guess  = x + 2 * nNodes + 2 * nLinks;
+    Predictor->count = 0;
+    Predictor->lastTime = -1.0;
+    return TRUE;
+}
+
+//=============================================================================
+
+void freePredictor()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: frees the past states of nodes & links.
+//
+{
+    if ( Predictor == NULL ) return;
+    FREE(Predictor->depth1);
+    FREE(Predictor);
+}
+
+//=============================================================================
+
+int createAnderson()
+//
+//  Input:   none
+//  Output:  returns FALSE if memory could not be allocated
+//  Purpose: allocates the past iterates used by Anderson acceleration.
+//
+{
+    int nNodes = Nobjects[NODE];
+    double* x;
+
+    Anderson = (TAnderson *) calloc(1, sizeof(TAnderson));
+    if ( Anderson == NULL ) return FALSE;
+    x = (double *) calloc((3 + 2 * ANDERSON_DEPTH) * nNodes + 1,
+                          sizeof(double));
+    if ( x == NULL ) return FALSE;
+    Anderson->x  = x;
+    Anderson->f  = x + nNodes;
+    Anderson->g  = x + 2 * nNodes;
+    Anderson->dF = x + 3 * nNodes;
+    Anderson->dG = x + (3 + ANDERSON_DEPTH) * nNodes;
+    return TRUE;
+}
+
+//=============================================================================
+
+void freeAnderson()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: frees the past iterates used by Anderson acceleration.
+//
+{
+    if ( Anderson == NULL ) return;
+    FREE(Anderson->x);
+    FREE(Anderson);
+}
+
+//=============================================================================
+
+void dynwave_copyState()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: copies the routing state carried between time steps to or from
+//           an in-memory simulation state.
+//
+{
+    int nNodes = Nobjects[NODE];
+
+    hotstart_copyState(&VariableStep, sizeof(double));
+    hotstart_copyState(&Omega, sizeof(double));
+    hotstart_copyState(&Steps, sizeof(int));
+    if ( Xnode == NULL ) return;
+    hotstart_copyState(Xnode, nNodes * sizeof(TXnode));
+
+    // --- the change flags of nodes & links are adjacent (see createActiveSet)
+    if ( ActiveSet )
+    {
+        hotstart_copyState(ActiveSet->nodeChanged,
+                           (nNodes + Nobjects[LINK]) * sizeof(char));
+        hotstart_copyState(ActiveSet->refInflow, 2 * nNodes * sizeof(double));
+    }
+
+    // --- so are the past states of nodes & links (see createPredictor)
+    if ( Predictor )
+    {
+        hotstart_copyState(&Predictor->count, sizeof(int));
+        hotstart_copyState(&Predictor->lastTime, sizeof(double));
+        hotstart_copyState(&Predictor->dt1, sizeof(double));
+        hotstart_copyState(&Predictor->dt2, sizeof(double));
+        hotstart_copyState(Predictor->depth1,
+                           2 * (nNodes + Nobjects[LINK]) * sizeof(double));
+    }
+}
+
+//=============================================================================
+
+////  New function added to release 5.1.008.  ////                             //(5.1.008)
+
+void dynwave_validate()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: adjusts dynamic wave routing options.
+//
+{
+    if ( MinRouteStep > RouteStep ) MinRouteStep = RouteStep;
+    if ( MinRouteStep < MINTIMESTEP ) MinRouteStep = MINTIMESTEP;
+	if ( MinSurfArea == 0.0 ) MinSurfArea = DEFAULT_SURFAREA;
+	else MinSurfArea /= UCF(LENGTH) * UCF(LENGTH);
+    if ( HeadTol == 0.0 ) HeadTol = DEFAULT_HEADTOL;
+    else HeadTol /= UCF(LENGTH);
+	if ( MaxTrials == 0 ) MaxTrials = DEFAULT_MAXTRIALS;
+
+    // --- time step classes require a variable time step
+    if ( CourantFactor == 0.0 ) StepClasses = 1;
+    ActiveSetTol /= UCF(FLOW);
+}
+
+//=============================================================================
+
+double dynwave_getRoutingStep(double fixedStep)
+//
+//  Input:   fixedStep = user-supplied fixed time step (sec)
+//  Output:  returns routing time step (sec)
+//  Purpose: computes variable routing time step if applicable.
+//
+{
+    // --- use user-supplied fixed step if variable step option turned off
+    //     or if its smaller than the min. allowable variable time step
+    if ( CourantFactor == 0.0 ) return fixedStep;
+    if ( fixedStep < MINTIMESTEP ) return fixedStep;
+
+    // --- at start of simulation (when current variable step is zero)
+    //     use the minimum allowable time step
+    if ( VariableStep == 0.0 )
+    {
+        VariableStep = MinRouteStep;                                           //(5.1.008)
+    }
+
+    // --- otherwise compute variable step based on current flow solution
+    else VariableStep = getVariableStep(fixedStep);
+
+    // --- adjust step to be a multiple of a millisecond
+    VariableStep = floor(1000.0 * VariableStep) / 1000.0;
+    return VariableStep;
+}
+
+//=============================================================================
+
+int dynwave_execute(double tStep)
+//
+//  Input:   links = array of topo sorted links indexes
+//           tStep = time step (sec)
+//  Output:  returns number of iterations used
+//  Purpose: routes flows through drainage network over current time step.
+//
+{
+    int converged;
+    int nThreads;
+    int substep = 0;                   // current substep
+    int substeps = 1;                  // number of substeps in time step
+    int steps = 0;                     // iterations made over all substeps
+    int failed = FALSE;                // TRUE if a substep did not converge
+    int predicted = FALSE;             // TRUE if started from predicted state
+    int warmStart = FALSE;             // TRUE if predicted state was kept
+    int failedSubsteps = 0;            // substeps that did not converge
+    int classFailures[MAX_STEP_CLASSES] = {0}; // class steps not converged
+    TProject* project = Project;
+
+    // --- initialize
+    if ( ErrorCode ) return 0;
+    Steps = 0;
+    converged = FALSE;
+    Omega = OMEGA;
+    if ( Newton )
+    {
+        Omega = 1.0;                   // no under-relaxation
+        Newton->picard = FALSE;
+    }
+    initRoutingStep();
+
+    // --- find the nodes & links that need to be routed
+    if ( ActiveSet ) findActiveSet(tStep);
+
+    // --- start iterations from a state predicted from past time steps
+    if ( Predictor ) predicted = predictState(tStep);
+    if ( Anderson ) Anderson->lastNorm = -1.0;
+
+    // --- assign nodes & links to time step classes
+    if ( Multirate )
+    {
+        setStepClasses(tStep);
+        substeps = Multirate->substeps;
+        initSubstep(0);
+    }
+
+    // --- keep iterating until convergence on each substep
+    //     (one team of threads carries out all of the iterations; the
+    //     functions called here share out their loops among its members)
+    nThreads = workers_begin(ROUTING_PHASE, getRoutedNodes() + getRoutedLinks());
+#pragma omp parallel num_threads(nThreads)
+{
+    Project = project;                 // worker threads share this project
+    do
+    {
+        while ( Steps < MaxTrials )
+        {
+            // --- execute a routing step & check for nodal convergence
+            initNodeStates();
+            findLinkFlows(tStep);
+            findNodeDepths(tStep, &converged);
+            #pragma omp single
+            {
+                Steps++;
+
+                // --- start over from the last state if the predicted
+                //     one slowed down the first iteration
+                if ( predicted )
+                {
+                    predicted = FALSE;
+                    if ( checkPrediction() )
+                    {
+                        steps += Steps;
+                        Steps = 0;
+                        converged = FALSE;
+                        if ( Anderson ) Anderson->lastNorm = -1.0;
+                    }
+                    else warmStart = TRUE;
+                }
+
+                // --- combine the last iterates into the next one
+                if ( Anderson && Steps > 0 && !converged )
+                    accelerateDepths(tStep);
+
+                // --- check if link calculations can be skipped in next step
+                if ( Steps > 1 && !converged ) findBypassedLinks();
+            }
+            // --- (the first iteration can meet a predicted state)
+            if ( (Steps > 1 || warmStart) && converged ) break;
+        }
+
+        // --- move on to the next substep (once every thread has left the
+        //     loop above, since the next substep resets its exit test)
+        #pragma omp barrier
+        #pragma omp single
+        {
+            steps += Steps;
+            if ( !converged )
+            {
+                failed = TRUE;
+                failedSubsteps++;
+                if ( Multirate ) findFailedClasses(classFailures);
+            }
+            substep++;
+            if ( substep < substeps )
+            {
+                initSubstep(substep);
+                Steps = 0;
+                converged = FALSE;
+                if ( Anderson ) Anderson->lastNorm = -1.0;
+            }
+        }
+    } while ( substep < substeps );
+}
+    workers_end(ROUTING_PHASE);
+    storeHotState();
+    if ( failed ) NonConvergeCount++;
+    if ( Multirate )
+        stats_updateSubsteps(substeps, steps, failedSubsteps, classFailures);
+    if ( Multirate ) restoreOldState();
+    if ( ActiveSet ) updateActiveSet(tStep);
+    if ( Predictor ) savePastState(tStep, failed);
+
+    //  --- identify any capacity-limited conduits
+    findLimitedLinks();
+    return steps;
+}
+
+//=============================================================================
+
+void   initRoutingStep()
+{
+    int i;
+    for (i = 0; i < Nobjects[NODE]; i++) Xnode[i].dYdT = 0.0;
+
+    // --- links left idle by the active set or their time step class
+    //     keep adding the surface areas of their last update
+    if ( !ActiveSet && !Multirate ) for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        Link[i].surfArea1 = 0.0;
+        Link[i].surfArea2 = 0.0;
+    }
+
+    // --- a2 preserves conduit area from solution at last time step
+    for ( i = 0; i < Nlinks[CONDUIT]; i++) Conduit[i].a2 = Conduit[i].a1;
+
+    // --- iterations start from the current state of nodes & links
+    loadHotState();
+}
+
+//=============================================================================
+
+void setStepClasses(double tStep)
+//
+//  Input:   tStep = time step (sec)
+//  Output:  none
+//  Purpose: assigns each node & link to the time step class whose step
+//           meets its stability limit and saves the old state of the
+//           routing step.
+//
+{
+    int i, j, k, n, top;
+    int maxClass = StepClasses - 1;
+    int maxUsed = 0;
+    int nodeCount[MAX_STEP_CLASSES];
+    int linkCount[MAX_STEP_CLASSES];
+    char* nodeClass = Multirate->nodeClass;
+    char* linkClass = Multirate->linkClass;
+    char* isQueued = Multirate->nodeActive;   // (reset by initSubstep)
+
+    // --- the finest class's step can't be below the min. variable step
+    while ( maxClass > 0 &&
+            tStep / (1 << maxClass) < MAX(MinRouteStep, MINTIMESTEP) )
+        maxClass--;
+
+    // --- place each object in a class by its own limit, making each
+    //     node's class at least as fine as those of its links
+    for (i = 0; i < Nobjects[NODE]; i++)
+    {
+        nodeClass[i] = getStepClass(Multirate->nodeLimit[i], tStep, maxClass);
+    }
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        k = getStepClass(Multirate->linkLimit[i], tStep, maxClass);
+        linkClass[i] = k;
+        n = Link[i].node1;
+        if ( nodeClass[n] < k ) nodeClass[n] = k;
+        n = Link[i].node2;
+        if ( nodeClass[n] < k ) nodeClass[n] = k;
+    }
+
+    // --- links that couple their end nodes take the class of the finer
+    //     end node, which can then raise the class of the other end node
+    top = 0;
+    for (i = 0; i < Nobjects[NODE]; i++)
+    {
+        Multirate->stack[top++] = i;
+        isQueued[i] = TRUE;
+    }
+    while ( top > 0 )
+    {
+        n = Multirate->stack[--top];
+        isQueued[n] = FALSE;
+        for (k = Multirate->adjStart[n]; k < Multirate->adjStart[n+1]; k++)
+        {
+            i = Multirate->adjLinks[k];
+            if ( linkClass[i] >= nodeClass[n] || !isCouplingLink(i) ) continue;
+            linkClass[i] = nodeClass[n];
+            j = Link[i].node1;
+            if ( j == n ) j = Link[i].node2;
+            if ( nodeClass[j] < linkClass[i] )
+            {
+                nodeClass[j] = linkClass[i];
+                if ( !isQueued[j] )
+                {
+                    Multirate->stack[top++] = j;
+                    isQueued[j] = TRUE;
+                }
+            }
+        }
+    }
+
+    // --- find the number of substeps & update the class histogram
+    for (k = 0; k < MAX_STEP_CLASSES; k++)
+    {
+        nodeCount[k] = 0;
+        linkCount[k] = 0;
+    }
+    for (i = 0; i < Nobjects[NODE]; i++)
+    {
+        nodeCount[(int)nodeClass[i]]++;
+        maxUsed = MAX(maxUsed, nodeClass[i]);
+    }
+    for (i = 0; i < Nobjects[LINK]; i++) linkCount[(int)linkClass[i]]++;
+    Multirate->substeps = 1 << maxUsed;
+    stats_updateStepClasses(nodeCount, linkCount, maxUsed + 1, tStep);
+
+    // --- save the old state that the substeps replace
+    for (i = 0; i < Nobjects[NODE]; i++)
+    {
+        Multirate->oldDepth[i] = Node[i].oldDepth;
+        Multirate->oldVolume[i] = Node[i].oldVolume;
+        Multirate->oldNetInflow[i] = Node[i].oldNetInflow;
+    }
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        Multirate->oldFlow[i] = Link[i].oldFlow;
+    }
+}
+
+//=============================================================================
+
+int getStepClass(double limit, double tStep, int maxClass)
+//
+//  Input:   limit = stable time step of a node or link (sec)
+//           tStep = time step (sec)
+//           maxClass = finest class allowed
+//  Output:  returns a time step class
+//  Purpose: finds the coarsest class whose time step (tStep / 2^class)
+//           does not exceed a stable time step.
+//
+{
+    int k = 0;
+    while ( k < maxClass && tStep / (1 << k) > limit ) k++;
+    return k;
+}
+
+//=============================================================================
+
+int isCouplingLink(int i)
+//
+//  Input:   i = link index
+//  Output:  returns TRUE if link must share the class of its end nodes
+//  Purpose: identifies links that can't be advanced with a coarser step
+//           than their end nodes: non-conduits, which are found from
+//           their end nodes' state, and links attached to a surcharged
+//           node, whose depth is found by balancing their flows.
+//
+{
+    int canPond, isPonded;
+
+    if ( !isTrueConduit(i) ) return TRUE;
+    if ( isSurcharged(Link[i].node1, &canPond, &isPonded) ) return TRUE;
+    if ( isSurcharged(Link[i].node2, &canPond, &isPonded) ) return TRUE;
+    return FALSE;
+}
+
+//=============================================================================
+
+void initSubstep(int substep)
+//
+//  Input:   substep = index of a substep of the current time step
+//  Output:  none
+//  Purpose: finds the nodes & links updated on a substep and starts a new
+//           step for those whose previous step has just ended.
+//
+{
+    int i, k, m;
+    int isStart;
+
+    // --- an object of class k is updated on every m-th substep,
+    //     where m = substeps / 2^k, and starts a new step after it
+    for (i = 0; i < Nobjects[NODE]; i++)
+    {
+        m = Multirate->substeps >> Multirate->nodeClass[i];
+        Multirate->nodeActive[i] = ((substep + 1) % m == 0);
+        Hot->converged[i] = isNodeSkipped(i);
+        isStart = (substep > 0 && substep % m == 0);
+        if ( isStart )
+        {
+            Node[i].oldDepth = Node[i].newDepth;
+            Node[i].oldVolume = Node[i].newVolume;
+            Node[i].oldNetInflow = Node[i].inflow - Node[i].outflow;
+        }
+    }
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        m = Multirate->substeps >> Multirate->linkClass[i];
+        Multirate->linkActive[i] = ((substep + 1) % m == 0);
+        Hot->bypassed[i] = FALSE;
+        isStart = (substep > 0 && substep % m == 0);
+        if ( isStart )
+        {
+            Link[i].oldFlow = Link[i].newFlow;
+            if ( Link[i].type == CONDUIT )
+            {
+                k = Link[i].subIndex;
+                Conduit[k].a2 = Conduit[k].a1;
+            }
+        }
+    }
+}
+
+//=============================================================================
+
+void findFailedClasses(int classFailures[])
+//
+//  Input:   classFailures = steps of each class that did not converge
+//  Output:  updated classFailures
+//  Purpose: counts a failed step for each class with a node updated on
+//           the current substep that did not converge.
+//
+{
+    int  i;
+    char failed[MAX_STEP_CLASSES] = {0};
+
+    for (i = 0; i < Nobjects[NODE]; i++)
+    {
+        if ( Node[i].type == OUTFALL || isNodeSkipped(i) ) continue;
+        if ( !Hot->converged[i] ) failed[(int)Multirate->nodeClass[i]] = TRUE;
+    }
+    for (i = 0; i < MAX_STEP_CLASSES; i++) classFailures[i] += failed[i];
+}
+
+//=============================================================================
+
+void restoreOldState()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: restores the old state saved at the start of a time step made
+//           of several substeps.
+//
+{
+    int i;
+
+    for (i = 0; i < Nobjects[NODE]; i++)
+    {
+        Node[i].oldDepth = Multirate->oldDepth[i];
+        Node[i].oldVolume = Multirate->oldVolume[i];
+        Node[i].oldNetInflow = Multirate->oldNetInflow[i];
+    }
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        Link[i].oldFlow = Multirate->oldFlow[i];
+    }
+}
+
+//=============================================================================
+
+double getNodeDt(int i, double tStep)
+//
+//  Input:   i = node index
+//           tStep = time step (sec)
+//  Output:  returns time step that node is advanced with (sec)
+//  Purpose: finds the time step of a node's class.
+//
+{
+    if ( Multirate == NULL ) return tStep;
+    return tStep / (1 << Multirate->nodeClass[i]);
+}
+
+//=============================================================================
+
+double getLinkDt(int i, double tStep)
+//
+//  Input:   i = link index
+//           tStep = time step (sec)
+//  Output:  returns time step that link is advanced with (sec)
+//  Purpose: finds the time step of a link's class.
+//
+{
+    if ( Multirate == NULL ) return tStep;
+    return tStep / (1 << Multirate->linkClass[i]);
+}
+
+//=============================================================================
+
+void findActiveSet(double tStep)
+//
+//  Input:   tStep = time step (sec)
+//  Output:  none
+//  Purpose: finds the nodes & links routed on the current time step.
+//
+//  NOTE: a node that is skipped keeps the inflow & outflow it had on the
+//        last time step (which node_initInflow saved before resetting them)
+//        so that its mass balance & statistics remain the same. The volume
+//        change this misses (from any imbalance in those flows or change
+//        in lateral inflow) is accumulated so that a node whose state
+//        drifts slowly is still routed every so often.
+//
+{
+    int    i;
+    int    canPond, isPonded;
+    double q;
+    TActiveSet* a = ActiveSet;
+
+    // --- nodes whose own state or lateral inflow has changed
+    for (i = 0; i < Nobjects[NODE]; i++)
+    {
+        if ( a->nodeFixed[i] || a->nodeChanged[i] || Node[i].overflow > 0.0 )
+            a->nodeIdle[i] = FALSE;
+        else if ( isSurcharged(i, &canPond, &isPonded) || isPonded )
+            a->nodeIdle[i] = FALSE;
+        else
+        {
+            q = Node[i].newLatFlow - Node[i].losses;
+            a->drift[i] += (fabs(Node[i].oldNetInflow) +
+                            fabs(q - a->refInflow[i])) * tStep;
+            a->nodeIdle[i] = ( a->drift[i] <= ActiveSetTol * tStep );
+        }
+    }
+
+    // --- conduits whose flow has changed or that join such a node
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        a->linkIdle[i] = ( isTrueConduit(i) && !a->linkChanged[i] &&
+                           a->nodeIdle[Link[i].node1] &&
+                           a->nodeIdle[Link[i].node2] );
+    }
+
+    // --- the far end nodes of these conduits are routed too
+    a->linkCount = 0;
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        if ( a->linkIdle[i] ) continue;
+        a->nodeIdle[Link[i].node1] = FALSE;
+        a->nodeIdle[Link[i].node2] = FALSE;
+        a->links[a->linkCount++] = i;
+    }
+
+    // --- list the routed nodes & restore the flows of skipped ones
+    a->nodeCount = 0;
+    for (i = 0; i < Nobjects[NODE]; i++)
+    {
+        if ( !a->nodeIdle[i] )
+        {
+            a->nodes[a->nodeCount++] = i;
+            continue;
+        }
+        Node[i].inflow = Node[i].oldFlowInflow;
+        Node[i].outflow = Node[i].oldFlowInflow - Node[i].oldNetInflow;
+        Hot->converged[i] = TRUE;
+    }
+    stats_updateActiveSet(a->nodeCount, a->linkCount, tStep);
+}
+
+//=============================================================================
+
+void updateActiveSet(double tStep)
+//
+//  Input:   tStep = time step (sec)
+//  Output:  none
+//  Purpose: notes which of the nodes & links routed on the current time
+//           step changed by more than the active set tolerance.
+//
+{
+    int    i, k;
+    double dV;
+    TActiveSet* a = ActiveSet;
+
+    // --- a node's change is measured as a rate of change in volume,
+    //     using its min. surface area where it stores no volume
+    //     (skipped nodes & links have not changed)
+    for (k = 0; k < a->nodeCount; k++)
+    {
+        i = a->nodes[k];
+        a->nodeChanged[i] = FALSE;
+        a->drift[i] = 0.0;
+        a->refInflow[i] = Node[i].newLatFlow - Node[i].losses;
+        dV = fabs(Node[i].newVolume - Node[i].oldVolume);
+        dV = MAX(dV, fabs(Node[i].newDepth - Node[i].oldDepth) * MinSurfArea);
+        if ( dV > ActiveSetTol * tStep ) a->nodeChanged[i] = TRUE;
+    }
+    for (k = 0; k < a->linkCount; k++)
+    {
+        i = a->links[k];
+        a->linkChanged[i] = FALSE;
+        if ( fabs(Link[i].newFlow - Link[i].oldFlow) > ActiveSetTol )
+            a->linkChanged[i] = TRUE;
+    }
+}
+
+//=============================================================================
+
+int isNodeSkipped(int i)
+//
+//  Input:   i = node index
+//  Output:  returns TRUE if node is not updated on the current substep
+//  Purpose: checks if a node is outside of the active set or is not
+//           updated by its time step class on the current substep.
+//
+{
+    if ( ActiveSet && ActiveSet->nodeIdle[i] ) return TRUE;
+    if ( Multirate && !Multirate->nodeActive[i] ) return TRUE;
+    return FALSE;
+}
+
+//=============================================================================
+
+int isLinkSkipped(int i)
+//
+//  Input:   i = link index
+//  Output:  returns TRUE if link is not updated on the current substep
+//  Purpose: checks if a link is outside of the active set or is not
+//           updated by its time step class on the current substep.
+//
+{
+    if ( ActiveSet && ActiveSet->linkIdle[i] ) return TRUE;
+    if ( Multirate && !Multirate->linkActive[i] ) return TRUE;
+    return FALSE;
+}
+
+//=============================================================================
+
+int getRoutedNodes()
+//
+//  Input:   none
+//  Output:  returns number of nodes routed on the current time step
+//  Purpose: finds how many nodes the routing loops visit.
+//
+{
+    if ( ActiveSet ) return ActiveSet->nodeCount;
+    return Nobjects[NODE];
+}
+
+//=============================================================================
+
+int getRoutedNode(int k)
+//
+//  Input:   k = position in list of routed nodes
+//  Output:  returns node index
+//  Purpose: finds the k-th node routed on the current time step.
+//
+{
+    if ( ActiveSet ) return ActiveSet->nodes[k];
+    return k;
+}
+
+//=============================================================================
+
+int getRoutedLinks()
+//
+//  Input:   none
+//  Output:  returns number of links routed on the current time step
+//  Purpose: finds how many links the routing loops visit.
+//
+{
+    if ( ActiveSet ) return ActiveSet->linkCount;
+    return Nobjects[LINK];
 }
 
 //=============================================================================
 
-void  dynwave_close()
+int getRoutedLink(int k)
 //
-//  Input:   none
-//  Output:  none
-//  Purpose: frees memory allocated for dynamic wave routing method.
+//  Input:   k = position in list of routed links
+//  Output:  returns link index
+//  Purpose: finds the k-th link routed on the current time step.
 //
 {
-    FREE(Xnode);
+    if ( ActiveSet ) return ActiveSet->links[k];
+    return k;
 }
 
 //=============================================================================
 
-////  New function added to release 5.1.008.  ////                             //(5.1.008)
-
-void dynwave_validate()
+int predictState(double tStep)
 //
-//  Input:   none
-//  Output:  none
-//  Purpose: adjusts dynamic wave routing options.
+//  Input:   tStep = time step (sec)
+//  Output:  returns TRUE if iterations start from a predicted state
+//  Purpose: extrapolates node depths & conduit flows from the last time
+//           steps to find the state that iterations start from.
 //
 {
-    if ( MinRouteStep > RouteStep ) MinRouteStep = RouteStep;
-    if ( MinRouteStep < MINTIMESTEP ) MinRouteStep = MINTIMESTEP;
-	if ( MinSurfArea == 0.0 ) MinSurfArea = DEFAULT_SURFAREA;
-	else MinSurfArea /= UCF(LENGTH) * UCF(LENGTH);
-    if ( HeadTol == 0.0 ) HeadTol = DEFAULT_HEADTOL;
-    else HeadTol /= UCF(LENGTH);
-	if ( MaxTrials == 0 ) MaxTrials = DEFAULT_MAXTRIALS;
+    int    i, j, k, n;
+    double y, q, r, t1, t2, yCrown;
+    double c0, c1, c2;                 // weights of current & past states
+    TPredictor* p = Predictor;
+
+    // --- past states can't be used after a gap in the time steps
+    //     (e.g., a skipped steady state period)
+    if ( p->lastTime != OldRoutingTime ) p->count = 0;
+    if ( p->count == 0 || Multirate ) return FALSE;
+
+    // --- weights of the current state & the past ones (Lagrange
+    //     polynomial through them evaluated at the end of the step)
+    t1 = p->dt1;
+    t2 = p->dt1 + p->dt2;
+    if ( p->count == 1 || DynWavePredictor == LINEAR_PREDICTOR )
+    {
+        r = tStep / t1;
+        c0 = 1.0 + r;
+        c1 = -r;
+        c2 = 0.0;
+    }
+    else
+    {
+        c0 = (tStep + t1) * (tStep + t2) / (t1 * t2);
+        c1 = -tStep * (tStep + t2) / (t1 * (t2 - t1));
+        c2 = tStep * (tStep + t1) / (t2 * (t2 - t1));
+    }
+
+    // --- predict depths of non-outfall nodes (the surcharge algorithm
+    //     works from the last depth, so surcharged nodes keep it)
+    n = getRoutedNodes();
+    for (k = 0; k < n; k++)
+    {
+        i = getRoutedNode(k);
+        if ( Node[i].type == OUTFALL ) continue;
+        y = c0 * Node[i].oldDepth + c1 * p->depth1[i] + c2 * p->depth2[i];
+        y = MAX(y, 0.0);
+        yCrown = Node[i].crownElev - Node[i].invertElev;
+        if ( MAX(y, Node[i].oldDepth) >= yCrown ) y = Node[i].oldDepth;
+        p->guess[i] = y;
+        Node[i].newDepth = y;
+        Hot->newDepth[i] = y;
+    }
+
+    // --- predict flows of conduits (but not a change in direction)
+    n = getRoutedLinks();
+    for (k = 0; k < n; k++)
+    {
+        j = getRoutedLink(k);
+        if ( !isTrueConduit(j) ) continue;
+        q = c0 * Link[j].oldFlow + c1 * p->flow1[j] + c2 * p->flow2[j];
+        if ( q * Link[j].oldFlow <= 0.0 ) q = Link[j].oldFlow;
+        Link[j].newFlow = q;
+        Conduit[Link[j].subIndex].q1 = q / Conduit[Link[j].subIndex].barrels;
+    }
+    return TRUE;
 }
 
 //=============================================================================
 
-double dynwave_getRoutingStep(double fixedStep)
+int checkPrediction()
 //
-//  Input:   fixedStep = user-supplied fixed time step (sec)
-//  Output:  returns routing time step (sec)
-//  Purpose: computes variable routing time step if applicable.
+//  Input:   none
+//  Output:  returns TRUE if the predicted state was discarded
+//  Purpose: restores the last state of nodes & conduits if the first
+//           iteration ended further from the predicted node depths than
+//           from the last ones.
 //
 {
-    // --- use user-supplied fixed step if variable step option turned off
-    //     or if its smaller than the min. allowable variable time step
-    if ( CourantFactor == 0.0 ) return fixedStep;
-    if ( fixedStep < MINTIMESTEP ) return fixedStep;
+    int    i, j, k, n;
+    double ePredicted = 0.0;
+    double eLast = 0.0;
 
-    // --- at start of simulation (when current variable step is zero)
-    //     use the minimum allowable time step
-    if ( VariableStep == 0.0 )
+    n = getRoutedNodes();
+    for (k = 0; k < n; k++)
     {
-        VariableStep = MinRouteStep;                                           //(5.1.008)
+        i = getRoutedNode(k);
+        if ( Node[i].type == OUTFALL ) continue;
+        ePredicted += fabs(Node[i].newDepth - Predictor->guess[i]);
+        eLast += fabs(Node[i].newDepth - Node[i].oldDepth);
     }
+    stats_updatePredictor(ePredicted > eLast);
+    if ( ePredicted <= eLast ) return FALSE;
 
-    // --- otherwise compute variable step based on current flow solution
-    else VariableStep = getVariableStep(fixedStep);
-
-    // --- adjust step to be a multiple of a millisecond
-    VariableStep = floor(1000.0 * VariableStep) / 1000.0;
-    return VariableStep;
+    // --- start over from the last state
+    for (k = 0; k < n; k++)
+    {
+        i = getRoutedNode(k);
+        if ( Node[i].type == OUTFALL ) continue;
+        Node[i].newDepth = Node[i].oldDepth;
+        Node[i].newVolume = Node[i].oldVolume;
+        Hot->newDepth[i] = Node[i].oldDepth;
+    }
+    n = getRoutedLinks();
+    for (k = 0; k < n; k++)
+    {
+        j = getRoutedLink(k);
+        if ( !isTrueConduit(j) ) continue;
+        Link[j].newFlow = Link[j].oldFlow;
+        Conduit[Link[j].subIndex].q1 = Link[j].oldFlow /
+                                       Conduit[Link[j].subIndex].barrels;
+    }
+    return TRUE;
 }
 
 //=============================================================================
 
-int dynwave_execute(double tStep)
+void savePastState(double tStep, int failed)
 //
-//  Input:   links = array of topo sorted links indexes
-//           tStep = time step (sec)
-//  Output:  returns number of iterations used
-//  Purpose: routes flows through drainage network over current time step.
+//  Input:   tStep = time step (sec)
+//           failed = TRUE if the time step did not converge
+//  Output:  none
+//  Purpose: saves the state at the start of the current time step as the
+//           most recent past state.
 //
 {
-    int converged;
+    int i;
+    TPredictor* p = Predictor;
 
-    // --- initialize
-    if ( ErrorCode ) return 0;
-    Steps = 0;
-    converged = FALSE;
-    Omega = OMEGA;
-    initRoutingStep();
+    // --- a state that did not converge is a poor basis for a prediction,
+    //     so the next time step starts from the last state instead
+    if ( p->lastTime != OldRoutingTime || failed ) p->count = 0;
+    p->lastTime = NewRoutingTime;
+    if ( failed ) return;
+    for (i = 0; i < Nobjects[NODE]; i++)
+    {
+        p->depth2[i] = p->depth1[i];
+        p->depth1[i] = Node[i].oldDepth;
+    }
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        p->flow2[i] = p->flow1[i];
+        p->flow1[i] = Link[i].oldFlow;
+    }
+    p->dt2 = p->dt1;
+    p->dt1 = tStep;
+    p->count = MIN(p->count + 1, 2);
+}
+
+//=============================================================================
 
-    // --- keep iterating until convergence 
-    while ( Steps < MaxTrials )
+void accelerateDepths(double tStep)
+//
+//  Input:   tStep = time step (sec)
+//  Output:  none
+//  Purpose: replaces the node depths found by the last iteration with the
+//           combination of the last few iterates that best cancels the
+//           change between iterations (Anderson acceleration).
+//
+{
+    int    i, j, k, l, n, m;
+    int    nNodes = Nobjects[NODE];
+    int    first;                      // TRUE if no earlier iterate saved
+    double f, norm = 0.0;
+    double y, yCrown;
+    double a[4][4], gamma[4];
+    double *dFj, *dFl;
+    TAnderson* aa = Anderson;
+
+    // --- find the change made by the iteration & its difference from
+    //     the change made by the previous one
+    first = (aa->lastNorm < 0.0);
+    if ( first )
     {
-        // --- execute a routing step & check for nodal convergence
-        initNodeStates();
-        findLinkFlows(tStep);
-        converged = findNodeDepths(tStep);
-        Steps++;
-        if ( Steps > 1 )
+        aa->count = 0;
+        aa->next = 0;
+    }
+    n = getRoutedNodes();
+    dFj = aa->dF + aa->next * nNodes;
+    dFl = aa->dG + aa->next * nNodes;
+    for (k = 0; k < n; k++)
+    {
+        i = getRoutedNode(k);
+        if ( Node[i].type == OUTFALL || isNodeSkipped(i) ) continue;
+        f = Node[i].newDepth - aa->x[i];
+        if ( !first )
         {
-            if ( converged ) break;
+            dFj[i] = f - aa->f[i];
+            dFl[i] = Node[i].newDepth - aa->g[i];
+        }
+        aa->f[i] = f;
+        aa->g[i] = Node[i].newDepth;
+        norm += f * f;
+    }
+
+    if ( first )
+    {
+        aa->lastNorm = norm;
+        return;
+    }
+
+    // --- restart the sequence of iterates if the change has grown
+    if ( norm > aa->lastNorm )
+    {
+        aa->count = 0;
+        aa->next = 0;
+    }
+    else
+    {
+        aa->count = MIN(aa->count + 1, ANDERSON_DEPTH);
+        aa->next = (aa->next + 1) % ANDERSON_DEPTH;
+    }
+    aa->lastNorm = norm;
 
-            // --- check if link calculations can be skipped in next step
-            findBypassedLinks();
+    // --- find the weights of the saved differences that minimize the
+    //     remaining change (from the normal equations of the least
+    //     squares problem)
+    m = aa->count;
+    for (j = 0; j < m; j++)
+    {
+        dFj = aa->dF + j * nNodes;
+        for (l = 0; l <= j; l++)
+        {
+            dFl = aa->dF + l * nNodes;
+            a[j][l] = 0.0;
+            for (k = 0; k < n; k++)
+            {
+                i = getRoutedNode(k);
+                if ( Node[i].type == OUTFALL || isNodeSkipped(i) ) continue;
+                a[j][l] += dFj[i] * dFl[i];
+            }
+            a[l][j] = a[j][l];
+        }
+        gamma[j] = 0.0;
+        for (k = 0; k < n; k++)
+        {
+            i = getRoutedNode(k);
+            if ( Node[i].type == OUTFALL || isNodeSkipped(i) ) continue;
+            gamma[j] += dFj[i] * aa->f[i];
         }
     }
-    if ( !converged ) NonConvergeCount++;
+    if ( m == 0 || !solveNormalEqns(a, gamma, m) ) return;
 
-    //  --- identify any capacity-limited conduits
-    findLimitedLinks();
-    return Steps;
+    // --- form the new depths, leaving alone nodes that are (or would
+    //     become) surcharged since the surcharge algorithm works from
+    //     the last iterate
+    for (k = 0; k < n; k++)
+    {
+        i = getRoutedNode(k);
+        if ( Node[i].type == OUTFALL || isNodeSkipped(i) ) continue;
+        y = aa->g[i];
+        for (j = 0; j < m; j++) y -= gamma[j] * aa->dG[j * nNodes + i];
+        y = MAX(y, 0.0);
+        yCrown = Node[i].crownElev - Node[i].invertElev;
+        if ( MAX(y, aa->g[i]) >= yCrown || Node[i].overflow > 0.0 ) continue;
+        Node[i].newDepth = y;
+        Node[i].newVolume = node_getVolume(i, y);
+        Hot->newDepth[i] = y;
+        Xnode[i].dYdT = fabs(y - Node[i].oldDepth) / getNodeDt(i, tStep);
+    }
 }
 
 //=============================================================================
 
-void   initRoutingStep()
+int solveNormalEqns(double a[][4], double b[], int n)
+//
+//  Input:   a = n x n symmetric coeff. matrix
+//           b = right hand side
+//           n = number of equations (up to 4)
+//  Output:  b = solution; returns FALSE if the equations are singular
+//  Purpose: solves a small set of normal equations by Gaussian elimination.
+//
 {
-    int i;
-    for (i = 0; i < Nobjects[NODE]; i++)
+    int    i, j, k, p;
+    double t, scale = 0.0;
+
+    // --- add a small multiple of the diagonal to keep nearly dependent
+    //     differences from producing huge weights
+    for (i = 0; i < n; i++) scale = MAX(scale, a[i][i]);
+    if ( scale <= 0.0 ) return FALSE;
+    for (i = 0; i < n; i++) a[i][i] += 1.0e-10 * scale;
+
+    for (k = 0; k < n; k++)
     {
-        Xnode[i].converged = FALSE;
-        Xnode[i].dYdT = 0.0;
+        p = k;
+        for (i = k + 1; i < n; i++) if ( fabs(a[i][k]) > fabs(a[p][k]) ) p = i;
+        if ( fabs(a[p][k]) <= 1.0e-14 * scale ) return FALSE;
+        if ( p != k )
+        {
+            for (j = 0; j < n; j++)
+            {
+                t = a[k][j]; a[k][j] = a[p][j]; a[p][j] = t;
+            }
+            t = b[k]; b[k] = b[p]; b[p] = t;
+        }
+        for (i = k + 1; i < n; i++)
+        {
+            t = a[i][k] / a[k][k];
+            for (j = k; j < n; j++) a[i][j] -= t * a[k][j];
+            b[i] -= t * b[k];
+        }
     }
-    for (i = 0; i < Nobjects[LINK]; i++)
+    for (k = n - 1; k >= 0; k--)
     {
-        Link[i].bypassed = FALSE;
-        Link[i].surfArea1 = 0.0;
-        Link[i].surfArea2 = 0.0;
+        for (j = k + 1; j < n; j++) b[k] -= a[k][j] * b[j];
+        b[k] /= a[k][k];
     }
-
-    // --- a2 preserves conduit area from solution at last time step
-    for ( i = 0; i < Nlinks[CONDUIT]; i++) Conduit[i].a2 = Conduit[i].a1;
+    return TRUE;
 }
 
 //=============================================================================
@@ -284,10 +1960,15 @@ void initNodeStates()
 //  Purpose: initializes node's surface area, inflow & outflow
 //
 {
-    int i;
+    int i, k;
+    int n = getRoutedNodes();
 
-    for (i = 0; i < Nobjects[NODE]; i++)
+    #pragma omp for
+    for (k = 0; k < n; k++)
     {
+        i = getRoutedNode(k);
+        if ( isNodeSkipped(i) ) continue;
+
         // --- initialize nodal surface area
         if ( AllowPonding )
         {
@@ -314,7 +1995,7 @@ void initNodeStates()
         {    
             Node[i].outflow -= Node[i].newLatFlow;
         }
-        Xnode[i].sumdqdh = 0.0;
+        Hot->sumdqdh[i] = 0.0;
     }
 }
 
@@ -322,13 +2003,13 @@ void initNodeStates()
 
 void   findBypassedLinks()
 {
-    int i;
-    for (i = 0; i < Nobjects[LINK]; i++)
+    int i, k;
+    int n = getRoutedLinks();
+    for (k = 0; k < n; k++)
     {
-        if ( Xnode[Link[i].node1].converged &&
-             Xnode[Link[i].node2].converged )
-             Link[i].bypassed = TRUE;
-        else Link[i].bypassed = FALSE;
+        i = getRoutedLink(k);
+        Hot->bypassed[i] = Hot->converged[Link[i].node1] &&
+                           Hot->converged[Link[i].node2];
     }
 }
 
@@ -369,32 +2050,47 @@ void  findLimitedLinks()
 
 void findLinkFlows(double dt)
 {
-    int i;
+    int i, k;
+    int nLinks = getRoutedLinks();
+    int nNodes = getRoutedNodes();
 
     // --- find new flow in each non-dummy conduit
-#pragma omp parallel num_threads(NumThreads)                                   //(5.1.008)
-{
     #pragma omp for                                                            //(5.1.008)
-    for ( i = 0; i < Nobjects[LINK]; i++)
+    for ( k = 0; k < nLinks; k++)
     {
-        if ( isTrueConduit(i) && !Link[i].bypassed )
-            dwflow_findConduitFlow(i, Steps, Omega, dt);
+        i = getRoutedLink(k);
+        if ( !isTrueConduit(i) ) continue;
+        if ( isLinkSkipped(i) ) continue;
+        if ( Hot->bypassed[i] ) continue;
+        dwflow_findConduitFlow(i, Steps, Omega, getLinkDt(i, dt));
+
+        // --- save what its end nodes need while the conduit is in cache
+        saveConduitState(i);
     }
-}
 
     // --- update inflow/outflows for nodes attached to non-dummy conduits
-    for ( i = 0; i < Nobjects[LINK]; i++)
+    //     (each node gathers from its own conduits so there are no races)
+    #pragma omp for
+    for ( k = 0; k < nNodes; k++)
     {
-        if ( isTrueConduit(i) ) updateNodeFlows(i);
+        i = getRoutedNode(k);
+        if ( isNodeSkipped(i) ) continue;
+        gatherNodeFlows(i);
     }
 
     // --- find new flows for all dummy conduits, pumps & regulators
-    for ( i = 0; i < Nobjects[LINK]; i++)
+    #pragma omp single
     {
-        if ( !isTrueConduit(i) )
-        {	
-            if ( !Link[i].bypassed ) findNonConduitFlow(i, dt);
-            updateNodeFlows(i);
+        for ( k = 0; k < nLinks; k++)
+        {
+            i = getRoutedLink(k);
+            if ( !isTrueConduit(i) )
+            {
+                if ( isLinkSkipped(i) ) continue;
+                if ( !Hot->bypassed[i] )
+                    findNonConduitFlow(i, getLinkDt(i, dt));
+                updateNodeFlows(i);
+            }
         }
     }
 }
@@ -522,15 +2218,75 @@ void  findNonConduitSurfArea(int i)
 void updateNodeFlows(int i)
 //
 //  Input:   i = link index
-//           q = link flow rate (cfs)
 //  Output:  none
 //  Purpose: updates cumulative inflow & outflow at link's end nodes.
 //
+{
+    updateEndNodeFlows(i, 0);
+    updateEndNodeFlows(i, 1);
+}
+
+//=============================================================================
+
+void gatherNodeFlows(int n)
+//
+//  Input:   n = node index
+//  Output:  none
+//  Purpose: adds the flows of all non-dummy conduits attached to a node
+//           to the node's cumulative inflow & outflow.
+//
+//  The conduits' flows, areas & losses are read from the packed arrays and
+//  the node's sums are kept in local variables, so that neither the large
+//  Link & Conduit records nor the Node record are touched in the loop.
+//
+{
+    int    i, k;
+    double q;
+    double inflow = Node[n].inflow;
+    double outflow = Node[n].outflow;
+    double surfArea = Xnode[n].newSurfArea;
+    double sumdqdh = Hot->sumdqdh[n];
+
+    for (k = NodeLinkStart[n]; k < NodeLinkStart[n+1]; k++)
+    {
+        i = NodeLinks[k] / 2;
+        q = Hot->newFlow[i];
+
+        // --- node is the conduit's upstream end
+        if ( NodeLinks[k] % 2 == 0 )
+        {
+            if ( q >= 0.0 ) outflow += q + Hot->lossRate[i];
+            else            inflow  -= q;
+            surfArea += Hot->surfArea1[i];
+        }
+
+        // --- node is the conduit's downstream end
+        else
+        {
+            if ( q >= 0.0 ) inflow  += q;
+            else            outflow -= q - Hot->lossRate[i];
+            surfArea += Hot->surfArea2[i];
+        }
+        sumdqdh += Hot->dqdh[i];
+    }
+    Node[n].inflow = inflow;
+    Node[n].outflow = outflow;
+    Xnode[n].newSurfArea = surfArea;
+    Hot->sumdqdh[n] = sumdqdh;
+}
+
+//=============================================================================
+
+void updateEndNodeFlows(int i, int end)
+//
+//  Input:   i = link index
+//           end = 0 for link's upstream node, 1 for its downstream node
+//  Output:  none
+//  Purpose: updates cumulative inflow & outflow at one of a link's end nodes.
+//
 {
     int    k;                                                                  //(5.1.011)
     int    barrels = 1;
-    int    n1 = Link[i].node1;
-    int    n2 = Link[i].node2;
     double q = Link[i].newFlow;
     double uniformLossRate = 0.0;
 
@@ -542,66 +2298,270 @@ void updateNodeFlows(int i)
         barrels = Conduit[k].barrels;
     }
 
-    // --- update total inflow & outflow at upstream/downstream nodes
-    if ( q >= 0.0 )
+    // --- upstream node
+    if ( end == 0 )
     {
-        Node[n1].outflow += q + uniformLossRate;
-        Node[n2].inflow  += q;
+        int n1 = Link[i].node1;
+
+        // --- update total inflow & outflow
+        if ( q >= 0.0 ) Node[n1].outflow += q + uniformLossRate;
+        else            Node[n1].inflow  -= q;
+
+        // --- add surf. area contribution & update summed value of dqdh
+        Xnode[n1].newSurfArea += Link[i].surfArea1 * barrels;
+        Hot->sumdqdh[n1] += Link[i].dqdh;
     }
+
+    // --- downstream node
     else
     {
-        Node[n1].inflow   -= q;
-        Node[n2].outflow  -= q - uniformLossRate;
-    }
+        int n2 = Link[i].node2;
 
-    // --- add surf. area contributions to upstream/downstream nodes
-    Xnode[Link[i].node1].newSurfArea += Link[i].surfArea1 * barrels;
-    Xnode[Link[i].node2].newSurfArea += Link[i].surfArea2 * barrels;
+        // --- update total inflow & outflow
+        if ( q >= 0.0 ) Node[n2].inflow  += q;
+        else            Node[n2].outflow -= q - uniformLossRate;
 
-    // --- update summed value of dqdh at each end node
-    Xnode[Link[i].node1].sumdqdh += Link[i].dqdh;
-    if ( Link[i].type == PUMP )
-    {
-        k = Link[i].subIndex;
-        if ( Pump[k].type != TYPE4_PUMP )                                      //(5.1.011)
+        // --- add surf. area contribution & update summed value of dqdh
+        Xnode[n2].newSurfArea += Link[i].surfArea2 * barrels;
+        if ( Link[i].type == PUMP )
         {
-            Xnode[n2].sumdqdh += Link[i].dqdh;
+            k = Link[i].subIndex;
+            if ( Pump[k].type != TYPE4_PUMP )                                  //(5.1.011)
+            {
+                Hot->sumdqdh[n2] += Link[i].dqdh;
+            }
         }
+        else Hot->sumdqdh[n2] += Link[i].dqdh;
     }
-    else Xnode[n2].sumdqdh += Link[i].dqdh;
 }
 
 //=============================================================================
 
-int findNodeDepths(double dt)
+void findNodeDepths(double dt, int* converged)
 {
-    int i;
-    int converged;      // convergence flag
+    int i, k;
+    int nLinks = getRoutedLinks();
+    int nNodes = getRoutedNodes();
     double yOld;        // previous node depth (ft)
 
     // --- compute outfall depths based on flow in connecting link
-    for ( i = 0; i < Nobjects[LINK]; i++ ) link_setOutfallDepth(i);
+    #pragma omp single
+    {
+        for ( k = 0; k < nLinks; k++ )
+        {
+            i = getRoutedLink(k);
+            if ( isLinkSkipped(i) ) continue;
+            link_setOutfallDepth(i);
+        }
+        *converged = TRUE;
+        if ( Newton && !Newton->picard ) findNewtonSteps(dt);
+    }
 
     // --- compute new depth for all non-outfall nodes and determine if
     //     depth change from previous iteration is below tolerance
-    converged = TRUE;
-#pragma omp parallel num_threads(NumThreads)                                   //(5.1.008)
+    #pragma omp for                                                            //(5.1.008)
+    for ( k = 0; k < nNodes; k++ )
+    {
+        i = getRoutedNode(k);
+        if ( Node[i].type == OUTFALL ) continue;
+        if ( isNodeSkipped(i) ) continue;
+        yOld = Hot->newDepth[i];
+        if ( Anderson ) Anderson->x[i] = yOld;
+        setNodeDepth(i, getNodeDt(i, dt));
+        Hot->converged[i] = TRUE;
+        if ( fabs(yOld - Hot->newDepth[i]) > HeadTol )
+        {
+            *converged = FALSE;
+            Hot->converged[i] = FALSE;
+        }
+    }
+}
+
+//=============================================================================
+
+void findNewtonSteps(double tStep)
+//
+//  Input:   tStep = time step (sec)
+//  Output:  none
+//  Purpose: finds the change in each node's depth that solves the nodal
+//           continuity equations linearized about the current flows.
+//
+//  The equations are factored on the first iteration of a time step and
+//  again only when the form of some node's equation changes (e.g., once
+//  it surcharges or floods); other iterations re-use the factors with the
+//  nodes' new continuity errors.
+//
 {
-    #pragma omp for private(yOld)                                              //(5.1.008)
+    int     i, k;
+    int     refactor = (Steps == 0);   // TRUE if equations must be factored
+    char    wasFlooded;                // node flooded on last iteration
+    char    wasDry;                    // node dry on last iteration
+    double  lastWeight;                // node's weight on last iteration
+    TSparseMatrix* a = &Newton->jacobian;
+
+    // --- find the diagonal coeff. & continuity error of each node
     for ( i = 0; i < Nobjects[NODE]; i++ )
     {
-        if ( Node[i].type == OUTFALL ) continue;
-        yOld = Node[i].newDepth;
-        setNodeDepth(i, dt);
-        Xnode[i].converged = TRUE;
-        if ( fabs(yOld - Node[i].newDepth) > HeadTol )
+        for ( k = a->start[i]; k < a->start[i+1]; k++ ) a->value[k] = 0.0;
+        a->value[Newton->diag[i]] = 1.0;
+        lastWeight = Newton->weight[i];
+        wasFlooded = Newton->flooded[i];
+        wasDry = Newton->dry[i];
+        Newton->weight[i] = 0.0;
+        Newton->rhs[i] = 0.0;
+        Newton->flooded[i] = FALSE;
+        Newton->dry[i] = FALSE;
+        if ( Node[i].type != OUTFALL && !isNodeSkipped(i) )
+            setNewtonEquation(i, getNodeDt(i, tStep));
+        if ( Newton->weight[i] != lastWeight ||
+             Newton->flooded[i] != wasFlooded ||
+             Newton->dry[i] != wasDry ) refactor = TRUE;
+    }
+
+    // --- add the coeffs. that couple the nodes at either end of a link
+    for ( i = 0; i < Nobjects[LINK]; i++ )
+    {
+        if ( !hasNewtonCoeff(i) ) continue;
+        a->value[Newton->pos1[i]] -= Newton->weight[Link[i].node1] *
+                                     Link[i].dqdh;
+        a->value[Newton->pos2[i]] -= Newton->weight[Link[i].node2] *
+                                     Link[i].dqdh;
+    }
+
+    // --- solve for the depth changes (if a tiny pivot is met then the
+    //     rest of the time step uses under-relaxed Picard iterations)
+    if ( refactor && !linsolve_factor(a) )
+    {
+        Newton->picard = TRUE;
+        Omega = OMEGA;
+        return;
+    }
+    linsolve_solve(a, Newton->rhs, Newton->step);
+
+    // --- halve the fraction of a node's change that is applied each time
+    //     its direction reverses, so that iterations oscillating about a
+    //     jump in the node's net inflow still converge (a dry node's
+    //     change is always applied in full)
+    for ( i = 0; i < Nobjects[NODE]; i++ )
+    {
+        if ( Newton->dry[i] )
+        {
+            Newton->damping[i] = 1.0;
+            Newton->lastStep[i] = 0.0;
+            continue;
+        }
+        if ( Steps == 0 ) Newton->damping[i] = 1.0;
+        else if ( Newton->step[i] * Newton->lastStep[i] < 0.0 )
+            Newton->damping[i] *= 0.5;
+        Newton->step[i] *= Newton->damping[i];
+        Newton->lastStep[i] = Newton->step[i];
+
+        // --- a flooded node's depth is pushed just over its max. depth so
+        //     that setNodeDepth finds its overflow
+        if ( Newton->flooded[i] ) Newton->step[i] = FUDGE;
+    }
+}
+
+//=============================================================================
+
+void setNewtonEquation(int i, double dt)
+//
+//  Input:   i  = node index
+//           dt = node's time step (sec)
+//  Output:  none
+//  Purpose: finds the diagonal coeff., flow term weight & continuity error
+//           of a node's linearized continuity equation.
+//
+//  The continuity equation of a node that is not surcharged requires that
+//  its change in volume over the time step equal its average net inflow;
+//  that of a surcharged node requires that its net inflow be zero. The
+//  change in a link's flow with the head at either end is given by the
+//  link's dqdh value.
+//
+//  A node that is dry, or that its net outflow would empty, is given the
+//  same (under-relaxed) depth change as a Picard iteration, which matches
+//  the volume drained from it, since the linearized equation of a node
+//  with next to no surface area or wetted links can send its depth far
+//  below zero or above its crown.
+//
+{
+    int     canPond, isPonded;
+    int     k = Newton->diag[i];       // position of node's own coeff.
+    double  dQ;                        // inflow minus outflow at node (cfs)
+    double  dV;                        // change in node volume (ft3)
+    double  surfArea;                  // node surface area (ft2)
+    double  yCrown;                    // depth to node crown (ft)
+    double  yLast;                     // previous node depth (ft)
+    double  yNew;                      // depth from Picard update (ft)
+    double  denom;                     // sum of dqdh terms at node (ft2/sec)
+    double  f;                         // relative surcharge depth
+    TSparseMatrix* a = &Newton->jacobian;
+
+    dQ = Node[i].inflow - Node[i].outflow;
+    dV = 0.5 * (Node[i].oldNetInflow + dQ) * dt;
+    surfArea = Xnode[i].newSurfArea;
+    yLast = Hot->newDepth[i];
+    if ( !isSurcharged(i, &canPond, &isPonded) )
+    {
+        // --- dry node's change is that of a Picard iteration
+        yNew = Node[i].oldDepth + dV / surfArea;
+        if ( yNew <= 0.0 )
+        {
+            Newton->dry[i] = TRUE;
+            Newton->rhs[i] = yNew - yLast;
+            if ( Steps > 0 ) Newton->rhs[i] *= OMEGA;
+            return;
+        }
+        a->value[k] = surfArea / dt + 0.5 * Hot->sumdqdh[i];
+        Newton->weight[i] = 0.5;
+        Newton->rhs[i] = (dV - surfArea * (yLast - Node[i].oldDepth)) / dt;
+    }
+    else if ( !canPond && dQ > 0.0 &&
+              yLast >= Node[i].fullDepth + Node[i].surDepth )
+    {
+        // --- a flooded node stays at its max. depth, its excess
+        //     inflow overflowing, so its depth change is zero
+        Newton->flooded[i] = TRUE;
+    }
+    else
+    {
+        // --- same surcharge coeff. as used by Picard iterations
+        yCrown = Node[i].crownElev - Node[i].invertElev;
+        denom = Hot->sumdqdh[i];
+        if ( yLast < 1.25 * yCrown )
         {
-            converged = FALSE;
-            Xnode[i].converged = FALSE;
+            f = (yLast - yCrown) / yCrown;
+            denom += (Xnode[i].oldSurfArea/dt -
+                      Hot->sumdqdh[i]) * exp(-15.0 * f);
+        }
+        if ( denom > 0.0 )
+        {
+            a->value[k] = denom;
+            Newton->weight[i] = 1.0;
+            Newton->rhs[i] = dQ;
         }
     }
-}                                                                              //(5.1.008)
-    return converged;
+}
+
+//=============================================================================
+
+int isSurcharged(int i, int* canPond, int* isPonded)
+//
+//  Input:   i = node index
+//  Output:  canPond = TRUE if node can pond overflows
+//           isPonded = TRUE if node is currently ponded
+//           returns TRUE if node's depth is found from its surcharge
+//           equation rather than from its surface area
+//  Purpose: determines if a non-outfall node is surcharged.
+//
+{
+    double yCrown = Node[i].crownElev - Node[i].invertElev;
+
+    *canPond = (AllowPonding && Node[i].pondedArea > 0.0);
+    *isPonded = (*canPond && Node[i].newDepth > Node[i].fullDepth);
+    if ( Node[i].newDepth <= yCrown || Node[i].type == STORAGE || *isPonded )
+        return FALSE;
+    return TRUE;
 }
 
 //=============================================================================
@@ -629,14 +2589,10 @@ void setNodeDepth(int i, double dt)
     double  corr;                      // correction factor
     double  f;                         // relative surcharge depth
 
-    // --- see if node can pond water above it
-    canPond = (AllowPonding && Node[i].pondedArea > 0.0);
-    isPonded = (canPond && Node[i].newDepth > Node[i].fullDepth);
-
     // --- initialize values
     yCrown = Node[i].crownElev - Node[i].invertElev;
     yOld = Node[i].oldDepth;
-    yLast = Node[i].newDepth;
+    yLast = Hot->newDepth[i];
     Node[i].overflow = 0.0;
     surfArea = Xnode[i].newSurfArea;
 
@@ -644,11 +2600,13 @@ void setNodeDepth(int i, double dt)
     dQ = Node[i].inflow - Node[i].outflow;
     dV = 0.5 * (Node[i].oldNetInflow + dQ) * dt;
 
-    // --- if node not surcharged, base depth change on surface area        
-    if ( yLast <= yCrown || Node[i].type == STORAGE || isPonded )
+    // --- if node not surcharged, base depth change on surface area
+    //     (or use the change found by a Newton iteration)
+    if ( !isSurcharged(i, &canPond, &isPonded) )
     {
         dy = dV / surfArea;
         yNew = yOld + dy;
+        if ( Newton && !Newton->picard ) yNew = yLast + Newton->step[i];
 
         // --- save non-ponded surface area for use in surcharge algorithm     //(5.1.002)
         if ( !isPonded ) Xnode[i].oldSurfArea = surfArea;                      //(5.1.002)
@@ -675,17 +2633,18 @@ void setNodeDepth(int i, double dt)
 
         // --- allow surface area from last non-surcharged condition
         //     to influence dqdh if depth close to crown depth
-        denom = Xnode[i].sumdqdh;
+        denom = Hot->sumdqdh[i];
         if ( yLast < 1.25 * yCrown )
         {
             f = (yLast - yCrown) / yCrown;
             denom += (Xnode[i].oldSurfArea/dt -
-                      Xnode[i].sumdqdh) * exp(-15.0 * f);
+                      Hot->sumdqdh[i]) * exp(-15.0 * f);
         }
 
         // --- compute new estimate of node depth
         if ( denom == 0.0 ) dy = 0.0;
         else dy = corr * dQ / denom;
+        if ( Newton && !Newton->picard ) dy = Newton->step[i];
         yNew = yLast + dy;
         if ( yNew < yCrown ) yNew = yCrown - FUDGE;
 
@@ -713,6 +2672,7 @@ void setNodeDepth(int i, double dt)
 
     // --- save new depth for node
     Node[i].newDepth = yNew;
+    Hot->newDepth[i] = yNew;
 }
 
 //=============================================================================
@@ -782,6 +2742,12 @@ double getVariableStep(double maxStep)
 
     // --- don't let time step go below an absolute minimum
     if ( tMin < MinRouteStep ) tMin = MinRouteStep;                            //(5.1.008)
+
+    // --- with time step classes the critical objects use the finest class
+    if ( Multirate )
+    {
+        tMin = MIN(maxStep, tMin * (1 << (StepClasses - 1)));
+    }
     return tMin;
 }
 
@@ -804,6 +2770,7 @@ double getLinkStep(double tMin, int *minLink)
     // --- examine each conduit link
     for ( i = 0; i < Nobjects[LINK]; i++ )
     {
+        if ( Multirate ) Multirate->linkLimit[i] = BIG;
         if ( Link[i].type == CONDUIT )
         {
             // --- skip conduits with negligible flow, area or Fr
@@ -818,6 +2785,7 @@ double getLinkStep(double tMin, int *minLink)
             t = Link[i].newVolume / Conduit[k].barrels / q;
             t = t * Conduit[k].modLength / link_getLength(i);
             t = t * Link[i].froude / (1.0 + Link[i].froude) * CourantFactor;
+            if ( Multirate ) Multirate->linkLimit[i] = t;
 
             // --- update critical link time step
             if ( t < tLink )
@@ -852,6 +2820,7 @@ double getNodeStep(double tMin, int *minNode)
     for ( i = 0; i < Nobjects[NODE]; i++ )
     {
         // --- see if node can be skipped
+        if ( Multirate ) Multirate->nodeLimit[i] = BIG;
         if ( Node[i].type == OUTFALL ) continue;
         if ( Node[i].newDepth <= FUDGE) continue;
         if ( Node[i].newDepth  + FUDGE >=
@@ -865,6 +2834,7 @@ double getNodeStep(double tMin, int *minNode)
 
         // --- compute time to reach max. depth & compare with critical time
         t1 = maxDepth / dYdT;
+        if ( Multirate ) Multirate->nodeLimit[i] = t1;
         if ( t1 < tNode )
         {
             tNode = t1;
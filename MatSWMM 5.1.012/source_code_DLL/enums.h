@@ -231,6 +231,23 @@ enum SysFlowType {
      SYS_EVAP,                         // evaporation
      SYS_PET};                         // potential ET                         //(5.1.010)
 
+//-------------------------------------
+// Phases computed by parallel workers
+//-------------------------------------
+#define MAX_WORKER_PHASES 4
+enum XsectTableColumnType {
+     XT_AREA,                          // flow area
+     XT_HRAD,                          // hydraulic radius
+     XT_WIDTH,                         // top width
+     XT_SFACT,                         // section factor
+     XT_COLUMNS};                      // number of columns in each row
+
+enum WorkerPhaseType {
+     RUNOFF_PHASE,                     // subcatchment runoff & washoff
+     ROUTING_PHASE,                    // flow routing of links & nodes
+     QUALITY_PHASE,                    // water quality routing
+     STATS_PHASE};                     // node & link statistics
+
 //-------------------------------------
 // Conduit flow classifications
 //-------------------------------------
@@ -337,6 +354,20 @@ enum  SubAreaType {
       H_W,                             // Hazen-Williams eqn.
       D_W};                            // Darcy-Weisbach eqn.
 
+ enum DynWaveMethodType {
+      PICARD,                          // Picard iterations
+      NEWTON,                          // Newton iterations (experimental)
+      ANDERSON};                       // Anderson accelerated Picard iterations
+
+ enum DynWavePredictorType {
+      NO_PREDICTOR,                    // iterations start from last state
+      LINEAR_PREDICTOR,                // extrapolated from last 2 states
+      QUADRATIC_PREDICTOR};            // extrapolated from last 3 states
+
+ enum RenumberingType {
+      NO_RENUMBERING,                  // objects kept in input order
+      RCM_RENUMBERING};                // reverse Cuthill-McKee node order
+
  enum OffsetType {
       DEPTH_OFFSET,                    // offset measured as depth
       ELEV_OFFSET};                    // offset measured as elevation
@@ -461,7 +492,10 @@ enum  CompatibilityType {
       IGNORE_SNOWMELT,   IGNORE_GWATER,     IGNORE_ROUTING,
       IGNORE_QUALITY,    MAX_TRIALS,        HEAD_TOL,
       SYS_FLOW_TOL,      LAT_FLOW_TOL,      IGNORE_RDII,                       //(5.1.004)
-      MIN_ROUTE_STEP,    NUM_THREADS};                                         //(5.1.008)
+      MIN_ROUTE_STEP,    NUM_THREADS,                                          //(5.1.008)
+      DYNWAVE_METHOD,    STEP_CLASSES,      XSECT_TABLES,
+      RENUMBERING,       ACTIVE_SET_TOL,    DYNWAVE_PREDICTOR,
+      EXPORT_BUFFER};
 
 enum  NoYesType {
       NO,
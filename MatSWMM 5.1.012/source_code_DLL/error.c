@@ -20,6 +20,7 @@
 #define _CRT_SECURE_NO_DEPRECATE
 
 #include <string.h>
+#include "macros.h"
 #include "error.h"
 
 #define ERR101 "\n  ERROR 101: memory allocation error."
@@ -167,6 +168,7 @@
 #define ERR405 \
 "\n  ERROR 405: amount of output produced will exceed maximum file size;" \
 "\n             either reduce Ending Date or increase Reporting Time Step."
+#define ERR407 "\n  ERROR 407: external controller stopped the simulation (code %s)."
 
 ////////////////////////////////////////////////////////////////////////////
 //  NOTE: Need to update ErrorMsgs[], ErrorCodes[], and ErrorType
@@ -185,7 +187,7 @@ char* ErrorMsgs[] =
       ERR313, ERR315, ERR317, ERR318, ERR319, ERR320, ERR321, ERR323, ERR325,
       ERR327, ERR329, ERR330, ERR331, ERR333, ERR335, ERR336, ERR337, ERR338,
       ERR339, ERR341, ERR343, ERR345, ERR351, ERR353, ERR355, ERR357, ERR361,
-      ERR363, ERR401, ERR402, ERR403, ERR405};
+      ERR363, ERR401, ERR402, ERR403, ERR405, ERR407};
 
 int ErrorCodes[] =
     { 0,      101,    103,    105,    107,    108,    109,    110,    111,
@@ -199,9 +201,9 @@ int ErrorCodes[] =
       313,    315,    317,    318,    319,    320,    321,    323,    325,
       327,    329,    330,    331,    333,    335,    336,    337,    338,
       339,    341,    343,    345,    351,    353,    355,    357,    361,
-      363,    401,    402,    403,    405};
+      363,    401,    402,    403,    405,    407};
 
-char  ErrString[256];
+THREADLOCAL char  ErrString[256];
 
 char* error_getMsg(int i)
 {
@@ -25,6 +25,14 @@
 //   - Overflow computed in updateStorageState() must be non-negative.
 //   - Terminal storage nodes now updated corectly.
 //
+//   Steady Flow and Kinematic Wave routing sweep the nodes one level of
+//   the topological sort at a time (see toposort_findLevels), routing the
+//   nodes on each level in parallel. A node adds the outflows of the links
+//   entering it to its own inflow, in sorted link order, before routing
+//   flow through the links that leave it, so results do not depend on the
+//   number of threads used. The step counts of the nodes are likewise
+//   saved and summed in level order once all levels have been routed.
+//
 //-----------------------------------------------------------------------------
 #define _CRT_SECURE_NO_DEPRECATE
 
@@ -39,6 +47,11 @@ static const double OMEGA   = 0.55;    // under-relaxation parameter
 static const int    MAXITER = 10;      // max. iterations for storage updating
 static const double STOPTOL = 0.005;   // storage updating stopping tolerance
 
+//-----------------------------------------------------------------------------
+//  Shared variables
+//-----------------------------------------------------------------------------
+#define LinkLevels (Project->LinkLevels)  // level schedule of sorted links
+
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)
 //-----------------------------------------------------------------------------
@@ -58,6 +71,8 @@ static void   validateTreeLayout(void);
 static void   validateGeneralLayout(void);
 static void   updateStorageState(int i, int j, int links[], double dt);
 static double getStorageOutflow(int node, int j, int links[], double dt);
+static double routeNodeLinks(int node, int links[], int routingModel,
+              double dt);
 static double getLinkInflow(int link, double dt);
 static void   setNewNodeState(int node, double dt);
 static void   setNewLinkState(int link);
@@ -138,11 +153,10 @@ int flowrout_execute(int links[], int routingModel, double tStep)
 //  Purpose: routes flow through conveyance network over current time step.
 //
 {
-    int   i, j;
-    int   n1;                          // upstream node of link
-    double qin;                        // link inflow (cfs)
-    double qout;                       // link outflow (cfs)
+    int   j;
+    int   nThreads;                    // number of threads used
     double steps;                      // computational step count
+    TProject* project = Project;
 
     // --- set overflows to drain any ponded water
     if ( ErrorCode ) return 0;
@@ -163,34 +177,90 @@ int flowrout_execute(int links[], int routingModel, double tStep)
         return dynwave_execute(tStep);
     }
 
-    // --- otherwise examine each link, moving from upstream to downstream
+    // --- otherwise examine each level of nodes, moving from upstream to
+    //     downstream, routing the nodes on a level in parallel
     steps = 0.0;
-    for (i = 0; i < Nobjects[LINK]; i++)
+    nThreads = workers_begin(ROUTING_PHASE, Nobjects[LINK]);
+#pragma omp parallel num_threads(nThreads)
+{
+    int lev, k;
+
+    Project = project;                 // worker threads share this project
+    for (lev = 0; lev < LinkLevels.nLevels; lev++)
+    {
+        #pragma omp for schedule(dynamic, 4)
+        for (k = LinkLevels.levelStart[lev]; k < LinkLevels.levelStart[lev+1];
+             k++)
+        {
+            LinkLevels.steps[k] = routeNodeLinks(LinkLevels.nodes[k], links,
+                                                 routingModel, tStep);
+        }
+    }
+
+    // --- update state of each non-updated node
+    #pragma omp for
+    for ( j=0; j<Nobjects[NODE]; j++) setNewNodeState(j, tStep);
+}
+    workers_end(ROUTING_PHASE);
+
+    // --- add up the step counts in a fixed order
+    for (j = 0; j < LinkLevels.levelStart[LinkLevels.nLevels]; j++)
+    {
+        steps += LinkLevels.steps[j];
+    }
+    if ( Nobjects[LINK] > 0 ) steps /= Nobjects[LINK];
+
+    // --- update state of each link
+    //     (done serially since it can raise the depths of its end nodes)
+    for ( j=0; j<Nobjects[LINK]; j++) setNewLinkState(j);
+    return (int)(steps+0.5);
+}
+
+//=============================================================================
+
+double routeNodeLinks(int n, int links[], int routingModel, double dt)
+//
+//  Input:   n = node index
+//           links = array of link indexes in topo-sorted order
+//           routingModel = type of routing method used
+//           dt = routing time step (sec)
+//  Output:  returns number of computational steps taken
+//  Purpose: adds the flows of the links entering a node to its inflow and
+//           routes flow through the links leaving it.
+//
+{
+    int    i, j, k;
+    double qin;                        // link inflow (cfs)
+    double qout;                       // link outflow (cfs)
+    double steps = 0.0;                // computational step count
+
+    // --- add outflows of links entering the node (in sorted order)
+    for (k = LinkLevels.inletStart[n]; k < LinkLevels.inletStart[n+1]; k++)
+    {
+        Node[n].inflow += Link[LinkLevels.inlets[k]].newFlow;
+    }
+
+    // --- examine each link leaving the node
+    k = LinkLevels.outletStart[n];
+    for (i = k; i < k + LinkLevels.outletCount[n]; i++)
     {
-        // --- see if upstream node is a storage unit whose state needs updating
+        // --- see if node is a storage unit whose state needs updating
         j = links[i];
-        n1 = Link[j].node1;
-        if ( Node[n1].type == STORAGE ) updateStorageState(n1, i, links, tStep);
+        if ( Node[n].type == STORAGE ) updateStorageState(n, i, links, dt);
 
         // --- retrieve inflow at upstream end of link
-        qin  = getLinkInflow(j, tStep);
+        qin  = getLinkInflow(j, dt);
 
         // route flow through link
         if ( routingModel == SF )
-            steps += steadyflow_execute(j, &qin, &qout, tStep);
-        else steps += kinwave_execute(j, &qin, &qout, tStep);
+            steps += steadyflow_execute(j, &qin, &qout, dt);
+        else steps += kinwave_execute(j, &qin, &qout, dt);
         Link[j].newFlow = qout;
 
-        // adjust outflow at upstream node and inflow at downstream node
-        Node[ Link[j].node1 ].outflow += qin;
-        Node[ Link[j].node2 ].inflow += qout;
+        // adjust outflow at upstream node
+        Node[n].outflow += qin;
     }
-    if ( Nobjects[LINK] > 0 ) steps /= Nobjects[LINK];
-
-    // --- update state of each non-updated node and link
-    for ( j=0; j<Nobjects[NODE]; j++) setNewNodeState(j, tStep);
-    for ( j=0; j<Nobjects[LINK]; j++) setNewLinkState(j);
-    return (int)(steps+0.5);
+    return steps;
 }
 
 //=============================================================================
@@ -29,6 +29,8 @@
 //   Project Manager Methods
 //-----------------------------------------------------------------------------
 void     project_open(char *f1, char *f2, char *f3);
+void     project_openFromBuffer(const char *inpText, size_t len, char *f2,
+         char *f3);
 void     project_close(void);
 
 void     project_readInput(void);
@@ -43,6 +45,8 @@ char*    project_findID(int type, char* id);
 double** project_createMatrix(int nrows, int ncols);
 void     project_freeMatrix(double** m);
 
+void     renumber_objects(void);
+
 //-----------------------------------------------------------------------------
 //   Input Reader Methods
 //-----------------------------------------------------------------------------
@@ -78,6 +82,7 @@ void    report_writeMaxStats(TMaxStats massBalErrs[], TMaxStats CourantCrit[],
         int nMaxStats);
 void    report_writeMaxFlowTurns(TMaxStats flowTurns[], int nMaxStats);
 void    report_writeSysStats(TSysStats* sysStats);
+void    report_writeWorkerStats(TWorkerPhase phases[], double overhead);
 
 void    report_writeErrorMsg(int code, char* msg);
 void    report_writeErrorCode(void);
@@ -152,6 +157,7 @@ void    output_readDateTime(int period, DateTime *aDate);
 void    output_readSubcatchResults(int period, int area);
 void    output_readNodeResults(int period, int node);
 void    output_readLinkResults(int period, int link);
+int     output_exportColumns(char* fname);
 
 //-----------------------------------------------------------------------------
 //   Groundwater Methods
@@ -200,6 +206,7 @@ double  landuse_getBuildup(int landuse, int pollut, double area, double curb,
 double  landuse_getWashoffLoad(int landuse, int p, double area,                //(5.1.008)
         TLandFactor landFactor[], double runoff, double vOutflow);             //(5.1.008)
 double  landuse_getAvgBmpEffic(int j, int p);
+void    landuse_setExternalRates(void);
 double  landuse_getCoPollutLoad(int p, double washoff[]);
 
 //-----------------------------------------------------------------------------
@@ -211,6 +218,8 @@ double  flowrout_getRoutingStep(int routingModel, double fixedStep);
 int     flowrout_execute(int links[], int routingModel, double tStep);
 
 void    toposort_sortLinks(int links[]);
+int     toposort_findLevels(int links[], TLinkLevels* levels);
+void    toposort_freeLevels(TLinkLevels* levels);
 int     kinwave_execute(int link, double* qin, double* qout, double tStep);
 
 void    dynwave_validate(void);                                                //(5.1.008)
@@ -218,8 +227,11 @@ void    dynwave_init(void);
 void    dynwave_close(void);
 double  dynwave_getRoutingStep(double fixedStep);
 int     dynwave_execute(double tStep);
+void    dynwave_copyState(void);
 void    dwflow_findConduitFlow(int j, int steps, double omega, double dt);
 
+int     qualrout_open(void);
+void    qualrout_close(void);
 void    qualrout_init(void);
 void    qualrout_execute(double tStep);
 
@@ -230,8 +242,9 @@ int     treatmnt_open(void);
 void    treatmnt_close(void);
 int     treatmnt_readExpression(char* tok[], int ntoks);
 void    treatmnt_delete(int node);
-void    treatmnt_treat(int node, double q, double v, double tStep);
-void    treatmnt_setInflow(double qIn, double wIn[]);
+void    treatmnt_setInflow(int node, double qIn, double wIn[]);
+void    treatmnt_evalBatches(double tStep);
+void    treatmnt_treat(int node, double tStep);
 
 //-----------------------------------------------------------------------------
 //   Mass Balance Methods
@@ -245,6 +258,8 @@ void    massbal_updateLoadingTotals(int type, int pollut, double w);
 void    massbal_updateGwaterTotals(double vInfil, double vUpperEvap,
         double vLowerEvap, double vLowerPerc, double vGwater);
 void    massbal_updateRoutingTotals(double tStep);
+void    massbal_deferTotals(int thread);
+void    massbal_commitTotals(void);
 
 void    massbal_initTimeStepTotals(void);
 void    massbal_addInflowFlow(int type, double q);
@@ -266,6 +281,12 @@ void    stats_close(void);
 void    stats_report(void);
 
 void    stats_updateCriticalTimeCount(int node, int link);
+void    stats_updateStepClasses(int nodeCount[], int linkCount[],
+        int nClasses, double tStep);
+void    stats_updateSubsteps(int substeps, int iterations, int failed,
+                             int classFailures[]);
+void    stats_updateActiveSet(int nodeCount, int linkCount, double tStep);
+void    stats_updatePredictor(int rejected);
 void    stats_updateFlowStats(double tStep, DateTime aDate, int stepCount,
         int steadyState);
 void    stats_updateSubcatchStats(int subcatch, double rainVol, double runonVol,
@@ -276,6 +297,15 @@ void    stats_updateGwaterStats(int j, double infil, double evap,              /
 void    stats_updateMaxRunoff(void);
 void    stats_updateMaxNodeDepth(int node, double depth);                      //(5.1.008)
 
+//-----------------------------------------------------------------------------
+//   Parallel Worker Methods
+//-----------------------------------------------------------------------------
+int     workers_open(void);
+void    workers_close(void);
+int     workers_begin(int phase, int items);
+void    workers_end(int phase);
+void    workers_report(void);
+
 //-----------------------------------------------------------------------------
 //   Raingage Methods
 //-----------------------------------------------------------------------------
@@ -380,6 +410,10 @@ void    iface_saveOutletResults(DateTime reportDate, FILE* file);
 //-----------------------------------------------------------------------------
 int     hotstart_open(void);
 void    hotstart_close(void);
+int     hotstart_saveState(void** state);
+int     hotstart_restoreState(void* state);
+void    hotstart_deleteState(void* state);
+void    hotstart_copyState(void* x, size_t size);
 
 //-----------------------------------------------------------------------------
 //   Conveyance System Link Methods
@@ -429,6 +463,11 @@ double  xsect_getRofY(TXsect* xsect, double y);
 double  xsect_getWofY(TXsect* xsect, double y);
 double  xsect_getYcrit(TXsect* xsect, double q);
 
+int     xsect_createTable(TXsect* xsect);
+void    xsect_deleteTables(void);
+double  xsect_getYofS(TXsect* xsect, double sFactor);
+void    xsect_getTableValues(TXsect* xsect, int n, double y[], double v[]);
+
 //-----------------------------------------------------------------------------
 //   Culvert/Roadway Methods                                                   //(5.1.010)
 //-----------------------------------------------------------------------------
@@ -462,6 +501,10 @@ int     shape_validate(TShape *shape, TTable *curve);
 int     controls_create(int n);
 void    controls_delete(void);
 int     controls_addRuleClause(int rule, int keyword, char* Tok[], int nTokens);
+void    controls_renumber(int nodeIndex[], int linkIndex[]);
+int     controls_open(void);
+void    controls_close(void);
+void    controls_copyState(void);
 int     controls_evaluate(DateTime currentTime, DateTime elapsedTime, 
         double tStep);
 
@@ -25,15 +25,23 @@
 //
 //   Build 5.1.011:
 //   - Changed WarningCode to Warnings (# warnings issued)
-//   - Added error message text as a variable. 
+//   - Added error message text as a variable.
 //   - Added elapsed simulation time (in decimal days) variable.
 //   - Added variables associated with detailed routing events.
 //
 //   Build 5.1.012:
 //   - InSteadyState variable made local to routing_execute in routing.c.
+//
+//   All of the engine's state variables are members of a TProject structure
+//   so that several projects can be analyzed at once on separate threads.
+//   Each thread works on the project that Project points to (it is set by
+//   the API functions in swmm5.c); the macros at the end of this file let
+//   the rest of the code refer to those members by their original names.
 //-----------------------------------------------------------------------------
 
-EXTERN TFile
+typedef struct TProject
+{
+TFile
                   Finp,                     // Input file
                   Fout,                     // Output file
                   Frpt,                     // Report file
@@ -46,21 +54,21 @@ EXTERN TFile
                   Finflows,                 // Inflows routing file
                   Foutflows;                // Outflows routing file
 
-EXTERN long
+long
                   Nperiods,                 // Number of reporting periods
                   StepCount,                // Number of routing steps used
                   NonConvergeCount;         // Number of non-converging steps
 
-EXTERN char
+char
                   Msg[MAXMSG+1],            // Text of output message
                   ErrorMsg[MAXMSG+1],       // Text of error message           //(5.1.011)
                   Title[MAXTITLE][MAXMSG+1],// Project title
                   TempDir[MAXFNAME+1];      // Temporary file directory
 
-EXTERN TRptFlags
+TRptFlags
                   RptFlags;                 // Reporting options
 
-EXTERN int
+int
                   Nobjects[MAX_OBJ_TYPES],  // Number of each object type
                   Nnodes[MAX_NODE_TYPES],   // Number of each node sub-type
                   Nlinks[MAX_LINK_TYPES],   // Number of each link sub-type
@@ -69,6 +77,8 @@ EXTERN int
                   InfilModel,               // Infiltration method
                   RouteModel,               // Flow routing method
                   ForceMainEqn,             // Flow equation for force mains
+                  DynWaveMethod,            // Dynamic wave solution method
+                  DynWavePredictor,         // Dynamic wave iteration predictor
                   LinkOffsets,              // Link offset convention
                   AllowPonding,             // Allow water to pond at nodes
                   InertDamping,             // Degree of inertial damping
@@ -82,6 +92,8 @@ EXTERN int
                   IgnoreGwater,             // Ignore groundwater
                   IgnoreRouting,            // Ignore flow routing
                   IgnoreQuality,            // Ignore water quality
+                  XsectTables,              // Use conduit geometry tables
+                  Renumbering,              // Node & link renumbering method
                   ErrorCode,                // Error code number
                   Warnings,                 // Number of warning messages      //(5.1.011)
                   WetStep,                  // Runoff wet time step (sec)
@@ -90,11 +102,14 @@ EXTERN int
                   SweepStart,               // Day of year when sweeping starts
                   SweepEnd,                 // Day of year when sweeping ends
                   MaxTrials,                // Max. trials for DW routing
+                  StepClasses,              // Number of DW time step classes
                   NumThreads,               // Number of parallel threads used //(5.1.008)
+                  ExportBuffer,             // Max. KB of results read at once by
+                                            //   output_exportColumns
                   NumEvents;                // Number of detailed events       //(5.1.011)
                 //InSteadyState;            // System flows remain constant    //(5.1.012)
 
-EXTERN double
+double
                   RouteStep,                // Routing time step (sec)
                   MinRouteStep,             // Minimum variable time step (sec) //(5.1.008)
                   LengtheningStep,          // Time step for lengthening (sec)
@@ -108,9 +123,10 @@ EXTERN double
                   QualError,                // Quality routing error
                   HeadTol,                  // DW routing head tolerance (ft)
                   SysFlowTol,               // Tolerance for steady system flow
-                  LatFlowTol;               // Tolerance for steady nodal inflow       
+                  LatFlowTol,               // Tolerance for steady nodal inflow
+                  ActiveSetTol;             // DW routing active set tolerance (cfs)
 
-EXTERN DateTime
+DateTime
                   StartDate,                // Starting date
                   StartTime,                // Starting time
                   StartDateTime,            // Starting Date+Time
@@ -121,7 +137,7 @@ EXTERN DateTime
                   ReportStartTime,          // Report start time
                   ReportStart;              // Report start Date+Time
 
-EXTERN double
+double
                   ReportTime,               // Current reporting time (msec)
                   OldRunoffTime,            // Previous runoff time (msec)
                   NewRunoffTime,            // Current runoff time (msec)
@@ -130,32 +146,403 @@ EXTERN double
                   TotalDuration,            // Simulation duration (msec)
                   ElapsedTime;              // Current elapsed time (days)     //(5.1.011)
 
-EXTERN TTemp      Temp;                     // Temperature data
-EXTERN TEvap      Evap;                     // Evaporation data
-EXTERN TWind      Wind;                     // Wind speed data
-EXTERN TSnow      Snow;                     // Snow melt data
-EXTERN TAdjust    Adjust;                   // Climate adjustments             //(5.1.007)
-
-EXTERN TSnowmelt* Snowmelt;                 // Array of snow melt objects
-EXTERN TGage*     Gage;                     // Array of rain gages
-EXTERN TSubcatch* Subcatch;                 // Array of subcatchments
-EXTERN TAquifer*  Aquifer;                  // Array of groundwater aquifers
-EXTERN TUnitHyd*  UnitHyd;                  // Array of unit hydrographs
-EXTERN TNode*     Node;                     // Array of nodes
-EXTERN TOutfall*  Outfall;                  // Array of outfall nodes
-EXTERN TDivider*  Divider;                  // Array of divider nodes
-EXTERN TStorage*  Storage;                  // Array of storage nodes
-EXTERN TLink*     Link;                     // Array of links
-EXTERN TConduit*  Conduit;                  // Array of conduit links
-EXTERN TPump*     Pump;                     // Array of pump links
-EXTERN TOrifice*  Orifice;                  // Array of orifice links
-EXTERN TWeir*     Weir;                     // Array of weir links
-EXTERN TOutlet*   Outlet;                   // Array of outlet device links
-EXTERN TPollut*   Pollut;                   // Array of pollutants
-EXTERN TLanduse*  Landuse;                  // Array of landuses
-EXTERN TPattern*  Pattern;                  // Array of time patterns
-EXTERN TTable*    Curve;                    // Array of curve tables
-EXTERN TTable*    Tseries;                  // Array of time series tables
-EXTERN TTransect* Transect;                 // Array of transect data
-EXTERN TShape*    Shape;                    // Array of custom conduit shapes
-EXTERN TEvent*    Event;                    // Array of routing events         //(5.1.011)
+TTemp      Temp;                     // Temperature data
+TEvap      Evap;                     // Evaporation data
+TWind      Wind;                     // Wind speed data
+TSnow      Snow;                     // Snow melt data
+TAdjust    Adjust;                   // Climate adjustments             //(5.1.007)
+
+TSnowmelt* Snowmelt;                 // Array of snow melt objects
+TGage*     Gage;                     // Array of rain gages
+TSubcatch* Subcatch;                 // Array of subcatchments
+TAquifer*  Aquifer;                  // Array of groundwater aquifers
+TUnitHyd*  UnitHyd;                  // Array of unit hydrographs
+TNode*     Node;                     // Array of nodes
+TOutfall*  Outfall;                  // Array of outfall nodes
+TDivider*  Divider;                  // Array of divider nodes
+TStorage*  Storage;                  // Array of storage nodes
+TLink*     Link;                     // Array of links
+TConduit*  Conduit;                  // Array of conduit links
+TPump*     Pump;                     // Array of pump links
+TOrifice*  Orifice;                  // Array of orifice links
+TWeir*     Weir;                     // Array of weir links
+TOutlet*   Outlet;                   // Array of outlet device links
+TPollut*   Pollut;                   // Array of pollutants
+TLanduse*  Landuse;                  // Array of landuses
+TPattern*  Pattern;                  // Array of time patterns
+TTable*    Curve;                    // Array of curve tables
+TTable*    Tseries;                  // Array of time series tables
+TTransect* Transect;                 // Array of transect data
+TShape*    Shape;                    // Array of custom conduit shapes
+TEvent*    Event;                    // Array of routing events         //(5.1.011)
+
+//-----------------------------------------------------------------------------
+//  Variables shared within individual modules
+//-----------------------------------------------------------------------------
+
+// --- swmm5.c
+int        IsOpenFlag;               // TRUE if a project has been opened
+int        IsStartedFlag;            // TRUE if a simulation has been started
+int        SaveResultsFlag;          // TRUE if output to be saved to binary file
+int        ExceptionCount;           // number of exceptions handled
+int        DoRunoff;                 // TRUE if runoff is computed
+int        DoRouting;                // TRUE if flow routing is computed
+int      (*Controller)(void*, double, double, void*); // native controller
+void*      ControllerData;           // user data passed to the controller
+int        ControllerInterval;       // routing steps between controller calls
+void*      ControllerLibrary;        // library the controller was loaded from
+
+// --- project.c
+struct HTentry** Htable[MAX_OBJ_TYPES]; // Hash tables for object ID names
+struct alloc_handle_t* MemPool;      // Memory pool for object ID names
+int*       NodeOrder;                // index of node at each input position
+int*       LinkOrder;                // index of link at each input position
+int*       NodePosition;             // input position of each node
+int*       LinkPosition;             // input position of each link
+double*    NodeQual;                 // pollutant arrays of all nodes
+double*    LinkQual;                 // pollutant arrays of all links
+
+// --- climate.c
+double     Tmin;                     // min. daily temperature (deg F)
+double     Tmax;                     // max. daily temperature (deg F)
+double     Trng;                     // 1/2 range of daily temperatures
+double     Trng1;                    // prev. max - current min. temp.
+double     Tave;                     // average daily temperature (deg F)
+double     Hrsr;                     // time of min. temp. (hrs)
+double     Hrss;                     // time of max. temp (hrs)
+double     Hrday;                    // avg. of min/max temp times
+double     Dhrdy;                    // hrs. between min. & max. temp. times
+double     Dydif;                    // hrs. between max. & min. temp. times
+DateTime   LastDay;                  // date of last day with temp. data
+TMovAve    Tma;                      // moving average of daily temperatures
+DateTime   NextEvapDate;             // next date when evap. rate changes
+double     NextEvapRate;             // next evaporation rate (user units)
+int        FileFormat;               // climate file format
+int        FileYear;                 // current year of file data
+int        FileMonth;                // current month of year of file data
+int        FileDay;                  // current day of month of file data
+int        FileLastDay;              // last day of current month of file data
+int        FileElapsedDays;          // number of days read from file
+double     FileValue[4];             // current day's values of climate data
+double     FileData[4][32];          // month's worth of daily climate data
+char       FileLine[MAXLINE+1];      // line from climate data file
+int        FileFieldPos[4];          // start of data fields for file record
+int        FileDateFieldPos;         // start of date field for file record
+int        FileWindType;             // wind speed type
+
+// --- controls.c
+struct TRule*       Rules;           // array of control rules
+struct TActionList* ActionList;      // linked list of control actions
+int        InputState;               // state of rule interpreter
+int        RuleCount;                // total number of rules
+double     ControlValue;             // value of controller variable
+double     SetPoint;                 // value of controller setpoint
+DateTime   CurrentDate;              // current date in whole days
+DateTime   CurrentTime;              // current time of day (decimal)
+struct TRuleVar*    RuleVars;        // variables watched by rule premises
+int        RuleVarCount;             // number of watched variables
+int*       RuleVarStart;             // start of each variable's rules
+int*       RuleVarRules;             // rules watching each variable
+int*       TimedRules;               // rules with time-varying premises
+int        TimedRuleCount;           // number of such rules
+struct TActionList** LinkActions;    // action list item of each link
+struct TActionList*  NextActionItem; // first unused action list item
+
+// --- dynwave.c
+double     VariableStep;             // size of variable time step (sec)
+struct TXnode* Xnode;                // extended nodal information
+struct THotState* HotState;          // node & link state used on every iteration
+double     Omega;                    // actual under-relaxation parameter
+int        Steps;                    // number of iterations
+struct TNewton* Newton;              // Newton iteration matrix & vectors
+struct TMultirate* Multirate;        // time step classes of nodes & links
+struct TActiveSet* ActiveSet;        // nodes & links routed on each step
+struct TPredictor* Predictor;        // past states used to start iterations
+struct TAnderson* Anderson;          // Anderson acceleration of node depths
+int*       NodeLinkStart;            // start of each node's entries in NodeLinks
+int*       NodeLinks;                // conduit ends at each node (2*link + end)
+
+// --- hotstart.c
+long       RunCount;                 // number of simulations started
+
+// --- iface.c
+int        IfaceFlowUnits;           // flow units for routing interface file
+int        IfaceStep;                // interface file time step (sec)
+int        NumIfacePolluts;          // number of pollutants in interface file
+int*       IfacePolluts;             // indexes of interface file pollutants
+int        NumIfaceNodes;            // number of nodes on interface file
+int*       IfaceNodes;               // indexes of nodes on interface file
+double**   OldIfaceValues;           // interface flows & WQ at previous time
+double**   NewIfaceValues;           // interface flows & WQ at next time
+double     IfaceFrac;                // fraction of interface file time step
+DateTime   OldIfaceDate;             // previous date of interface values
+DateTime   NewIfaceDate;             // next date of interface values
+
+// --- infil.c
+THorton*   HortInfil;                // Horton infiltration objects
+TGrnAmpt*  GAInfil;                  // Green-Ampt infiltration objects
+TCurveNum* CNInfil;                  // Curve Number infiltration objects
+
+// --- lid.c
+struct TLidProc* LidProcs;           // array of LID processes
+int        LidCount;                 // number of LID processes
+struct LidGroup** LidGroups;         // array of LID process groups
+int        GroupCount;               // number of LID groups (subcatchments)
+
+// --- massbal.c
+TRunoffTotals    RunoffTotals;       // overall surface runoff continuity totals
+TLoadingTotals*  LoadingTotals;      // overall WQ washoff continuity totals
+TGwaterTotals    GwaterTotals;       // overall groundwater continuity totals
+TRoutingTotals   FlowTotals;         // overall routed flow continuity totals
+TRoutingTotals*  QualTotals;         // overall routed WQ continuity totals
+TRoutingTotals   StepFlowTotals;     // routed flow totals over time step
+TRoutingTotals   OldStepFlowTotals;
+TRoutingTotals*  StepQualTotals;     // routed WQ totals over time step
+double*    NodeInflow;               // total inflow volume to each node (ft3)
+double*    NodeOutflow;              // total outflow volume from each node (ft3)
+double     TotalArea;                // total drainage area (ft2)
+struct TMassbalLog* MassbalLogs;     // per-thread logs of deferred updates
+int        NumMassbalLogs;           // number of deferred update logs
+
+// --- output.c
+int        IDStartPos;               // starting file position of ID names
+int        InputStartPos;            // starting file position of input data
+int        OutputStartPos;           // starting file position of output data
+int        BytesPerPeriod;           // bytes saved per simulation time period
+int        NsubcatchResults;         // number of subcatchment output variables
+int        NnodeResults;             // number of node output variables
+int        NlinkResults;             // number of link output variables
+int        NumSubcatch;              // number of subcatchments reported on
+int        NumNodes;                 // number of nodes reported on
+int        NumLinks;                 // number of links reported on
+int        NumPolluts;               // number of pollutants reported on
+float      SysResults[MAX_SYS_RESULTS]; // values of system output vars.
+float*     SubcatchResults;          // subcatchment results for a period
+float*     NodeResults;              // node results for a period
+float*     LinkResults;              // link results for a period
+
+// --- rdii.c
+struct TUHGroup* UHGroup;            // processing data for each UH group
+int        RdiiStep;                 // RDII time step (sec)
+int        NumRdiiNodes;             // number of nodes w/ RDII data
+int*       RdiiNodeIndex;            // indexes of nodes w/ RDII data
+float*     RdiiNodeFlow;             // inflows for nodes with RDII
+int        RdiiFlowUnits;            // RDII flow units code
+DateTime   RdiiStartDate;            // start date of RDII inflow period
+DateTime   RdiiEndDate;              // end date of RDII inflow period
+double     TotalRainVol;             // total rainfall volume (ft3)
+double     TotalRdiiVol;             // total RDII volume (ft3)
+int        RdiiFileType;             // type (binary/text) of RDII file
+
+// --- report.c
+time_t     SysTime;                  // time when the analysis began
+
+// --- qualrout.c
+int*       QualLinkStart;            // start of each node's entries in QualLinks
+int*       QualLinks;                // links attached to each node
+
+// --- routing.c
+int*       SortedLinks;              // topologically sorted link indexes
+TLinkLevels LinkLevels;              // level schedule of sorted links
+int        NextEvent;                // index of next routing event
+int        BetweenEvents;            // TRUE if between routing events
+
+// --- runoff.c
+char       IsRaining;                // TRUE if precip. falls on study area
+char       HasRunoff;                // TRUE if study area generates runoff
+char       HasSnow;                  // TRUE if any snow cover on study area
+char       HasWetLids;               // TRUE if any LIDs are wet
+int        Nsteps;                   // number of runoff time steps taken
+int        MaxSteps;                 // final number of runoff time steps
+long       MaxStepsPos;              // position in Runoff interface file
+double*    OutflowLoad;              // exported pollutant mass load
+int*       RunonOrder;               // subcatchments ordered by run-on level
+int*       RunonLevelStart;          // start of each level in RunonOrder
+int        RunonLevels;              // number of run-on levels
+
+// --- stats.c
+TSysStats       SysStats;
+TMaxStats       MaxMassBalErrs[MAX_STATS];
+TMaxStats       MaxCourantCrit[MAX_STATS];
+TMaxStats       MaxFlowTurns[MAX_STATS];
+double          SysOutfallFlow;
+TSubcatchStats* SubcatchStats;
+TNodeStats*     NodeStats;
+TLinkStats*     LinkStats;
+TStorageStats*  StorageStats;
+TOutfallStats*  OutfallStats;
+TPumpStats*     PumpStats;
+double          MaxOutfallFlow;
+double          MaxRunoffFlow;
+
+// --- transect.c
+int        Ntransects;               // total number of transects
+
+// --- treatmnt.c
+double*    TreatRemovals;            // pollut. removals (for each thread)
+double*    TreatInflows;             // inflow rate of each treated node
+double*    TreatVolumes;             // average volume of each treated node
+struct TTreatBatch* TreatBatches;    // treatment eqns. evaluated together
+int        TreatBatchCount;          // number of treatment batches
+int*       TreatBatchNodes;          // nodes of each treatment batch
+int        TreatBatchSlots;          // most variables in a batched eqn.
+double*    TreatBatchValues;         // batch variables & results (for each thread)
+
+// --- xsect.c
+double**   GeomTables;               // shared conduit geometry tables
+int        NGeomTables;              // number of shared geometry tables
+double**   DepthTables;              // shared critical & normal depth tables
+int        NDepthTables;             // number of shared depth tables
+
+// --- workers.c
+TWorkerPhase WorkerPhases[MAX_WORKER_PHASES]; // thread use by each phase
+double     WorkerOverhead;           // cost of a parallel region (sec)
+}  TProject;
+
+//-----------------------------------------------------------------------------
+//  Project being analyzed by the current thread
+//-----------------------------------------------------------------------------
+EXTERN THREADLOCAL_PROJECT TProject* Project;
+
+#define Finp              (Project->Finp)
+#define Fout              (Project->Fout)
+#define Frpt              (Project->Frpt)
+#define Fclimate          (Project->Fclimate)
+#define Frain             (Project->Frain)
+#define Frunoff           (Project->Frunoff)
+#define Frdii             (Project->Frdii)
+#define Fhotstart1        (Project->Fhotstart1)
+#define Fhotstart2        (Project->Fhotstart2)
+#define Finflows          (Project->Finflows)
+#define Foutflows         (Project->Foutflows)
+#define Nperiods          (Project->Nperiods)
+#define StepCount         (Project->StepCount)
+#define NonConvergeCount  (Project->NonConvergeCount)
+#define Msg               (Project->Msg)
+#define ErrorMsg          (Project->ErrorMsg)
+#define Title             (Project->Title)
+#define TempDir           (Project->TempDir)
+#define RptFlags          (Project->RptFlags)
+#define Nobjects          (Project->Nobjects)
+#define Nnodes            (Project->Nnodes)
+#define Nlinks            (Project->Nlinks)
+#define UnitSystem        (Project->UnitSystem)
+#define FlowUnits         (Project->FlowUnits)
+#define InfilModel        (Project->InfilModel)
+#define RouteModel        (Project->RouteModel)
+#define ForceMainEqn      (Project->ForceMainEqn)
+#define DynWaveMethod     (Project->DynWaveMethod)
+#define DynWavePredictor  (Project->DynWavePredictor)
+#define LinkOffsets       (Project->LinkOffsets)
+#define AllowPonding      (Project->AllowPonding)
+#define InertDamping      (Project->InertDamping)
+#define NormalFlowLtd     (Project->NormalFlowLtd)
+#define SlopeWeighting    (Project->SlopeWeighting)
+#define Compatibility     (Project->Compatibility)
+#define SkipSteadyState   (Project->SkipSteadyState)
+#define IgnoreRainfall    (Project->IgnoreRainfall)
+#define IgnoreRDII        (Project->IgnoreRDII)
+#define IgnoreSnowmelt    (Project->IgnoreSnowmelt)
+#define IgnoreGwater      (Project->IgnoreGwater)
+#define IgnoreRouting     (Project->IgnoreRouting)
+#define IgnoreQuality     (Project->IgnoreQuality)
+#define XsectTables       (Project->XsectTables)
+#define Renumbering       (Project->Renumbering)
+#define ErrorCode         (Project->ErrorCode)
+#define Warnings          (Project->Warnings)
+#define WetStep           (Project->WetStep)
+#define DryStep           (Project->DryStep)
+#define ReportStep        (Project->ReportStep)
+#define SweepStart        (Project->SweepStart)
+#define SweepEnd          (Project->SweepEnd)
+#define MaxTrials         (Project->MaxTrials)
+#define StepClasses       (Project->StepClasses)
+#define ExportBuffer      (Project->ExportBuffer)
+#define NumThreads        (Project->NumThreads)
+#define NumEvents         (Project->NumEvents)
+#define RouteStep         (Project->RouteStep)
+#define MinRouteStep      (Project->MinRouteStep)
+#define LengtheningStep   (Project->LengtheningStep)
+#define StartDryDays      (Project->StartDryDays)
+#define CourantFactor     (Project->CourantFactor)
+#define MinSurfArea       (Project->MinSurfArea)
+#define MinSlope          (Project->MinSlope)
+#define RunoffError       (Project->RunoffError)
+#define GwaterError       (Project->GwaterError)
+#define FlowError         (Project->FlowError)
+#define QualError         (Project->QualError)
+#define HeadTol           (Project->HeadTol)
+#define SysFlowTol        (Project->SysFlowTol)
+#define LatFlowTol        (Project->LatFlowTol)
+#define ActiveSetTol      (Project->ActiveSetTol)
+#define StartDate         (Project->StartDate)
+#define StartTime         (Project->StartTime)
+#define StartDateTime     (Project->StartDateTime)
+#define EndDate           (Project->EndDate)
+#define EndTime           (Project->EndTime)
+#define EndDateTime       (Project->EndDateTime)
+#define ReportStartDate   (Project->ReportStartDate)
+#define ReportStartTime   (Project->ReportStartTime)
+#define ReportStart       (Project->ReportStart)
+#define ReportTime        (Project->ReportTime)
+#define OldRunoffTime     (Project->OldRunoffTime)
+#define NewRunoffTime     (Project->NewRunoffTime)
+#define OldRoutingTime    (Project->OldRoutingTime)
+#define NewRoutingTime    (Project->NewRoutingTime)
+#define TotalDuration     (Project->TotalDuration)
+#define ElapsedTime       (Project->ElapsedTime)
+#define Temp              (Project->Temp)
+#define Evap              (Project->Evap)
+#define Wind              (Project->Wind)
+#define Snow              (Project->Snow)
+#define Adjust            (Project->Adjust)
+#define Snowmelt          (Project->Snowmelt)
+#define Gage              (Project->Gage)
+#define Subcatch          (Project->Subcatch)
+#define Aquifer           (Project->Aquifer)
+#define UnitHyd           (Project->UnitHyd)
+#define Node              (Project->Node)
+#define Outfall           (Project->Outfall)
+#define Divider           (Project->Divider)
+#define Storage           (Project->Storage)
+#define Link              (Project->Link)
+#define Conduit           (Project->Conduit)
+#define Pump              (Project->Pump)
+#define Orifice           (Project->Orifice)
+#define Weir              (Project->Weir)
+#define Outlet            (Project->Outlet)
+#define Pollut            (Project->Pollut)
+#define Landuse           (Project->Landuse)
+#define Pattern           (Project->Pattern)
+#define Curve             (Project->Curve)
+#define Tseries           (Project->Tseries)
+#define Transect          (Project->Transect)
+#define Shape             (Project->Shape)
+#define Event             (Project->Event)
+
+// --- variables shared between modules
+#define NodeOrder         (Project->NodeOrder)
+#define LinkOrder         (Project->LinkOrder)
+#define NodePosition      (Project->NodePosition)
+#define LinkPosition      (Project->LinkPosition)
+#define NodeQual          (Project->NodeQual)
+#define LinkQual          (Project->LinkQual)
+#define SubcatchResults   (Project->SubcatchResults)
+#define NodeResults       (Project->NodeResults)
+#define LinkResults       (Project->LinkResults)
+#define NodeInflow        (Project->NodeInflow)
+#define NodeOutflow       (Project->NodeOutflow)
+#define StepFlowTotals    (Project->StepFlowTotals)
+#define HasWetLids        (Project->HasWetLids)
+#define OutflowLoad       (Project->OutflowLoad)
+#define SubcatchStats     (Project->SubcatchStats)
+#define NodeStats         (Project->NodeStats)
+#define LinkStats         (Project->LinkStats)
+#define StorageStats      (Project->StorageStats)
+#define OutfallStats      (Project->OutfallStats)
+#define PumpStats         (Project->PumpStats)
+#define MaxOutfallFlow    (Project->MaxOutfallFlow)
+#define MaxRunoffFlow     (Project->MaxRunoffFlow)
+#define HortInfil         (Project->HortInfil)
+#define GAInfil           (Project->GAInfil)
+#define CNInfil           (Project->CNInfil)
@@ -64,30 +64,30 @@ static char* GWVarWords[] = {"HGW", "HSW", "HCB", "HGS", "KS", "K",            /
 //  Shared variables
 //-----------------------------------------------------------------------------
 //  NOTE: all flux rates are in ft/sec, all depths are in ft.
-static double    Area;            // subcatchment area (ft2)                   //(5.1.008)
-static double    Infil;           // infiltration rate from surface
-static double    MaxEvap;         // max. evaporation rate
-static double    AvailEvap;       // available evaporation rate
-static double    UpperEvap;       // evaporation rate from upper GW zone
-static double    LowerEvap;       // evaporation rate from lower GW zone
-static double    UpperPerc;       // percolation rate from upper to lower zone
-static double    LowerLoss;       // loss rate from lower GW zone
-static double    GWFlow;          // flow rate from lower zone to conveyance node
-static double    MaxUpperPerc;    // upper limit on UpperPerc
-static double    MaxGWFlowPos;    // upper limit on GWFlow when its positve
-static double    MaxGWFlowNeg;    // upper limit on GWFlow when its negative
-static double    FracPerv;        // fraction of surface that is pervious
-static double    TotalDepth;      // total depth of GW aquifer
-static double    Theta;           // moisture content of upper zone
-static double    HydCon;          // unsaturated hydraulic conductivity (ft/s) //(5.1.010)
-static double    Hgw;             // ht. of saturated zone
-static double    Hstar;           // ht. from aquifer bottom to node invert
-static double    Hsw;             // ht. from aquifer bottom to water surface
-static double    Tstep;           // current time step (sec)
-static TAquifer  A;               // aquifer being analyzed
-static TGroundwater* GW;          // groundwater object being analyzed
-static MathExpr* LatFlowExpr;     // user-supplied lateral GW flow expression  //(5.1.007)
-static MathExpr* DeepFlowExpr;    // user-supplied deep GW flow expression     //(5.1.007)
+static THREADLOCAL double    Area;            // subcatchment area (ft2)                   //(5.1.008)
+static THREADLOCAL double    Infil;           // infiltration rate from surface
+static THREADLOCAL double    MaxEvap;         // max. evaporation rate
+static THREADLOCAL double    AvailEvap;       // available evaporation rate
+static THREADLOCAL double    UpperEvap;       // evaporation rate from upper GW zone
+static THREADLOCAL double    LowerEvap;       // evaporation rate from lower GW zone
+static THREADLOCAL double    UpperPerc;       // percolation rate from upper to lower zone
+static THREADLOCAL double    LowerLoss;       // loss rate from lower GW zone
+static THREADLOCAL double    GWFlow;          // flow rate from lower zone to conveyance node
+static THREADLOCAL double    MaxUpperPerc;    // upper limit on UpperPerc
+static THREADLOCAL double    MaxGWFlowPos;    // upper limit on GWFlow when its positve
+static THREADLOCAL double    MaxGWFlowNeg;    // upper limit on GWFlow when its negative
+static THREADLOCAL double    FracPerv;        // fraction of surface that is pervious
+static THREADLOCAL double    TotalDepth;      // total depth of GW aquifer
+static THREADLOCAL double    Theta;           // moisture content of upper zone
+static THREADLOCAL double    HydCon;          // unsaturated hydraulic conductivity (ft/s) //(5.1.010)
+static THREADLOCAL double    Hgw;             // ht. of saturated zone
+static THREADLOCAL double    Hstar;           // ht. from aquifer bottom to node invert
+static THREADLOCAL double    Hsw;             // ht. from aquifer bottom to water surface
+static THREADLOCAL double    Tstep;           // current time step (sec)
+static THREADLOCAL TAquifer  A;               // aquifer being analyzed
+static THREADLOCAL TGroundwater* GW;          // groundwater object being analyzed
+static THREADLOCAL MathExpr* LatFlowExpr;     // user-supplied lateral GW flow expression  //(5.1.007)
+static THREADLOCAL MathExpr* DeepFlowExpr;    // user-supplied deep GW flow expression     //(5.1.007)
 
 //-----------------------------------------------------------------------------
 //  External Functions (declared in funcs.h)
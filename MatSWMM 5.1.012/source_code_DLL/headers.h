@@ -11,6 +11,7 @@
 //   DO NOT CHANGE THE ORDER OF THE #INCLUDE STATEMENTS
 //-----------------------------------------------------------------------------
 #include <stdio.h>
+#include <time.h>
 #include "consts.h"
 #include "macros.h"
 #include "enums.h"
@@ -37,6 +37,14 @@
 //   Build 5.1.011:
 //   - Link control setting bug when reading a hot start file fixed.    
 //
+//   The state of a running simulation can also be kept in memory
+//   (hotstart_saveState / hotstart_restoreState) so that it can be returned
+//   to after stepping ahead, e.g. to try out several control strategies
+//   from the same starting point. Unlike a hot start file, an in-memory
+//   state holds the complete set of time-varying variables (including the
+//   simulation clocks, mass balance totals and summary statistics) and can
+//   only be restored within the same run of the project that saved it.
+//
 //-----------------------------------------------------------------------------
 #define _CRT_SECURE_NO_DEPRECATE
 
@@ -45,17 +53,43 @@
 #include <string.h>
 #include <math.h>
 #include "headers.h"
+#include "lid.h"
+#include "exfil.h"
 
 //-----------------------------------------------------------------------------
 //  Local Variables
 //-----------------------------------------------------------------------------
-static int fileVersion;
+static THREADLOCAL int fileVersion;
+
+//-----------------------------------------------------------------------------
+//  In-memory simulation state
+//-----------------------------------------------------------------------------
+enum StateMode {STATE_SIZE, STATE_SAVE, STATE_RESTORE};
+
+typedef struct
+{
+    TProject* project;          // project that saved the state
+    long      runCount;         // run of the project that saved the state
+    size_t    size;             // size of the saved data (bytes)
+    char*     data;             // saved data
+}  TState;
+
+static THREADLOCAL TState* theState;   // state being saved or restored
+static THREADLOCAL int     stateMode;  // a StateMode code
+static THREADLOCAL size_t  statePos;   // current position in state's data
+
+// Shared variables
+#define RunCount (Project->RunCount)   // number of simulations started
 
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)
 //-----------------------------------------------------------------------------
 // hotstart_open                          (called by swmm_start in swmm5.c)
 // hotstart_close                         (called by swmm_end in swmm5.c)      //(5.1.005)
+// hotstart_saveState                     (called by swmm_saveState in swmm5.c)
+// hotstart_restoreState                  (called by swmm_restoreState in swmm5.c)
+// hotstart_deleteState                   (called by swmm_deleteState in swmm5.c)
+// hotstart_copyState                     (called by modules with private state)
 
 //-----------------------------------------------------------------------------
 // Function declarations
@@ -68,11 +102,17 @@ static void readRouting(void);
 static void saveRouting(void);
 static int  readFloat(float *x, FILE* f);
 static int  readDouble(double* x, FILE* f);
+static void copyState(void);
+static void copyArray(void* x, int n, size_t size);
+static void copyFilePos(TFile* f);
 
 //=============================================================================
 
 int hotstart_open()
 {
+    // --- start a new run (in-memory states of previous runs become invalid)
+    RunCount++;
+
     // --- open hot start files
     if ( !openHotstartFile1() ) return FALSE;       //input hot start file
     if ( !openHotstartFile2() ) return FALSE;       //output hot start file
@@ -102,6 +142,331 @@ void hotstart_close()
 
 //=============================================================================
 
+int hotstart_saveState(void** state)
+//
+//  Input:   state = a previously saved state to overwrite or NULL
+//  Output:  state = in-memory state of the current simulation;
+//           returns an error code
+//  Purpose: saves the state of the simulation in progress to memory.
+//
+{
+    TState* s = (TState *)(*state);
+    size_t  size;
+
+    // --- find the size of the state
+    theState = NULL;
+    stateMode = STATE_SIZE;
+    statePos = 0;
+    copyState();
+    size = statePos;
+
+    // --- re-use the memory of a state saved earlier in the same run
+    if ( s && (s->project != Project || s->runCount != RunCount ||
+               s->size != size) )
+    {
+        hotstart_deleteState(s);
+        s = NULL;
+        *state = NULL;
+    }
+    if ( s == NULL )
+    {
+        s = (TState *) calloc(1, sizeof(TState));
+        if ( s == NULL ) return ERR_MEMORY;
+        s->data = (char *) malloc(size + 1);
+        if ( s->data == NULL )
+        {
+            free(s);
+            return ERR_MEMORY;
+        }
+        s->project = Project;
+        s->runCount = RunCount;
+        s->size = size;
+    }
+
+    // --- copy the state into it
+    theState = s;
+    stateMode = STATE_SAVE;
+    statePos = 0;
+    copyState();
+    theState = NULL;
+    *state = s;
+    return 0;
+}
+
+//=============================================================================
+
+int hotstart_restoreState(void* state)
+//
+//  Input:   state = an in-memory state
+//  Output:  returns an error code
+//  Purpose: returns the simulation in progress to a state saved by
+//           hotstart_saveState.
+//
+{
+    TState* s = (TState *)state;
+
+    if ( s == NULL || s->project != Project || s->runCount != RunCount )
+        return ERR_NOT_OPEN;
+    theState = s;
+    stateMode = STATE_RESTORE;
+    statePos = 0;
+    copyState();
+    theState = NULL;
+    return 0;
+}
+
+//=============================================================================
+
+void hotstart_deleteState(void* state)
+//
+//  Input:   state = an in-memory state
+//  Output:  none
+//  Purpose: frees the memory used by an in-memory state.
+//
+{
+    TState* s = (TState *)state;
+
+    if ( s == NULL ) return;
+    FREE(s->data);
+    free(s);
+}
+
+//=============================================================================
+
+void hotstart_copyState(void* x, size_t size)
+//
+//  Input:   x = address of a block of state variables
+//           size = size of the block (bytes)
+//  Output:  none
+//  Purpose: copies a block of state variables to or from the in-memory
+//           state being saved or restored.
+//
+{
+    if ( x == NULL || size == 0 ) return;
+    if ( stateMode == STATE_SAVE ) memcpy(theState->data + statePos, x, size);
+    else if ( stateMode == STATE_RESTORE )
+        memcpy(x, theState->data + statePos, size);
+    statePos += size;
+}
+
+//=============================================================================
+
+void copyState()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: copies all time-varying variables of a simulation to or from
+//           an in-memory state.
+//
+//  Note:    whole object arrays are copied, including their pointers to
+//           other data, since those pointers do not change during a run.
+//
+{
+    int i, j, k;
+    int nPolluts = Nobjects[POLLUT];
+    int nSubcatch = Nobjects[SUBCATCH];
+    int nNodes = Nobjects[NODE];
+    int nLinks = Nobjects[LINK];
+
+    // --- simulation clocks & counters
+    hotstart_copyState(&ReportTime, sizeof(double));
+    hotstart_copyState(&OldRunoffTime, sizeof(double));
+    hotstart_copyState(&NewRunoffTime, sizeof(double));
+    hotstart_copyState(&OldRoutingTime, sizeof(double));
+    hotstart_copyState(&NewRoutingTime, sizeof(double));
+    hotstart_copyState(&ElapsedTime, sizeof(double));
+    hotstart_copyState(&Nperiods, sizeof(long));
+    hotstart_copyState(&StepCount, sizeof(long));
+    hotstart_copyState(&NonConvergeCount, sizeof(long));
+
+    // --- climate
+    hotstart_copyState(&Temp, sizeof(TTemp));
+    hotstart_copyState(&Evap, sizeof(TEvap));
+    hotstart_copyState(&Wind, sizeof(TWind));
+    hotstart_copyState(&Snow, sizeof(TSnow));
+    hotstart_copyState(&Project->Tmin, sizeof(double));
+    hotstart_copyState(&Project->Tmax, sizeof(double));
+    hotstart_copyState(&Project->Trng, sizeof(double));
+    hotstart_copyState(&Project->Trng1, sizeof(double));
+    hotstart_copyState(&Project->Tave, sizeof(double));
+    hotstart_copyState(&Project->Hrsr, sizeof(double));
+    hotstart_copyState(&Project->Hrss, sizeof(double));
+    hotstart_copyState(&Project->Hrday, sizeof(double));
+    hotstart_copyState(&Project->Dhrdy, sizeof(double));
+    hotstart_copyState(&Project->Dydif, sizeof(double));
+    hotstart_copyState(&Project->LastDay, sizeof(DateTime));
+    hotstart_copyState(&Project->Tma, sizeof(TMovAve));
+    hotstart_copyState(&Project->NextEvapDate, sizeof(DateTime));
+    hotstart_copyState(&Project->NextEvapRate, sizeof(double));
+    hotstart_copyState(&Project->FileYear, sizeof(int));
+    hotstart_copyState(&Project->FileMonth, sizeof(int));
+    hotstart_copyState(&Project->FileDay, sizeof(int));
+    hotstart_copyState(&Project->FileLastDay, sizeof(int));
+    hotstart_copyState(&Project->FileElapsedDays, sizeof(int));
+    hotstart_copyState(Project->FileValue, sizeof(Project->FileValue));
+    hotstart_copyState(Project->FileData, sizeof(Project->FileData));
+
+    // --- rain gages & time series (incl. their current interval)
+    copyArray(Gage, Nobjects[GAGE], sizeof(TGage));
+    copyArray(Tseries, Nobjects[TSERIES], sizeof(TTable));
+    copyArray(Curve, Nobjects[CURVE], sizeof(TTable));
+
+    // --- subcatchments, with their infiltration, groundwater, snow pack
+    //     and water quality
+    copyArray(Subcatch, nSubcatch, sizeof(TSubcatch));
+    copyArray(HortInfil, nSubcatch, sizeof(THorton));
+    copyArray(GAInfil, nSubcatch, sizeof(TGrnAmpt));
+    copyArray(CNInfil, nSubcatch, sizeof(TCurveNum));
+    for (i = 0; i < nSubcatch; i++)
+    {
+        hotstart_copyState(Subcatch[i].groundwater, sizeof(TGroundwater));
+        hotstart_copyState(Subcatch[i].snowpack, sizeof(TSnowpack));
+        copyArray(Subcatch[i].oldQual, nPolluts, sizeof(double));
+        copyArray(Subcatch[i].newQual, nPolluts, sizeof(double));
+        copyArray(Subcatch[i].pondedQual, nPolluts, sizeof(double));
+        copyArray(Subcatch[i].totalLoad, nPolluts, sizeof(double));
+        copyArray(Subcatch[i].landFactor, Nobjects[LANDUSE],
+                  sizeof(TLandFactor));
+        for (k = 0; k < Nobjects[LANDUSE]; k++)
+            copyArray(Subcatch[i].landFactor[k].buildup, nPolluts,
+                      sizeof(double));
+    }
+    lid_copyState();
+
+    // --- nodes
+    copyArray(Node, nNodes, sizeof(TNode));
+    copyArray(Outfall, Nnodes[OUTFALL], sizeof(TOutfall));
+    copyArray(Storage, Nnodes[STORAGE], sizeof(TStorage));
+    for (i = 0; i < nNodes; i++)
+    {
+        copyArray(Node[i].oldQual, nPolluts, sizeof(double));
+        copyArray(Node[i].newQual, nPolluts, sizeof(double));
+    }
+    for (j = 0; j < Nnodes[OUTFALL]; j++)
+        copyArray(Outfall[j].wRouted, nPolluts, sizeof(double));
+    for (j = 0; j < Nnodes[STORAGE]; j++)
+    {
+        if ( Storage[j].exfil == NULL ) continue;
+        hotstart_copyState(Storage[j].exfil->btmExfil, sizeof(TGrnAmpt));
+        hotstart_copyState(Storage[j].exfil->bankExfil, sizeof(TGrnAmpt));
+    }
+
+    // --- links
+    copyArray(Link, nLinks, sizeof(TLink));
+    copyArray(Conduit, Nlinks[CONDUIT], sizeof(TConduit));
+    copyArray(Pump, Nlinks[PUMP], sizeof(TPump));
+    copyArray(Orifice, Nlinks[ORIFICE], sizeof(TOrifice));
+    copyArray(Weir, Nlinks[WEIR], sizeof(TWeir));
+    copyArray(Outlet, Nlinks[OUTLET], sizeof(TOutlet));
+    for (i = 0; i < nLinks; i++)
+    {
+        copyArray(Link[i].oldQual, nPolluts, sizeof(double));
+        copyArray(Link[i].newQual, nPolluts, sizeof(double));
+        copyArray(Link[i].totalLoad, nPolluts, sizeof(double));
+    }
+
+    // --- runoff & routing
+    hotstart_copyState(&Project->IsRaining, sizeof(char));
+    hotstart_copyState(&Project->HasRunoff, sizeof(char));
+    hotstart_copyState(&Project->HasSnow, sizeof(char));
+    hotstart_copyState(&HasWetLids, sizeof(char));
+    hotstart_copyState(&Project->Nsteps, sizeof(int));
+    copyArray(OutflowLoad, nPolluts, sizeof(double));
+    hotstart_copyState(&Project->NextEvent, sizeof(int));
+    hotstart_copyState(&Project->BetweenEvents, sizeof(int));
+    dynwave_copyState();
+
+    // --- control rules (PID errors & last premise results)
+    controls_copyState();
+
+    // --- external inflows from interface files
+    if ( Project->OldIfaceValues )
+    {
+        k = Project->NumIfaceNodes * (1 + Project->NumIfacePolluts);
+        copyArray(Project->OldIfaceValues[0], k, sizeof(double));
+        copyArray(Project->NewIfaceValues[0], k, sizeof(double));
+    }
+    hotstart_copyState(&Project->IfaceFrac, sizeof(double));
+    hotstart_copyState(&Project->OldIfaceDate, sizeof(DateTime));
+    hotstart_copyState(&Project->NewIfaceDate, sizeof(DateTime));
+    copyArray(Project->RdiiNodeFlow, Project->NumRdiiNodes, sizeof(float));
+    hotstart_copyState(&Project->RdiiStartDate, sizeof(DateTime));
+    hotstart_copyState(&Project->RdiiEndDate, sizeof(DateTime));
+
+    // --- mass balance totals
+    hotstart_copyState(&Project->RunoffTotals, sizeof(TRunoffTotals));
+    copyArray(Project->LoadingTotals, nPolluts, sizeof(TLoadingTotals));
+    hotstart_copyState(&Project->GwaterTotals, sizeof(TGwaterTotals));
+    hotstart_copyState(&Project->FlowTotals, sizeof(TRoutingTotals));
+    copyArray(Project->QualTotals, nPolluts, sizeof(TRoutingTotals));
+    hotstart_copyState(&StepFlowTotals, sizeof(TRoutingTotals));
+    hotstart_copyState(&Project->OldStepFlowTotals, sizeof(TRoutingTotals));
+    copyArray(Project->StepQualTotals, nPolluts, sizeof(TRoutingTotals));
+    copyArray(NodeInflow, nNodes, sizeof(double));
+    copyArray(NodeOutflow, nNodes, sizeof(double));
+
+    // --- summary statistics
+    hotstart_copyState(&Project->SysStats, sizeof(TSysStats));
+    hotstart_copyState(Project->MaxMassBalErrs, sizeof(Project->MaxMassBalErrs));
+    hotstart_copyState(Project->MaxCourantCrit, sizeof(Project->MaxCourantCrit));
+    hotstart_copyState(Project->MaxFlowTurns, sizeof(Project->MaxFlowTurns));
+    hotstart_copyState(&Project->SysOutfallFlow, sizeof(double));
+    hotstart_copyState(&MaxOutfallFlow, sizeof(double));
+    hotstart_copyState(&MaxRunoffFlow, sizeof(double));
+    copyArray(SubcatchStats, nSubcatch, sizeof(TSubcatchStats));
+    copyArray(NodeStats, nNodes, sizeof(TNodeStats));
+    copyArray(LinkStats, nLinks, sizeof(TLinkStats));
+    copyArray(StorageStats, Nnodes[STORAGE], sizeof(TStorageStats));
+    copyArray(OutfallStats, Nnodes[OUTFALL], sizeof(TOutfallStats));
+    copyArray(PumpStats, Nlinks[PUMP], sizeof(TPumpStats));
+    if ( OutfallStats ) for (j = 0; j < Nnodes[OUTFALL]; j++)
+        copyArray(OutfallStats[j].totalLoad, nPolluts, sizeof(double));
+
+    // --- positions in files read or written as the simulation proceeds
+    //     (results written after a state was saved get overwritten once
+    //     it is restored)
+    copyFilePos(&Fout);
+    copyFilePos(&Fclimate);
+    copyFilePos(&Frunoff);
+    copyFilePos(&Frdii);
+    copyFilePos(&Finflows);
+    copyFilePos(&Foutflows);
+}
+
+//=============================================================================
+
+void copyArray(void* x, int n, size_t size)
+//
+//  Input:   x = an array of state variables
+//           n = number of elements in the array
+//           size = size of each element (bytes)
+//  Output:  none
+//  Purpose: copies an array to or from an in-memory state.
+//
+{
+    if ( n > 0 ) hotstart_copyState(x, n * size);
+}
+
+//=============================================================================
+
+void copyFilePos(TFile* f)
+//
+//  Input:   f = a SWMM file
+//  Output:  none
+//  Purpose: copies the current position of an open file to or from an
+//           in-memory state.
+//
+{
+    fpos_t pos;
+
+    if ( f->file == NULL ) return;
+    if ( stateMode == STATE_SAVE ) fgetpos(f->file, &pos);
+    hotstart_copyState(&pos, sizeof(fpos_t));
+    if ( stateMode == STATE_RESTORE ) fsetpos(f->file, &pos);
+}
+
+//=============================================================================
+
 int openHotstartFile1()
 //
 //  Input:   none
@@ -237,11 +602,13 @@ void  saveRouting()
 //  Purpose: saves current state of all nodes and links to hotstart file.
 //
 {
-    int   i, j;
+    int   i, j, k;
     float x[3];
 
-    for (i = 0; i < Nobjects[NODE]; i++)
+    // --- nodes and links are saved in input order
+    for (k = 0; k < Nobjects[NODE]; k++)
     {
+        i = NodeOrder[k];
         x[0] = (float)Node[i].newDepth;
         x[1] = (float)Node[i].newLatFlow;
         fwrite(x, sizeof(float), 2, Fhotstart2.file);
@@ -261,8 +628,9 @@ void  saveRouting()
             fwrite(&x[0], sizeof(float), 1, Fhotstart2.file);
         }
     }
-    for (i = 0; i < Nobjects[LINK]; i++)
+    for (k = 0; k < Nobjects[LINK]; k++)
     {
+        i = LinkOrder[k];
         x[0] = (float)Link[i].newFlow;
         x[1] = (float)Link[i].newDepth;
         x[2] = (float)Link[i].setting;
@@ -285,7 +653,7 @@ void readRouting()
 //           from hotstart file.
 //
 {
-    int   i, j;
+    int   i, j, k;
     float x;
     double xgw[4];
     FILE* f = Fhotstart1.file;
@@ -309,9 +677,10 @@ void readRouting()
         }
     }
 
-    // --- read node states
-    for (i = 0; i < Nobjects[NODE]; i++)
+    // --- read node states (saved in input order)
+    for (k = 0; k < Nobjects[NODE]; k++)
     {
+        i = NodeOrder[k];
         if ( !readFloat(&x, f) ) return;
         Node[i].newDepth = x;
         if ( !readFloat(&x, f) ) return;
@@ -343,8 +712,9 @@ void readRouting()
     }
 
     // --- read link states
-    for (i = 0; i < Nobjects[LINK]; i++)
+    for (k = 0; k < Nobjects[LINK]; k++)
     {
+        i = LinkOrder[k];
         if ( !readFloat(&x, f) ) return;
         Link[i].newFlow = x;
         if ( !readFloat(&x, f) ) return;
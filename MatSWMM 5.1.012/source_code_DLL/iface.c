@@ -22,17 +22,17 @@ extern double Qcf[];                   // flow units conversion factors
 //-----------------------------------------------------------------------------                  
 //  Shared variables
 //-----------------------------------------------------------------------------                  
-static int      IfaceFlowUnits;        // flow units for routing interface file
-static int      IfaceStep;             // interface file time step (sec)
-static int      NumIfacePolluts;       // number of pollutants in interface file
-static int*     IfacePolluts;          // indexes of interface file pollutants
-static int      NumIfaceNodes;         // number of nodes on interface file
-static int*     IfaceNodes;            // indexes of nodes on interface file
-static double** OldIfaceValues;        // interface flows & WQ at previous time
-static double** NewIfaceValues;        // interface flows & WQ at next time
-static double   IfaceFrac;             // fraction of interface file time step
-static DateTime OldIfaceDate;          // previous date of interface values
-static DateTime NewIfaceDate;          // next date of interface values
+#define IfaceFlowUnits  (Project->IfaceFlowUnits)  // flow units for routing interface file
+#define IfaceStep       (Project->IfaceStep)       // interface file time step (sec)
+#define NumIfacePolluts (Project->NumIfacePolluts) // number of pollutants in interface file
+#define IfacePolluts    (Project->IfacePolluts)    // indexes of interface file pollutants
+#define NumIfaceNodes   (Project->NumIfaceNodes)   // number of nodes on interface file
+#define IfaceNodes      (Project->IfaceNodes)      // indexes of nodes on interface file
+#define OldIfaceValues  (Project->OldIfaceValues)  // interface flows & WQ at previous time
+#define NewIfaceValues  (Project->NewIfaceValues)  // interface flows & WQ at next time
+#define IfaceFrac       (Project->IfaceFrac)       // fraction of interface file time step
+#define OldIfaceDate    (Project->OldIfaceDate)    // previous date of interface values
+#define NewIfaceDate    (Project->NewIfaceDate)    // next date of interface values
 
 //-----------------------------------------------------------------------------
 //  External Functions (declared in funcs.h)
@@ -281,15 +281,16 @@ void iface_saveOutletResults(DateTime reportDate, FILE* file)
 //  Purpose: saves system outflows to routing interface file.
 //
 {
-    int i, p, yr, mon, day, hr, min, sec;
+    int i, k, p, yr, mon, day, hr, min, sec;
     char theDate[25];
     datetime_decodeDate(reportDate, &yr, &mon, &day);
     datetime_decodeTime(reportDate, &hr, &min, &sec);
     sprintf(theDate, " %04d %02d  %02d  %02d  %02d  %02d ",
             yr, mon, day, hr, min, sec);
-    for (i=0; i<Nobjects[NODE]; i++)
+    for (k=0; k<Nobjects[NODE]; k++)
     {
         // --- check that node is an outlet node
+        i = NodeOrder[k];
         if ( !isOutletNode(i) ) continue;
 
         // --- write node ID, date, flow, and quality to file
@@ -312,7 +313,7 @@ void openFileForOutput()
 //  Purpose: opens a routing interface file for writing.
 //
 {
-    int i, n;
+    int i, k, n;
 
     // --- open the routing file for writing text
     Foutflows.file = fopen(Foutflows.name, "wt");
@@ -344,10 +345,11 @@ void openFileForOutput()
         if ( isOutletNode(i) ) n++;
     }
 
-    // --- write number and names of outlet nodes to file
+    // --- write number and names of outlet nodes to file (in input order)
     fprintf(Foutflows.file, "\n%-4d - number of nodes as listed below:", n);
-    for (i=0; i<Nobjects[NODE]; i++)
+    for (k=0; k<Nobjects[NODE]; k++)
     {
+          i = NodeOrder[k];
           if ( isOutletNode(i) )
             fprintf(Foutflows.file, "\n%s", Node[i].ID);
     }
@@ -40,11 +40,7 @@
 //-----------------------------------------------------------------------------
 //  Local Variables
 //-----------------------------------------------------------------------------
-THorton*   HortInfil = NULL;
-TGrnAmpt*  GAInfil   = NULL;
-TCurveNum* CNInfil   = NULL;
-
-static double Fumax;   // saturated water volume in upper soil zone (ft)
+static THREADLOCAL double Fumax;   // saturated water volume in upper soil zone (ft)
 
 //-----------------------------------------------------------------------------
 //  External Functions (declared in infil.h)
@@ -81,13 +81,6 @@ typedef struct
 
 }  TCurveNum;
 
-//-----------------------------------------------------------------------------
-//   Exported Variables
-//-----------------------------------------------------------------------------
-extern THorton*   HortInfil;
-extern TGrnAmpt*  GAInfil;
-extern TCurveNum* CNInfil;
-
 //-----------------------------------------------------------------------------
 //   Infiltration Methods
 //-----------------------------------------------------------------------------
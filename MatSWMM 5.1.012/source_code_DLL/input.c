@@ -34,12 +34,12 @@ static const int MAXERRS = 100;        // Max. input errors reported
 //-----------------------------------------------------------------------------
 //  Shared variables
 //-----------------------------------------------------------------------------
-static char *Tok[MAXTOKS];             // String tokens from line of input
-static int  Ntokens;                   // Number of tokens in line of input
-static int  Mobjects[MAX_OBJ_TYPES];   // Working number of objects of each type
-static int  Mnodes[MAX_NODE_TYPES];    // Working number of node objects
-static int  Mlinks[MAX_LINK_TYPES];    // Working number of link objects
-static int  Mevents;                   // Working number of event periods      //(5.1.011)
+static THREADLOCAL char *Tok[MAXTOKS];             // String tokens from line of input
+static THREADLOCAL int  Ntokens;                   // Number of tokens in line of input
+static THREADLOCAL int  Mobjects[MAX_OBJ_TYPES];   // Working number of objects of each type
+static THREADLOCAL int  Mnodes[MAX_NODE_TYPES];    // Working number of node objects
+static THREADLOCAL int  Mlinks[MAX_LINK_TYPES];    // Working number of link objects
+static THREADLOCAL int  Mevents;                  // Working number of event periods      //(5.1.011)
 
 //-----------------------------------------------------------------------------
 //  External Functions (declared in funcs.h)
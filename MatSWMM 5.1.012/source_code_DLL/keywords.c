@@ -44,6 +44,7 @@ char* CurveTypeWords[]     = { w_STORAGE, w_DIVERSION, w_TIDAL, w_RATING,
                                w_CONTROLS, w_SHAPE,
                                w_PUMP1, w_PUMP2, w_PUMP3, w_PUMP4, NULL}; 
 char* DividerTypeWords[]   = { w_CUTOFF, w_TABULAR, w_WEIR, w_OVERFLOW, NULL};
+char* DynWaveMethodWords[] = { w_PICARD, w_NEWTON, w_ANDERSON, NULL};
 char* EvapTypeWords[]      = { w_CONSTANT, w_MONTHLY, w_TIMESERIES,
                                w_TEMPERATURE, w_FILE, w_RECOVERY,
                                w_DRYONLY, NULL};
@@ -88,18 +89,23 @@ char* OptionWords[]        = { w_FLOW_UNITS,        w_INFIL_MODEL,
                                w_MAX_TRIALS,        w_HEAD_TOL,
                                w_SYS_FLOW_TOL,      w_LAT_FLOW_TOL,
                                w_IGNORE_RDII,       w_MIN_ROUTE_STEP,          //(5.1.008)
-                               w_NUM_THREADS,       NULL};                     //(5.1.008)
+                               w_NUM_THREADS,       w_DYNWAVE_METHOD,          //(5.1.008)
+                               w_STEP_CLASSES,      w_XSECT_TABLES,
+                               w_RENUMBERING,       w_ACTIVE_SET_TOL,
+                               w_DYNWAVE_PREDICTOR, w_EXPORT_BUFFER, NULL};
 char* OrificeTypeWords[]   = { w_SIDE, w_BOTTOM, NULL};
 char* OutfallTypeWords[]   = { w_FREE, w_NORMAL, w_FIXED, w_TIDAL,
                                w_TIMESERIES, NULL};
 char* PatternTypeWords[]   = { w_MONTHLY, w_DAILY, w_HOURLY, w_WEEKEND, NULL};
 char* PondingUnitsWords[]  = { w_PONDED_FEET, w_PONDED_METERS };
+char* PredictorWords[]     = { w_NONE, w_LINEAR, w_QUADRATIC, NULL};
 char* ProcessVarWords[]    = { w_HRT, w_DT, w_FLOW, w_DEPTH, w_AREA, NULL};
 char* PumpTypeWords[]      = { w_TYPE1, w_TYPE2, w_TYPE3, w_TYPE4, w_IDEAL };
 char* QualUnitsWords[]     = { w_MGperL, w_UGperL, w_COUNTperL, NULL};
 char* RainTypeWords[]      = { w_INTENSITY, w_VOLUME, w_CUMULATIVE, NULL};
 char* RainUnitsWords[]     = { w_INCHES, w_MMETER, NULL};
 char* RelationWords[]      = { w_TABULAR, w_FUNCTIONAL, NULL};
+char* RenumberingWords[]   = { w_NONE, w_RCM, NULL};
 char* ReportWords[]        = { w_INPUT, w_CONTINUITY, w_FLOWSTATS,
                                w_CONTROLS, w_SUBCATCH, w_NODE, w_LINK,
                                w_NODESTATS, NULL};
@@ -40,11 +40,13 @@ extern char* OrificeTypeWords[];
 extern char* OutfallTypeWords[];
 extern char* PatternTypeWords[];
 extern char* PondingUnitsWords[];
+extern char* PredictorWords[];
 extern char* ProcessVarWords[];
 extern char* PumpTypeWords[];
 extern char* QualUnitsWords[];
 extern char* RainTypeWords[];
 extern char* RainUnitsWords[];
+extern char* RenumberingWords[];
 extern char* ReportWords[];
 extern char* RelationWords[];
 extern char* RouteModelWords[];
@@ -30,12 +30,12 @@ static const double EPSIL   = 0.001;   // convergence criterion
 //-----------------------------------------------------------------------------
 //  Shared variables
 //-----------------------------------------------------------------------------
-static double   Beta1;
-static double   C1;
-static double   C2;
-static double   Afull;
-static double   Qfull;
-static TXsect*  pXsect;
+static THREADLOCAL double   Beta1;
+static THREADLOCAL double   C1;
+static THREADLOCAL double   C2;
+static THREADLOCAL double   Afull;
+static THREADLOCAL double   Qfull;
+static THREADLOCAL TXsect*  pXsect;
 
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)
@@ -35,6 +35,7 @@
 //  landuse_getWashoffLoad    (called by surfqual_getWashoff)
 //  landuse_getCoPollutLoad   (called by surfqual_getwashoff));
 //  landuse_getAvgBMPEffic    (called by updatePondedQual in surfqual.c)
+//  landuse_setExternalRates  (called by runoff_execute)
 
 //-----------------------------------------------------------------------------
 // Function declarations
@@ -696,6 +697,39 @@ double landuse_getCoPollutLoad(int p, double washoff[])
 
 //=============================================================================
 
+void landuse_setExternalRates()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: finds the rate of each external buildup function over the
+//           current runoff time step.
+//
+//  This is done once per time step, before the subcatchments are analyzed,
+//  since several of them may share the same buildup time series and a
+//  time series lookup updates the series' position.
+//
+{
+    int    i, p, ts;
+    double sf;
+    DateTime t = getDateTime(NewRunoffTime);
+
+    for (i = 0; i < Nobjects[LANDUSE]; i++)
+    {
+        for (p = 0; p < Nobjects[POLLUT]; p++)
+        {
+            if ( Landuse[i].buildupFunc[p].funcType != EXTERNAL_BUILDUP )
+                continue;
+            sf = Landuse[i].buildupFunc[p].coeff[1];             // scaling factor
+            ts = (int)floor(Landuse[i].buildupFunc[p].coeff[2]); // time series index
+            Landuse[i].buildupFunc[p].extRate = 0.0;
+            if ( ts >= 0 ) Landuse[i].buildupFunc[p].extRate =
+                sf * table_tseriesLookup(&Tseries[ts], t, FALSE);
+        }
+    }
+}
+
+//=============================================================================
+
 double landuse_getExternalBuildup(int i, int p, double buildup, double tStep)
 //
 //  Input:   i = landuse index
@@ -708,19 +742,14 @@ double landuse_getExternalBuildup(int i, int p, double buildup, double tStep)
 //
 {
     double maxBuildup = Landuse[i].buildupFunc[p].coeff[0];
-    double sf = Landuse[i].buildupFunc[p].coeff[1];              // scaling factor
-    int    ts = (int)floor(Landuse[i].buildupFunc[p].coeff[2]);  // time series index
-    double rate = 0.0;
+    double rate;
 
     // --- no buildup increment at start of simulation
     if (NewRunoffTime == 0.0) return 0.0;
 
-    // --- get buildup rate (mass/unit/day) over the interval
-    if ( ts >= 0 )
-    {        
-        rate = sf * table_tseriesLookup(&Tseries[ts],
-               getDateTime(NewRunoffTime), FALSE);
-    }
+    // --- buildup rate (mass/unit/day) over the interval was found
+    //     by landuse_setExternalRates
+    rate = Landuse[i].buildupFunc[p].extRate;
 
     // --- compute buildup at end of time interval
     buildup = buildup + rate * tStep / SECperDAY;
@@ -136,29 +136,27 @@ typedef struct LidGroup* TLidGroup;
 //-----------------------------------------------------------------------------
 //  Shared Variables
 //-----------------------------------------------------------------------------
-static TLidProc*  LidProcs;            // array of LID processes
-static int        LidCount;            // number of LID processes
-static TLidGroup* LidGroups;           // array of LID process groups
-static int        GroupCount;          // number of LID groups (subcatchments)
+#define LidProcs   (Project->LidProcs)   // array of LID processes
+#define LidCount   (Project->LidCount)   // number of LID processes
+#define LidGroups  (Project->LidGroups)  // array of LID process groups
+#define GroupCount (Project->GroupCount) // number of LID groups (subcatchments)
 
-static double     EvapRate;            // evaporation rate (ft/s)
-static double     NativeInfil;         // native soil infil. rate (ft/s)
-static double     MaxNativeInfil;      // native soil infil. rate limit (ft/s)
+static THREADLOCAL double     EvapRate;            // evaporation rate (ft/s)
+static THREADLOCAL double     NativeInfil;         // native soil infil. rate (ft/s)
+static THREADLOCAL double     MaxNativeInfil;      // native soil infil. rate limit (ft/s)
 
 //-----------------------------------------------------------------------------
 //  Imported Variables (from SUBCATCH.C)
 //-----------------------------------------------------------------------------
 // Volumes (ft3) for a subcatchment over a time step                           //(5.1.008)
-extern double     Vevap;               // evaporation
-extern double     Vpevap;              // pervious area evaporation
-extern double     Vinfil;              // non-LID infiltration
-extern double     VlidInfil;           // infiltration from LID units
-extern double     VlidIn;              // impervious area flow to LID units
-extern double     VlidOut;             // surface outflow from LID units
-extern double     VlidDrain;           // drain outflow from LID units
-extern double     VlidReturn;          // LID outflow returned to pervious area
-extern char       HasWetLids;          // TRUE if any LIDs are wet             //(5.1.010)
-                                       // (from RUNOFF.C)                      //(5.1.010)
+extern THREADLOCAL double     Vevap;               // evaporation
+extern THREADLOCAL double     Vpevap;              // pervious area evaporation
+extern THREADLOCAL double     Vinfil;              // non-LID infiltration
+extern THREADLOCAL double     VlidInfil;           // infiltration from LID units
+extern THREADLOCAL double     VlidIn;              // impervious area flow to LID units
+extern THREADLOCAL double     VlidOut;             // surface outflow from LID units
+extern THREADLOCAL double     VlidDrain;           // drain outflow from LID units
+extern THREADLOCAL double     VlidReturn;          // LID outflow returned to pervious area
 
 ////  Deleted for release 5.1.008.  ////                                       //(5.1.008)
 //static double     NextReportTime;
@@ -170,12 +168,14 @@ extern char       HasWetLids;          // TRUE if any LIDs are wet             /
 //  lid_create               called by createObjects in project.c
 //  lid_delete               called by deleteObjects in project.c
 //  lid_validate             called by project_validate
+//  lid_renumberNodes        called by remapIndexes in renumber.c
 //  lid_initState            called by project_init
 
 //  lid_readProcParams       called by parseLine in input.c
 //  lid_readGroupParams      called by parseLine in input.c
 
 //  lid_setOldGroupState     called by subcatch_setOldState
+//  lid_copyState            called by copyState in hotstart.c
 //  lid_setReturnQual        called by findLidLoads in surfqual.c              //(5.1.008)
 //  lid_getReturnQual        called by subcatch_getRunon                       //(5.1.008)
 
@@ -191,6 +191,7 @@ extern char       HasWetLids;          // TRUE if any LIDs are wet             /
 //  lid_addDrainRunon        called by subcatch_getRunon
 //  lid_addDrainLoads        called by surfqual_getWashoff
 //  lid_addDrainInflow       called by addLidDrainInflows in routing.c
+//  lid_getDrainSubcatchs    called by findRunonLevels in runoff.c
 
 //  lid_writeSummary         called by inputrpt_writeInput
 //  lid_writeWaterBalance    called by statsrpt_writeReport
@@ -821,6 +822,36 @@ void lid_validate()
 
 //=============================================================================
 
+void lid_renumberNodes(int nodeIndex[])
+//
+//  Purpose: updates the drain nodes of all LID units after the project's
+//           nodes have been renumbered.
+//  Input:   nodeIndex = new index of each node
+//  Output:  none
+//
+{
+    int        j;
+    TLidGroup  lidGroup;
+    TLidList*  lidList;
+    TLidUnit*  lidUnit;
+
+    for (j = 0; j < GroupCount; j++)
+    {
+        lidGroup = LidGroups[j];
+        if ( lidGroup == NULL ) continue;
+        lidList = lidGroup->lidList;
+        while ( lidList )
+        {
+            lidUnit = lidList->lidUnit;
+            if ( lidUnit->drainNode >= 0 )
+                lidUnit->drainNode = nodeIndex[lidUnit->drainNode];
+            lidList = lidList->nextLidUnit;
+        }
+    }
+}
+
+//=============================================================================
+
 void validateLidProc(int j)
 //
 //  Purpose: validates LID process parameters.
@@ -1246,6 +1277,35 @@ void  lid_setOldGroupState(int j)
 
 //=============================================================================
 
+void  lid_copyState()
+//
+//  Purpose: copies the state of each LID unit to or from an in-memory
+//           simulation state.
+//  Input:   none
+//  Output:  none
+//
+{
+    int        j;
+    TLidList*  lidList;
+    TLidGroup  lidGroup;
+
+    for (j = 0; j < GroupCount; j++)
+    {
+        lidGroup = LidGroups[j];
+        if ( lidGroup == NULL ) continue;
+        hotstart_copyState(lidGroup, sizeof(struct LidGroup));
+        lidList = lidGroup->lidList;
+        while ( lidList )
+        {
+            hotstart_copyState(lidList->lidUnit, sizeof(TLidUnit));
+            hotstart_copyState(lidList->lidUnit->rptFile, sizeof(TLidRptFile));
+            lidList = lidList->nextLidUnit;
+        }
+    }
+}
+
+//=============================================================================
+
 int isLidPervious(int k)
 //
 //  Purpose: determines if a LID process allows infiltration or not.
@@ -1317,6 +1377,35 @@ double   lid_getFlowToPerv(int j)
 
 //=============================================================================
 
+int lid_getDrainSubcatchs(int j, int subcatchs[])
+//
+//  Purpose: lists the other subcatchments that receive underdrain flow
+//           from the LIDs placed in a subcatchment.
+//  Input:   j = subcatchment index
+//  Output:  subcatchs = indexes of the receiving subcatchments (if not NULL);
+//           returns the number of receiving subcatchments
+//
+{
+    int n = 0;
+    TLidList* lidList;
+
+    if ( LidGroups == NULL || LidGroups[j] == NULL ) return 0;
+    lidList = LidGroups[j]->lidList;
+    while ( lidList )
+    {
+        if ( lidList->lidUnit->drainSubcatch >= 0 &&
+             lidList->lidUnit->drainSubcatch != j )
+        {
+            if ( subcatchs ) subcatchs[n] = lidList->lidUnit->drainSubcatch;
+            n++;
+        }
+        lidList = lidList->nextLidUnit;
+    }
+    return n;
+}
+
+//=============================================================================
+
 double lid_getStoredVolume(int j)
 //
 //  Purpose: computes stored volume of water for all LIDs 
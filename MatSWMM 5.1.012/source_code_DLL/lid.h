@@ -117,7 +117,7 @@ typedef struct
 }  TDrainMatLayer;
 
 // LID Process - generic LID design per unit of area
-typedef struct
+typedef struct TLidProc
 {
     char*          ID;            // identifying name
     int            lidType;       // type of LID
@@ -189,8 +189,10 @@ int      lid_readProcParams(char* tok[], int ntoks);
 int      lid_readGroupParams(char* tok[], int ntoks);
 
 void     lid_validate(void);
+void     lid_renumberNodes(int nodeIndex[]);
 void     lid_initState(void);
 void     lid_setOldGroupState(int subcatch);                                   //(5.1.008)
+void     lid_copyState(void);
 
 double   lid_getPervArea(int subcatch);
 double   lid_getFlowToPerv(int subcatch);
@@ -203,6 +205,7 @@ double   lid_getStoredVolume(int subcatch);
 void     lid_addDrainLoads(int subcatch, double c[], double tStep);            //(5.1.008)
 void     lid_addDrainRunon(int subcatch);                                      //(5.1.008)
 void     lid_addDrainInflow(int subcatch, double f);                           //(5.1.008)
+int      lid_getDrainSubcatchs(int subcatch, int subcatchs[]);
 
 void     lid_getRunoff(int subcatch, double tStep);                            //(5.1.008)
 
@@ -97,40 +97,39 @@ enum LidRptVars {
 //-----------------------------------------------------------------------------
 //  Imported variables 
 //-----------------------------------------------------------------------------
-extern char HasWetLids;      // TRUE if any LIDs are wet (declared in runoff.c)
 
 //-----------------------------------------------------------------------------
 //  Local Variables
 //-----------------------------------------------------------------------------
-static TLidUnit*  theLidUnit;     // ptr. to a subcatchment's LID unit
-static TLidProc*  theLidProc;     // ptr. to a LID process
+static THREADLOCAL TLidUnit*  theLidUnit;     // ptr. to a subcatchment's LID unit
+static THREADLOCAL TLidProc*  theLidProc;     // ptr. to a LID process
 
-static double     Tstep;          // current time step (sec)
+static THREADLOCAL double     Tstep;          // current time step (sec)
 //static double   Rainfall;       // current rainfall rate (ft/s)              //(5.1.008)
-static double     EvapRate;       // evaporation rate (ft/s)
-static double     MaxNativeInfil; // native soil infil. rate limit (ft/s)
-
-static double     SurfaceInflow;  // precip. + runon to LID unit (ft/s)
-static double     SurfaceInfil;   // infil. rate from surface layer (ft/s)
-static double     SurfaceEvap;    // evap. rate from surface layer (ft/s)
-static double     SurfaceOutflow; // outflow from surface layer (ft/s)
-static double     SurfaceVolume;  // volume in surface storage (ft)
-
-static double     PaveEvap;       // evap. from pavement layer (ft/s)          //(5.1.008)
-static double     PavePerc;       // percolation from pavement layer (ft/s)    //(5.1.008)
-static double     PaveVolume;     // volume stored in pavement layer  (ft)     //(5.1.008)
-
-static double     SoilEvap;       // evap. from soil layer (ft/s)
-static double     SoilPerc;       // percolation from soil layer (ft/s)
-static double     SoilVolume;     // volume in soil/pavement storage (ft)
-
-static double     StorageInflow;  // inflow rate to storage layer (ft/s)
-static double     StorageExfil;   // exfil. rate from storage layer (ft/s)     //(5.1.011)
-static double     StorageEvap;    // evap.rate from storage layer (ft/s)
-static double     StorageDrain;   // underdrain flow rate layer (ft/s)
-static double     StorageVolume;  // volume in storage layer (ft)
-
-static double     Xold[MAX_LAYERS];  // previous moisture level in LID layers  //(5.1.008)
+static THREADLOCAL double     EvapRate;       // evaporation rate (ft/s)
+static THREADLOCAL double     MaxNativeInfil; // native soil infil. rate limit (ft/s)
+
+static THREADLOCAL double     SurfaceInflow;  // precip. + runon to LID unit (ft/s)
+static THREADLOCAL double     SurfaceInfil;   // infil. rate from surface layer (ft/s)
+static THREADLOCAL double     SurfaceEvap;    // evap. rate from surface layer (ft/s)
+static THREADLOCAL double     SurfaceOutflow; // outflow from surface layer (ft/s)
+static THREADLOCAL double     SurfaceVolume;  // volume in surface storage (ft)
+
+static THREADLOCAL double     PaveEvap;       // evap. from pavement layer (ft/s)          //(5.1.008)
+static THREADLOCAL double     PavePerc;       // percolation from pavement layer (ft/s)    //(5.1.008)
+static THREADLOCAL double     PaveVolume;     // volume stored in pavement layer  (ft)     //(5.1.008)
+
+static THREADLOCAL double     SoilEvap;       // evap. from soil layer (ft/s)
+static THREADLOCAL double     SoilPerc;       // percolation from soil layer (ft/s)
+static THREADLOCAL double     SoilVolume;     // volume in soil/pavement storage (ft)
+
+static THREADLOCAL double     StorageInflow;  // inflow rate to storage layer (ft/s)
+static THREADLOCAL double     StorageExfil;   // exfil. rate from storage layer (ft/s)     //(5.1.011)
+static THREADLOCAL double     StorageEvap;    // evap.rate from storage layer (ft/s)
+static THREADLOCAL double     StorageDrain;   // underdrain flow rate layer (ft/s)
+static THREADLOCAL double     StorageVolume;  // volume in storage layer (ft)
+
+static THREADLOCAL double     Xold[MAX_LAYERS];  // previous moisture level in LID layers  //(5.1.008)
 
 //-----------------------------------------------------------------------------
 //  External Functions (declared in lid.h)
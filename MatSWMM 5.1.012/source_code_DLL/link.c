@@ -756,7 +756,7 @@ double  link_getYnorm(int j, double q)
 //
 {
     int    k;
-    double s, a, y;
+    double s, y;
 
     if ( Link[j].type != CONDUIT ) return 0.0;
     if ( Link[j].xsect.type == DUMMY ) return 0.0;
@@ -765,8 +765,7 @@ double  link_getYnorm(int j, double q)
     if ( q > Conduit[k].qMax ) q = Conduit[k].qMax;
     if ( q <= 0.0 ) return 0.0;
     s = q / Conduit[k].beta;
-    a = xsect_getAofS(&Link[j].xsect, s);
-    y = xsect_getYofA(&Link[j].xsect, a);
+    y = xsect_getYofS(&Link[j].xsect, s);
     return y;
 }
 
@@ -1111,6 +1110,13 @@ void  conduit_validate(int j, int k)
          Link[j].cLossAvg    == 0.0
        ) Conduit[k].hasLosses = FALSE;
     else Conduit[k].hasLosses = TRUE;
+
+    // --- tabulate cross section geometry used by Dynamic Wave routing
+    if ( RouteModel == DW && XsectTables && Link[j].xsect.type != DUMMY )
+    {
+        if ( !xsect_createTable(&Link[j].xsect) )
+            report_writeErrorMsg(ERR_MEMORY, "");
+    }
 }
 
 //=============================================================================
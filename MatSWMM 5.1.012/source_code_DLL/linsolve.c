@@ -0,0 +1,423 @@
+//-----------------------------------------------------------------------------
+//   linsolve.c
+//
+//   Direct solution of a sparse system of linear equations A*x = b whose
+//   matrix has a symmetric pattern of non-zero entries (such as one row and
+//   column per node of a network with an entry for each pair of connected
+//   nodes).
+//
+//   The rows are first re-ordered by the minimum degree rule, which keeps
+//   the fill-in of the LU factors small (there is none at all for a tree
+//   shaped network), and the pattern of the factors is found. A is then
+//   factored as A = L*U without pivoting, which is stable for the
+//   diagonally dominant matrices of network flow problems, and each system
+//   is solved by substituting b through L and U. The factors can be used
+//   for several right hand sides. A pivot that is tiny compared to the
+//   largest entry of its row in A is reported as a failure, so the caller
+//   can fall back to some other method rather than use a meaningless
+//   solution.
+//
+//   The caller allocates a matrix with linsolve_open, fills in its start
+//   and index arrays with the matrix's pattern (every row must contain its
+//   diagonal entry), calls linsolve_init once, and then may solve any
+//   number of systems with different values of A and b, calling
+//   linsolve_factor whenever A changes and then linsolve_solve.
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <math.h>
+#include "macros.h"
+#include "linsolve.h"
+
+#define TINY 1.0e-30
+#define PIVOT_TOL 1.0e-8       // smallest pivot relative to its row of A
+
+//-----------------------------------------------------------------------------
+//    Local declarations
+//-----------------------------------------------------------------------------
+typedef struct                 // a growable list of integers
+{
+    int  n;                    // number of items
+    int  size;                 // allocated number of items
+    int* item;                 // the items
+} TIntList;
+
+static int  orderRows(TSparseMatrix* a, int* lStart, TIntList* lIndex);
+static int  buildFactors(TSparseMatrix* a, int* lStart, TIntList* lIndex);
+static int  addItem(TIntList* list, int item);
+static void removeItem(TIntList* list, int item);
+static int  hasItem(TIntList* list, int item);
+
+//-----------------------------------------------------------------------------
+//    allocate a sparse matrix with n rows and nEntries non-zero entries
+//    (return 1 if successful, 0 if not)
+//-----------------------------------------------------------------------------
+int linsolve_open(TSparseMatrix* a, int n, int nEntries)
+{
+    a->n      = n;
+    a->start  = (int *) calloc(n+1, sizeof(int));
+    a->index  = (int *) calloc(nEntries+1, sizeof(int));
+    a->value  = (double *) calloc(nEntries+1, sizeof(double));
+    a->perm   = (int *) calloc(n+1, sizeof(int));
+    a->map    = (int *) calloc(nEntries+1, sizeof(int));
+    a->work   = (double *) calloc(n+1, sizeof(double));
+    a->col    = (int *) calloc(n+1, sizeof(int));
+    a->fStart = NULL;
+    a->fIndex = NULL;
+    a->fDiag  = NULL;
+    a->lu     = NULL;
+    if ( !a->start || !a->index || !a->value || !a->perm || !a->map ||
+         !a->work || !a->col ) return 0;
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+//    re-order the rows of a matrix and find the pattern of its LU factors
+//    (return 1 if successful, 0 if not)
+//-----------------------------------------------------------------------------
+int linsolve_init(TSparseMatrix* a)
+{
+    int      result;
+    int*     lStart;
+    TIntList lIndex = {0, 0, NULL};
+
+    // --- lStart & lIndex list the columns of the upper factor in each row
+    lStart = (int *) calloc(a->n+1, sizeof(int));
+    if ( lStart == NULL ) return 0;
+    result = orderRows(a, lStart, &lIndex);
+    if ( result ) result = buildFactors(a, lStart, &lIndex);
+    free(lStart);
+    FREE(lIndex.item);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//    free a sparse matrix
+//-----------------------------------------------------------------------------
+void linsolve_close(TSparseMatrix* a)
+{
+    FREE(a->start);
+    FREE(a->index);
+    FREE(a->value);
+    FREE(a->perm);
+    FREE(a->fStart);
+    FREE(a->fIndex);
+    FREE(a->fDiag);
+    FREE(a->map);
+    FREE(a->lu);
+    FREE(a->work);
+    FREE(a->col);
+    a->n = 0;
+}
+
+//-----------------------------------------------------------------------------
+//    find the LU factors of a matrix
+//    (return 1 if successful, 0 if a tiny pivot was met)
+//-----------------------------------------------------------------------------
+int linsolve_factor(TSparseMatrix* a)
+{
+    int     i, j, k, m;
+    int*    fStart = a->fStart;
+    int*    fIndex = a->fIndex;
+    int*    col = a->col;
+    double* lu = a->lu;
+    double* rowMax = a->work;
+    double  pivot;
+
+    // --- load the matrix into the factors, noting the largest entry
+    //     of each row
+    for (k = 0; k < fStart[a->n]; k++) lu[k] = 0.0;
+    for (i = 0; i < a->n; i++)
+    {
+        rowMax[i] = 0.0;
+        col[i] = -1;
+    }
+    for (i = 0; i < a->n; i++)
+    {
+        for (k = a->start[i]; k < a->start[i+1]; k++)
+        {
+            lu[a->map[k]] += a->value[k];
+            m = a->perm[i];
+            rowMax[m] = MAX(rowMax[m], fabs(a->value[k]));
+        }
+    }
+
+    for (i = 0; i < a->n; i++)
+    {
+        // --- the pattern of row i holds that of the upper part of every
+        //     row it is combined with, so locate each of its columns
+        for (k = fStart[i]; k < fStart[i+1]; k++) col[fIndex[k]] = k;
+
+        // --- eliminate each entry of row i lying left of the diagonal
+        for (k = fStart[i]; k < a->fDiag[i]; k++)
+        {
+            j = fIndex[k];
+            lu[k] /= lu[a->fDiag[j]];
+            for (m = a->fDiag[j] + 1; m < fStart[j+1]; m++)
+                lu[col[fIndex[m]]] -= lu[k] * lu[m];
+        }
+        for (k = fStart[i]; k < fStart[i+1]; k++) col[fIndex[k]] = -1;
+
+        // --- check that the pivot is not tiny compared to its row
+        pivot = fabs(lu[a->fDiag[i]]);
+        if ( pivot < TINY || pivot < PIVOT_TOL * rowMax[i] ) return 0;
+    }
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+//    solve A*x = b using the LU factors of A
+//-----------------------------------------------------------------------------
+void linsolve_solve(TSparseMatrix* a, double* b, double* x)
+{
+    int     i, k;
+    int     n = a->n;
+    double* z = a->work;
+    double  sum;
+
+    // --- forward substitution with the unit lower factor
+    for (i = 0; i < n; i++) z[a->perm[i]] = b[i];
+    for (i = 0; i < n; i++)
+    {
+        sum = z[i];
+        for (k = a->fStart[i]; k < a->fDiag[i]; k++)
+            sum -= a->lu[k] * z[a->fIndex[k]];
+        z[i] = sum;
+    }
+
+    // --- back substitution with the upper factor
+    for (i = n - 1; i >= 0; i--)
+    {
+        sum = z[i];
+        for (k = a->fDiag[i] + 1; k < a->fStart[i+1]; k++)
+            sum -= a->lu[k] * z[a->fIndex[k]];
+        z[i] = sum / a->lu[a->fDiag[i]];
+    }
+    for (i = 0; i < n; i++) x[i] = z[a->perm[i]];
+}
+
+//-----------------------------------------------------------------------------
+//    order the rows of a matrix by the minimum degree rule, saving in lStart
+//    & lIndex the rows (in their original numbering) linked to each row
+//    when it is eliminated
+//    (return 1 if successful, 0 if not)
+//-----------------------------------------------------------------------------
+int orderRows(TSparseMatrix* a, int* lStart, TIntList* lIndex)
+{
+    int       i, j, k, m, u, v, d;
+    int       n = a->n;
+    int       minDegree = 0;
+    int       result = 0;
+    int*      head;               // first row in each degree's list
+    int*      next;               // next row in its degree's list
+    int*      prev;               // previous row in its degree's list
+    int*      degree;             // number of rows linked to each row
+    TIntList* adj;                // rows linked to each uneliminated row
+
+    head = (int *) malloc((n+1) * sizeof(int));
+    next = (int *) malloc((n+1) * sizeof(int));
+    prev = (int *) malloc((n+1) * sizeof(int));
+    degree = (int *) calloc(n+1, sizeof(int));
+    adj = (TIntList *) calloc(n+1, sizeof(TIntList));
+    if ( !head || !next || !prev || !degree || !adj ) goto done;
+
+    // --- build the graph of links between rows
+    for (i = 0; i < n; i++)
+    {
+        for (k = a->start[i]; k < a->start[i+1]; k++)
+        {
+            j = a->index[k];
+            if ( j == i ) continue;
+            if ( !hasItem(&adj[i], j) && !addItem(&adj[i], j) ) goto done;
+            if ( !hasItem(&adj[j], i) && !addItem(&adj[j], i) ) goto done;
+        }
+    }
+
+    // --- place each row in the list of rows with its degree
+    for (d = 0; d <= n; d++) head[d] = -1;
+    for (i = n - 1; i >= 0; i--)
+    {
+        d = adj[i].n;
+        degree[i] = d;
+        prev[i] = -1;
+        next[i] = head[d];
+        if ( head[d] >= 0 ) prev[head[d]] = i;
+        head[d] = i;
+    }
+
+    // --- eliminate the rows one at a time
+    for (m = 0; m < n; m++)
+    {
+        // --- remove a row of least degree from its list
+        while ( head[minDegree] < 0 ) minDegree++;
+        v = head[minDegree];
+        head[minDegree] = next[v];
+        if ( next[v] >= 0 ) prev[next[v]] = -1;
+        a->perm[v] = m;
+
+        // --- save the rows linked to it & link them to each other
+        lStart[m] = lIndex->n;
+        for (k = 0; k < adj[v].n; k++)
+        {
+            u = adj[v].item[k];
+            if ( !addItem(lIndex, u) ) goto done;
+            removeItem(&adj[u], v);
+            for (j = 0; j < adj[v].n; j++)
+            {
+                i = adj[v].item[j];
+                if ( i != u && !hasItem(&adj[u], i) &&
+                     !addItem(&adj[u], i) ) goto done;
+            }
+        }
+
+        // --- move each linked row to the list for its new degree
+        for (k = 0; k < adj[v].n; k++)
+        {
+            u = adj[v].item[k];
+            d = degree[u];
+            if ( prev[u] >= 0 ) next[prev[u]] = next[u];
+            else head[d] = next[u];
+            if ( next[u] >= 0 ) prev[next[u]] = prev[u];
+            d = adj[u].n;
+            degree[u] = d;
+            prev[u] = -1;
+            next[u] = head[d];
+            if ( head[d] >= 0 ) prev[head[d]] = u;
+            head[d] = u;
+            minDegree = MIN(minDegree, d);
+        }
+        FREE(adj[v].item);
+    }
+    lStart[n] = lIndex->n;
+    result = 1;
+
+done:
+    if ( adj ) for (i = 0; i < n; i++) FREE(adj[i].item);
+    FREE(adj);
+    FREE(head);
+    FREE(next);
+    FREE(prev);
+    FREE(degree);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//    build the pattern of the LU factors (in the new row order) and locate
+//    each entry of the matrix within it
+//    (return 1 if successful, 0 if not)
+//-----------------------------------------------------------------------------
+int buildFactors(TSparseMatrix* a, int* lStart, TIntList* lIndex)
+{
+    int  i, j, k, m, c;
+    int  n = a->n;
+    int  nEntries = n + 2*lStart[n];
+    int* next;
+
+    a->fStart = (int *) calloc(n+1, sizeof(int));
+    a->fIndex = (int *) calloc(nEntries+1, sizeof(int));
+    a->fDiag  = (int *) calloc(n+1, sizeof(int));
+    a->lu     = (double *) calloc(nEntries+1, sizeof(double));
+    next      = (int *) calloc(n+1, sizeof(int));
+    if ( !a->fStart || !a->fIndex || !a->fDiag || !a->lu || !next )
+    {
+        FREE(next);
+        return 0;
+    }
+
+    // --- row m of the factors holds its diagonal, an upper entry for each
+    //     row linked to it when it was eliminated, and the matching lower
+    //     entry in each of those rows
+    for (m = 0; m < n; m++)
+    {
+        a->fStart[m+1] += 1 + lStart[m+1] - lStart[m];
+        for (k = lStart[m]; k < lStart[m+1]; k++)
+            a->fStart[a->perm[lIndex->item[k]] + 1]++;
+    }
+    for (m = 0; m < n; m++)
+    {
+        a->fStart[m+1] += a->fStart[m];
+        next[m] = a->fStart[m];
+        a->fIndex[next[m]++] = m;
+    }
+    for (m = 0; m < n; m++)
+    {
+        for (k = lStart[m]; k < lStart[m+1]; k++)
+        {
+            c = a->perm[lIndex->item[k]];
+            a->fIndex[next[m]++] = c;
+            a->fIndex[next[c]++] = m;
+        }
+    }
+    free(next);
+
+    // --- sort the columns of each row & locate its diagonal
+    for (m = 0; m < n; m++)
+    {
+        for (k = a->fStart[m] + 1; k < a->fStart[m+1]; k++)
+        {
+            c = a->fIndex[k];
+            for (j = k; j > a->fStart[m] && a->fIndex[j-1] > c; j--)
+                a->fIndex[j] = a->fIndex[j-1];
+            a->fIndex[j] = c;
+        }
+        for (k = a->fStart[m]; k < a->fStart[m+1]; k++)
+            if ( a->fIndex[k] == m ) a->fDiag[m] = k;
+    }
+
+    // --- locate each entry of the matrix in the factors
+    for (i = 0; i < n; i++)
+    {
+        m = a->perm[i];
+        for (k = a->start[i]; k < a->start[i+1]; k++)
+        {
+            c = a->perm[a->index[k]];
+            for (j = a->fStart[m]; j < a->fStart[m+1]; j++)
+                if ( a->fIndex[j] == c ) a->map[k] = j;
+        }
+    }
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+//    add an item to the end of a list
+//    (return 1 if successful, 0 if not)
+//-----------------------------------------------------------------------------
+int addItem(TIntList* list, int item)
+{
+    int* items;
+    if ( list->n == list->size )
+    {
+        items = (int *) realloc(list->item, MAX(2*list->size, 4) * sizeof(int));
+        if ( items == NULL ) return 0;
+        list->item = items;
+        list->size = MAX(2*list->size, 4);
+    }
+    list->item[list->n++] = item;
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+//    remove an item from a list
+//-----------------------------------------------------------------------------
+void removeItem(TIntList* list, int item)
+{
+    int k;
+    for (k = 0; k < list->n; k++)
+    {
+        if ( list->item[k] == item )
+        {
+            list->item[k] = list->item[--list->n];
+            return;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//    check if a list contains an item
+//-----------------------------------------------------------------------------
+int hasItem(TIntList* list, int item)
+{
+    int k;
+    for (k = 0; k < list->n; k++) if ( list->item[k] == item ) return 1;
+    return 0;
+}
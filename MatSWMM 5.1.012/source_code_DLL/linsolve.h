@@ -0,0 +1,36 @@
+//-----------------------------------------------------------------------------
+//  linsolve.h
+//
+//  Header file for the sparse linear equation solver contained in linsolve.c
+//
+//-----------------------------------------------------------------------------
+
+#ifndef LINSOLVE_H
+#define LINSOLVE_H
+
+// sparse matrix stored by rows, with its LU factors
+typedef struct TSparseMatrix
+{
+    int     n;                // number of rows (and columns)
+    int*    start;            // start of each row's entries (n+1 items)
+    int*    index;            // column of each entry
+    double* value;            // value of each entry
+    int*    perm;             // row of the factors for each row of the matrix
+    int*    fStart;           // start of each row's entries in the factors
+    int*    fIndex;           // column of each entry of the factors
+    int*    fDiag;            // position of each diagonal entry of the factors
+    int*    map;              // position in the factors of each matrix entry
+    double* lu;               // values of the LU factors
+    double* work;             // work array
+    int*    col;              // position of each column in the row being
+                              //   factored (or -1)
+} TSparseMatrix;
+
+// functions that create, use, and free a sparse matrix
+int  linsolve_open(TSparseMatrix* a, int n, int nEntries);
+int  linsolve_init(TSparseMatrix* a);
+int  linsolve_factor(TSparseMatrix* a);
+void linsolve_solve(TSparseMatrix* a, double* b, double* x);
+void linsolve_close(TSparseMatrix* a);
+
+#endif
@@ -36,3 +36,28 @@
 // Macro to evaluate function x with error checking
 //-------------------------------------------------
 #define CALL(x) (ErrorCode = ((ErrorCode>0) ? (ErrorCode) : (x)))
+
+//-------------------------------------------------
+// Storage class for variables private to a thread
+//-------------------------------------------------
+#ifdef _MSC_VER
+  #define THREADLOCAL __declspec(thread)
+#else
+  #define THREADLOCAL __thread
+#endif
+
+//-------------------------------------------------
+// Storage class for the current project pointer,
+// which is read on every access to project data.
+// GCC/Clang default to the general-dynamic TLS
+// model in a shared library (a __tls_get_addr call
+// per read); initial-exec makes each read a single
+// thread-pointer relative load. Only this pointer
+// uses it so the DLL's static TLS need stays small
+// enough to be loaded with dlopen.
+//-------------------------------------------------
+#if defined(__GNUC__) && !defined(_WIN32)
+  #define THREADLOCAL_PROJECT __thread __attribute__((tls_model("initial-exec")))
+#else
+  #define THREADLOCAL_PROJECT THREADLOCAL
+#endif
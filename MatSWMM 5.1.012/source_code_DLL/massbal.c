@@ -49,21 +49,51 @@ static const double MAX_FLOW_BALANCE_ERR   = 10.0;
 //-----------------------------------------------------------------------------
 //  Shared variables   
 //-----------------------------------------------------------------------------
-TRunoffTotals    RunoffTotals;    // overall surface runoff continuity totals
-TLoadingTotals*  LoadingTotals;   // overall WQ washoff continuity totals
-TGwaterTotals    GwaterTotals;    // overall groundwater continuity totals 
-TRoutingTotals   FlowTotals;      // overall routed flow continuity totals 
-TRoutingTotals*  QualTotals;      // overall routed WQ continuity totals 
-TRoutingTotals   StepFlowTotals;  // routed flow totals over time step
-TRoutingTotals   OldStepFlowTotals;
-TRoutingTotals*  StepQualTotals;  // routed WQ totals over time step
+#define RunoffTotals      (Project->RunoffTotals)      // overall surface runoff continuity totals
+#define LoadingTotals     (Project->LoadingTotals)     // overall WQ washoff continuity totals
+#define GwaterTotals      (Project->GwaterTotals)      // overall groundwater continuity totals
+#define FlowTotals        (Project->FlowTotals)        // overall routed flow continuity totals
+#define QualTotals        (Project->QualTotals)        // overall routed WQ continuity totals
+#define OldStepFlowTotals (Project->OldStepFlowTotals)
+#define StepQualTotals    (Project->StepQualTotals)    // routed WQ totals over time step
 
 //-----------------------------------------------------------------------------
 //  Exportable variables
 //-----------------------------------------------------------------------------
-double*  NodeInflow;              // total inflow volume to each node (ft3)
-double*  NodeOutflow;             // total outflow volume from each node (ft3)
-double   TotalArea;               // total drainage area (ft2)
+#define TotalArea (Project->TotalArea) // total drainage area (ft2)
+
+//-----------------------------------------------------------------------------
+//  Deferred totals
+//-----------------------------------------------------------------------------
+//  While subcatchments (or the water quality of nodes and links) are
+//  analyzed in parallel each thread logs its updates to the runoff, loading,
+//  groundwater (or routed quality) totals instead of adding them in. The
+//  logs are then added in thread order so that the totals are summed in
+//  exactly the same order as in a serial run.
+enum MassbalTotalsType {RUNOFF_TOTALS, LOADING_TOTALS, GWATER_TOTALS,
+                        QUAL_TOTALS};
+enum QualTotalsType {QUAL_REACTED, QUAL_SEEPAGE, QUAL_FINAL_STORAGE};
+
+typedef struct
+{
+    char       totals;         // type of totals being updated
+    char       type;           // component of the totals being updated
+    int        pollut;         // pollutant index (loading totals only)
+    double     value;          // volume or mass added to the component
+}  TMassbalEntry;
+
+struct TMassbalLog
+{
+    int            count;      // number of updates logged
+    int            size;       // number of updates that fit in entries
+    int            error;      // TRUE if entries could not be enlarged
+    TMassbalEntry* entries;    // updates in the order they were made
+};
+
+#define MassbalLogs    (Project->MassbalLogs)    // deferred update logs
+#define NumMassbalLogs (Project->NumMassbalLogs) // number of update logs
+
+static THREADLOCAL struct TMassbalLog* theLog;   // this thread's log (or NULL)
 
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)
@@ -75,6 +105,8 @@ double   TotalArea;               // total drainage area (ft2)
 //  massbal_updateDrainTotals   (called from evalLidUnit in lid.c)             //(5.1.008)
 //  massbal_updateLoadingTotals (called from subcatch_getBuildup)
 //  massbal_updateGwaterTotals  (called from updateMassBal in gwater.c)
+//  massbal_deferTotals         (called from runoff_execute & qualrout_execute)
+//  massbal_commitTotals        (called from runoff_execute & qualrout_execute)
 //  massbal_updateRoutingTotals (called from routing_execute)
 //  massbal_initTimeStepTotals  (called from routing_execute)
 //  massbal_addInflowFlow       (called from routing.c)
@@ -99,6 +131,7 @@ double massbal_getLoadingError(void);
 double massbal_getGwaterError(void);
 double massbal_getFlowError(void);
 double massbal_getQualError(void);
+static void logUpdate(int totals, int type, int p, double v);
 
 
 //=============================================================================
@@ -256,6 +289,21 @@ int massbal_open()
         }
         for (j = 0; j < Nobjects[NODE]; j++) NodeInflow[j] = Node[j].newVolume;
     }
+
+    // --- allocate a log of deferred runoff & quality updates for each thread
+    MassbalLogs = NULL;
+    NumMassbalLogs = 0;
+    if ( NumThreads > 1 && (Nobjects[SUBCATCH] > 0 || Nobjects[POLLUT] > 0) )
+    {
+        MassbalLogs = (struct TMassbalLog *) calloc(NumThreads,
+                      sizeof(struct TMassbalLog));
+        if ( MassbalLogs == NULL )
+        {
+             report_writeErrorMsg(ERR_MEMORY, "");
+             return ErrorCode;
+        }
+        NumMassbalLogs = NumThreads;
+    }
     return ErrorCode;
 }
 
@@ -268,11 +316,19 @@ void massbal_close()
 //  Purpose: frees memory used by mass balance system.
 //
 {
+    int j;
+
     FREE(LoadingTotals);
     FREE(QualTotals);
     FREE(StepQualTotals);
     FREE(NodeInflow);
     FREE(NodeOutflow);
+    if ( MassbalLogs )
+    {
+        for (j = 0; j < NumMassbalLogs; j++) FREE(MassbalLogs[j].entries);
+        FREE(MassbalLogs);
+    }
+    NumMassbalLogs = 0;
 }
 
 //=============================================================================
@@ -364,6 +420,11 @@ void massbal_updateRunoffTotals(int flowType, double v)
 //  Purpose: updates runoff totals after current time step.
 //
 {
+    if ( theLog )
+    {
+        logUpdate(RUNOFF_TOTALS, flowType, 0, v);
+        return;
+    }
     switch(flowType)
     {
     case RUNOFF_RAINFALL: RunoffTotals.rainfall += v; break;
@@ -389,6 +450,15 @@ void massbal_updateGwaterTotals(double vInfil, double vUpperEvap, double vLowerE
 //  Purpose: updates groundwater totals after current time step.
 //
 {
+    if ( theLog )
+    {
+        logUpdate(GWATER_TOTALS, 0, 0, vInfil);
+        logUpdate(GWATER_TOTALS, 1, 0, vUpperEvap);
+        logUpdate(GWATER_TOTALS, 2, 0, vLowerEvap);
+        logUpdate(GWATER_TOTALS, 3, 0, vLowerPerc);
+        logUpdate(GWATER_TOTALS, 4, 0, vGwater);
+        return;
+    }
     GwaterTotals.infil     += vInfil;
     GwaterTotals.upperEvap += vUpperEvap;
     GwaterTotals.lowerEvap += vLowerEvap;
@@ -398,6 +468,124 @@ void massbal_updateGwaterTotals(double vInfil, double vUpperEvap, double vLowerE
 
 //=============================================================================
 
+void massbal_deferTotals(int thread)
+//
+//  Input:   thread = index of the calling thread (or -1)
+//  Output:  none
+//  Purpose: starts logging the calling thread's updates to the runoff,
+//           loading, groundwater and routed quality totals (or stops if
+//           thread is -1).
+//
+{
+    if ( thread < 0 || thread >= NumMassbalLogs ) theLog = NULL;
+    else
+    {
+        theLog = &MassbalLogs[thread];
+        theLog->count = 0;
+    }
+}
+
+//=============================================================================
+
+void massbal_commitTotals()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: adds the updates logged by each thread to the runoff, loading,
+//           groundwater and routed quality totals in thread order.
+//
+{
+    int i, k;
+    TMassbalEntry* e;
+    struct TMassbalLog* log = theLog;
+
+    // --- the calling thread may still be logging its own updates
+    //     (when committing inside a parallel region), so suspend its log
+    theLog = NULL;
+    for (k = 0; k < NumMassbalLogs; k++)
+    {
+        if ( MassbalLogs[k].error ) report_writeErrorMsg(ERR_MEMORY, "");
+        MassbalLogs[k].error = FALSE;
+        for (i = 0; i < MassbalLogs[k].count; i++)
+        {
+            e = &MassbalLogs[k].entries[i];
+            switch (e->totals)
+            {
+            case RUNOFF_TOTALS:
+                massbal_updateRunoffTotals(e->type, e->value);
+                break;
+            case LOADING_TOTALS:
+                massbal_updateLoadingTotals(e->type, e->pollut, e->value);
+                break;
+            case GWATER_TOTALS:
+                switch (e->type)
+                {
+                case 0: GwaterTotals.infil     += e->value; break;
+                case 1: GwaterTotals.upperEvap += e->value; break;
+                case 2: GwaterTotals.lowerEvap += e->value; break;
+                case 3: GwaterTotals.lowerPerc += e->value; break;
+                case 4: GwaterTotals.gwater    += e->value; break;
+                }
+                break;
+            case QUAL_TOTALS:
+                switch (e->type)
+                {
+                case QUAL_REACTED:
+                    StepQualTotals[e->pollut].reacted += e->value;
+                    break;
+                case QUAL_SEEPAGE:
+                    StepQualTotals[e->pollut].seepLoss += e->value;
+                    break;
+                case QUAL_FINAL_STORAGE:
+                    StepQualTotals[e->pollut].finalStorage += e->value;
+                    break;
+                }
+                break;
+            }
+        }
+        MassbalLogs[k].count = 0;
+    }
+    theLog = log;
+}
+
+//=============================================================================
+
+void logUpdate(int totals, int type, int p, double v)
+//
+//  Input:   totals = type of totals being updated
+//           type = component of the totals being updated
+//           p = pollutant index
+//           v = volume or mass added to the component
+//  Output:  none
+//  Purpose: appends an update of the mass balance totals to the calling
+//           thread's log.
+//
+{
+    int n;
+    TMassbalEntry* entries;
+
+    if ( theLog->count == theLog->size )
+    {
+        n = MAX(2 * theLog->size, 256);
+        entries = (TMassbalEntry *) realloc(theLog->entries,
+                  n * sizeof(TMassbalEntry));
+        if ( entries == NULL )
+        {
+            theLog->error = TRUE;
+            return;
+        }
+        theLog->entries = entries;
+        theLog->size = n;
+    }
+    entries = &theLog->entries[theLog->count++];
+    entries->totals = (char)totals;
+    entries->type = (char)type;
+    entries->pollut = p;
+    entries->value = v;
+}
+
+//=============================================================================
+
 void massbal_initTimeStepTotals()
 //
 //  Input:   none
@@ -464,6 +652,11 @@ void massbal_updateLoadingTotals(int type, int p, double w)
 //  Purpose: adds inflow mass loading to loading totals for current time step.
 //
 {
+    if ( theLog )
+    {
+        logUpdate(LOADING_TOTALS, type, p, w);
+        return;
+    }
     switch (type)
     {
       case BUILDUP_LOAD:     LoadingTotals[p].buildup    += w; break;
@@ -545,6 +738,12 @@ void massbal_addReactedMass(int p, double w)
 //
 {
     if ( p < 0 || p >= Nobjects[POLLUT] ) return;
+    if ( theLog )
+    {
+        // --- adding nothing leaves the totals unchanged
+        if ( w != 0.0 ) logUpdate(QUAL_TOTALS, QUAL_REACTED, p, w);
+        return;
+    }
     StepQualTotals[p].reacted += w;
 }
 
@@ -561,6 +760,11 @@ void massbal_addSeepageLoss(int p, double w)
 //
 {
     if ( p < 0 || p >= Nobjects[POLLUT] ) return;
+    if ( theLog )
+    {
+        if ( w != 0.0 ) logUpdate(QUAL_TOTALS, QUAL_SEEPAGE, p, w);
+        return;
+    }
     StepQualTotals[p].seepLoss += w;
 }
 
@@ -577,6 +781,11 @@ void massbal_addToFinalStorage(int p, double w)
 //
 {
     if ( p < 0 || p >= Nobjects[POLLUT] ) return;
+    if ( theLog )
+    {
+        if ( w != 0.0 ) logUpdate(QUAL_TOTALS, QUAL_FINAL_STORAGE, p, w);
+        return;
+    }
     StepQualTotals[p].finalStorage += w;
 }
 
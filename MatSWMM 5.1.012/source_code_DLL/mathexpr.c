@@ -40,6 +40,19 @@
 **	  27 = log10
 **    28 = step (x<=0 ? 0 : 1)
 **	  31 = ^
+**
+**   Once parsed, an expression is also compiled into a list of instructions
+**   that act on an array of registers. The first registers (or slots) hold
+**   the values of the expression's variables (one slot per variable, no
+**   matter how often it appears), the next ones its constants and the rest
+**   the results of its operations. Operations on constants alone are
+**   carried out when the expression is compiled. Each instruction applies
+**   the same operator to the same operands as the stack interpreter would,
+**   so compiled and interpreted expressions give identical results. An
+**   expression can also be evaluated for many sets of variable values at
+**   once, one instruction at a time over all of the sets. An expression
+**   that cannot be compiled (e.g., if memory runs out) is evaluated by the
+**   stack interpreter.
 ******************************************************************************/
 #define _CRT_SECURE_NO_DEPRECATE
 
@@ -48,6 +61,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include "macros.h"
 #include "mathexpr.h"
 
 #define MAX_STACK_SIZE  1024
@@ -65,16 +79,37 @@ struct TreeNode
 };
 typedef struct TreeNode ExprTree;
 
+//  Instruction of a compiled math expression
+typedef struct
+{
+    int    opcode;                // operator code
+    int    r;                     // register receiving the result
+    int    a;                     // register holding left (or only) operand
+    int    b;                     // register holding right operand
+} ExprCode;
+
+//  Compiled math expression
+struct MathProgram
+{
+    int       nCodes;             // number of instructions
+    int       nSlots;             // number of variables
+    int       nRegs;              // number of registers
+    int       result;             // register holding the result
+    int*      slotVar;            // variable index held in each slot
+    double*   regInit;            // initial register values (constants)
+    ExprCode* codes;              // instructions
+};
+
 // Local variables
 //----------------
-static int    Err;
-static int    Bc;
-static int    PrevLex, CurLex;
-static int    Len, Pos;
-static char   *S;
-static char   Token[255];
-static int    Ivar;
-static double Fvalue;
+static THREADLOCAL int    Err;
+static THREADLOCAL int    Bc;
+static THREADLOCAL int    PrevLex, CurLex;
+static THREADLOCAL int    Len, Pos;
+static THREADLOCAL char   *S;
+static THREADLOCAL char   Token[255];
+static THREADLOCAL int    Ivar;
+static THREADLOCAL double Fvalue;
 
 // math function names
 char *MathFunc[] =  {"COS", "SIN", "TAN", "COT", "ABS", "SGN",
@@ -99,9 +134,16 @@ static ExprTree * getOp(int *);
 static ExprTree * getTree(void);
 static void       traverseTree(ExprTree *, MathExpr **);
 static void       deleteTree(ExprTree *);
+static struct MathProgram * compileExpr(MathExpr *);
+static int        isUnaryOp(int);
+static int        isBinaryOp(int);
+static double     applyOp(int, double, double);
+static double     evalCompiled(struct MathProgram *, double (*) (int));
+static void       runProgram(struct MathProgram *, int, double *);
+static void       getResults(struct MathProgram *, int, double *, double *);
 
 // Callback functions
-static int    (*getVariableIndex) (char *); // return index of named variable
+static THREADLOCAL int (*getVariableIndex) (char *); // return index of named variable
 
 //=============================================================================
 
@@ -509,6 +551,7 @@ void traverseTree(ExprTree *tree, MathExpr **expr)
     node->fvalue = tree->fvalue;
     node->opcode = tree->opcode;
     node->ivar = tree->ivar;
+    node->program = NULL;
     node->next = NULL;
     node->prev = (*expr);
     if (*expr) (*expr)->next = node;
@@ -543,6 +586,9 @@ double mathexpr_eval(MathExpr *expr, double (*getVariableValue) (int))
     MathExpr *node = expr;
     double r1, r2;
     int stackindex = 0;
+
+    // --- compiled expressions are run as register instructions
+    if ( expr && expr->program ) return evalCompiled(expr->program, getVariableValue);
     
     ExprStack[0] = 0.0;
     while(node != NULL)
@@ -736,6 +782,440 @@ double mathexpr_eval(MathExpr *expr, double (*getVariableValue) (int))
     return r1;
 }
 
+//=============================================================================
+
+double evalCompiled(struct MathProgram *prog, double (*getVariableValue) (int))
+//
+//  Input:   prog = a compiled math expression
+//           getVariableValue = function that returns a variable's value
+//  Output:  returns the value of the expression
+//  Purpose: evaluates a compiled math expression.
+//
+{
+    double  regStack[MAX_STACK_SIZE];
+    double* regs = regStack;
+    double  result = 0.0;
+    int     k;
+
+    // --- expressions too large for the local register array
+    //     are given one from the heap
+    if ( prog->nRegs > MAX_STACK_SIZE )
+    {
+        regs = (double *) malloc(prog->nRegs * sizeof(double));
+        if ( regs == NULL ) return 0.0;
+    }
+
+    // --- retrieve the value of each variable only once
+    for (k = 0; k < prog->nSlots; k++)
+    {
+        if (getVariableValue != NULL) regs[k] = getVariableValue(prog->slotVar[k]);
+        else regs[k] = 0.0;
+    }
+    runProgram(prog, 1, regs);
+    getResults(prog, 1, regs, &result);
+    if ( regs != regStack ) free(regs);
+    return result;
+}
+
+//=============================================================================
+
+void mathexpr_evalBatch(MathExpr *expr, int n, double *values, double *results)
+//
+//  Input:   expr = a compiled math expression (one whose slot count is
+//                  not -1; others give results of 0)
+//           n = number of sets of variable values
+//           values = values of the expression's variables, where
+//                    values[k*n + i] is the value of slot k in set i
+//           results = array of n values
+//  Output:  results[i] = value of the expression for set i
+//  Purpose: evaluates a math expression for many sets of variable values.
+//
+{
+    struct MathProgram *prog;
+    double  regStack[MAX_STACK_SIZE];
+    double* regs = regStack;
+    int     i, k, m, size;
+
+    if ( n <= 0 ) return;
+    if ( expr == NULL || expr->program == NULL )
+    {
+        for (i = 0; i < n; i++) results[i] = 0.0;
+        return;
+    }
+    prog = expr->program;
+
+    // --- sets are evaluated in groups that fit in the local register
+    //     array (one at a time from the heap for very large expressions)
+    size = MAX_STACK_SIZE / MAX(prog->nRegs, 1);
+    if ( size == 0 )
+    {
+        size = 1;
+        regs = (double *) malloc(prog->nRegs * sizeof(double));
+        if ( regs == NULL )
+        {
+            for (i = 0; i < n; i++) results[i] = 0.0;
+            return;
+        }
+    }
+
+    for (i = 0; i < n; i += m)
+    {
+        m = MIN(size, n - i);
+        for (k = 0; k < prog->nSlots; k++)
+        {
+            memcpy(regs + k*m, values + k*n + i, m * sizeof(double));
+        }
+        runProgram(prog, m, regs);
+        getResults(prog, m, regs, results + i);
+    }
+    if ( regs != regStack ) free(regs);
+}
+
+//=============================================================================
+
+void runProgram(struct MathProgram *prog, int n, double *regs)
+//
+//  Input:   prog = a compiled math expression
+//           n = number of sets of variable values
+//           regs = register array of prog->nRegs rows of n values, whose
+//                  first prog->nSlots rows hold the variable values
+//  Output:  none
+//  Purpose: executes the instructions of a compiled math expression.
+//
+{
+    ExprCode* code;
+    double *r, *a, *b;
+    int     i, k;
+
+    // --- load the constants
+    for (k = prog->nSlots; k < prog->nRegs; k++)
+    {
+        r = regs + k*n;
+        for (i = 0; i < n; i++) r[i] = prog->regInit[k];
+    }
+
+    // --- apply each instruction to all sets of values
+    for (k = 0; k < prog->nCodes; k++)
+    {
+        code = &prog->codes[k];
+        r = regs + code->r*n;
+        a = regs + code->a*n;
+        b = regs + code->b*n;
+        switch (code->opcode)
+        {
+        case 3:  for (i = 0; i < n; i++) r[i] = a[i] + b[i]; break;
+        case 4:  for (i = 0; i < n; i++) r[i] = a[i] - b[i]; break;
+        case 5:  for (i = 0; i < n; i++) r[i] = a[i] * b[i]; break;
+        case 6:  for (i = 0; i < n; i++) r[i] = a[i] / b[i]; break;
+        case 9:  for (i = 0; i < n; i++) r[i] = -a[i];       break;
+        default:
+            for (i = 0; i < n; i++) r[i] = applyOp(code->opcode, a[i], b[i]);
+        }
+    }
+}
+
+//=============================================================================
+
+void getResults(struct MathProgram *prog, int n, double *regs, double *results)
+//
+//  Input:   prog = a compiled math expression
+//           n = number of sets of variable values
+//           regs = register array after execution
+//           results = array of n values
+//  Output:  results = values of the expression
+//  Purpose: retrieves the results of an executed math expression.
+//
+{
+    int i;
+    double* r = regs + prog->result*n;
+
+    for (i = 0; i < n; i++)
+    {
+        results[i] = r[i];
+
+        // Set result to 0 if it is NaN due to an illegal math op
+        if ( results[i] != results[i] ) results[i] = 0.0;
+    }
+}
+
+//=============================================================================
+
+double applyOp(int opcode, double x, double y)
+//
+//  Input:   opcode = operator code
+//           x = left (or only) operand
+//           y = right operand of a binary operator
+//  Output:  returns the result of the operation
+//  Purpose: applies an operator in the same way as mathexpr_eval.
+//
+{
+    switch (opcode)
+    {
+    case 3:  return x + y;
+    case 4:  return x - y;
+    case 5:  return x * y;
+    case 6:  return x / y;
+    case 9:  return -x;
+    case 10: return cos(x);
+    case 11: return sin(x);
+    case 12: return tan(x);
+    case 13:
+        if (x == 0.0) return 0.0;
+        return 1.0/tan( x );
+    case 14: return fabs( x );
+    case 15:
+        if (x < 0.0) return -1.0;
+        if (x > 0.0) return 1.0;
+        return 0.0;
+    case 16:
+        if (x < 0.0) return 0.0;
+        return sqrt( x );
+    case 17:
+        if (x <= 0) return 0.0;
+        return log(x);
+    case 18: return exp(x);
+    case 19: return asin( x );
+    case 20: return acos( x );
+    case 21: return atan( x );
+    case 22: return 1.57079632679489661923 - atan(x);
+    case 23: return (exp(x)-exp(-x))/2.0;
+    case 24: return (exp(x)+exp(-x))/2.0;
+    case 25: return (exp(x)-exp(-x))/(exp(x)+exp(-x));
+    case 26: return (exp(x)+exp(-x))/(exp(x)-exp(-x));
+    case 27:
+        if (x == 0.0) return 0.0;
+        return log10( x );
+    case 28:
+        if (x <= 0.0) return 0.0;
+        return 1.0;
+    case 31:
+        if (x <= 0.0) return 0.0;
+        return exp(y*log(x));
+    }
+    return x;
+}
+
+//=============================================================================
+
+int isUnaryOp(int opcode)
+//
+//  Input:   opcode = operator code
+//  Output:  returns TRUE if the operator acts on a single operand
+//
+{
+    return (opcode >= 9 && opcode <= 28);
+}
+
+//=============================================================================
+
+int isBinaryOp(int opcode)
+//
+//  Input:   opcode = operator code
+//  Output:  returns TRUE if the operator acts on two operands
+//
+{
+    return ((opcode >= 3 && opcode <= 6) || opcode == 31);
+}
+
+//=============================================================================
+
+struct MathProgram * compileExpr(MathExpr *expr)
+//
+//  Input:   expr = a tokenized math expression
+//  Output:  returns a compiled version of the expression (or NULL if
+//           memory runs out or the expression is malformed)
+//  Purpose: compiles a tokenized math expression into register instructions.
+//
+//  The interpreter's stack is followed entry by entry, each entry recording
+//  either a constant value or the register that will hold its value.
+//
+{
+    struct MathProgram *prog;
+    MathExpr *node;
+    ExprCode *code;
+    int     nNodes = 0, nSlots = 0, maxRegs, top, k;
+    int*    stackReg;             // register of each stack entry (-1 = const)
+    double* stackVal;             // value of each constant stack entry
+    int     a, b;
+    char*   block;
+
+    // --- find the number of list nodes and of different variables
+    for (node = expr; node; node = node->next)
+    {
+        nNodes++;
+        if ( node->opcode == 8 ) nSlots++;
+    }
+    maxRegs = 2*nNodes + nSlots + 1;
+
+    // --- allocate the program and its arrays in a single block
+    block = (char *) malloc(sizeof(struct MathProgram) +
+                            maxRegs * sizeof(double) +
+                            nNodes * sizeof(ExprCode) +
+                            nSlots * sizeof(int));
+    stackReg = (int *) malloc((nNodes+1) * sizeof(int));
+    stackVal = (double *) malloc((nNodes+1) * sizeof(double));
+    if ( block == NULL || stackReg == NULL || stackVal == NULL )
+    {
+        free(block);
+        free(stackReg);
+        free(stackVal);
+        return NULL;
+    }
+    prog = (struct MathProgram *) block;
+    prog->regInit = (double *) (block + sizeof(struct MathProgram));
+    prog->codes = (ExprCode *) (prog->regInit + maxRegs);
+    prog->slotVar = (int *) (prog->codes + nNodes);
+    prog->nCodes = 0;
+
+    // --- assign a slot to each variable in order of first appearance
+    prog->nSlots = 0;
+    for (node = expr; node; node = node->next)
+    {
+        if ( node->opcode != 8 ) continue;
+        for (k = 0; k < prog->nSlots; k++)
+        {
+            if ( prog->slotVar[k] == node->ivar ) break;
+        }
+        if ( k == prog->nSlots ) prog->slotVar[prog->nSlots++] = node->ivar;
+    }
+    for (k = 0; k < prog->nSlots; k++) prog->regInit[k] = 0.0;
+    prog->nRegs = prog->nSlots;
+
+    // --- the interpreter's stack starts with a 0 entry
+    top = 0;
+    stackReg[0] = -1;
+    stackVal[0] = 0.0;
+
+    for (node = expr; node; node = node->next)
+    {
+        // --- push constants and variables
+        if ( node->opcode == 7 || node->opcode == 8 )
+        {
+            top++;
+            if ( node->opcode == 7 )
+            {
+                stackReg[top] = -1;
+                stackVal[top] = node->fvalue;
+            }
+            else
+            {
+                for (k = 0; prog->slotVar[k] != node->ivar; k++);
+                stackReg[top] = k;
+            }
+            continue;
+        }
+        if ( isUnaryOp(node->opcode) )
+        {
+            a = top;
+            b = top;
+        }
+        else if ( isBinaryOp(node->opcode) )
+        {
+            if ( top == 0 ) break;
+            a = top - 1;
+            b = top;
+        }
+        else continue;
+
+        // --- fold operations on constants
+        if ( stackReg[a] < 0 && stackReg[b] < 0 )
+        {
+            stackVal[a] = applyOp(node->opcode, stackVal[a], stackVal[b]);
+            top = a;
+            continue;
+        }
+
+        // --- place constant operands in registers
+        for (k = a; k <= b; k++)
+        {
+            if ( stackReg[k] >= 0 ) continue;
+            stackReg[k] = prog->nRegs;
+            prog->regInit[prog->nRegs++] = stackVal[k];
+        }
+
+        // --- add an instruction whose result goes to a new register
+        code = &prog->codes[prog->nCodes++];
+        code->opcode = node->opcode;
+        code->a = stackReg[a];
+        code->b = stackReg[b];
+        code->r = prog->nRegs;
+        prog->regInit[prog->nRegs++] = 0.0;
+        stackReg[a] = code->r;
+        top = a;
+    }
+
+    // --- the result is the top stack entry
+    if ( node == NULL )
+    {
+        if ( stackReg[top] < 0 )
+        {
+            stackReg[top] = prog->nRegs;
+            prog->regInit[prog->nRegs++] = stackVal[top];
+        }
+        prog->result = stackReg[top];
+    }
+    else
+    {
+        free(prog);
+        prog = NULL;
+    }
+    free(stackReg);
+    free(stackVal);
+    return prog;
+}
+
+//=============================================================================
+
+int mathexpr_getSlotCount(MathExpr *expr)
+//
+//  Input:   expr = a tokenized math expression
+//  Output:  returns the number of different variables in the expression
+//           (or -1 if it was not compiled and can only be evaluated by
+//           mathexpr_eval)
+//
+{
+    if ( expr == NULL || expr->program == NULL ) return -1;
+    return expr->program->nSlots;
+}
+
+//=============================================================================
+
+int mathexpr_isEqual(MathExpr *expr1, MathExpr *expr2)
+//
+//  Input:   expr1, expr2 = two tokenized math expressions
+//  Output:  returns 1 if both were compiled into the same instructions
+//           on the same variables and constants, 0 otherwise
+//
+{
+    struct MathProgram *p1, *p2;
+
+    if ( expr1 == NULL || expr2 == NULL ) return 0;
+    p1 = expr1->program;
+    p2 = expr2->program;
+    if ( p1 == NULL || p2 == NULL ) return 0;
+    if ( p1->nCodes != p2->nCodes || p1->nSlots != p2->nSlots ||
+         p1->nRegs != p2->nRegs || p1->result != p2->result ) return 0;
+    if ( memcmp(p1->slotVar, p2->slotVar, p1->nSlots * sizeof(int)) ||
+         memcmp(p1->regInit, p2->regInit, p1->nRegs * sizeof(double)) ||
+         memcmp(p1->codes, p2->codes, p1->nCodes * sizeof(ExprCode)) )
+        return 0;
+    return 1;
+}
+
+//=============================================================================
+
+int mathexpr_getSlotVariable(MathExpr *expr, int slot)
+//
+//  Input:   expr = a tokenized math expression
+//           slot = a variable slot of the expression
+//  Output:  returns the index of the variable held in the slot (or -1)
+//
+{
+    if ( expr == NULL || expr->program == NULL ) return -1;
+    if ( slot < 0 || slot >= expr->program->nSlots ) return -1;
+    return expr->program->slotVar[slot];
+}
+
 // Turn off "precise" floating point option                                    //(5.1.008)
 #pragma float_control(pop)                                                     //(5.1.008)
 
@@ -743,7 +1223,11 @@ double mathexpr_eval(MathExpr *expr, double (*getVariableValue) (int))
 
 void mathexpr_delete(MathExpr *expr)
 {
-    if (expr) mathexpr_delete(expr->next);
+    if (expr)
+    {
+        mathexpr_delete(expr->next);
+        free(expr->program);
+    }
     free(expr);
 }
 
@@ -773,5 +1257,9 @@ MathExpr * mathexpr_create(char *formula, int (*getVar) (char *))
         }
     }
     deleteTree(tree);
+
+    // --- compile the expression (if that fails, it is evaluated by the
+    //     stack interpreter instead)
+    if ( result ) result->program = compileExpr(result);
     return result;
 }
@@ -8,6 +8,9 @@
 **  LAST UPDATE:   03/20/14
 ******************************************************************************/
 
+//  Compiled form of a math expression (see mathexpr.c)
+struct MathProgram;
+
 //  Node in a tokenized math expression list
 struct ExprNode
 {
@@ -16,6 +19,7 @@ struct ExprNode
     double fvalue;                // numerical value
 	struct ExprNode *prev;        // previous node
     struct ExprNode *next;        // next node
+    struct MathProgram *program;  // compiled expression (first node only)
 };
 typedef struct ExprNode MathExpr;
 
@@ -25,5 +29,18 @@ MathExpr* mathexpr_create(char* s, int (*getVar) (char *));
 //  Evaluates a tokenized math expression
 double mathexpr_eval(MathExpr* expr, double (*getVal) (int));
 
+//  Returns the number of different variables in a math expression
+int mathexpr_getSlotCount(MathExpr* expr);
+
+//  Checks if two math expressions were compiled into the same instructions
+int mathexpr_isEqual(MathExpr* expr1, MathExpr* expr2);
+
+//  Returns the index of the variable held in a slot of a math expression
+int mathexpr_getSlotVariable(MathExpr* expr, int slot);
+
+//  Evaluates a math expression for many sets of variable values
+void mathexpr_evalBatch(MathExpr* expr, int n, double* values,
+                        double* results);
+
 //  Deletes a tokenized math expression
 void  mathexpr_delete(MathExpr* expr);
@@ -18,6 +18,7 @@
 
 #include <stdlib.h>
 #include <malloc.h>
+#include "macros.h"
 #include "mempool.h"
 
 /*
@@ -50,10 +51,10 @@ typedef struct alloc_root_s
 }  alloc_root_t;
 
 /*
-**  root - Pointer to the current pool.
+**  root - Pointer to the current pool (each thread has its own).
 */
 
-static alloc_root_t *root;
+static THREADLOCAL alloc_root_t *root;
 
 
 /*
@@ -63,18 +63,6 @@ typedef struct
    FILE*         file;                 // FILE structure pointer
 }  TFile;
 
-//-----------------------------------------
-// LINKED LIST ENTRY FOR TABLES/TIME SERIES
-//-----------------------------------------
-struct  TableEntry
-{
-   double  x;
-   double  y;
-   struct  TableEntry* next;
-};
-typedef struct TableEntry TTableEntry;
-
-
 //-------------------------
 // CURVE/TIME SERIES OBJECT
 //-------------------------
@@ -84,12 +72,17 @@ typedef struct
    int           curveType;       // type of curve tabulated
    int           refersTo;        // reference to some other object
    double        dxMin;           // smallest x-value interval
+   int           yAscending;      // TRUE if y-values never decrease
    double        lastDate;        // last input date for time series
    double        x1, x2;          // current bracket on x-values
    double        y1, y2;          // current bracket on y-values
-   TTableEntry*  firstEntry;      // first data point
-   TTableEntry*  lastEntry;       // last data point
-   TTableEntry*  thisEntry;       // current data point
+   int           nPoints;         // number of data points
+   int           maxPoints;       // allocated size of data arrays
+   int           thisEntry;       // index of current data point
+   double*       xData;           // x-values of data points
+   double*       yData;           // y-values of data points
+   double*       areas;           // area under curve up to each point
+   double*       invAreas;        // same, as summed by table_getInverseArea
    TFile         file;            // external data file
 }  TTable;
 
@@ -147,6 +140,20 @@ typedef struct
    double        tanAnglat;       // tangent of latitude angle
 }  TTemp;
 
+//-----------------------------
+// MOVING AVERAGE OF TEMPERATURE
+//-----------------------------
+typedef struct
+{
+   double        tAve;            // moving avg. for daily temperature (deg F)
+   double        tRng;            // moving avg. for daily temp. range (deg F)
+   double        ta[7];           // data window for tAve
+   double        tr[7];           // data window for tRng
+   int           count;           // length of moving average window
+   int           maxCount;        // maximum length of moving average window
+   int           front;           // index of front of moving average window
+}  TMovAve;
+
 
 //-----------------
 // WINDSPEED OBJECT
@@ -481,6 +488,9 @@ typedef struct
 {
     int          treatType;       // treatment equation type: REMOVAL/CONCEN
     MathExpr*    equation;        // treatment eqn. as tokenized math terms
+    char         batched;         // TRUE if eqn. evaluated with other nodes'
+    double       value;           // value of batched eqn. on current step
+    double       cIn;             // inflow concen. on current step
 } TTreatment;
 
 
@@ -576,6 +586,8 @@ typedef struct
 //-----------------------------
 // CROSS SECTION DATA STRUCTURE
 //-----------------------------
+#define  N_XSECT_TBL  101         // size of conduit geometry tables
+
 typedef struct
 {
    int           type;            // type code of cross section shape
@@ -594,6 +606,9 @@ typedef struct
    double        aBot;            // area of bottom section
    double        sBot;            // slope of bottom section
    double        rBot;            // radius of bottom section
+
+   double*       geomTbl;         // shared normalized geometry table (or NULL)
+   double*       depthTbl;        // shared crit. & normal depth table (or NULL)
 }  TXsect;
 
 
@@ -808,6 +823,7 @@ typedef struct
    int           funcType;        // buildup function type code
    double        coeff[3];        // coeffs. of buildup function
    double        maxDays;         // time to reach max. buildup (days)
+   double        extRate;         // external buildup rate over time step
 }  TBuildup;
 
 
@@ -940,9 +956,61 @@ typedef struct
    double        avgTimeStep;
    double        avgStepCount;
    double        steadyStateCount;
+   double        nodeClassTime[MAX_STEP_CLASSES]; // node-sec. in each DW
+   double        linkClassTime[MAX_STEP_CLASSES]; //   time step class
+   double        classUpdates;    // node & link updates made by step classes
+   double        finestUpdates;   // updates if all used the finest step
+   double        substeps;        // substeps of DW steps made by classes
+   double        substepIterations; // iterations made over those substeps
+   double        failedSubsteps;  // substeps that did not converge
+   double        classSteps[MAX_STEP_CLASSES];    // steps made by each class
+   double        classFailures[MAX_STEP_CLASSES]; // class steps not converged
+   double        activeNodeTime;  // node-sec. & link-sec. routed by the
+   double        activeLinkTime;  //   DW active set
+   double        activeSetTime;   // time during which active set was used (sec)
+   double        minActiveLinks;  // min. fraction of links routed on a step
+   double        maxActiveLinks;  // max. fraction of links routed on a step
+   double        predictions;     // DW steps started from a predicted state
+   double        rejectedPredictions; // predictions that slowed iterations
 }  TSysStats;
 
 
+//---------------------------
+// PARALLEL PHASE THREAD USE
+//---------------------------
+typedef struct
+{
+   int           items;           // number of items processed per call
+   int           threads;         // threads used (0 while being chosen)
+   int           trial;           // index of thread count being timed
+   int           calls;           // calls timed with trial thread count,
+                                  //   or made since the count was chosen
+   int           choices;         // number of times thread count was chosen
+   int           chosenItems;     // items per call when count was chosen
+   double        start;           // time when current call began (sec)
+   double        time;            // time spent in timed calls (sec)
+   double        timedItems;      // items processed in timed calls
+   double        bestTime;        // least time per item found (sec)
+   int           bestThreads;     // thread count giving least time
+}  TWorkerPhase;
+
+
+//-----------------------------
+// LEVEL SCHEDULE OF LINK SWEEP
+//-----------------------------
+typedef struct
+{
+   int           nLevels;         // number of levels
+   int*          levelStart;      // start of each level's entries in nodes
+   int*          nodes;           // nodes ordered by level
+   int*          outletStart;     // sorted position of node's 1st outlet link
+   int*          outletCount;     // number of outlet links of each node
+   int*          inletStart;      // start of each node's entries in inlets
+   int*          inlets;          // links entering each node, in sorted order
+   double*       steps;           // computational steps of each entry in nodes
+}  TLinkLevels;
+
+
 //--------------------
 // RAINFALL STATISTICS
 //--------------------
@@ -11,6 +11,7 @@
 
 #include <stdlib.h>
 #include <math.h>
+#include "macros.h"
 #include "odesolve.h"
 
 #define MAXSTP 10000
@@ -24,13 +25,13 @@
 //-----------------------------------------------------------------------------
 //    Local declarations
 //-----------------------------------------------------------------------------
-int      nmax;      // max. number of equations
-double*  y;         // dependent variable
-double*  yscal;     // scaling factors
-double*  yerr;      // integration errors
-double*  ytemp;     // temporary values of y
-double*  dydx;      // derivatives of y
-double*  ak;        // derivatives at intermediate points
+THREADLOCAL int      nmax;      // max. number of equations
+THREADLOCAL double*  y;         // dependent variable
+THREADLOCAL double*  yscal;     // scaling factors
+THREADLOCAL double*  yerr;      // integration errors
+THREADLOCAL double*  ytemp;     // temporary values of y
+THREADLOCAL double*  dydx;      // derivatives of y
+THREADLOCAL double*  ak;        // derivatives at intermediate points
 
 
 // function that integrates over an error-controlled stepsize
@@ -19,6 +19,9 @@
 //
 //-----------------------------------------------------------------------------
 #define _CRT_SECURE_NO_DEPRECATE
+#ifndef _WIN32
+#define _FILE_OFFSET_BITS 64           // 64-bit off_t for fseeko
+#endif
 
 #include <stdlib.h>
 #include <string.h>
@@ -34,29 +37,34 @@
 enum InputDataType {INPUT_TYPE_CODE, INPUT_AREA, INPUT_INVERT, INPUT_MAX_DEPTH,
                     INPUT_OFFSET, INPUT_LENGTH};
 
-//-----------------------------------------------------------------------------
-//  Shared variables    
-//-----------------------------------------------------------------------------
-static INT4      IDStartPos;           // starting file position of ID names
-static INT4      InputStartPos;        // starting file position of input data
-static INT4      OutputStartPos;       // starting file position of output data
-static INT4      BytesPerPeriod;       // bytes saved per simulation time period
-static INT4      NsubcatchResults;     // number of subcatchment output variables
-static INT4      NnodeResults;         // number of node output variables
-static INT4      NlinkResults;         // number of link output variables
-static INT4      NumSubcatch;          // number of subcatchments reported on
-static INT4      NumNodes;             // number of nodes reported on
-static INT4      NumLinks;             // number of links reported on
-static INT4      NumPolluts;           // number of pollutants reported on
-static REAL4     SysResults[MAX_SYS_RESULTS];    // values of system output vars.
+// Constants for the columnar results file written by output_exportColumns
+#define COLUMNS_MAGIC     516114600    // identifies a columnar results file
+#define COLUMNS_VERSION   1            // version of the columnar file layout
+#define COLUMNS_HDR_INTS  14           // INT4 fields in the file header
+
+// 64-bit file positioning (results files can exceed 2 GB; long is only
+// 32 bits on Windows and on 32-bit targets)
+#ifdef _WIN32
+#define FSEEK64(f, pos) _fseeki64(f, (__int64)(pos), SEEK_SET)
+#else
+#define FSEEK64(f, pos) fseeko(f, (off_t)(pos), SEEK_SET)
+#endif
 
 //-----------------------------------------------------------------------------
-//  Exportable variables (shared with report.c)
+//  Shared variables    
 //-----------------------------------------------------------------------------
-REAL4*           SubcatchResults;
-REAL4*           NodeResults;
-REAL4*           LinkResults;
-
+#define IDStartPos       (Project->IDStartPos)       // starting file position of ID names
+#define InputStartPos    (Project->InputStartPos)    // starting file position of input data
+#define OutputStartPos   (Project->OutputStartPos)   // starting file position of output data
+#define BytesPerPeriod   (Project->BytesPerPeriod)   // bytes saved per simulation time period
+#define NsubcatchResults (Project->NsubcatchResults) // number of subcatchment output variables
+#define NnodeResults     (Project->NnodeResults)     // number of node output variables
+#define NlinkResults     (Project->NlinkResults)     // number of link output variables
+#define NumSubcatch      (Project->NumSubcatch)      // number of subcatchments reported on
+#define NumNodes         (Project->NumNodes)         // number of nodes reported on
+#define NumLinks         (Project->NumLinks)         // number of links reported on
+#define NumPolluts       (Project->NumPolluts)       // number of pollutants reported on
+#define SysResults       (Project->SysResults)       // values of system output vars.
 
 //-----------------------------------------------------------------------------
 //  Local functions
@@ -66,6 +74,11 @@ static void output_saveID(char* id, FILE* file);
 static void output_saveSubcatchResults(double reportTime, FILE* file);
 static void output_saveNodeResults(double reportTime, FILE* file);
 static void output_saveLinkResults(double reportTime, FILE* file);
+static void output_transposeColumns(char* buf, REAL4* cols, int nChunk,
+            int nObjects, int nResults, int periodBytes);
+static int  output_gatherColumns(FILE* file, FILE* tmp, REAL4* group,
+            REAL4* part, size_t groupSize, long long colPos, int nCols,
+            int chunkPeriods);
 
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)
@@ -79,6 +92,7 @@ static void output_saveLinkResults(double reportTime, FILE* file);
 //  output_readSubcatchResults    (called by report_Subcatchments)
 //  output_readNodeResults        (called by report_Nodes)
 //  output_readLinkResults        (called by report_Links)
+//  output_exportColumns          (called by c_saveResultsColumns)
 
 
 //=============================================================================
@@ -90,7 +104,7 @@ int output_open()
 //  Purpose: writes basic project data to binary output file.
 //
 {
-    int   j;
+    int   i, j;
     int   m;
     INT4  k;
     REAL4 x;
@@ -165,12 +179,14 @@ int output_open()
     {
         if ( Subcatch[j].rptFlag ) output_saveID(Subcatch[j].ID, Fout.file);
     }
-    for (j=0; j<Nobjects[NODE];     j++)
+    for (i=0; i<Nobjects[NODE];     i++)
     {
+        j = NodeOrder[i];
         if ( Node[j].rptFlag ) output_saveID(Node[j].ID, Fout.file);
     }
-    for (j=0; j<Nobjects[LINK];     j++)
+    for (i=0; i<Nobjects[LINK];     i++)
     {
+        j = LinkOrder[i];
         if ( Link[j].rptFlag ) output_saveID(Link[j].ID, Fout.file);
     }
     for (j=0; j<NumPolluts; j++) output_saveID(Pollut[j].ID, Fout.file);
@@ -205,8 +221,9 @@ int output_open()
     fwrite(&k, sizeof(INT4), 1, Fout.file);
     k = INPUT_MAX_DEPTH;
     fwrite(&k, sizeof(INT4), 1, Fout.file);
-    for (j=0; j<Nobjects[NODE]; j++)
+    for (i=0; i<Nobjects[NODE]; i++)
     {
+        j = NodeOrder[i];
         if ( !Node[j].rptFlag ) continue;
         k = Node[j].type;
         NodeResults[0] = (REAL4)(Node[j].invertElev * UCF(LENGTH));
@@ -229,8 +246,9 @@ int output_open()
     k = INPUT_LENGTH;
     fwrite(&k, sizeof(INT4), 1, Fout.file);
 
-    for (j=0; j<Nobjects[LINK]; j++)
+    for (i=0; i<Nobjects[LINK]; i++)
     {
+        j = LinkOrder[i];
         if ( !Link[j].rptFlag ) continue;
         k = Link[j].type;
         if ( k == PUMP )
@@ -565,16 +583,17 @@ void output_saveNodeResults(double reportTime, FILE* file)
 //  Purpose: writes computed node results to binary file.
 //
 {
-    extern TRoutingTotals StepFlowTotals;  // defined in massbal.c
-    int j;
+    int j, k;
 
     // --- find where current reporting time lies between latest routing times
     double f = (reportTime - OldRoutingTime) /
                (NewRoutingTime - OldRoutingTime);
 
     // --- write node results to file
-    for (j=0; j<Nobjects[NODE]; j++)
+    for (k=0; k<Nobjects[NODE]; k++)
     {
+        j = NodeOrder[k];
+
         // --- retrieve interpolated results for reporting time & write to file
         node_getResults(j, f, NodeResults);
         if ( Node[j].rptFlag )
@@ -609,7 +628,7 @@ void output_saveLinkResults(double reportTime, FILE* file)
 //  Purpose: writes computed link results to binary file.
 //
 {
-    int j;
+    int j, k;
     double f;
     double z;
 
@@ -617,8 +636,10 @@ void output_saveLinkResults(double reportTime, FILE* file)
     f = (reportTime - OldRoutingTime) / (NewRoutingTime - OldRoutingTime);
 
     // --- write link results to file
-    for (j=0; j<Nobjects[LINK]; j++)
+    for (k=0; k<Nobjects[LINK]; k++)
     {
+        j = LinkOrder[k];
+
         // --- retrieve interpolated results for reporting time & write to file
         link_getResults(j, f, LinkResults);
         if ( Link[j].rptFlag ) 
@@ -700,3 +721,283 @@ void output_readLinkResults(int period, int index)
 }
 
 //=============================================================================
+
+//=============================================================================
+
+int output_exportColumns(char* fname)
+//
+//  Input:   fname = name of the columnar results file to create
+//  Output:  returns an error code
+//  Purpose: copies all computed results from the binary output file to a
+//           columnar file in one sequential pass over the output file.
+//
+//  The columnar file holds:
+//    - a header of COLUMNS_HDR_INTS 4-byte integers (magic number, version,
+//      # periods, report step, # subcatchments, # subcatch. variables,
+//      # nodes, # node variables, # links, # link variables, # system
+//      variables, # pollutants, flow units, byte offset of the data)
+//      followed by the 8-byte starting date of the simulation;
+//    - the ID names of the reported subcatchments, nodes & links, each as
+//      a 4-byte length followed by its characters;
+//    - starting at the data offset, the 8-byte date of each period and
+//      then one contiguous block of 4-byte reals per variable (subcatchment,
+//      node, link and system variables, in the order of the output file).
+//      Each block holds all periods of its first object, then all periods
+//      of the next object, and so on.
+//
+//  The output file is read in chunks of periods of up to EXPORT_BUFFER
+//  kilobytes. If it takes more than one chunk, each transposed chunk is
+//  first appended to a temporary file, from which groups of whole columns
+//  are then gathered and written to the columnar file in a single run.
+//
+{
+    FILE*     file;
+    FILE*     tmp = NULL;
+    char      tmpName[MAXFNAME+1];
+    INT4      header[COLUMNS_HDR_INTS];
+    REAL8     startDate = StartDateTime;
+    INT4      dataPos;
+    long long colPos;
+    int       i, j, k, n, p, nChunk, chunkPeriods, nCols, errcode = 0;
+    int       periodBytes = BytesPerPeriod;
+    size_t    bufBytes;
+    char*     buf;
+    REAL4*    cols;
+    REAL8*    dates;
+
+    if ( Fout.file == NULL ) return ERR_OUT_FILE;
+
+    // --- allocate a buffer that holds as many periods as allowed
+    //     (and at least one whole column for gathering columns)
+    chunkPeriods = (int)MIN((long long)ExportBuffer * 1024 / periodBytes,
+                            (long long)Nperiods);
+    if ( chunkPeriods < 1 ) chunkPeriods = 1;
+    bufBytes = (size_t)chunkPeriods * periodBytes;
+    bufBytes = MAX(bufBytes, (size_t)Nperiods * sizeof(REAL4));
+    buf = (char *) malloc(bufBytes);
+    cols = (REAL4 *) malloc((size_t)chunkPeriods * periodBytes);
+    dates = (REAL8 *) malloc(chunkPeriods * sizeof(REAL8));
+    if ( buf == NULL || cols == NULL || dates == NULL )
+    {
+        FREE(buf);
+        FREE(cols);
+        FREE(dates);
+        return ERR_MEMORY;
+    }
+
+    // --- open the columnar file (and a temporary file for the chunks
+    //     if the output file takes more than one)
+    file = fopen(fname, "w+b");
+    if ( file && chunkPeriods < Nperiods )
+    {
+        if ( getTempFileName(tmpName) ) tmp = fopen(tmpName, "w+b");
+        if ( tmp == NULL )
+        {
+            fclose(file);
+            file = NULL;
+        }
+    }
+    if ( file == NULL )
+    {
+        free(buf);
+        free(cols);
+        free(dates);
+        return ERR_OUT_FILE;
+    }
+
+    // --- write the header & the ID names of the reported objects
+    fseek(file, COLUMNS_HDR_INTS * sizeof(INT4) + sizeof(REAL8), SEEK_SET);
+    for (j=0; j<Nobjects[SUBCATCH]; j++)
+    {
+        if ( Subcatch[j].rptFlag ) output_saveID(Subcatch[j].ID, file);
+    }
+    for (i=0; i<Nobjects[NODE]; i++)
+    {
+        j = NodeOrder[i];
+        if ( Node[j].rptFlag ) output_saveID(Node[j].ID, file);
+    }
+    for (i=0; i<Nobjects[LINK]; i++)
+    {
+        j = LinkOrder[i];
+        if ( Link[j].rptFlag ) output_saveID(Link[j].ID, file);
+    }
+    dataPos = ftell(file);
+    dataPos = (dataPos + 7) / 8 * 8;
+
+    header[0]  = COLUMNS_MAGIC;
+    header[1]  = COLUMNS_VERSION;
+    header[2]  = Nperiods;
+    header[3]  = ReportStep;
+    header[4]  = NumSubcatch;
+    header[5]  = NsubcatchResults;
+    header[6]  = NumNodes;
+    header[7]  = NnodeResults;
+    header[8]  = NumLinks;
+    header[9]  = NlinkResults;
+    header[10] = MAX_SYS_RESULTS;
+    header[11] = NumPolluts;
+    header[12] = FlowUnits;
+    header[13] = dataPos;
+    fseek(file, 0, SEEK_SET);
+    fwrite(header, sizeof(INT4), COLUMNS_HDR_INTS, file);
+    fwrite(&startDate, sizeof(REAL8), 1, file);
+
+    // --- the variable blocks of all object types follow the dates as
+    //     one sequence of columns of Nperiods values
+    colPos = dataPos + (long long)Nperiods * sizeof(REAL8);
+    nCols = NumSubcatch * NsubcatchResults + NumNodes * NnodeResults +
+            NumLinks * NlinkResults + MAX_SYS_RESULTS;
+
+    // --- read consecutive chunks of reporting periods
+    fseek(Fout.file, OutputStartPos, SEEK_SET);
+    for (p = 0; p < Nperiods; p += nChunk)
+    {
+        nChunk = MIN(chunkPeriods, Nperiods - p);
+        if ( fread(buf, periodBytes, nChunk, Fout.file) < (size_t)nChunk )
+        {
+            errcode = ERR_OUT_READ;
+            break;
+        }
+
+        // --- dates of the periods
+        for (k = 0; k < nChunk; k++)
+        {
+            memcpy(&dates[k], buf + (size_t)k * periodBytes, sizeof(REAL8));
+        }
+        FSEEK64(file, dataPos + (long long)p * sizeof(REAL8));
+        fwrite(dates, sizeof(REAL8), nChunk, file);
+
+        // --- transpose the results of each type of object
+        n = sizeof(REAL8);
+        k = 0;
+        output_transposeColumns(buf + n, cols, nChunk, NumSubcatch,
+            NsubcatchResults, periodBytes);
+        n += NumSubcatch * NsubcatchResults * sizeof(REAL4);
+        k += NumSubcatch * NsubcatchResults;
+        output_transposeColumns(buf + n, cols + (size_t)k * nChunk, nChunk,
+            NumNodes, NnodeResults, periodBytes);
+        n += NumNodes * NnodeResults * sizeof(REAL4);
+        k += NumNodes * NnodeResults;
+        output_transposeColumns(buf + n, cols + (size_t)k * nChunk, nChunk,
+            NumLinks, NlinkResults, periodBytes);
+        n += NumLinks * NlinkResults * sizeof(REAL4);
+        k += NumLinks * NlinkResults;
+        output_transposeColumns(buf + n, cols + (size_t)k * nChunk, nChunk,
+            1, MAX_SYS_RESULTS, periodBytes);
+
+        // --- a chunk holding all periods fills the blocks in one run
+        if ( tmp == NULL )
+        {
+            FSEEK64(file, colPos);
+            fwrite(cols, sizeof(REAL4), (size_t)nCols * nChunk, file);
+        }
+        else fwrite(cols, sizeof(REAL4), (size_t)nCols * nChunk, tmp);
+    }
+
+    // --- gather groups of whole columns from the transposed chunks
+    if ( tmp && !errcode )
+    {
+        errcode = output_gatherColumns(file, tmp, (REAL4 *)buf, cols,
+            bufBytes / sizeof(REAL4), colPos, nCols, chunkPeriods);
+    }
+
+    if ( ferror(file) && !errcode ) errcode = ERR_OUT_WRITE;
+    fclose(file);
+    if ( tmp )
+    {
+        fclose(tmp);
+        remove(tmpName);
+    }
+    free(buf);
+    free(cols);
+    free(dates);
+    return errcode;
+}
+
+//=============================================================================
+
+void output_transposeColumns(char* buf, REAL4* cols, int nChunk,
+                             int nObjects, int nResults, int periodBytes)
+//
+//  Input:   buf = results of the first object of a type in a chunk of
+//                 periods read from the output file
+//           cols = array receiving the chunk's columns of the type
+//           nChunk = number of periods in the chunk
+//           nObjects = number of objects of the type
+//           nResults = number of variables per object
+//           periodBytes = bytes per period in the output file
+//  Output:  none
+//  Purpose: transposes the results of a chunk of periods for all objects
+//           of one type so that each object's variable holds its periods
+//           contiguously (ordered by variable, then by object).
+//
+{
+    int       j, v, k;
+    REAL4*    x;
+    REAL4*    col;
+
+    for (k = 0; k < nChunk; k++)
+    {
+        x = (REAL4 *)(buf + (size_t)k * periodBytes);
+        for (j = 0; j < nObjects; j++)
+        {
+            col = cols + (size_t)j * nChunk + k;
+            for (v = 0; v < nResults; v++)
+            {
+                col[(size_t)v * nObjects * nChunk] = x[v];
+            }
+            x += nResults;
+        }
+    }
+}
+
+//=============================================================================
+
+int output_gatherColumns(FILE* file, FILE* tmp, REAL4* group, REAL4* part,
+                         size_t groupSize, long long colPos, int nCols,
+                         int chunkPeriods)
+//
+//  Input:   file = columnar results file
+//           tmp = file holding the transposed chunks of periods
+//           group = work array of groupSize values (at least Nperiods)
+//           part = work array at least as large as a transposed chunk
+//           groupSize = number of values the group array holds
+//           colPos = file position of the first column
+//           nCols = number of columns
+//           chunkPeriods = number of periods in each chunk (but the last)
+//  Output:  returns an error code
+//  Purpose: copies whole columns from the transposed chunks into the
+//           columnar file, as many columns at a time as fit in the group
+//           array.
+//
+//  Within a transposed chunk the columns are consecutive, so the part of
+//  a group of columns in each chunk is read at once, and the groups are
+//  written one after the other in a single sequential run.
+//
+{
+    int       k, k0, m, p, nChunk;
+    int       nGroup = (int)MIN(groupSize / Nperiods, (size_t)nCols);
+    long long pos;
+
+    FSEEK64(file, colPos);
+    for (k0 = 0; k0 < nCols; k0 += m)
+    {
+        m = MIN(nGroup, nCols - k0);
+        for (p = 0; p < Nperiods; p += nChunk)
+        {
+            nChunk = MIN(chunkPeriods, Nperiods - p);
+            pos = ((long long)p * nCols + (long long)k0 * nChunk) *
+                  sizeof(REAL4);
+            FSEEK64(tmp, pos);
+            if ( fread(part, sizeof(REAL4), (size_t)m * nChunk, tmp) <
+                 (size_t)m * nChunk ) return ERR_OUT_READ;
+            for (k = 0; k < m; k++)
+            {
+                memcpy(group + (size_t)k * Nperiods + p,
+                       part + (size_t)k * nChunk, nChunk * sizeof(REAL4));
+            }
+        }
+        fwrite(group, sizeof(REAL4), (size_t)m * Nperiods, file);
+    }
+    return 0;
+}
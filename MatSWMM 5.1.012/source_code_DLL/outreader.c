@@ -0,0 +1,497 @@
+//-----------------------------------------------------------------------------
+//   outreader.c
+//
+//   Project:  EPA SWMM5
+//   Version:  5.1
+//
+//   Read-only access to the binary output file of a finished run.
+//
+//   The whole file is memory-mapped, so that the results of an object can be
+//   read over all reporting periods without seeking and without opening the
+//   project that produced the file. A value of variable v for object j of a
+//   given type at period p lies at a fixed stride of one period record from
+//   the value of the previous period, which lets callers use the mapped file
+//   directly as a strided array (outreader_getView) or copy a time series
+//   out of it (outreader_getSeries).
+//-----------------------------------------------------------------------------
+#define _CRT_SECURE_NO_DEPRECATE
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "headers.h"
+#include "hash.h"
+#include "cosimulation.h"
+#include "outreader.h"
+
+// Definition of 4-byte integer, 4-byte real and 8-byte real types
+#define INT4  int
+#define REAL4 float
+#define REAL8 double
+
+enum OutObjType {OUT_SUBCATCH, OUT_NODE, OUT_LINK, OUT_MAX_TYPES};
+
+//-----------------------------------------------------------------------------
+//  Data Structures
+//-----------------------------------------------------------------------------
+struct TOutReader
+{
+    char*     data;                    // start of the mapped file
+    long long size;                    // size of the file (bytes)
+    int       nPeriods;                // number of reporting periods
+    int       reportStep;              // reporting time step (sec)
+    double    startDate;               // date of period before the first one
+    int       count[OUT_MAX_TYPES];    // number of objects of each type
+    int       nResults[OUT_MAX_TYPES]; // number of variables of each type
+    long long resultsPos[OUT_MAX_TYPES]; // offset of each type in a period
+    long long outputPos;               // file offset of the first period
+    long long bytesPerPeriod;          // bytes in each period record
+    HTtable*  ids[OUT_MAX_TYPES];      // hash tables of object IDs
+    char*     idBuf;                   // storage for the ID strings
+#ifdef _WIN32
+    HANDLE    file;                    // file handle
+    HANDLE    map;                     // file mapping handle
+#endif
+};
+
+//-----------------------------------------------------------------------------
+//  Local functions
+//-----------------------------------------------------------------------------
+static int  mapFile(TOutReader* r, char* fname);
+static void unmapFile(TOutReader* r);
+static INT4 readInt(TOutReader* r, long long pos);
+static int  readIDs(TOutReader* r, long long pos);
+static int  getTypeIndex(int objType);
+
+//=============================================================================
+
+int outreader_open(char* fname, TOutReader** reader)
+//
+//  Input:   fname = name of a binary output file
+//  Output:  reader = new reader for the file;
+//           returns 0 or an error code
+//  Purpose: memory-maps a binary output file and reads its layout.
+//
+{
+    TOutReader* r;
+    long long   pos, idPos, inputPos;
+    int         i, k, nPolluts;
+
+    *reader = NULL;
+    r = (TOutReader *) calloc(1, sizeof(TOutReader));
+    if ( r == NULL ) return C_ERROR_INCOHERENT;
+    if ( !mapFile(r, fname) )
+    {
+        free(r);
+        return C_ERROR_PATH;
+    }
+
+    // --- check the magic numbers at both ends of the file
+    if ( r->size < 13 * (long long)sizeof(INT4) ||
+         readInt(r, 0) != MAGICNUMBER ||
+         readInt(r, r->size - sizeof(INT4)) != MAGICNUMBER )
+    {
+        outreader_close(r);
+        return C_ERROR_PATH;
+    }
+
+    // --- read the number of objects & the file offsets of each section
+    r->count[OUT_SUBCATCH] = readInt(r, 3 * sizeof(INT4));
+    r->count[OUT_NODE]     = readInt(r, 4 * sizeof(INT4));
+    r->count[OUT_LINK]     = readInt(r, 5 * sizeof(INT4));
+    nPolluts               = readInt(r, 6 * sizeof(INT4));
+    pos = r->size - 6 * sizeof(INT4);
+    idPos         = readInt(r, pos);
+    inputPos      = readInt(r, pos + sizeof(INT4));
+    r->outputPos  = readInt(r, pos + 2 * sizeof(INT4));
+    r->nPeriods   = readInt(r, pos + 3 * sizeof(INT4));
+
+    // --- skip the input data of each type of object
+    //     (a count of values per object, their codes & the values)
+    pos = inputPos;
+    for (i = 0; i < OUT_MAX_TYPES; i++)
+    {
+        k = readInt(r, pos);
+        pos += (1 + k + (long long)k * r->count[i]) * sizeof(INT4);
+    }
+
+    // --- read the number of output variables of each type of object
+    //     (the system variables follow the link variables)
+    for (i = 0; i < OUT_MAX_TYPES; i++)
+    {
+        r->nResults[i] = readInt(r, pos);
+        pos += (1 + r->nResults[i]) * sizeof(INT4);
+    }
+    k = readInt(r, pos);
+    pos += (1 + k) * sizeof(INT4);
+
+    // --- check that the counts are valid & the starting date is in the file
+    for (i = 0; i < OUT_MAX_TYPES; i++)
+    {
+        if ( r->count[i] < 0 || r->nResults[i] < 0 ) k = -1;
+    }
+    if ( k < 0 || pos < 0 ||
+         pos + (long long)(sizeof(REAL8) + sizeof(INT4)) > r->size )
+    {
+        outreader_close(r);
+        return C_ERROR_PATH;
+    }
+    memcpy(&r->startDate, r->data + pos, sizeof(REAL8));
+    r->reportStep = readInt(r, pos + sizeof(REAL8));
+
+    // --- find the layout of each period record
+    r->resultsPos[OUT_SUBCATCH] = sizeof(REAL8);
+    r->resultsPos[OUT_NODE] = r->resultsPos[OUT_SUBCATCH] +
+        (long long)r->count[OUT_SUBCATCH] * r->nResults[OUT_SUBCATCH] * sizeof(REAL4);
+    r->resultsPos[OUT_LINK] = r->resultsPos[OUT_NODE] +
+        (long long)r->count[OUT_NODE] * r->nResults[OUT_NODE] * sizeof(REAL4);
+    r->bytesPerPeriod = r->resultsPos[OUT_LINK] +
+        (long long)r->count[OUT_LINK] * r->nResults[OUT_LINK] * sizeof(REAL4) +
+        k * sizeof(REAL4);
+    if ( r->nPeriods < 0 || r->outputPos < 0 ||
+         r->outputPos + r->nPeriods * r->bytesPerPeriod >
+         r->size - 6 * (long long)sizeof(INT4) || nPolluts < 0 )
+    {
+        outreader_close(r);
+        return C_ERROR_PATH;
+    }
+
+    // --- build hash tables of object IDs
+    if ( !readIDs(r, idPos) )
+    {
+        outreader_close(r);
+        return C_ERROR_INCOHERENT;
+    }
+    *reader = r;
+    return 0;
+}
+
+//=============================================================================
+
+void outreader_close(TOutReader* r)
+//
+//  Input:   r = a results reader
+//  Output:  none
+//  Purpose: unmaps the file of a results reader and frees the reader.
+//
+{
+    int i;
+    if ( r == NULL ) return;
+    for (i = 0; i < OUT_MAX_TYPES; i++)
+    {
+        if ( r->ids[i] ) HTfree(r->ids[i]);
+    }
+    FREE(r->idBuf);
+    unmapFile(r);
+    free(r);
+}
+
+//=============================================================================
+
+int outreader_getInfo(TOutReader* r, int* nPeriods, int* reportStep,
+                      double* startDate)
+//
+//  Input:   r = a results reader
+//  Output:  nPeriods = number of reporting periods
+//           reportStep = reporting time step (sec)
+//           startDate = date of the period before the first one;
+//           returns 0 or an error code
+//  Purpose: retrieves the reporting times of a results file.
+//
+{
+    if ( r == NULL ) return C_ERROR_INCOHERENT;
+    *nPeriods = r->nPeriods;
+    *reportStep = r->reportStep;
+    *startDate = r->startDate;
+    return 0;
+}
+
+//=============================================================================
+
+int outreader_getCount(TOutReader* r, int objType)
+//
+//  Input:   r = a results reader
+//           objType = SUBCATCH, NODE or LINK
+//  Output:  returns number of reported objects of the type or an error code
+//  Purpose: retrieves the number of objects with results in the file.
+//
+{
+    int i = getTypeIndex(objType);
+    if ( r == NULL ) return C_ERROR_INCOHERENT;
+    if ( i < 0 ) return C_ERROR_TYPE;
+    return r->count[i];
+}
+
+//=============================================================================
+
+int outreader_getIndex(TOutReader* r, int objType, char* id)
+//
+//  Input:   r = a results reader
+//           objType = SUBCATCH, NODE or LINK
+//           id = ID name of an object
+//  Output:  returns index of the object in the file or an error code
+//  Purpose: finds the position of an object among the reported objects
+//           of its type.
+//
+{
+    int i = getTypeIndex(objType);
+    int j;
+    if ( r == NULL ) return C_ERROR_INCOHERENT;
+    if ( i < 0 ) return C_ERROR_TYPE;
+    j = HTfind(r->ids[i], id);
+    if ( j == NOTFOUND ) return C_ERROR_NFOUND;
+    return j;
+}
+
+//=============================================================================
+
+int outreader_getDates(TOutReader* r, int first, int n, double* dates)
+//
+//  Input:   r = a results reader
+//           first = index of the first period (starting from 0)
+//           n = number of periods
+//  Output:  dates = date/time of each period;
+//           returns 0 or an error code
+//  Purpose: retrieves the dates of a range of reporting periods.
+//
+{
+    int p;
+    if ( r == NULL || first < 0 || n < 0 || first + n > r->nPeriods )
+        return C_ERROR_INCOHERENT;
+    for (p = 0; p < n; p++)
+    {
+        memcpy(&dates[p], r->data + r->outputPos +
+               (first + p) * r->bytesPerPeriod, sizeof(REAL8));
+    }
+    return 0;
+}
+
+//=============================================================================
+
+int outreader_getView(TOutReader* r, int objType, int index, int variable,
+                      float** values, int* stride)
+//
+//  Input:   r = a results reader
+//           objType = SUBCATCH, NODE or LINK
+//           index = index of the object in the file
+//           variable = index of the output variable (e.g. NODE_DEPTH)
+//  Output:  values = address of the variable's value in the first period
+//                    within the mapped file;
+//           stride = number of floats between consecutive periods;
+//           returns 0 or an error code
+//  Purpose: gives zero-copy access to the time series of an object's
+//           variable. The view stays valid until the reader is closed.
+//
+{
+    int i = getTypeIndex(objType);
+
+    if ( r == NULL ) return C_ERROR_INCOHERENT;
+    if ( i < 0 ) return C_ERROR_TYPE;
+    if ( index < 0 || index >= r->count[i] ) return C_ERROR_NFOUND;
+    if ( variable < 0 || variable >= r->nResults[i] ) return C_ERROR_ATR;
+    *values = (float *)(r->data + r->outputPos + r->resultsPos[i] +
+              ((long long)index * r->nResults[i] + variable) * sizeof(REAL4));
+    *stride = (int)(r->bytesPerPeriod / sizeof(REAL4));
+    return 0;
+}
+
+//=============================================================================
+
+int outreader_getSeries(TOutReader* r, int objType, int index, int variable,
+                        int first, int n, float* values)
+//
+//  Input:   r = a results reader
+//           objType = SUBCATCH, NODE or LINK
+//           index = index of the object in the file
+//           variable = index of the output variable (e.g. NODE_DEPTH)
+//           first = index of the first period (starting from 0)
+//           n = number of periods
+//  Output:  values = value of the variable at each period;
+//           returns 0 or an error code
+//  Purpose: copies the time series of an object's variable.
+//
+{
+    int    p, stride, err;
+    float* x;
+
+    err = outreader_getView(r, objType, index, variable, &x, &stride);
+    if ( err ) return err;
+    if ( first < 0 || n < 0 || first + n > r->nPeriods )
+        return C_ERROR_INCOHERENT;
+    x += (long long)first * stride;
+    for (p = 0; p < n; p++)
+    {
+        memcpy(&values[p], x, sizeof(REAL4));
+        x += stride;
+    }
+    return 0;
+}
+
+//=============================================================================
+
+int getTypeIndex(int objType)
+//
+//  Input:   objType = SUBCATCH, NODE or LINK
+//  Output:  returns position of the type in the file or -1
+//  Purpose: converts an object type code to its position in the file.
+//
+{
+    switch ( objType )
+    {
+      case SUBCATCH: return OUT_SUBCATCH;
+      case NODE:     return OUT_NODE;
+      case LINK:     return OUT_LINK;
+      default:       return -1;
+    }
+}
+
+//=============================================================================
+
+INT4 readInt(TOutReader* r, long long pos)
+//
+//  Input:   r = a results reader
+//           pos = offset in the file
+//  Output:  returns the 4-byte integer at the offset (0 if out of range)
+//  Purpose: reads an integer from the mapped file.
+//
+{
+    INT4 k = 0;
+    if ( pos >= 0 && pos + (long long)sizeof(INT4) <= r->size )
+        memcpy(&k, r->data + pos, sizeof(INT4));
+    return k;
+}
+
+//=============================================================================
+
+int readIDs(TOutReader* r, long long pos)
+//
+//  Input:   r = a results reader
+//           pos = file offset of the ID names
+//  Output:  returns TRUE if successful
+//  Purpose: builds a hash table of the ID names of each type of object.
+//
+{
+    int       i, j, n;
+    long long p, total = 0;
+    char*     s;
+
+    // --- find space needed by the null-terminated ID names
+    p = pos;
+    for (i = 0; i < OUT_MAX_TYPES; i++)
+    {
+        for (j = 0; j < r->count[i]; j++)
+        {
+            n = readInt(r, p);
+            if ( n < 0 || p < 0 ||
+                 p + (long long)sizeof(INT4) + n > r->outputPos ) return FALSE;
+            total += n + 1;
+            p += sizeof(INT4) + n;
+        }
+    }
+    r->idBuf = (char *) malloc((size_t)total + 1);
+    if ( r->idBuf == NULL ) return FALSE;
+
+    // --- copy each name & add it to its type's table
+    p = pos;
+    s = r->idBuf;
+    for (i = 0; i < OUT_MAX_TYPES; i++)
+    {
+        r->ids[i] = HTcreate();
+        if ( r->ids[i] == NULL ) return FALSE;
+        for (j = 0; j < r->count[i]; j++)
+        {
+            n = readInt(r, p);
+            memcpy(s, r->data + p + sizeof(INT4), n);
+            s[n] = '\0';
+            if ( !HTinsert(r->ids[i], s, j) ) return FALSE;
+            s += n + 1;
+            p += sizeof(INT4) + n;
+        }
+    }
+    return TRUE;
+}
+
+//=============================================================================
+
+int mapFile(TOutReader* r, char* fname)
+//
+//  Input:   r = a results reader
+//           fname = name of the file
+//  Output:  returns TRUE if successful
+//  Purpose: maps a whole file into memory for reading.
+//
+{
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    r->file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if ( r->file == INVALID_HANDLE_VALUE )
+    {
+        r->file = NULL;
+        return FALSE;
+    }
+    if ( !GetFileSizeEx(r->file, &size) || size.QuadPart == 0 )
+    {
+        unmapFile(r);
+        return FALSE;
+    }
+    r->size = size.QuadPart;
+    r->map = CreateFileMappingA(r->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if ( r->map == NULL )
+    {
+        unmapFile(r);
+        return FALSE;
+    }
+    r->data = (char *) MapViewOfFile(r->map, FILE_MAP_READ, 0, 0, 0);
+    if ( r->data == NULL )
+    {
+        unmapFile(r);
+        return FALSE;
+    }
+    return TRUE;
+#else
+    struct stat st;
+    void* p;
+    int   fd = open(fname, O_RDONLY);
+    if ( fd < 0 ) return FALSE;
+    if ( fstat(fd, &st) != 0 || st.st_size == 0 )
+    {
+        close(fd);
+        return FALSE;
+    }
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if ( p == MAP_FAILED ) return FALSE;
+    r->data = (char *) p;
+    r->size = st.st_size;
+    return TRUE;
+#endif
+}
+
+//=============================================================================
+
+void unmapFile(TOutReader* r)
+//
+//  Input:   r = a results reader
+//  Output:  none
+//  Purpose: releases the memory map of a reader's file.
+//
+{
+#ifdef _WIN32
+    if ( r->data ) UnmapViewOfFile(r->data);
+    if ( r->map ) CloseHandle(r->map);
+    if ( r->file ) CloseHandle(r->file);
+    r->map = NULL;
+    r->file = NULL;
+#else
+    if ( r->data ) munmap(r->data, (size_t)r->size);
+#endif
+    r->data = NULL;
+}
@@ -0,0 +1,28 @@
+//-----------------------------------------------------------------------------
+//   outreader.h
+//
+//   Project: EPA SWMM5
+//   Version: 5.1
+//
+//   Header file for outreader.c, which gives read-only, memory-mapped
+//   access to the binary output file of a finished SWMM run.
+//-----------------------------------------------------------------------------
+
+#ifndef OUTREADER_H
+#define OUTREADER_H
+
+typedef struct TOutReader TOutReader;
+
+int    outreader_open(char* fname, TOutReader** reader);
+void   outreader_close(TOutReader* reader);
+int    outreader_getInfo(TOutReader* reader, int* nPeriods, int* reportStep,
+       double* startDate);
+int    outreader_getCount(TOutReader* reader, int objType);
+int    outreader_getIndex(TOutReader* reader, int objType, char* id);
+int    outreader_getDates(TOutReader* reader, int first, int n, double* dates);
+int    outreader_getView(TOutReader* reader, int objType, int index,
+       int variable, float** values, int* stride);
+int    outreader_getSeries(TOutReader* reader, int objType, int index,
+       int variable, int first, int n, float* values);
+
+#endif
@@ -68,13 +68,14 @@
 //-----------------------------------------------------------------------------
 //  Shared variables
 //-----------------------------------------------------------------------------
-static HTtable* Htable[MAX_OBJ_TYPES]; // Hash tables for object ID names
-static char     MemPoolAllocated;      // TRUE if memory pool allocated 
+#define Htable  (Project->Htable)  // Hash tables for object ID names
+#define MemPool (Project->MemPool) // Memory pool for object ID names
 
 //-----------------------------------------------------------------------------
 //  External Functions (declared in funcs.h)
 //-----------------------------------------------------------------------------
 //  project_open           (called from swmm_open in swmm5.c)
+//  project_openFromBuffer (called from swmm_openFromBuffer in swmm5.c)
 //  project_close          (called from swmm_close in swmm5.c)
 //  project_readInput      (called from swmm_open in swmm5.c)
 //  project_readOption     (called from readOption in input.c)
@@ -92,6 +93,9 @@ static char     MemPoolAllocated;      // TRUE if memory pool allocated
 static void initPointers(void);
 static void setDefaults(void);
 static void openFiles(char *f1, char *f2, char *f3);
+static void openBufferFiles(const char *inpText, size_t len, char *f2,
+            char *f3);
+static FILE* openInputBuffer(const char *inpText, size_t len);
 static void createObjects(void);
 static void deleteObjects(void);
 static void createHashTables(void);
@@ -116,6 +120,25 @@ void project_open(char *f1, char *f2, char *f3)
 
 //=============================================================================
 
+void project_openFromBuffer(const char *inpText, size_t len, char *f2,
+     char *f3)
+//
+//  Input:   inpText = contents of an input file
+//           len = number of characters in inpText
+//           f2 = pointer to name of report file (NULL or empty for none)
+//           f3 = pointer to name of binary output file (NULL or empty for
+//                a scratch file)
+//  Output:  none
+//  Purpose: opens a new SWMM project whose input is held in memory.
+//
+{
+    initPointers();
+    setDefaults();
+    openBufferFiles(inpText, len, f2, f3);
+}
+
+//=============================================================================
+
 void project_readInput()
 //
 //  Input:   none
@@ -186,6 +209,7 @@ void project_validate()
     int i;
     int j;
     int err;
+    TProject* project = Project;
 
     // --- validate Curves and TimeSeries
     for ( i=0; i<Nobjects[CURVE]; i++ )
@@ -255,10 +279,12 @@ void project_validate()
 
 #pragma omp parallel                                                           //(5.1.008)
 {
+    Project = project;                 // worker threads share this project
     if ( NumThreads == 0 ) NumThreads = omp_get_num_threads();                 //(5.1.008)
     else NumThreads = MIN(NumThreads, omp_get_num_threads());                  //(5.1.008)
 }
-    if ( Nobjects[LINK] < 4 * NumThreads ) NumThreads = 1;                     //(5.1.008)
+    // --- NumThreads is an upper limit; each parallel phase of the
+    //     simulation chooses its own thread count (see workers.c)
 
 }
 
@@ -316,6 +342,7 @@ int   project_addObject(int type, char *id, int n)
     // --- use memory from the hash tables' common memory pool to store
     //     a copy of the object's ID string
     len = strlen(id) + 1;
+    AllocSetPool(MemPool);
     newID = (char *) Alloc(len*sizeof(char));
     strcpy(newID, id);
 
@@ -558,6 +585,7 @@ int project_readOption(char* s1, char* s2)
       case IGNORE_ROUTING:
       case IGNORE_QUALITY:
       case IGNORE_RDII:                                                        //(5.1.004)
+      case XSECT_TABLES:
         m = findmatch(s2, NoYesWords);
         if ( m < 0 ) return error_setInpError(ERR_KEYWORD, s2);
         switch ( k )
@@ -571,6 +599,7 @@ int project_readOption(char* s1, char* s2)
           case IGNORE_ROUTING:    IgnoreRouting   = m;  break;
           case IGNORE_QUALITY:    IgnoreQuality   = m;  break;
           case IGNORE_RDII:       IgnoreRDII      = m;  break;                 //(5.1.004)
+          case XSECT_TABLES:      XsectTables     = m;  break;
         }
         break;
 
@@ -587,6 +616,24 @@ int project_readOption(char* s1, char* s2)
         ForceMainEqn = m;
         break;
 
+      case DYNWAVE_METHOD:
+        m = findmatch(s2, DynWaveMethodWords);
+        if ( m < 0 ) return error_setInpError(ERR_KEYWORD, s2);
+        DynWaveMethod = m;
+        break;
+
+      case DYNWAVE_PREDICTOR:
+        m = findmatch(s2, PredictorWords);
+        if ( m < 0 ) return error_setInpError(ERR_KEYWORD, s2);
+        DynWavePredictor = m;
+        break;
+
+      case RENUMBERING:
+        m = findmatch(s2, RenumberingWords);
+        if ( m < 0 ) return error_setInpError(ERR_KEYWORD, s2);
+        Renumbering = m;
+        break;
+
       case LINK_OFFSETS:
         m = findmatch(s2, LinkOffsetWords);
         if ( m < 0 ) return error_setInpError(ERR_KEYWORD, s2);
@@ -677,6 +724,23 @@ int project_readOption(char* s1, char* s2)
         MaxTrials = m;
         break;
 
+      // --- number of power-of-two time step classes that dynamic wave
+      //     nodes & links are advanced with (1 = one step for all)
+      case STEP_CLASSES:
+        m = atoi(s2);
+        if ( m < 1 || m > MAX_STEP_CLASSES )
+            return error_setInpError(ERR_NUMBER, s2);
+        StepClasses = m;
+        break;
+
+      // --- kilobytes of the binary output file read at once when
+      //     exporting results to a columnar file
+      case EXPORT_BUFFER:
+        m = atoi(s2);
+        if ( m < 1 ) return error_setInpError(ERR_NUMBER, s2);
+        ExportBuffer = m;
+        break;
+
       // --- head convergence tolerance for dynamic wave routing
       case HEAD_TOL:
         if ( !getDouble(s2, &HeadTol) )
@@ -703,6 +767,15 @@ int project_readOption(char* s1, char* s2)
         LatFlowTol /= 100.0;
         break;
 
+      // --- change in flow below which dynamic wave routing skips a
+      //     node or conduit (0 = route every node & conduit)
+      case ACTIVE_SET_TOL:
+        if ( !getDouble(s2, &ActiveSetTol) || ActiveSetTol < 0.0 )
+        {
+            return error_setInpError(ERR_NUMBER, s2);
+        }
+        break;
+
       case TEMPDIR: // Temporary Directory
         sstrncpy(TempDir, s2, MAXFNAME);
         break;
@@ -743,7 +816,13 @@ void initPointers()
     UnitHyd    = NULL;
     Snowmelt   = NULL;
     Event      = NULL;                                                         //(5.1.011)
-    MemPoolAllocated = FALSE;
+    NodeOrder    = NULL;
+    NodePosition = NULL;
+    LinkOrder    = NULL;
+    LinkPosition = NULL;
+    NodeQual   = NULL;
+    LinkQual   = NULL;
+    MemPool    = NULL;
 }
 
 //=============================================================================
@@ -790,6 +869,8 @@ void setDefaults()
    InertDamping    = SOME;             // Partial inertial damping
    NormalFlowLtd   = BOTH;             // Default normal flow limitation
    ForceMainEqn    = H_W;              // Hazen-Williams eqn. for force mains
+   DynWaveMethod   = PICARD;           // Picard iterations for dynamic wave
+   DynWavePredictor = NO_PREDICTOR;    // Iterations start from last state
    LinkOffsets     = DEPTH_OFFSET;     // Use depth for link offsets
    LengtheningStep = 0;                // No lengthening of conduits
    CourantFactor   = 0.0;              // No variable time step 
@@ -802,6 +883,8 @@ void setDefaults()
    IgnoreGwater    = FALSE;            // Analyze groundwater 
    IgnoreRouting   = FALSE;            // Analyze flow routing
    IgnoreQuality   = FALSE;            // Analyze water quality
+   XsectTables     = FALSE;            // Evaluate conduit geometry exactly
+   Renumbering     = NO_RENUMBERING;   // Keep nodes & links in input order
    WetStep         = 300;              // Runoff wet time step (secs)
    DryStep         = 3600;             // Runoff dry time step (secs)
    RouteStep       = 300.0;            // Routing time step (secs)
@@ -809,10 +892,13 @@ void setDefaults()
    ReportStep      = 900;              // Reporting time step (secs)
    StartDryDays    = 0.0;              // Antecedent dry days
    MaxTrials       = 0;                // Force use of default max. trials 
+   StepClasses     = 1;                // All nodes & links share one step
    HeadTol         = 0.0;              // Force use of default head tolerance
+   ActiveSetTol    = 0.0;              // Route every node & conduit
    SysFlowTol      = 0.05;             // System flow tolerance for steady state
    LatFlowTol      = 0.05;             // Lateral flow tolerance for steady state
    NumThreads      = 0;                // Number of parallel threads to use
+   ExportBuffer    = 65536;            // Read up to 64 MB of results at once
    NumEvents       = 0;                // Number of detailed routing events    //(5.1.011)
 
    // Deprecated options
@@ -938,6 +1024,84 @@ void openFiles(char *f1, char *f2, char *f3)
 
 //=============================================================================
 
+void openBufferFiles(const char *inpText, size_t len, char *f2, char *f3)
+//
+//  Input:   inpText = contents of an input file
+//           len = number of characters in inpText
+//           f2 = name of report file (NULL or empty for none)
+//           f3 = name of binary output file (NULL or empty for none)
+//  Output:  none
+//  Purpose: opens a stream over an in-memory input file and a report file,
+//           which is an anonymous temporary file when no name is given.
+//
+{
+    if ( f2 == NULL ) f2 = "";
+    if ( f3 == NULL ) f3 = "";
+
+    // --- initialize file pointers to NULL
+    Finp.file = NULL;
+    Frpt.file = NULL;
+    Fout.file = NULL;
+
+    // --- save file names (the input has none)
+    strcpy(Finp.name, "");
+    sstrncpy(Frpt.name, f2, MAXFNAME);
+    sstrncpy(Fout.name, f3, MAXFNAME);
+
+    // --- check that file names are not identical
+    if ( strlen(f2) > 0 && strcomp(f2, f3) )
+    {
+        writecon(FMT11);
+        ErrorCode = ERR_FILE_NAME;
+        return;
+    }
+
+    // --- open input stream and report file
+    if ( inpText == NULL || len == 0 ||
+         (Finp.file = openInputBuffer(inpText, len)) == NULL )
+    {
+        writecon(FMT12);
+        ErrorCode = ERR_INP_FILE;
+        return;
+    }
+    if ( strlen(f2) > 0 ) Frpt.file = fopen(f2, "wt");
+    else                  Frpt.file = tmpfile();
+    if ( Frpt.file == NULL )
+    {
+       writecon(FMT13);
+       ErrorCode = ERR_RPT_FILE;
+       return;
+    }
+}
+
+//=============================================================================
+
+FILE* openInputBuffer(const char *inpText, size_t len)
+//
+//  Input:   inpText = contents of an input file
+//           len = number of characters in inpText
+//  Output:  returns a stream positioned at the start of inpText
+//  Purpose: lets the input parser read an input file held in memory.
+//
+{
+#ifdef _WIN32
+    // --- no memory streams: copy the text to an anonymous temporary file
+    FILE* f = tmpfile();
+    if ( f == NULL ) return NULL;
+    if ( fwrite(inpText, 1, len, f) != len )
+    {
+        fclose(f);
+        return NULL;
+    }
+    rewind(f);
+    return f;
+#else
+    return fmemopen((void *)inpText, len, "r");
+#endif
+}
+
+//=============================================================================
+
 void createObjects()
 //
 //  Input:   none
@@ -981,6 +1145,15 @@ void createObjects()
     Event[NumEvents].end = BIG + 1.0;
 ////
 
+    // --- create maps between input order and the order nodes & links
+    //     are stored in (the same unless renumbered, see renumber.c)
+    NodeOrder    = (int *) calloc(Nobjects[NODE], sizeof(int));
+    NodePosition = (int *) calloc(Nobjects[NODE], sizeof(int));
+    LinkOrder    = (int *) calloc(Nobjects[LINK], sizeof(int));
+    LinkPosition = (int *) calloc(Nobjects[LINK], sizeof(int));
+    for (j = 0; j < Nobjects[NODE]; j++) NodeOrder[j] = NodePosition[j] = j;
+    for (j = 0; j < Nobjects[LINK]; j++) LinkOrder[j] = LinkPosition[j] = j;
+
     // --- create LID objects
     lid_create(Nobjects[LID], Nobjects[SUBCATCH]);
 
@@ -1005,10 +1178,18 @@ void createObjects()
         Subcatch[j].pondedQual = (double *) calloc(Nobjects[POLLUT], sizeof(double));
         Subcatch[j].totalLoad  = (double *) calloc(Nobjects[POLLUT], sizeof(double));
     }
+
+    // --- the pollutant arrays of all nodes (and of all links) share one
+    //     block of memory, each array following the one of the previous
+    //     object (see also renumber_objects)
+    NodeQual = (double *) calloc(2 * Nobjects[NODE] * Nobjects[POLLUT] + 1,
+                                 sizeof(double));
+    LinkQual = (double *) calloc(3 * Nobjects[LINK] * Nobjects[POLLUT] + 1,
+                                 sizeof(double));
     for (j = 0; j < Nobjects[NODE]; j++)
     {
-        Node[j].oldQual = (double *) calloc(Nobjects[POLLUT], sizeof(double));
-        Node[j].newQual = (double *) calloc(Nobjects[POLLUT], sizeof(double));
+        Node[j].oldQual = NodeQual + j * Nobjects[POLLUT];
+        Node[j].newQual = NodeQual + (Nobjects[NODE] + j) * Nobjects[POLLUT];
         Node[j].extInflow = NULL;
         Node[j].dwfInflow = NULL;
         Node[j].rdiiInflow = NULL;
@@ -1016,9 +1197,9 @@ void createObjects()
     }
     for (j = 0; j < Nobjects[LINK]; j++)
     {
-        Link[j].oldQual = (double *) calloc(Nobjects[POLLUT], sizeof(double));
-        Link[j].newQual = (double *) calloc(Nobjects[POLLUT], sizeof(double));
-        Link[j].totalLoad = (double *) calloc(Nobjects[POLLUT], sizeof(double));
+        Link[j].oldQual = LinkQual + j * Nobjects[POLLUT];
+        Link[j].newQual = LinkQual + (Nobjects[LINK] + j) * Nobjects[POLLUT];
+        Link[j].totalLoad = LinkQual + (2*Nobjects[LINK] + j) * Nobjects[POLLUT];
     }
 
     // --- allocate memory for land use buildup/washoff functions
@@ -1152,17 +1333,11 @@ void deleteObjects()
         FREE(Subcatch[j].pondedQual);
         FREE(Subcatch[j].totalLoad);
     }
-    if ( Node ) for (j = 0; j < Nobjects[NODE]; j++)
-    {
-        FREE(Node[j].oldQual);
-        FREE(Node[j].newQual);
-    }
-    if ( Link ) for (j = 0; j < Nobjects[LINK]; j++)
-    {
-        FREE(Link[j].oldQual);
-        FREE(Link[j].newQual);
-        FREE(Link[j].totalLoad);
-    }
+    FREE(NodeQual);
+    FREE(LinkQual);
+
+    // --- free memory used for conduit geometry tables
+    xsect_deleteTables();
 
     // --- free memory used for rainfall infiltration
     infil_delete();
@@ -1232,6 +1407,10 @@ void deleteObjects()
     FREE(Snowmelt);
     FREE(Shape);
     FREE(Event);                                                               //(5.1.011)
+    FREE(NodeOrder);
+    FREE(NodePosition);
+    FREE(LinkOrder);
+    FREE(LinkPosition);
 }
 
 //=============================================================================
@@ -1243,7 +1422,7 @@ void createHashTables()
 //  Purpose: allocates memory for object ID hash tables
 //
 {   int j;
-    MemPoolAllocated = FALSE;
+    MemPool = NULL;
     for (j = 0; j < MAX_OBJ_TYPES ; j++)
     {
         Htable[j] = HTcreate();
@@ -1251,8 +1430,8 @@ void createHashTables()
     }
 
     // --- initialize memory pool used to store object ID's
-    if ( AllocInit() == NULL ) report_writeErrorMsg(ERR_MEMORY, "");
-    else MemPoolAllocated = TRUE;
+    MemPool = AllocInit();
+    if ( MemPool == NULL ) report_writeErrorMsg(ERR_MEMORY, "");
 }
 
 //=============================================================================
@@ -1271,7 +1450,12 @@ void deleteHashTables()
     }
 
     // --- free object ID memory pool
-    if ( MemPoolAllocated ) AllocFreePool();
+    if ( MemPool )
+    {
+        AllocSetPool(MemPool);
+        AllocFreePool();
+        MemPool = NULL;
+    }
 }
 
 //=============================================================================
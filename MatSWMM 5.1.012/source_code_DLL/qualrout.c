@@ -22,12 +22,18 @@
 //   - Entire module re-written to be more compact and easier to follow.
 //   - Neglible depth limit replaced with a negligible volume limit.
 //
+//   Nodes and then links are analyzed in parallel. Instead of each link
+//   adding its mass flow to its downstream node, each node gathers the
+//   mass flows of the links draining into it (in link order, as a serial
+//   run would add them), so no two threads update the same node.
+//
 //-----------------------------------------------------------------------------
 #define _CRT_SECURE_NO_DEPRECATE
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <omp.h>
 #include "headers.h"
 
 //-----------------------------------------------------------------------------
@@ -35,16 +41,24 @@
 //-----------------------------------------------------------------------------
 static const double ZeroVolume = 0.0353147; // 1 liter in ft3
 
+//-----------------------------------------------------------------------------
+//  Shared variables
+//-----------------------------------------------------------------------------
+#define QualLinkStart (Project->QualLinkStart) // start of node's entries in QualLinks
+#define QualLinks     (Project->QualLinks)     // links attached to each node
+
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)
 //-----------------------------------------------------------------------------
+//  qualrout_open            (called by routing_open)
+//  qualrout_close           (called by routing_close)
 //  qualrout_init            (called by swmm_start)
 //  qualrout_execute         (called by routing_execute)
 
 //-----------------------------------------------------------------------------
 //  Function declarations
 //-----------------------------------------------------------------------------
-static void  findLinkMassFlow(int i, double tStep);
+static void  findLinkMassFlows(int j, double tStep);
 static void  findNodeQual(int j);
 static void  findLinkQual(int i, double tStep);
 static void  findSFLinkQual(int i, double qSeep, double fEvap, double tStep);
@@ -55,6 +69,72 @@ static double getMixedQual(double c, double v1, double wIn, double qIn,
               double tStep);
 //=============================================================================
 
+int qualrout_open()
+//
+//  Input:   none
+//  Output:  returns an error code
+//  Purpose: lists the links attached to each node (in link order).
+//
+{
+    int i, j, n1, n2;
+    int nNodes = Nobjects[NODE];
+    int* next;
+
+    QualLinkStart = NULL;
+    QualLinks = NULL;
+    if ( Nobjects[POLLUT] == 0 || IgnoreQuality ) return ErrorCode;
+    QualLinkStart = (int *) calloc(nNodes + 1, sizeof(int));
+    QualLinks = (int *) calloc(2 * Nobjects[LINK] + 1, sizeof(int));
+    next = (int *) calloc(nNodes + 1, sizeof(int));
+    if ( QualLinkStart == NULL || QualLinks == NULL || next == NULL )
+    {
+        FREE(next);
+        report_writeErrorMsg(ERR_MEMORY, "");
+        return ErrorCode;
+    }
+
+    // --- count the links at each node (a link that starts & ends at
+    //     the same node is listed just once)
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        n1 = Link[i].node1;
+        n2 = Link[i].node2;
+        QualLinkStart[n1+1]++;
+        if ( n2 != n1 ) QualLinkStart[n2+1]++;
+    }
+    for (j = 0; j < nNodes; j++)
+    {
+        QualLinkStart[j+1] += QualLinkStart[j];
+        next[j] = QualLinkStart[j];
+    }
+
+    // --- list the links of each node
+    for (i = 0; i < Nobjects[LINK]; i++)
+    {
+        n1 = Link[i].node1;
+        n2 = Link[i].node2;
+        QualLinks[next[n1]++] = i;
+        if ( n2 != n1 ) QualLinks[next[n2]++] = i;
+    }
+    FREE(next);
+    return ErrorCode;
+}
+
+//=============================================================================
+
+void qualrout_close()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: frees the lists of links attached to each node.
+//
+{
+    FREE(QualLinkStart);
+    FREE(QualLinks);
+}
+
+//=============================================================================
+
 void    qualrout_init()
 //
 //  Input:   none
@@ -101,23 +181,32 @@ void qualrout_execute(double tStep)
 //
 {
     int    i, j;
-    double qIn, vAvg;
+    int    nThreads;
+    double qIn;
+    TProject* project = Project;
 
-    // --- find mass flow each link contributes to its downstream node
-    for ( i = 0; i < Nobjects[LINK]; i++ ) findLinkMassFlow(i, tStep);
+    nThreads = workers_begin(QUALITY_PHASE, Nobjects[NODE] + Nobjects[LINK]);
+#pragma omp parallel num_threads(nThreads) private(qIn)
+{
+    Project = project;                 // worker threads share this project
+
+    // --- each thread logs its mass balance updates so that they can be
+    //     added in node (or link) order (see massbal_deferTotals)
+    if ( nThreads > 1 ) massbal_deferTotals(omp_get_thread_num());
 
     // --- find new water quality concentration at each node  
+    #pragma omp for schedule(static)
     for (j = 0; j < Nobjects[NODE]; j++)
     {
-        // --- get node inflow and average volume
-        qIn = Node[j].inflow;
-        vAvg = (Node[j].oldVolume + Node[j].newVolume) / 2.0;
-        
-        // --- save inflow concentrations if treatment applied
+        // --- add mass flow from the links draining into the node
+        findLinkMassFlows(j, tStep);
+
+        // --- save inflow rate & concentrations if treatment applied
         if ( Node[j].treatment )
         {
+            qIn = Node[j].inflow;
             if ( qIn < ZERO ) qIn = 0.0;
-            treatmnt_setInflow(qIn, Node[j].newQual);
+            treatmnt_setInflow(j, qIn, Node[j].newQual);
         }
        
         // --- find new quality at the node 
@@ -126,13 +215,29 @@ void qualrout_execute(double tStep)
             findStorageQual(j, tStep);
         }
         else findNodeQual(j);
+    }
 
-        // --- apply treatment to new quality values
-        if ( Node[j].treatment ) treatmnt_treat(j, qIn, vAvg, tStep);
+    // --- apply treatment to new quality values (once the treatment
+    //     equations shared by many nodes have been evaluated together)
+    treatmnt_evalBatches(tStep);
+    #pragma omp for schedule(static)
+    for (j = 0; j < Nobjects[NODE]; j++)
+    {
+        if ( Node[j].treatment ) treatmnt_treat(j, tStep);
+    }
+    if ( nThreads > 1 )
+    {
+        #pragma omp single
+        massbal_commitTotals();
     }
 
     // --- find new water quality in each link
+    #pragma omp for schedule(static)
     for ( i = 0; i < Nobjects[LINK]; i++ ) findLinkQual(i, tStep);
+    massbal_deferTotals(-1);
+}
+    if ( nThreads > 1 ) massbal_commitTotals();
+    workers_end(QUALITY_PHASE);
 }
 
 //=============================================================================
@@ -170,38 +275,45 @@ double getMixedQual(double c, double v1, double wIn, double qIn, double tStep)
 
 //=============================================================================
 
-void findLinkMassFlow(int i, double tStep)
+void findLinkMassFlows(int j, double tStep)
 //
-//  Input:   i = link index
+//  Input:   j = node index
 //           tStep = time step (sec)
 //  Output:  none
-//  Purpose: adds constituent mass flow out of link to the total
-//           accumulation at the link's downstream node.
+//  Purpose: adds constituent mass flow out of each link whose downstream
+//           node is node j to the total accumulation at the node.
 //
 //  Note:    Node[].newQual[], the accumulator variable, already contains
 //           contributions from runoff and other external inflows from
 //           calculations made in routing_execute().
 {
-    int    j, p;
+    int    i, k, p;
     double qLink, w;
 
-    // --- find inflow to downstream node
-    qLink = Link[i].newFlow;
+    for (k = QualLinkStart[j]; k < QualLinkStart[j+1]; k++)
+    {
+        // --- find inflow to downstream node
+        i = QualLinks[k];
+        qLink = Link[i].newFlow;
 
-    // --- identify index of downstream node
-    j = Link[i].node2;
-    if ( qLink < 0.0 ) j = Link[i].node1;
-    qLink = fabs(qLink);
+        // --- skip link if node j is not its downstream node
+        if ( qLink < 0.0 )
+        {
+            if ( Link[i].node1 != j ) continue;
+        }
+        else if ( Link[i].node2 != j ) continue;
+        qLink = fabs(qLink);
 
-    // --- examine each pollutant
-    for (p = 0; p < Nobjects[POLLUT]; p++)
-    {
-        // --- temporarily accumulate inflow load in Node[j].newQual
-        w = qLink * Link[i].oldQual[p];
-        Node[j].newQual[p] += w;
+        // --- examine each pollutant
+        for (p = 0; p < Nobjects[POLLUT]; p++)
+        {
+            // --- temporarily accumulate inflow load in Node[j].newQual
+            w = qLink * Link[i].oldQual[p];
+            Node[j].newQual[p] += w;
 
-        // --- update total load transported by link
-        Link[i].totalLoad[p] += w * tStep;
+            // --- update total load transported by link
+            Link[i].totalLoad[p] += w * tStep;
+        }
     }
 }
 
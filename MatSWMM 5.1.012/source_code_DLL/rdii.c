@@ -57,7 +57,7 @@ typedef struct                         // Data for a single unit hydrograph
    double    iaUsed;                   // initial abstraction used (in or mm)
 }  TUHData;
 
-typedef struct                         // Data for a unit hydrograph group
+typedef struct TUHGroup                // Data for a unit hydrograph group
 {                                      //---------------------------------
    int       isUsed;                   // true if UH group used by any nodes
    int       rainInterval;             // time interval for RDII processing (sec)
@@ -71,17 +71,17 @@ typedef struct                         // Data for a unit hydrograph group
 //-----------------------------------------------------------------------------
 // Shared Variables
 //-----------------------------------------------------------------------------
-static TUHGroup*  UHGroup;             // processing data for each UH group
-static int        RdiiStep;            // RDII time step (sec)
-static int        NumRdiiNodes;        // number of nodes w/ RDII data
-static int*       RdiiNodeIndex;       // indexes of nodes w/ RDII data
-static REAL4*     RdiiNodeFlow;        // inflows for nodes with RDII          //(5.1.003)
-static int        RdiiFlowUnits;       // RDII flow units code
-static DateTime   RdiiStartDate;       // start date of RDII inflow period
-static DateTime   RdiiEndDate;         // end date of RDII inflow period
-static double     TotalRainVol;        // total rainfall volume (ft3)
-static double     TotalRdiiVol;        // total RDII volume (ft3)
-static int        RdiiFileType;        // type (binary/text) of RDII file
+#define UHGroup       (Project->UHGroup)       // processing data for each UH group
+#define RdiiStep      (Project->RdiiStep)      // RDII time step (sec)
+#define NumRdiiNodes  (Project->NumRdiiNodes)  // number of nodes w/ RDII data
+#define RdiiNodeIndex (Project->RdiiNodeIndex) // indexes of nodes w/ RDII data
+#define RdiiNodeFlow  (Project->RdiiNodeFlow)  // inflows for nodes with RDII          //(5.1.003)
+#define RdiiFlowUnits (Project->RdiiFlowUnits) // RDII flow units code
+#define RdiiStartDate (Project->RdiiStartDate) // start date of RDII inflow period
+#define RdiiEndDate   (Project->RdiiEndDate)   // end date of RDII inflow period
+#define TotalRainVol  (Project->TotalRainVol)  // total rainfall volume (ft3)
+#define TotalRdiiVol  (Project->TotalRdiiVol)  // total RDII volume (ft3)
+#define RdiiFileType  (Project->RdiiFileType)  // type (binary/text) of RDII file
 
 //-----------------------------------------------------------------------------
 // Imported Variables
@@ -572,11 +572,15 @@ int readRdiiFileHeader()
     if ( !RdiiNodeFlow ) return ERR_MEMORY;
 
     // --- read indexes of RDII nodes
+    //     (saved as positions of the nodes in the input file)
     if ( feof(Frdii.file) ) return ERR_RDII_FILE_FORMAT;
     fread(RdiiNodeIndex, sizeof(INT4), NumRdiiNodes, Frdii.file);
     for ( i=0; i<NumRdiiNodes; i++ )
     {
         j = RdiiNodeIndex[i];
+        if ( j < 0 || j >= Nobjects[NODE] ) return ERR_RDII_FILE_FORMAT;
+        j = NodeOrder[j];
+        RdiiNodeIndex[i] = j;
         if ( Node[j].rdiiInflow == NULL ) return ERR_RDII_FILE_FORMAT;
     }
     if ( feof(Frdii.file) ) return ERR_RDII_FILE_FORMAT;
@@ -869,6 +873,7 @@ void openRdiiProcessor()
 //
 {
     int j;                             // object index
+    int k;                             // input position of a node
     int n;                             // RDII node count
 
     // --- set RDII processing arrays to NULL
@@ -892,10 +897,11 @@ void openRdiiProcessor()
         return;
     }
 
-    // --- identify index of each node with RDII inflow
+    // --- identify index of each node with RDII inflow (in input order)
     n = 0;
-    for (j=0; j<Nobjects[NODE]; j++)
+    for (k=0; k<Nobjects[NODE]; k++)
     {
+        j = NodeOrder[k];
         if ( Node[j].rdiiInflow )
         {
             RdiiNodeIndex[n] = j;
@@ -1123,6 +1129,7 @@ int openNewRdiiFile()
 //
 {
     int j;                             // node index
+    int k;                             // input position of a node
 
     // --- create a temporary file name if scratch file being used
     if ( Frdii.mode == SCRATCH_FILE ) getTempFileName(Frdii.name);
@@ -1138,12 +1145,13 @@ int openNewRdiiFile()
     fwrite(FileStamp, sizeof(char), strlen(FileStamp), Frdii.file);
 
     // --- initialize the contents of the file with RDII time step (sec),
-    //     number of RDII nodes, and index of each node
+    //     number of RDII nodes, and input position of each node
     fwrite(&RdiiStep, sizeof(INT4), 1, Frdii.file);
     fwrite(&NumRdiiNodes, sizeof(INT4), 1, Frdii.file);
-    for (j=0; j<Nobjects[NODE]; j++)
+    for (k=0; k<Nobjects[NODE]; k++)
     {
-        if ( Node[j].rdiiInflow ) fwrite(&j, sizeof(INT4), 1, Frdii.file);
+        j = NodeOrder[k];
+        if ( Node[j].rdiiInflow ) fwrite(&k, sizeof(INT4), 1, Frdii.file);
     }
     return TRUE;
 }
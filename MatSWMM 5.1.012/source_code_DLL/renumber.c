@@ -0,0 +1,473 @@
+//-----------------------------------------------------------------------------
+//   renumber.c
+//
+//   Project:  EPA SWMM5
+//   Version:  5.1
+//
+//   Renumbering of nodes and links for better memory locality.
+//
+//   Nodes and links are stored in the order they appear in the input file,
+//   so the end nodes of a link can lie far apart in the Node array. When
+//   the RENUMBERING option is RCM, the nodes are renumbered once the project
+//   has been validated so that they follow a reverse Cuthill-McKee ordering
+//   of the network, which keeps connected nodes close together, and the
+//   links are then sorted by the lower new index of their end nodes. Every
+//   index that refers to a node or a link is remapped, so the rest of the
+//   program is unaware of the change.
+//
+//   NodeOrder[k] and LinkOrder[k] give the index of the object found at
+//   position k of the input file (NodePosition and LinkPosition give the
+//   reverse). Output files, reports, hotstart & interface files and the
+//   indexes used by the cosimulation functions list objects through them,
+//   so that they still appear in input order.
+//-----------------------------------------------------------------------------
+#define _CRT_SECURE_NO_DEPRECATE
+
+#include <stdlib.h>
+#include "headers.h"
+#include "hash.h"
+#include "lid.h"
+
+//-----------------------------------------------------------------------------
+//  Shared variables
+//-----------------------------------------------------------------------------
+#define Htable  (Project->Htable)  // Hash tables for object ID names
+
+//-----------------------------------------------------------------------------
+//  External functions (declared in funcs.h)
+//-----------------------------------------------------------------------------
+//  renumber_objects  (called from swmm_open in swmm5.c)
+
+//-----------------------------------------------------------------------------
+//  Local functions
+//-----------------------------------------------------------------------------
+static int  findNodeOrder(int order[]);
+static int  findPeripheralNode(int root, int start[], int adj[], int level[],
+            int queue[]);
+static int  addComponent(int root, int n, int order[], int start[],
+            int adj[], char placed[]);
+static int  findLinkOrder(int nodeIndex[], int order[]);
+static void remapIndexes(int nodeIndex[], int linkIndex[]);
+static void remapHashTable(HTtable* ht, int newIndex[]);
+static int  moveQualArrays(void);
+
+//=============================================================================
+
+void renumber_objects()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: renumbers the project's nodes and links if the RENUMBERING
+//           option calls for it.
+//
+{
+    int    k;
+    int    nNodes = Nobjects[NODE];
+    int    nLinks = Nobjects[LINK];
+    int*   nodeOrder;
+    int*   nodeIndex;
+    int*   linkOrder;
+    int*   linkIndex;
+    TNode* nodes;
+    TLink* links;
+
+    if ( ErrorCode || Renumbering == NO_RENUMBERING ) return;
+    if ( nNodes == 0 || nLinks == 0 ) return;
+
+    // --- allocate work arrays
+    nodeOrder = (int *) calloc(nNodes, sizeof(int));
+    nodeIndex = (int *) calloc(nNodes, sizeof(int));
+    linkOrder = (int *) calloc(nLinks, sizeof(int));
+    linkIndex = (int *) calloc(nLinks, sizeof(int));
+    nodes = (TNode *) calloc(nNodes, sizeof(TNode));
+    links = (TLink *) calloc(nLinks, sizeof(TLink));
+
+    // --- find the new order of nodes and links
+    if ( !nodeOrder || !nodeIndex || !linkOrder || !linkIndex ||
+         !nodes || !links || !findNodeOrder(nodeOrder) )
+    {
+        report_writeErrorMsg(ERR_MEMORY, "");
+    }
+    else
+    {
+        for (k = 0; k < nNodes; k++) nodeIndex[nodeOrder[k]] = k;
+        if ( !findLinkOrder(nodeIndex, linkOrder) )
+            report_writeErrorMsg(ERR_MEMORY, "");
+    }
+
+    // --- move nodes and links to their new positions
+    if ( !ErrorCode )
+    {
+        for (k = 0; k < nLinks; k++) linkIndex[linkOrder[k]] = k;
+        for (k = 0; k < nNodes; k++) nodes[k] = Node[k];
+        for (k = 0; k < nLinks; k++) links[k] = Link[k];
+        for (k = 0; k < nNodes; k++) Node[k] = nodes[nodeOrder[k]];
+        for (k = 0; k < nLinks; k++) Link[k] = links[linkOrder[k]];
+        remapIndexes(nodeIndex, linkIndex);
+        if ( !moveQualArrays() ) report_writeErrorMsg(ERR_MEMORY, "");
+    }
+
+    // --- free work arrays
+    FREE(nodeOrder);
+    FREE(nodeIndex);
+    FREE(linkOrder);
+    FREE(linkIndex);
+    FREE(nodes);
+    FREE(links);
+}
+
+//=============================================================================
+
+int findNodeOrder(int order[])
+//
+//  Input:   none
+//  Output:  order = index of the node placed at each new position;
+//           returns FALSE if out of memory
+//  Purpose: finds the reverse Cuthill-McKee ordering of the network's nodes.
+//
+{
+    int   i, j, k, n;
+    int   nNodes = Nobjects[NODE];
+    int*  start  = (int *) calloc(nNodes+1, sizeof(int));
+    int*  adj    = (int *) calloc(2*Nobjects[LINK], sizeof(int));
+    int*  level  = (int *) calloc(nNodes, sizeof(int));
+    int*  queue  = (int *) calloc(nNodes, sizeof(int));
+    char* placed = (char *) calloc(nNodes, sizeof(char));
+
+    if ( !start || !adj || !level || !queue || !placed )
+    {
+        FREE(start);
+        FREE(adj);
+        FREE(level);
+        FREE(queue);
+        FREE(placed);
+        return FALSE;
+    }
+
+    // --- build the adjacency list of each node (start[i] is where the
+    //     nodes adjacent to node i begin in adj)
+    for (k = 0; k < Nobjects[LINK]; k++)
+    {
+        i = Link[k].node1;
+        j = Link[k].node2;
+        if ( i == j ) continue;
+        start[i+1]++;
+        start[j+1]++;
+    }
+    for (i = 0; i < nNodes; i++) start[i+1] += start[i];
+    for (i = 0; i < nNodes; i++) level[i] = start[i];
+    for (k = 0; k < Nobjects[LINK]; k++)
+    {
+        i = Link[k].node1;
+        j = Link[k].node2;
+        if ( i == j ) continue;
+        adj[level[i]++] = j;
+        adj[level[j]++] = i;
+    }
+    for (i = 0; i < nNodes; i++) level[i] = -1;
+
+    // --- order each connected part of the network in turn, starting
+    //     from a node at one of its far ends
+    n = 0;
+    for (i = 0; i < nNodes; i++)
+    {
+        if ( placed[i] ) continue;
+        j = findPeripheralNode(i, start, adj, level, queue);
+        n = addComponent(j, n, order, start, adj, placed);
+    }
+
+    // --- reverse the Cuthill-McKee ordering
+    for (i = 0, j = nNodes-1; i < j; i++, j--)
+    {
+        k = order[i];
+        order[i] = order[j];
+        order[j] = k;
+    }
+
+    free(start);
+    free(adj);
+    free(level);
+    free(queue);
+    free(placed);
+    return TRUE;
+}
+
+//=============================================================================
+
+int findPeripheralNode(int root, int start[], int adj[], int level[],
+                       int queue[])
+//
+//  Input:   root = index of a node
+//           start = start of each node's adjacency list
+//           adj = adjacency lists of all nodes
+//           level = work array (all entries -1)
+//           queue = work array
+//  Output:  returns index of a node at the far end of root's part of the
+//           network
+//  Purpose: finds a pseudo-peripheral node of the network's graph.
+//
+//  NOTE: each pass does a breadth first search from the current node and
+//        moves to the lowest degree node of the last level reached, until
+//        the number of levels stops growing.
+//
+{
+    int i, j, k, n, head, last;
+    int depth = -1;
+
+    for (;;)
+    {
+        // --- breadth first search from root
+        queue[0] = root;
+        level[root] = 0;
+        head = 0;
+        n = 1;
+        while ( head < n )
+        {
+            i = queue[head++];
+            for (k = start[i]; k < start[i+1]; k++)
+            {
+                j = adj[k];
+                if ( level[j] >= 0 ) continue;
+                level[j] = level[i] + 1;
+                queue[n++] = j;
+            }
+        }
+
+        // --- find the lowest degree node on the last level
+        last = queue[n-1];
+        for (k = n-1; k >= 0 && level[queue[k]] == level[queue[n-1]]; k--)
+        {
+            j = queue[k];
+            if ( start[j+1] - start[j] < start[last+1] - start[last] )
+                last = j;
+        }
+        i = level[queue[n-1]];
+        for (k = 0; k < n; k++) level[queue[k]] = -1;
+
+        // --- stop when the search gets no deeper
+        if ( i <= depth ) return root;
+        depth = i;
+        root = last;
+    }
+}
+
+//=============================================================================
+
+int addComponent(int root, int n, int order[], int start[], int adj[],
+                 char placed[])
+//
+//  Input:   root = index of the node the ordering starts from
+//           n = number of nodes already ordered
+//           order = nodes in order
+//           start = start of each node's adjacency list
+//           adj = adjacency lists of all nodes
+//           placed = TRUE for nodes already ordered
+//  Output:  returns number of nodes ordered
+//  Purpose: appends the Cuthill-McKee ordering of root's part of the network
+//           to the ordered nodes.
+//
+{
+    int i, j, k, m, d, first;
+    int head = n;
+
+    order[n++] = root;
+    placed[root] = TRUE;
+    while ( head < n )
+    {
+        // --- append the unordered neighbours of the next ordered node
+        i = order[head++];
+        first = n;
+        for (k = start[i]; k < start[i+1]; k++)
+        {
+            j = adj[k];
+            if ( placed[j] ) continue;
+            placed[j] = TRUE;
+            order[n++] = j;
+        }
+
+        // --- sort them by increasing degree
+        for (m = first + 1; m < n; m++)
+        {
+            j = order[m];
+            d = start[j+1] - start[j];
+            for (k = m; k > first &&
+                 start[order[k-1]+1] - start[order[k-1]] > d; k--)
+            {
+                order[k] = order[k-1];
+            }
+            order[k] = j;
+        }
+    }
+    return n;
+}
+
+//=============================================================================
+
+int findLinkOrder(int nodeIndex[], int order[])
+//
+//  Input:   nodeIndex = new index of each node
+//  Output:  order = index of the link placed at each new position;
+//           returns FALSE if out of memory
+//  Purpose: sorts links by the lower new index of their end nodes.
+//
+{
+    int  i, k;
+    int  nNodes = Nobjects[NODE];
+    int* count = (int *) calloc(nNodes+1, sizeof(int));
+
+    if ( count == NULL ) return FALSE;
+
+    // --- a counting sort keeps links with the same key in input order
+    for (k = 0; k < Nobjects[LINK]; k++)
+    {
+        i = MIN(nodeIndex[Link[k].node1], nodeIndex[Link[k].node2]);
+        count[i+1]++;
+    }
+    for (i = 0; i < nNodes; i++) count[i+1] += count[i];
+    for (k = 0; k < Nobjects[LINK]; k++)
+    {
+        i = MIN(nodeIndex[Link[k].node1], nodeIndex[Link[k].node2]);
+        order[count[i]++] = k;
+    }
+    free(count);
+    return TRUE;
+}
+
+//=============================================================================
+
+void remapIndexes(int nodeIndex[], int linkIndex[])
+//
+//  Input:   nodeIndex = new index of each node
+//           linkIndex = new index of each link
+//  Output:  none
+//  Purpose: replaces the old indexes of nodes and links wherever they are
+//           referred to.
+//
+{
+    int j, k;
+
+    // --- link end nodes
+    for (j = 0; j < Nobjects[LINK]; j++)
+    {
+        Link[j].node1 = nodeIndex[Link[j].node1];
+        Link[j].node2 = nodeIndex[Link[j].node2];
+    }
+
+    // --- subcatchment outlet and groundwater nodes
+    for (j = 0; j < Nobjects[SUBCATCH]; j++)
+    {
+        if ( Subcatch[j].outNode >= 0 )
+            Subcatch[j].outNode = nodeIndex[Subcatch[j].outNode];
+        if ( Subcatch[j].groundwater )
+            Subcatch[j].groundwater->node =
+                nodeIndex[Subcatch[j].groundwater->node];
+    }
+
+    // --- diverted links of divider nodes
+    for (j = 0; j < Nnodes[DIVIDER]; j++)
+    {
+        if ( Divider[j].link >= 0 )
+            Divider[j].link = linkIndex[Divider[j].link];
+    }
+
+    // --- LID drain nodes and control rules
+    lid_renumberNodes(nodeIndex);
+    controls_renumber(nodeIndex, linkIndex);
+
+    // --- ID name hash tables
+    remapHashTable(Htable[NODE], nodeIndex);
+    remapHashTable(Htable[LINK], linkIndex);
+
+    // --- maps between input order and storage order
+    for (k = 0; k < Nobjects[NODE]; k++)
+    {
+        j = nodeIndex[NodeOrder[k]];
+        NodeOrder[k] = j;
+        NodePosition[j] = k;
+    }
+    for (k = 0; k < Nobjects[LINK]; k++)
+    {
+        j = linkIndex[LinkOrder[k]];
+        LinkOrder[k] = j;
+        LinkPosition[j] = k;
+    }
+}
+
+//=============================================================================
+
+void remapHashTable(HTtable* ht, int newIndex[])
+//
+//  Input:   ht = hash table of object ID names
+//           newIndex = new index of each object
+//  Output:  none
+//  Purpose: replaces the object index stored with each ID name.
+//
+{
+    int i;
+    struct HTentry* entry;
+
+    for (i = 0; i < HTMAXSIZE; i++)
+    {
+        for (entry = ht[i]; entry != NULL; entry = entry->next)
+        {
+            entry->data = newIndex[entry->data];
+        }
+    }
+}
+
+//=============================================================================
+
+int moveQualArrays()
+//
+//  Input:   none
+//  Output:  returns FALSE if out of memory
+//  Purpose: moves the pollutant arrays of nodes and links so that they are
+//           stored in the new order of their objects (see createObjects in
+//           project.c).
+//
+{
+    int j, p;
+    int nNodes = Nobjects[NODE];
+    int nLinks = Nobjects[LINK];
+    int nPolluts = Nobjects[POLLUT];
+    double* nodeQual;
+    double* linkQual;
+
+    nodeQual = (double *) calloc(2 * nNodes * nPolluts + 1, sizeof(double));
+    linkQual = (double *) calloc(3 * nLinks * nPolluts + 1, sizeof(double));
+    if ( nodeQual == NULL || linkQual == NULL )
+    {
+        FREE(nodeQual);
+        FREE(linkQual);
+        return FALSE;
+    }
+    for (j = 0; j < nNodes; j++)
+    {
+        for (p = 0; p < nPolluts; p++)
+        {
+            nodeQual[j*nPolluts + p] = Node[j].oldQual[p];
+            nodeQual[(nNodes + j)*nPolluts + p] = Node[j].newQual[p];
+        }
+        Node[j].oldQual = nodeQual + j*nPolluts;
+        Node[j].newQual = nodeQual + (nNodes + j)*nPolluts;
+    }
+    for (j = 0; j < nLinks; j++)
+    {
+        for (p = 0; p < nPolluts; p++)
+        {
+            linkQual[j*nPolluts + p] = Link[j].oldQual[p];
+            linkQual[(nLinks + j)*nPolluts + p] = Link[j].newQual[p];
+            linkQual[(2*nLinks + j)*nPolluts + p] = Link[j].totalLoad[p];
+        }
+        Link[j].oldQual = linkQual + j*nPolluts;
+        Link[j].newQual = linkQual + (nLinks + j)*nPolluts;
+        Link[j].totalLoad = linkQual + (2*nLinks + j)*nPolluts;
+    }
+    FREE(NodeQual);
+    FREE(LinkQual);
+    NodeQual = nodeQual;
+    LinkQual = linkQual;
+    return TRUE;
+}
+
+//=============================================================================
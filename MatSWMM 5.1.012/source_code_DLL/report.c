@@ -55,16 +55,13 @@
 //-----------------------------------------------------------------------------
 //  Shared variables
 //-----------------------------------------------------------------------------
-static time_t SysTime;
+#define SysTime (Project->SysTime)
 
 //-----------------------------------------------------------------------------
 //  Imported variables
 //-----------------------------------------------------------------------------
 #define REAL4 float
-extern REAL4* SubcatchResults;         // Results vectors defined in OUTPUT.C
-extern REAL4* NodeResults;             //  "
-extern REAL4* LinkResults;             //  "
-extern char   ErrString[81];           // defined in ERROR.C
+extern THREADLOCAL char   ErrString[81];           // defined in ERROR.C
 
 //-----------------------------------------------------------------------------
 //  Local functions
@@ -77,6 +74,8 @@ static void report_Nodes(void);
 static void report_NodeHeader(char *id);
 static void report_Links(void);
 static void report_LinkHeader(char *id);
+static void report_StepClasses(TSysStats* sysStats);
+static void report_ActiveSet(TSysStats* sysStats);
 
 
 //=============================================================================
@@ -329,17 +328,34 @@ void report_writeOptions()
     if ( Nobjects[LINK] > 0 )
     {
         fprintf(Frpt.file, "\n  Routing Time Step ........ %.2f sec", RouteStep);
+        if ( Renumbering != NO_RENUMBERING )
+        fprintf(Frpt.file, "\n  Node Renumbering ......... %s",
+            RenumberingWords[Renumbering]);
 		if ( RouteModel == DW )
 		{
 		fprintf(Frpt.file, "\n  Variable Time Step ....... ");
 		if ( CourantFactor > 0.0 ) fprintf(Frpt.file, "YES");
 		else                       fprintf(Frpt.file, "NO");
+		fprintf(Frpt.file, "\n  Solution Method .......... %s",
+            DynWaveMethodWords[DynWaveMethod]);
+		if ( DynWaveMethod == NEWTON )
+		fprintf(Frpt.file, " (experimental)");
+		if ( DynWavePredictor != NO_PREDICTOR )
+		fprintf(Frpt.file, "\n  Iteration Predictor ...... %s",
+            PredictorWords[DynWavePredictor]);
 		fprintf(Frpt.file, "\n  Maximum Trials ........... %d", MaxTrials);
+		if ( StepClasses > 1 )
+		fprintf(Frpt.file, "\n  Time Step Classes ........ %d", StepClasses);
+		if ( XsectTables )
+		fprintf(Frpt.file, "\n  Cross Section Tables ..... YES");
         fprintf(Frpt.file, "\n  Number of Threads ........ %d", NumThreads);   //(5.1.008)
 		fprintf(Frpt.file, "\n  Head Tolerance ........... %.6f ",
             HeadTol*UCF(LENGTH));                                              //(5.1.008)
 		if ( UnitSystem == US ) fprintf(Frpt.file, "ft");
 		else                    fprintf(Frpt.file, "m");
+		if ( ActiveSetTol > 0.0 )
+		fprintf(Frpt.file, "\n  Active Set Tolerance ..... %.6f %s",
+            ActiveSetTol*UCF(FLOW), FlowUnitWords[FlowUnits]);
 		}
     }
     WRITE("");
@@ -1038,6 +1054,128 @@ void report_writeSysStats(TSysStats* sysStats)
     fprintf(Frpt.file,
         "\n  Percent Not Converging      :  %7.2f",
         100.0 * (double)NonConvergeCount / eventStepCount);                    //(5.1.012)
+    if ( sysStats->predictions > 0.0 )
+        fprintf(Frpt.file,
+            "\n  Percent Predictions Rejected:  %7.2f",
+            100.0 * sysStats->rejectedPredictions / sysStats->predictions);
+    if ( ActiveSetTol > 0.0 ) report_ActiveSet(sysStats);
+    if ( StepClasses > 1 ) report_StepClasses(sysStats);
+    WRITE("");
+}
+
+//=============================================================================
+
+void report_StepClasses(TSysStats* sysStats)
+//
+//  Input:   sysStats = simulation statistics for overall system
+//  Output:  none
+//  Purpose: writes the time-weighted share of nodes & links advanced with
+//           each dynamic wave time step class, and the convergence of
+//           each class's steps, to report file.
+//
+{
+    int    i;
+    double nodeTime = 0.0;
+    double linkTime = 0.0;
+
+    if ( sysStats->finestUpdates == 0.0 ) return;
+    for (i = 0; i < StepClasses; i++)
+    {
+        nodeTime += sysStats->nodeClassTime[i];
+        linkTime += sysStats->linkClassTime[i];
+    }
+    nodeTime = MAX(nodeTime, TINY);
+    linkTime = MAX(linkTime, TINY);
+    fprintf(Frpt.file,
+        "\n  Percent of Finest Step Work :  %7.2f",
+        100.0 * sysStats->classUpdates / sysStats->finestUpdates);
+
+    // --- a routing step counts as not converging if any of its substeps
+    //     did not, so also list the convergence of the substeps themselves
+    //     and of the steps taken by each class
+    if ( sysStats->classSteps[0] > 0.0 )
+    {
+        fprintf(Frpt.file,
+            "\n  Average Substeps per Step   :  %7.2f",
+            sysStats->substeps / sysStats->classSteps[0]);
+        fprintf(Frpt.file,
+            "\n  Avg. Iterations per Substep :  %7.2f",
+            sysStats->substepIterations / sysStats->substeps);
+        fprintf(Frpt.file,
+            "\n  Percent Substeps Not Conv.  :  %7.2f",
+            100.0 * sysStats->failedSubsteps / sysStats->substeps);
+    }
+    fprintf(Frpt.file,
+        "\n\n  Step Class   Time Step      %% Nodes     %% Links   %% Not Conv."
+          "\n  ----------------------------------------------------------");
+    for (i = 0; i < StepClasses; i++)
+    {
+        fprintf(Frpt.file, "\n  %10d   1/%-8d %9.2f   %9.2f   %9.2f", i, 1 << i,
+            100.0 * sysStats->nodeClassTime[i] / nodeTime,
+            100.0 * sysStats->linkClassTime[i] / linkTime,
+            100.0 * sysStats->classFailures[i] /
+                MAX(sysStats->classSteps[i], 1.0));
+    }
+}
+
+//=============================================================================
+
+void report_ActiveSet(TSysStats* sysStats)
+//
+//  Input:   sysStats = simulation statistics for overall system
+//  Output:  none
+//  Purpose: writes the time-weighted share of nodes & links routed by the
+//           dynamic wave active set to report file.
+//
+{
+    double t = sysStats->activeSetTime;
+
+    if ( t == 0.0 ) return;
+    fprintf(Frpt.file,
+        "\n  Percent Active Nodes        :  %7.2f",
+        100.0 * sysStats->activeNodeTime / t / MAX(Nobjects[NODE], 1));
+    fprintf(Frpt.file,
+        "\n  Percent Active Links        :  %7.2f",
+        100.0 * sysStats->activeLinkTime / t / MAX(Nobjects[LINK], 1));
+    fprintf(Frpt.file,
+        "\n  Min. Percent Active Links   :  %7.2f",
+        100.0 * sysStats->minActiveLinks);
+    fprintf(Frpt.file,
+        "\n  Max. Percent Active Links   :  %7.2f",
+        100.0 * sysStats->maxActiveLinks);
+}
+
+//=============================================================================
+
+void report_writeWorkerStats(TWorkerPhase phases[], double overhead)
+//
+//  Input:   phases = thread use by each parallel phase
+//           overhead = time to start & end a parallel region (sec)
+//  Output:  none
+//  Purpose: writes the number of threads chosen for each parallel phase
+//           of the simulation to report file.
+//
+{
+    int  i;
+    char* phaseNames[] = {"Runoff", "Flow Routing", "Water Quality",
+                          "Flow Statistics"};
+
+    WRITE("");
+    WRITE("***********************");
+    WRITE("Parallel Thread Summary");
+    WRITE("***********************");
+    fprintf(Frpt.file,
+        "\n  Maximum Threads             :  %7d", NumThreads);
+    fprintf(Frpt.file,
+        "\n  Parallel Region Overhead    :  %7.2f usec", overhead * 1.0e6);
+    for (i = 0; i < MAX_WORKER_PHASES; i++)
+    {
+        if ( phases[i].items == 0 ) continue;
+        fprintf(Frpt.file,
+            "\n  %-16s Threads    :  %7d   (%.3f usec per item, %d choices)",
+            phaseNames[i], phases[i].threads, phases[i].bestTime * 1.0e6,
+            phases[i].choices);
+    }
     WRITE("");
 }
 
@@ -1202,7 +1340,7 @@ void report_Nodes()
 //  Purpose: writes results for selected nodes to report file.
 //
 {
-    int      j, p, k;
+    int      i, j, p, k;
     int      period;
     DateTime days;
     char     theDate[20];
@@ -1214,8 +1352,9 @@ void report_Nodes()
     WRITE("Node Results");
     WRITE("************");
     k = 0;
-    for (j = 0; j < Nobjects[NODE]; j++)
+    for (i = 0; i < Nobjects[NODE]; i++)
     {
+        j = NodeOrder[i];
         if ( Node[j].rptFlag == TRUE )
         {
             report_NodeHeader(Node[j].ID);
@@ -1281,7 +1420,7 @@ void report_Links()
 //  Purpose: writes results for selected links to report file.
 //
 {
-    int      j, p, k;
+    int      i, j, p, k;
     int      period;
     DateTime days;
     char     theDate[12];
@@ -1293,8 +1432,9 @@ void report_Links()
     WRITE("Link Results");
     WRITE("************");
     k = 0;
-    for (j = 0; j < Nobjects[LINK]; j++)
+    for (i = 0; i < Nobjects[LINK]; i++)
     {
+        j = LinkOrder[i];
         if ( Link[j].rptFlag == TRUE )
         {
             report_LinkHeader(Link[j].ID);
@@ -50,9 +50,10 @@
 //-----------------------------------------------------------------------------
 // Shared variables
 //-----------------------------------------------------------------------------
-static int* SortedLinks;
-static int  NextEvent;                                                         //(5.1.011)
-static int  BetweenEvents;                                                     //(5.1.012)
+#define SortedLinks   (Project->SortedLinks)
+#define LinkLevels    (Project->LinkLevels)    // level schedule of SortedLinks
+#define NextEvent     (Project->NextEvent)     //(5.1.011)
+#define BetweenEvents (Project->BetweenEvents) //(5.1.012)
 
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)
@@ -90,6 +91,12 @@ int routing_open()
     // --- open treatment system
     if ( !treatmnt_open() ) return ErrorCode;
 
+    // --- list the links attached to each node for quality routing
+    if ( qualrout_open() ) return ErrorCode;
+
+    // --- index the control rules by the variables they watch
+    if ( controls_open() ) return ErrorCode;
+
     // --- topologically sort the links
     SortedLinks = NULL;
     if ( Nobjects[LINK] > 0 )
@@ -102,6 +109,14 @@ int routing_open()
         }
         toposort_sortLinks(SortedLinks);
         if ( ErrorCode ) return ErrorCode;
+
+        // --- group the sorted links into levels routed in parallel
+        if ( RouteModel != DW &&
+             !toposort_findLevels(SortedLinks, &LinkLevels) )
+        {
+            report_writeErrorMsg(ERR_MEMORY, "");
+            return ErrorCode;
+        }
     }
 
     // --- open any routing interface files
@@ -133,8 +148,11 @@ void routing_close(int routingModel)
 
     // --- free allocated memory
     flowrout_close(routingModel);
+    qualrout_close();
+    controls_close();
     treatmnt_close();
     FREE(SortedLinks);
+    toposort_freeLevels(&LinkLevels);
 }
 
 //=============================================================================
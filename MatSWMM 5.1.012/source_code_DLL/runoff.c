@@ -35,30 +35,24 @@
 #include <stdio.h>
 #include <string.h>
 #include <malloc.h>
+#include <omp.h>
 #include "headers.h"
+#include "lid.h"
 #include "odesolve.h"
 
 //-----------------------------------------------------------------------------
 // Shared variables
 //-----------------------------------------------------------------------------
-static char  IsRaining;                // TRUE if precip. falls on study area
-static char  HasRunoff;                // TRUE if study area generates runoff
-static char  HasSnow;                  // TRUE if any snow cover on study area
-static int   Nsteps;                   // number of runoff time steps taken
-static int   MaxSteps;                 // final number of runoff time steps
-static long  MaxStepsPos;              // position in Runoff interface file
+#define IsRaining   (Project->IsRaining)   // TRUE if precip. falls on study area
+#define HasRunoff   (Project->HasRunoff)   // TRUE if study area generates runoff
+#define HasSnow     (Project->HasSnow)     // TRUE if any snow cover on study area
+#define Nsteps      (Project->Nsteps)      // number of runoff time steps taken
+#define MaxSteps    (Project->MaxSteps)    // final number of runoff time steps
+#define MaxStepsPos (Project->MaxStepsPos) // position in Runoff interface file
                                        //    where MaxSteps is saved
-
-//-----------------------------------------------------------------------------
-//  Exportable variables 
-//-----------------------------------------------------------------------------
-char    HasWetLids;  // TRUE if any LIDs are wet (used in lidproc.c)           //(5.1.008)
-double* OutflowLoad; // exported pollutant mass load (used in surfqual.c)
-
-//-----------------------------------------------------------------------------
-//  Imported variables
-//-----------------------------------------------------------------------------
-extern float* SubcatchResults;         // Results vector defined in OUTPUT.C
+#define RunonOrder  (Project->RunonOrder)  // subcatchments ordered by level
+#define RunonLevelStart (Project->RunonLevelStart) // start of each level
+#define RunonLevels (Project->RunonLevels) // number of run-on levels
 
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)
@@ -75,6 +69,11 @@ static void   runoff_initFile(void);
 static void   runoff_readFromFile(void);
 static void   runoff_saveToFile(float tStep);
 static void   runoff_getOutfallRunon(double tStep);                            //(5.1.008)
+static void   runoff_getSubcatchRunoff(int nThreads, double tStep,
+              DateTime currentDate, char canSweep);
+static double getRunoff(int j, double tStep, DateTime currentDate,
+              char canSweep);
+static int    findRunonLevels(void);
 
 //=============================================================================
 
@@ -93,11 +92,17 @@ int runoff_open()
     // --- open the Ordinary Differential Equation solver
     if ( !odesolve_open(MAXODES) ) report_writeErrorMsg(ERR_ODE_SOLVER, "");
 
+    // --- order the subcatchments so that those sending runoff to other
+    //     subcatchments are analyzed before the ones receiving it
+    if ( !findRunonLevels() ) report_writeErrorMsg(ERR_MEMORY, "");
+
     // --- allocate memory for pollutant runoff loads                          //(5.1.008)
+    //     (one row for each thread that computes washoff)
     OutflowLoad = NULL;
     if ( Nobjects[POLLUT] > 0 )
     {
-        OutflowLoad = (double *) calloc(Nobjects[POLLUT], sizeof(double));
+        OutflowLoad = (double *) calloc(MAX(NumThreads, 1) * Nobjects[POLLUT],
+                                        sizeof(double));
         if ( !OutflowLoad ) report_writeErrorMsg(ERR_MEMORY, "");
     }
 
@@ -134,6 +139,9 @@ void runoff_close()
 
     // --- free memory for pollutant runoff loads                              //(5.1.008)
     FREE(OutflowLoad);
+    FREE(RunonOrder);
+    FREE(RunonLevelStart);
+    RunonLevels = 0;
 
     // --- close runoff interface file if in use
     if ( Frunoff.file )
@@ -160,7 +168,8 @@ void runoff_execute()
 //  Purpose: computes runoff from each subcatchment at current runoff time.
 //
 {
-    int      j;                        // object index
+    int      j, k;                     // object indexes
+    int      nThreads;                 // number of threads used
     int      day;                      // day of calendar year
     double   runoffStep;               // runoff time step (sec)
     double   oldRunoffStep;            // previous runoff time step (sec)      //(5.1.011)
@@ -250,32 +259,25 @@ void runoff_execute()
     HasSnow = FALSE;
     HasRunoff = FALSE;
     HasWetLids = FALSE;                                                        //(5.1.008)
-    for (j = 0; j < Nobjects[SUBCATCH]; j++)
+    landuse_setExternalRates();
+    nThreads = workers_begin(RUNOFF_PHASE, Nobjects[SUBCATCH]);
+    if ( nThreads > 1 )
+    {
+        runoff_getSubcatchRunoff(nThreads, runoffStep, currentDate, canSweep);
+    }
+    else for (k = 0; k < Nobjects[SUBCATCH]; k++)
     {
-        // --- find total runoff rate (in ft/sec) over the subcatchment
-        //     (the amount that actually leaves the subcatchment (in cfs)
-        //     is also computed and is stored in Subcatch[j].newRunoff)
+        j = RunonOrder[k];
         if ( Subcatch[j].area == 0.0 ) continue;                               //(5.1.008)
-        runoff = subcatch_getRunoff(j, runoffStep);
+        runoff = getRunoff(j, runoffStep, currentDate, canSweep);
 
         // --- update state of study area surfaces
         if ( runoff > 0.0 ) HasRunoff = TRUE;
         if ( Subcatch[j].newSnowDepth > 0.0 ) HasSnow = TRUE;
-
-        // --- skip pollutant buildup/washoff if quality ignored
-        if ( IgnoreQuality ) continue;
-
-        // --- add to pollutant buildup if runoff is negligible
-        if ( runoff < MIN_RUNOFF ) surfqual_getBuildup(j, runoffStep); 
-
-        // --- reduce buildup by street sweeping
-        if ( canSweep && Subcatch[j].rainfall <= MIN_RUNOFF)
-            surfqual_sweepBuildup(j, currentDate);
-
-        // --- compute pollutant washoff 
-        surfqual_getWashoff(j, runoff, runoffStep);
     }
 
+    workers_end(RUNOFF_PHASE);
+
     // --- update tracking of system-wide max. runoff rate
     stats_updateMaxRunoff();
 
@@ -292,6 +294,212 @@ void runoff_execute()
 
 //=============================================================================
 
+void runoff_getSubcatchRunoff(int nThreads, double tStep,
+                              DateTime currentDate, char canSweep)
+//
+//  Input:   nThreads = number of threads to use
+//           tStep = runoff time step (sec)
+//           currentDate = current date/time
+//           canSweep = TRUE if street sweeping can occur
+//  Output:  none
+//  Purpose: computes runoff and pollutant buildup/washoff in all
+//           subcatchments in parallel.
+//
+//  The subcatchments are analyzed one run-on level at a time, so one that
+//  sends runoff to another never runs alongside it. Each thread logs its
+//  updates to the mass balance totals, which are added after each level
+//  in the same order as a serial run.
+//
+{
+    int    j, k, level;
+    int    hasRunoff = FALSE;
+    int    hasSnow = FALSE;
+    int    odeError = FALSE;
+    double runoff;
+    TProject* project = Project;
+
+#pragma omp parallel num_threads(nThreads) private(j, k, level, runoff) \
+        reduction(||:hasRunoff, hasSnow, odeError)
+{
+    int t = omp_get_thread_num();
+
+    Project = project;                 // worker threads share this project
+
+    // --- worker threads need their own ODE solver workspace
+    if ( t > 0 && !odesolve_open(MAXODES) ) odeError = TRUE;
+    massbal_deferTotals(t);
+
+    for (level = 0; level < RunonLevels; level++)
+    {
+        #pragma omp for schedule(static)
+        for (k = RunonLevelStart[level]; k < RunonLevelStart[level+1]; k++)
+        {
+            j = RunonOrder[k];
+            if ( Subcatch[j].area == 0.0 ) continue;
+            runoff = getRunoff(j, tStep, currentDate, canSweep);
+            if ( runoff > 0.0 ) hasRunoff = TRUE;
+            if ( Subcatch[j].newSnowDepth > 0.0 ) hasSnow = TRUE;
+        }
+
+        // --- add each thread's mass balance updates in subcatchment order
+        //     (the implicit barrier after the loop means all are logged)
+        #pragma omp single
+        massbal_commitTotals();
+    }
+
+    massbal_deferTotals(-1);
+    if ( t > 0 ) odesolve_close();
+}
+
+    if ( odeError ) report_writeErrorMsg(ERR_ODE_SOLVER, "");
+    if ( hasRunoff ) HasRunoff = TRUE;
+    if ( hasSnow ) HasSnow = TRUE;
+}
+
+//=============================================================================
+
+double getRunoff(int j, double tStep, DateTime currentDate, char canSweep)
+//
+//  Input:   j = subcatchment index
+//           tStep = runoff time step (sec)
+//           currentDate = current date/time
+//           canSweep = TRUE if street sweeping can occur
+//  Output:  returns total runoff rate over the subcatchment (ft/sec)
+//  Purpose: computes runoff and pollutant buildup/washoff in a subcatchment.
+//
+{
+    double runoff;
+
+    // --- find total runoff rate (in ft/sec) over the subcatchment
+    //     (the amount that actually leaves the subcatchment (in cfs)
+    //     is also computed and is stored in Subcatch[j].newRunoff)
+    runoff = subcatch_getRunoff(j, tStep);
+
+    // --- skip pollutant buildup/washoff if quality ignored
+    if ( IgnoreQuality ) return runoff;
+
+    // --- add to pollutant buildup if runoff is negligible
+    if ( runoff < MIN_RUNOFF ) surfqual_getBuildup(j, tStep);
+
+    // --- reduce buildup by street sweeping
+    if ( canSweep && Subcatch[j].rainfall <= MIN_RUNOFF)
+        surfqual_sweepBuildup(j, currentDate);
+
+    // --- compute pollutant washoff
+    surfqual_getWashoff(j, runoff, tStep);
+    return runoff;
+}
+
+//=============================================================================
+
+int findRunonLevels()
+//
+//  Input:   none
+//  Output:  returns FALSE if memory could not be allocated
+//  Purpose: groups the subcatchments into levels, placing each one level
+//           below the lowest of the subcatchments that send runoff (or LID
+//           underdrain flow) to it.
+//
+//  Subcatchments within a level, and the levels themselves, stay in index
+//  order, so a study area with no subcatchment-to-subcatchment routing is
+//  analyzed in the same order as before. Subcatchments that route runoff
+//  around a loop, or receive it from one, are placed on levels of their
+//  own after all others.
+//
+{
+    int  i, j, k, m, n = Nobjects[SUBCATCH];
+    int  nEdges = 0, maxLevel = 0;
+    int* level;                        // level of each subcatchment
+    int* senders;                      // number of unplaced senders to each
+    int* edgeStart;                    // start of each one's receivers
+    int* edges;                        // receivers of each subcatchment
+    int* stack;                        // subcatchments with all senders placed
+
+    RunonLevels = 0;
+    RunonOrder = (int *) calloc(n + 1, sizeof(int));
+    RunonLevelStart = (int *) calloc(n + 2, sizeof(int));
+    level = (int *) calloc(n + 1, sizeof(int));
+    senders = (int *) calloc(n + 1, sizeof(int));
+    edgeStart = (int *) calloc(n + 2, sizeof(int));
+    stack = (int *) calloc(n + 1, sizeof(int));
+
+    // --- count the receivers of each subcatchment
+    if ( edgeStart ) for (j = 0; j < n; j++)
+    {
+        k = Subcatch[j].outSubcatch;
+        edgeStart[j+1] = ( k >= 0 && k != j ) + lid_getDrainSubcatchs(j, NULL);
+        nEdges += edgeStart[j+1];
+    }
+    edges = (int *) calloc(nEdges + 1, sizeof(int));
+    if ( !RunonOrder || !RunonLevelStart || !level || !senders ||
+         !edgeStart || !edges || !stack )
+    {
+        FREE(level);
+        FREE(senders);
+        FREE(edgeStart);
+        FREE(edges);
+        FREE(stack);
+        return FALSE;
+    }
+
+    // --- list the receivers of each subcatchment
+    for (j = 0; j < n; j++)
+    {
+        edgeStart[j+1] += edgeStart[j];
+        i = edgeStart[j];
+        k = Subcatch[j].outSubcatch;
+        if ( k >= 0 && k != j ) edges[i++] = k;
+        lid_getDrainSubcatchs(j, &edges[i]);
+    }
+    for (i = 0; i < nEdges; i++) senders[edges[i]]++;
+
+    // --- place each subcatchment after all of its senders have been
+    //     (level -1 marks one not yet placed)
+    m = 0;
+    for (j = n - 1; j >= 0; j--)
+    {
+        level[j] = -1;
+        if ( senders[j] == 0 ) stack[m++] = j;
+    }
+    for (j = 0; j < n; j++) if ( senders[j] == 0 ) level[j] = 0;
+    while ( m > 0 )
+    {
+        j = stack[--m];
+        maxLevel = MAX(maxLevel, level[j]);
+        for (i = edgeStart[j]; i < edgeStart[j+1]; i++)
+        {
+            k = edges[i];
+            level[k] = MAX(level[k], level[j] + 1);
+            if ( --senders[k] == 0 ) stack[m++] = k;
+        }
+    }
+
+    // --- subcatchments on or below a loop get one level each
+    if ( n > 0 ) RunonLevels = maxLevel + 1;
+    for (j = 0; j < n; j++)
+    {
+        if ( senders[j] > 0 ) level[j] = RunonLevels++;
+    }
+
+    // --- order the subcatchments by level
+    for (j = 0; j < n; j++) RunonLevelStart[level[j] + 1]++;
+    for (i = 0; i < RunonLevels; i++)
+    {
+        RunonLevelStart[i+1] += RunonLevelStart[i];
+        stack[i] = RunonLevelStart[i];
+    }
+    for (j = 0; j < n; j++) RunonOrder[stack[level[j]]++] = j;
+
+    free(level);
+    free(senders);
+    free(edgeStart);
+    free(edges);
+    free(stack);
+    return TRUE;
+}
+
+//=============================================================================
+
 double runoff_getTimeStep(DateTime currentDate)
 //
 //  Input:   currentDate = current simulation date/time
@@ -41,30 +41,11 @@
 //-----------------------------------------------------------------------------
 //  Shared variables
 //-----------------------------------------------------------------------------
-#define MAX_STATS 5
-static TSysStats       SysStats;
-static TMaxStats       MaxMassBalErrs[MAX_STATS];
-static TMaxStats       MaxCourantCrit[MAX_STATS];
-static TMaxStats       MaxFlowTurns[MAX_STATS];
-static double          SysOutfallFlow;
-
-//-----------------------------------------------------------------------------
-//  Exportable variables (shared with statsrpt.c)
-//-----------------------------------------------------------------------------
-TSubcatchStats* SubcatchStats;
-TNodeStats*     NodeStats;
-TLinkStats*     LinkStats;
-TStorageStats*  StorageStats;
-TOutfallStats*  OutfallStats;
-TPumpStats*     PumpStats;
-double          MaxOutfallFlow;
-double          MaxRunoffFlow;
-
-//-----------------------------------------------------------------------------
-//  Imported variables
-//-----------------------------------------------------------------------------
-extern double*         NodeInflow;     // defined in massbal.c
-extern double*         NodeOutflow;    // defined in massbal.c
+#define SysStats       (Project->SysStats)
+#define MaxMassBalErrs (Project->MaxMassBalErrs)
+#define MaxCourantCrit (Project->MaxCourantCrit)
+#define MaxFlowTurns   (Project->MaxFlowTurns)
+#define SysOutfallFlow (Project->SysOutfallFlow)
 
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)
@@ -76,6 +57,10 @@ extern double*         NodeOutflow;    // defined in massbal.c
 //  stats_updateGwaterStats       (called from gwater_getGroundwater)          //(5.1.008)
 //  stats_updateFlowStats         (called from routing_execute)
 //  stats_updateCriticalTimeCount (called from getVariableStep in dynwave.c)
+//  stats_updateStepClasses       (called from dynwave_execute)
+//  stats_updateSubsteps          (called from dynwave_execute)
+//  stats_updateActiveSet         (called from dynwave_execute)
+//  stats_updatePredictor         (called from dynwave_execute)
 //  stats_updateMaxNodeDepth      (called from output_saveNodeResults)         //(5.1.008)
 
 //-----------------------------------------------------------------------------
@@ -277,6 +262,25 @@ int  stats_open()
     SysStats.avgTimeStep = 0.0;
     SysStats.avgStepCount = 0.0;
     SysStats.steadyStateCount = 0.0;
+    for (j = 0; j < MAX_STEP_CLASSES; j++)
+    {
+        SysStats.nodeClassTime[j] = 0.0;
+        SysStats.linkClassTime[j] = 0.0;
+        SysStats.classSteps[j] = 0.0;
+        SysStats.classFailures[j] = 0.0;
+    }
+    SysStats.classUpdates = 0.0;
+    SysStats.finestUpdates = 0.0;
+    SysStats.substeps = 0.0;
+    SysStats.substepIterations = 0.0;
+    SysStats.failedSubsteps = 0.0;
+    SysStats.activeNodeTime = 0.0;
+    SysStats.activeLinkTime = 0.0;
+    SysStats.activeSetTime = 0.0;
+    SysStats.minActiveLinks = 1.0;
+    SysStats.maxActiveLinks = 0.0;
+    SysStats.predictions = 0.0;
+    SysStats.rejectedPredictions = 0.0;
     return 0;
 }
 
@@ -322,6 +326,9 @@ void  stats_report()
         report_writeSysStats(&SysStats);
     }
 
+    // --- report thread counts used by parallel computations
+    workers_report();
+
     // --- report summary statistics
     statsrpt_writeReport();
 }
@@ -419,14 +426,18 @@ void   stats_updateFlowStats(double tStep, DateTime aDate, int stepCount,
 //
 {
     int   j;
+    int   nThreads;
+    TProject* project = Project;
 
     // --- update stats only after reporting period begins
     if ( aDate < ReportStart ) return;
     SysOutfallFlow = 0.0;
 
     // --- update node & link stats
-#pragma omp parallel num_threads(NumThreads)                                   //(5.1.008)
+    nThreads = workers_begin(STATS_PHASE, Nobjects[NODE] + Nobjects[LINK]);
+#pragma omp parallel num_threads(nThreads)                                     //(5.1.008)
 {
+    Project = project;                 // worker threads share this project
     #pragma omp for                                                            //(5.1.008)
     for ( j=0; j<Nobjects[NODE]; j++ )
         stats_updateNodeStats(j, tStep, aDate);
@@ -434,6 +445,7 @@ void   stats_updateFlowStats(double tStep, DateTime aDate, int stepCount,
     for ( j=0; j<Nobjects[LINK]; j++ )
         stats_updateLinkStats(j, tStep, aDate);
 }
+    workers_end(STATS_PHASE);
 
 ////  Following code segment modified for release 5.1.012.  ////               //(5.1.012)
 
@@ -477,6 +489,97 @@ void stats_updateCriticalTimeCount(int node, int link)
 
 //=============================================================================
 
+void stats_updateStepClasses(int nodeCount[], int linkCount[], int nClasses,
+                             double tStep)
+//
+//  Input:   nodeCount = number of nodes in each time step class
+//           linkCount = number of links in each time step class
+//           nClasses = number of classes in use
+//           tStep = routing time step (sec)
+//  Output:  none
+//  Purpose: updates the histogram of dynamic wave time step classes.
+//
+{
+    int    i;
+    double n = 0.0;
+
+    // --- class i objects are updated 2^i times per routing step
+    for (i = 0; i < nClasses; i++)
+    {
+        SysStats.nodeClassTime[i] += nodeCount[i] * tStep;
+        SysStats.linkClassTime[i] += linkCount[i] * tStep;
+        SysStats.classUpdates += (double)(nodeCount[i] + linkCount[i]) *
+                                 (1 << i);
+        n += nodeCount[i] + linkCount[i];
+    }
+    SysStats.finestUpdates += n * (1 << (nClasses - 1));
+}
+
+//=============================================================================
+
+void stats_updateSubsteps(int substeps, int iterations, int failed,
+                          int classFailures[])
+//
+//  Input:   substeps = number of substeps in routing step
+//           iterations = iterations made over all substeps
+//           failed = number of substeps that did not converge
+//           classFailures = steps of each class that did not converge
+//  Output:  none
+//  Purpose: updates the convergence of the substeps of a dynamic wave
+//           routing step made by time step classes.
+//
+{
+    int i;
+
+    // --- class i takes 2^i steps per routing step
+    for (i = 0; (1 << i) <= substeps; i++)
+    {
+        SysStats.classSteps[i] += 1 << i;
+        SysStats.classFailures[i] += classFailures[i];
+    }
+    SysStats.substeps += substeps;
+    SysStats.substepIterations += iterations;
+    SysStats.failedSubsteps += failed;
+}
+
+//=============================================================================
+
+void stats_updateActiveSet(int nodeCount, int linkCount, double tStep)
+//
+//  Input:   nodeCount = number of nodes routed on current time step
+//           linkCount = number of links routed on current time step
+//           tStep = routing time step (sec)
+//  Output:  none
+//  Purpose: updates the size of the dynamic wave active set over time.
+//
+{
+    double f;
+
+    SysStats.activeNodeTime += nodeCount * tStep;
+    SysStats.activeLinkTime += linkCount * tStep;
+    SysStats.activeSetTime += tStep;
+    if ( Nobjects[LINK] == 0 ) return;
+    f = (double)linkCount / Nobjects[LINK];
+    SysStats.minActiveLinks = MIN(SysStats.minActiveLinks, f);
+    SysStats.maxActiveLinks = MAX(SysStats.maxActiveLinks, f);
+}
+
+//=============================================================================
+
+void stats_updatePredictor(int rejected)
+//
+//  Input:   rejected = TRUE if predicted state was replaced by the last one
+//  Output:  none
+//  Purpose: counts the dynamic wave time steps whose iterations started
+//           from a predicted state.
+//
+{
+    SysStats.predictions += 1.0;
+    if ( rejected ) SysStats.rejectedPredictions += 1.0;
+}
+
+//=============================================================================
+
 ////  Function modified for release 5.1.008.  ////                             //(5.1.008)
 
 void stats_updateNodeStats(int j, double tStep, DateTime aDate)
@@ -32,20 +32,6 @@
 #include "headers.h"
 #include "lid.h"
 
-//-----------------------------------------------------------------------------
-//  Imported variables
-//-----------------------------------------------------------------------------
-extern TSubcatchStats* SubcatchStats;          // defined in STATS.C
-extern TNodeStats*     NodeStats;
-extern TLinkStats*     LinkStats;
-extern TStorageStats*  StorageStats;
-extern TOutfallStats*  OutfallStats;
-extern TPumpStats*     PumpStats;
-extern double          MaxOutfallFlow;
-extern double          MaxRunoffFlow;
-extern double*         NodeInflow;             // defined in MASSBAL.C
-extern double*         NodeOutflow;            // defined in massbal.c
-
 //-----------------------------------------------------------------------------
 //  Local functions
 //-----------------------------------------------------------------------------
@@ -66,8 +52,8 @@ void    writeLinkLoads(void);
 
 #define WRITE(x) (report_writeLine((x)))
 
-static char   FlowFmt[6];
-static double Vcf;
+static THREADLOCAL char   FlowFmt[6];
+static THREADLOCAL double Vcf;
 
 //=============================================================================
 
@@ -303,7 +289,7 @@ void writeNodeDepths()
 //  Purpose: writes simulation statistics for nodes to report file.
 //
 {
-    int j, days, hrs, mins;
+    int j, m, days, hrs, mins;
     if ( Nobjects[LINK] == 0 ) return;
 
     WRITE("");
@@ -323,8 +309,9 @@ void writeNodeDepths()
     fprintf(Frpt.file,
 "\n  ---------------------------------------------------------------------------------");
 
-    for ( j = 0; j < Nobjects[NODE]; j++ )
+    for ( m = 0; m < Nobjects[NODE]; m++ )
     {
+        j = NodeOrder[m];
         fprintf(Frpt.file, "\n  %-20s", Node[j].ID);
         fprintf(Frpt.file, " %-9s ", NodeTypeWords[Node[j].type]);
         getElapsedTime(NodeStats[j].maxDepthDate, &days, &hrs, &mins);
@@ -346,7 +333,7 @@ void writeNodeFlows()
 //  Purpose: writes flow statistics for nodes to report file.
 //
 {
-    int j;
+    int j, m;
     int days1, hrs1, mins1;
 
     WRITE("");
@@ -366,8 +353,9 @@ void writeNodeFlows()
     fprintf(Frpt.file,
 "\n  -------------------------------------------------------------------------------------------------");
 
-    for ( j = 0; j < Nobjects[NODE]; j++ )
+    for ( m = 0; m < Nobjects[NODE]; m++ )
     {
+        j = NodeOrder[m];
         fprintf(Frpt.file, "\n  %-20s", Node[j].ID);
         fprintf(Frpt.file, " %-9s", NodeTypeWords[Node[j].type]);
         getElapsedTime(NodeStats[j].maxInflowDate, &days1, &hrs1, &mins1);
@@ -391,7 +379,7 @@ void writeNodeFlows()
 
 void writeNodeSurcharge()
 {
-    int    j, n = 0;
+    int    j, m, n = 0;
     double t, d1, d2;
 
     WRITE("");
@@ -400,8 +388,9 @@ void writeNodeSurcharge()
     WRITE("**********************");
     WRITE("");
 
-    for ( j = 0; j < Nobjects[NODE]; j++ )
+    for ( m = 0; m < Nobjects[NODE]; m++ )
     {
+        j = NodeOrder[m];
         if ( Node[j].type == OUTFALL ) continue;
         if ( NodeStats[j].timeSurcharged == 0.0 ) continue;
         t = MAX(0.01, (NodeStats[j].timeSurcharged / 3600.0));
@@ -437,7 +426,7 @@ void writeNodeSurcharge()
 
 void writeNodeFlooding()
 {
-    int    j, n = 0;
+    int    j, m, n = 0;
     int    days, hrs, mins;
     double t;
 
@@ -447,8 +436,9 @@ void writeNodeFlooding()
     WRITE("*********************");
     WRITE("");
 
-    for ( j = 0; j < Nobjects[NODE]; j++ )
+    for ( m = 0; m < Nobjects[NODE]; m++ )
     {
+        j = NodeOrder[m];
         if ( Node[j].type == OUTFALL ) continue;
         if ( NodeStats[j].timeFlooded == 0.0 ) continue;
         t = MAX(0.01, (NodeStats[j].timeFlooded / 3600.0));
@@ -501,7 +491,7 @@ void writeStorageVolumes()
 //  Purpose: writes simulation statistics for storage units to report file.
 //
 {
-    int    j, k, days, hrs, mins;
+    int    j, m, k, days, hrs, mins;
     double avgVol, maxVol, pctAvgVol, pctMaxVol;
     double addedVol, pctEvapLoss, pctSeepLoss;
 
@@ -525,8 +515,9 @@ void writeStorageVolumes()
         fprintf(Frpt.file,
 "\n  --------------------------------------------------------------------------------------------------");
 
-        for ( j = 0; j < Nobjects[NODE]; j++ )
+        for ( m = 0; m < Nobjects[NODE]; m++ )
         {
+            j = NodeOrder[m];
             if ( Node[j].type != STORAGE ) continue;
             k = Node[j].subIndex;
             fprintf(Frpt.file, "\n  %-20s", Node[j].ID);
@@ -570,7 +561,7 @@ void writeOutfallLoads()
 //
 {
     char    units[15];
-    int     i, j, k, p;
+    int     i, j, m, k, p;
     double  x;
     double  outfallCount, flowCount;
     double  flowSum, freqSum, volSum;
@@ -618,8 +609,9 @@ void writeOutfallLoads()
         for (p = 0; p < Nobjects[POLLUT]; p++) fprintf(Frpt.file, "--------------");
 
         // --- identify each outfall node
-        for (j=0; j<Nobjects[NODE]; j++)
+        for (m=0; m<Nobjects[NODE]; m++)
         {
+            j = NodeOrder[m];
             if ( Node[j].type != OUTFALL ) continue;
             k = Node[j].subIndex;
             flowCount = OutfallStats[k].totalPeriods;
@@ -685,7 +677,7 @@ void writeLinkFlows()
 //  Purpose: writes simulation statistics for links to report file.
 //
 {
-    int    j, k, days, hrs, mins;
+    int    j, m, k, days, hrs, mins;
     double v, fullDepth;
 
     if ( Nobjects[LINK] == 0 ) return;
@@ -708,8 +700,9 @@ void writeLinkFlows()
     fprintf(Frpt.file,
 "\n  -----------------------------------------------------------------------------");
 
-    for ( j = 0; j < Nobjects[LINK]; j++ )
+    for ( m = 0; m < Nobjects[LINK]; m++ )
     {
+        j = LinkOrder[m];
         // --- print link ID
         k = Link[j].subIndex;
         fprintf(Frpt.file, "\n  %-20s", Link[j].ID);
@@ -772,7 +765,7 @@ void writeFlowClass()
 //  Purpose: writes flow classification fro each conduit to report file.
 //
 {
-    int   i, j, k;
+    int   i, j, m, k;
 
     if ( RouteModel != DW ) return;
     WRITE("");
@@ -786,8 +779,9 @@ void writeFlowClass()
 "\n                       /Actual         Up    Down  Sub   Sup   Up    Down  Norm  Inlet "
 "\n  Conduit               Length    Dry  Dry   Dry   Crit  Crit  Crit  Crit  Ltd   Ctrl  "
 "\n  -------------------------------------------------------------------------------------");
-    for ( j = 0; j < Nobjects[LINK]; j++ )
+    for ( m = 0; m < Nobjects[LINK]; m++ )
     {
+        j = LinkOrder[m];
         if ( Link[j].type != CONDUIT ) continue;
         if ( Link[j].xsect.type == DUMMY ) continue;
         k = Link[j].subIndex;
@@ -810,7 +804,7 @@ void writeFlowClass()
 
 void writeLinkSurcharge()
 {
-    int    i, j, n = 0;
+    int    i, j, m, n = 0;
     double t[5];
 
     WRITE("");
@@ -818,8 +812,9 @@ void writeLinkSurcharge()
     WRITE("Conduit Surcharge Summary");
     WRITE("*************************");
     WRITE("");
-    for ( j = 0; j < Nobjects[LINK]; j++ )
+    for ( m = 0; m < Nobjects[LINK]; m++ )
     {
+        j = LinkOrder[m];
         if ( Link[j].type != CONDUIT ||
 			 Link[j].xsect.type == DUMMY ) continue; 
         t[0] = LinkStats[j].timeSurcharged / 3600.0;
@@ -856,7 +851,7 @@ void writePumpFlows()
 //  Purpose: writes simulation statistics for pumps to report file.
 //
 {
-    int    j, k;
+    int    j, m, k;
     double avgFlow, pctUtilized, pctOffCurve1, pctOffCurve2, totalSeconds;
 
     if ( Nlinks[PUMP] == 0 ) return;
@@ -875,8 +870,9 @@ void writePumpFlows()
 "\n  ---------------------------------------------------------------------------------------------------------",
         FlowUnitWords[FlowUnits], FlowUnitWords[FlowUnits],
         FlowUnitWords[FlowUnits], VolUnitsWords[UnitSystem]);
-    for ( j = 0; j < Nobjects[LINK]; j++ )
+    for ( m = 0; m < Nobjects[LINK]; m++ )
     {
+        j = LinkOrder[m];
         if ( Link[j].type != PUMP ) continue;
         k = Link[j].subIndex;
         fprintf(Frpt.file, "\n  %-20s", Link[j].ID);
@@ -905,7 +901,7 @@ void writePumpFlows()
 
 void writeLinkLoads()
 {
-    int i, j, p;
+    int i, j, m, p;
     double x;
     char  units[15];
     char  linkLine[] = "--------------------";
@@ -933,8 +929,9 @@ void writeLinkLoads()
     for (p = 0; p < Nobjects[POLLUT]; p++) fprintf(Frpt.file, "%s", pollutLine);
 
     // --- print the pollutant loadings carried by each link
-    for ( j = 0; j < Nobjects[LINK]; j++ )
+    for ( m = 0; m < Nobjects[LINK]; m++ )
     {
+        j = LinkOrder[m];
         fprintf(Frpt.file, "\n  %-20s", Link[j].ID);
         for (p = 0; p < Nobjects[POLLUT]; p++)
         {
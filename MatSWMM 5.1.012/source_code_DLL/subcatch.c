@@ -57,21 +57,21 @@ const double ODETOL    = 0.0001;            // acceptable error for ODE solver
 // Globally shared variables   
 //-----------------------------------------------------------------------------
 // Volumes (ft3) for a subcatchment over a time step                           //(5.1.008)
-double     Vevap;         // evaporation
-double     Vpevap;        // pervious area evaporation
-double     Vinfil;        // non-LID infiltration
-double     Vinflow;       // non-LID precip + snowmelt + runon + ponded water
-double     Voutflow;      // non-LID runoff to subcatchment's outlet
-double     VlidIn;        // impervious area flow to LID units
-double     VlidInfil;     // infiltration from LID units
-double     VlidOut;       // surface outflow from LID units
-double     VlidDrain;     // drain outflow from LID units
-double     VlidReturn;    // LID outflow returned to pervious area
+THREADLOCAL double     Vevap;         // evaporation
+THREADLOCAL double     Vpevap;        // pervious area evaporation
+THREADLOCAL double     Vinfil;        // non-LID infiltration
+THREADLOCAL double     Vinflow;       // non-LID precip + snowmelt + runon + ponded water
+THREADLOCAL double     Voutflow;      // non-LID runoff to subcatchment's outlet
+THREADLOCAL double     VlidIn;        // impervious area flow to LID units
+THREADLOCAL double     VlidInfil;     // infiltration from LID units
+THREADLOCAL double     VlidOut;       // surface outflow from LID units
+THREADLOCAL double     VlidDrain;     // drain outflow from LID units
+THREADLOCAL double     VlidReturn;    // LID outflow returned to pervious area
 
 //-----------------------------------------------------------------------------
 // Locally shared variables   
 //-----------------------------------------------------------------------------
-static  TSubarea* theSubarea;     // subarea to which getDdDt() is applied
+static  THREADLOCAL TSubarea* theSubarea;     // subarea to which getDdDt() is applied
 static  char *RunoffRoutingWords[] = { w_OUTLET,  w_IMPERV, w_PERV, NULL};
 
 //-----------------------------------------------------------------------------
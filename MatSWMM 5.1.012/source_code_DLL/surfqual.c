@@ -18,24 +18,28 @@
 
 #include <math.h>
 #include <string.h>
+#include <omp.h>
 #include "headers.h"
 #include "lid.h"
 
 //-----------------------------------------------------------------------------
 //  Imported variables 
 //-----------------------------------------------------------------------------
-// Declared in RUNOFF.C
-extern  double*    OutflowLoad;   // exported pollutant mass load
-
 // Volumes (ft3) for a subcatchment over a time step declared in SUBCATCH.C
-extern double      Vinfil;        // non-LID infiltration
-extern double      Vinflow;       // non-LID precip + snowmelt + runon + ponded water
-extern double      Voutflow;      // non-LID runoff to subcatchment's outlet
-extern double      VlidIn;        // inflow to LID units
-extern double      VlidInfil;     // infiltration from LID units
-extern double      VlidOut;       // surface outflow from LID units
-extern double      VlidDrain;     // drain outflow from LID units
-extern double      VlidReturn;    // LID outflow returned to pervious area
+extern THREADLOCAL double      Vinfil;        // non-LID infiltration
+extern THREADLOCAL double      Vinflow;       // non-LID precip + snowmelt + runon + ponded water
+extern THREADLOCAL double      Voutflow;      // non-LID runoff to subcatchment's outlet
+extern THREADLOCAL double      VlidIn;        // inflow to LID units
+extern THREADLOCAL double      VlidInfil;     // infiltration from LID units
+extern THREADLOCAL double      VlidOut;       // surface outflow from LID units
+extern THREADLOCAL double      VlidDrain;     // drain outflow from LID units
+extern THREADLOCAL double      VlidReturn;    // LID outflow returned to pervious area
+
+//-----------------------------------------------------------------------------
+//  Local variables
+//-----------------------------------------------------------------------------
+// Row of OutflowLoad used by the thread computing a subcatchment's washoff
+static THREADLOCAL double*     Load;
 
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)   
@@ -215,7 +219,9 @@ void  surfqual_getWashoff(int j, double runoff, double tStep)
     if ( Nobjects[POLLUT] == 0 || area == 0.0 ) return;
 
     // --- find contributions from washoff, runon and wet precip. to OutflowLoad
-    for (p = 0; p < Nobjects[POLLUT]; p++) OutflowLoad[p] = 0.0;
+    //     (each thread has its own row of OutflowLoad)
+    Load = OutflowLoad + omp_get_thread_num() * Nobjects[POLLUT];
+    for (p = 0; p < Nobjects[POLLUT]; p++) Load[p] = 0.0;
     findWashoffLoads(j, runoff);
     findPondedLoads(j, tStep);
     findLidLoads(j, tStep);
@@ -250,7 +256,7 @@ void  surfqual_getWashoff(int j, double runoff, double tStep)
     {
         // --- convert washoff load to a concentration
         cOut = 0.0;
-        if ( vOut1 > 0.0 ) cOut = OutflowLoad[p] / vOut1;
+        if ( vOut1 > 0.0 ) cOut = Load[p] / vOut1;
 
         // --- assign any difference between pre- and post-LID
         //     loads (with LID return flow included) to BMP removal
@@ -373,7 +379,7 @@ void findPondedLoads(int j, double tStep)
 
             // --- update ponded mass (using newly computed ponded depth)
             Subcatch[j].pondedQual[p] = cPonded * subcatch_getDepth(j) * nonLidArea;
-            OutflowLoad[p] += wOutflow;
+            Load[p] += wOutflow;
         }
     }
 }
@@ -405,7 +411,7 @@ void  findWashoffLoads(int j, double runoff)
             // --- compute load generated by washoff function
             for (p = 0; p < Nobjects[POLLUT]; p++)
             {
-                OutflowLoad[p] += landuse_getWashoffLoad(
+                Load[p] += landuse_getWashoffLoad(
                     i, p, area, Subcatch[j].landFactor, runoff, Voutflow);
             }
         }
@@ -419,14 +425,14 @@ void  findWashoffLoads(int j, double runoff)
         if ( k >= 0 )
         {
             // --- compute addition to washoff from co-pollutant
-            w = Pollut[p].coFraction * OutflowLoad[k];
+            w = Pollut[p].coFraction * Load[k];
 
             // --- add this washoff to buildup mass balance totals
             //     so that things will balance
             massbal_updateLoadingTotals(BUILDUP_LOAD, p, w * Pollut[p].mcf);
 
             // --- then also add it to the total washoff load
-            OutflowLoad[p] += w;
+            Load[p] += w;
         }
     }
 }
@@ -469,6 +475,6 @@ void  findLidLoads(int j, double tStep)
         else            wLidRunon = 0.0;
 
         // --- update total outflow pollutant load (mass)
-        OutflowLoad[p] += wLidRain + wLidRunon;
+        Load[p] += wLidRain + wLidRunon;
     }
 }
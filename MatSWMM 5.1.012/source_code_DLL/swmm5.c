@@ -71,6 +71,8 @@
 #ifdef WINDOWS
   #include <windows.h>
   #include <direct.h>                                                          //(5.1.012)
+#else
+  #include <dlfcn.h>
 #endif
 #ifdef EXH
   #include <excpt.h>
@@ -104,6 +106,7 @@
 #include "swmm5.h"                     // declaration of exportable functions
                                        //   callable from other programs
 #include "cosimulation.h"
+#include "outreader.h"
 #define  MAX_EXCEPTIONS 100            // max. number of exceptions handled
 
 //-----------------------------------------------------------------------------
@@ -129,30 +132,49 @@ const double Qcf[6] =                  // Flow Conversion Factors:
 //-----------------------------------------------------------------------------
 //  Shared variables
 //-----------------------------------------------------------------------------
-static int  IsOpenFlag;           // TRUE if a project has been opened
-static int  IsStartedFlag;        // TRUE if a simulation has been started
-static int  SaveResultsFlag;      // TRUE if output to be saved to binary file
-static int  ExceptionCount;       // number of exceptions handled
-static int  DoRunoff;             // TRUE if runoff is computed
-static int  DoRouting;            // TRUE if flow routing is computed
+static TProject DefaultProject;        // project used by the legacy API
+THREADLOCAL_PROJECT TProject* Project = &DefaultProject;
+
+#define IsOpenFlag      (Project->IsOpenFlag)      // TRUE if a project has been opened
+#define IsStartedFlag   (Project->IsStartedFlag)   // TRUE if a simulation has been started
+#define SaveResultsFlag (Project->SaveResultsFlag) // TRUE if output to be saved to binary file
+#define ExceptionCount  (Project->ExceptionCount)  // number of exceptions handled
+#define DoRunoff        (Project->DoRunoff)        // TRUE if runoff is computed
+#define DoRouting       (Project->DoRouting)       // TRUE if flow routing is computed
+#define Controller      (Project->Controller)      // native controller
+#define ControllerData  (Project->ControllerData)  // user data passed to the controller
+#define ControllerInterval (Project->ControllerInterval) // routing steps between calls
+#define ControllerLibrary  (Project->ControllerLibrary)  // library holding the controller
 
 //-----------------------------------------------------------------------------
 //  External functions (prototyped in swmm5.h)
 //-----------------------------------------------------------------------------
 //  swmm_run
 //  swmm_open
+//  swmm_openFromBuffer
 //  swmm_start
 //  swmm_step
+//  swmm_stepUntil
+//  swmm_stepUntilEvent
 //  swmm_end
 //  swmm_report
 //  swmm_close
 //  swmm_getMassBalErr
 //  swmm_getVersion
+//  swmm_createProject
+//  swmm_deleteProject
+//  swmm_set_controller
+//  swmm_load_controller
+//  plus a re-entrant "_r" version of each function that takes a project handle
 
 //-----------------------------------------------------------------------------
 //  Local functions
 //-----------------------------------------------------------------------------
+static int  openProject(char* f1, const char* inpText, size_t len, char* f2,
+            char* f3);
 static void execRouting(void);                                                 //(5.1.011)
+static void runController(double routingStep);
+static void closeControllerLibrary(void);
 
 // Exception filtering function
 #ifdef EXH                                                                     //(5.1.011)
@@ -223,9 +245,10 @@ int  main(int argc, char *argv[])
 
 //=============================================================================
 
-int DLLEXPORT  swmm_run(char* f1, char* f2, char* f3)
+int DLLEXPORT  swmm_run_r(SWMM_Project ph, char* f1, char* f2, char* f3)
 //
-//  Input:   f1 = name of input file
+//  Input:   ph = project handle
+//           f1 = name of input file
 //           f2 = name of report file
 //           f3 = name of binary output file
 //  Output:  returns error code
@@ -237,14 +260,16 @@ int DLLEXPORT  swmm_run(char* f1, char* f2, char* f3)
     double elapsedTime = 0.0;                                                  //(5.1.011)
 
     // --- open the files & read input data
+    if ( ph == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
     ErrorCode = 0;
-    swmm_open(f1, f2, f3);
+    swmm_open_r(ph, f1, f2, f3);
 
     // --- run the simulation if input data OK
     if ( !ErrorCode )
     {
         // --- initialize values
-        swmm_start(TRUE);
+        swmm_start_r(ph, TRUE);
 
         // --- execute each time step until elapsed time is re-set to 0
         if ( !ErrorCode )
@@ -252,7 +277,7 @@ int DLLEXPORT  swmm_run(char* f1, char* f2, char* f3)
             writecon("\n o  Simulating day: 0     hour:  0");
             do
             {
-                swmm_step(&elapsedTime);
+                swmm_step_r(ph, &elapsedTime);
                 newHour = (long)(elapsedTime * 24.0);
                 if ( newHour > oldHour )
                 {
@@ -270,27 +295,65 @@ int DLLEXPORT  swmm_run(char* f1, char* f2, char* f3)
         }
 
         // --- clean up
-        swmm_end();
+        swmm_end_r(ph);
     }
 
     // --- report results
-    if ( Fout.mode == SCRATCH_FILE ) swmm_report();
+    if ( Fout.mode == SCRATCH_FILE ) swmm_report_r(ph);
 
     // --- close the system
-    swmm_close();
+    swmm_close_r(ph);
     return error_getCode(ErrorCode);                                           //(5.1.011)
 }
 
 //=============================================================================
 
-int DLLEXPORT swmm_open(char* f1, char* f2, char* f3)
+int DLLEXPORT swmm_open_r(SWMM_Project ph, char* f1, char* f2, char* f3)
 //
-//  Input:   f1 = name of input file
+//  Input:   ph = project handle
+//           f1 = name of input file
 //           f2 = name of report file
 //           f3 = name of binary output file
 //  Output:  returns error code
 //  Purpose: opens a SWMM project.
 //
+{
+    if ( ph == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
+    return openProject(f1, NULL, 0, f2, f3);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_openFromBuffer_r(SWMM_Project ph, const char* inpText,
+                                    size_t len, char* f2, char* f3)
+//
+//  Input:   ph = project handle
+//           inpText = contents of an input file
+//           len = number of characters in inpText
+//           f2 = name of report file (NULL or "" for a temporary file)
+//           f3 = name of binary output file (NULL or "" for a scratch file)
+//  Output:  returns error code
+//  Purpose: opens a SWMM project whose input file is held in memory.
+//
+{
+    if ( ph == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
+    return openProject(NULL, inpText, len, f2, f3);
+}
+
+//=============================================================================
+
+int openProject(char* f1, const char* inpText, size_t len, char* f2, char* f3)
+//
+//  Input:   f1 = name of input file (NULL when inpText is used)
+//           inpText = contents of an input file
+//           len = number of characters in inpText
+//           f2 = name of report file
+//           f3 = name of binary output file
+//  Output:  returns error code
+//  Purpose: opens the current project and reads its input.
+//
 {
 #ifdef DLL
    _fpreset();              
@@ -311,7 +374,8 @@ int DLLEXPORT swmm_open(char* f1, char* f2, char* f3)
         ExceptionCount = 0;
 
         // --- open a SWMM project
-        project_open(f1, f2, f3);
+        if ( f1 ) project_open(f1, f2, f3);
+        else      project_openFromBuffer(inpText, len, f2, f3);
         if ( ErrorCode ) return error_getCode(ErrorCode);                      //(5.1.011)
         IsOpenFlag = TRUE;
         report_writeLogo();
@@ -327,6 +391,9 @@ int DLLEXPORT swmm_open(char* f1, char* f2, char* f3)
 
         // --- write input summary to report file if requested
         if ( RptFlags.input ) inputrpt_writeInput();
+
+        // --- renumber nodes & links for faster routing if requested
+        renumber_objects();
     }
 
 #ifdef EXH                                                                     //(5.1.011)
@@ -341,13 +408,17 @@ int DLLEXPORT swmm_open(char* f1, char* f2, char* f3)
 
 //=============================================================================
 
-int DLLEXPORT swmm_start(int saveResults)
+int DLLEXPORT swmm_start_r(SWMM_Project ph, int saveResults)
 //
-//  Input:   saveResults = TRUE if simulation results saved to binary file 
+//  Input:   ph = project handle
+//           saveResults = TRUE if simulation results saved to binary file 
 //  Output:  returns an error code
 //  Purpose: starts a SWMM simulation.
 //
 {
+    if ( ph == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
+
     // --- check that a project is open & no run started
     if ( ErrorCode ) return error_getCode(ErrorCode);                          //(5.1.011)
     if ( !IsOpenFlag || IsStartedFlag )
@@ -414,6 +485,9 @@ int DLLEXPORT swmm_start(int saveResults)
         massbal_open();
         stats_open();
 
+        // --- start the worker threads used by parallel computations
+        workers_open();
+
         // --- write project options to report file 
 	    report_writeOptions();
         if ( RptFlags.controls ) report_writeControlActionsHeading();
@@ -431,14 +505,18 @@ int DLLEXPORT swmm_start(int saveResults)
 }
 //=============================================================================
 
-int DLLEXPORT swmm_step(double* elapsedTime)                                   //(5.1.011)
+int DLLEXPORT swmm_step_r(SWMM_Project ph, double* elapsedTime)
 //
-//  Input:   elapsedTime = current elapsed time in decimal days
+//  Input:   ph = project handle
+//           elapsedTime = current elapsed time in decimal days
 //  Output:  updated value of elapsedTime,
 //           returns error code
 //  Purpose: advances the simulation by one routing time step.
 //
 {
+    if ( ph == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
+
     // --- check that simulation can proceed
     if ( ErrorCode ) return error_getCode(ErrorCode);                          //(5.1.011)
     if ( !IsOpenFlag || !IsStartedFlag  )
@@ -491,6 +569,119 @@ int DLLEXPORT swmm_step(double* elapsedTime)                                   /
 
 //=============================================================================
 
+int DLLEXPORT swmm_stepUntil_r(SWMM_Project ph, double targetElapsedTime,
+                               double* elapsedTime)
+//
+//  Input:   ph = project handle
+//           targetElapsedTime = elapsed time to advance to (decimal days)
+//  Output:  elapsedTime = elapsed time reached (0 if the simulation ended),
+//           returns error code
+//  Purpose: advances the simulation by as many routing time steps as are
+//           needed to reach targetElapsedTime (always at least one).
+//
+{
+    return swmm_stepUntilEvent_r(ph, targetElapsedTime, 0, NULL, NULL, NULL,
+                                 NULL, 0, elapsedTime, NULL);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_stepUntilEvent_r(SWMM_Project ph, double targetElapsedTime,
+                                    int n, int* objTypes, int* indices,
+                                    int* attributes, double* thresholds,
+                                    int units, double* elapsedTime, int* event)
+//
+//  Input:   ph = project handle
+//           targetElapsedTime = elapsed time to advance to (decimal days)
+//           n = number of watched quantities
+//           objTypes = object type of each watch (NODE, LINK or SUBCATCH)
+//           indices = object index of each watch (as from swmm_get_index)
+//           attributes = cosimulation attribute of each watch (C_DEPTH,
+//                        C_FLOW, C_FLOODING, ...)
+//           thresholds = threshold of each watch
+//           units = unit system of the thresholds (SI/US)
+//  Output:  elapsedTime = elapsed time reached (0 if the simulation ended),
+//           event = index of the watch that stopped the simulation or -1,
+//           returns error code
+//  Purpose: advances the simulation like swmm_stepUntil but stops after the
+//           first routing step in which a watched value crosses its
+//           threshold (rises above it or falls back to or below it).
+//
+//  NOTE: at least one routing step is always taken, even if the target
+//        time has already been reached.
+//
+{
+    int     i, k, errcode;
+    double* values = NULL;
+    char*   above = NULL;
+
+    if ( ph == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
+    if ( event ) *event = -1;
+
+    // --- check that simulation can proceed
+    if ( ErrorCode ) return error_getCode(ErrorCode);
+    if ( !IsOpenFlag || !IsStartedFlag  )
+    {
+        report_writeErrorMsg(ERR_NOT_OPEN, "");
+        return error_getCode(ErrorCode);
+    }
+    if ( elapsedTime == NULL || n < 0 ||
+         (n > 0 && (objTypes == NULL || indices == NULL ||
+                    attributes == NULL || thresholds == NULL ||
+                    event == NULL)) )
+        return C_ERROR_INCOHERENT;
+
+    // --- record on which side of its threshold each watch starts
+    if ( n > 0 )
+    {
+        values = (double *) calloc(n, sizeof(double));
+        above = (char *) calloc(n, sizeof(char));
+        if ( values == NULL || above == NULL )
+        {
+            free(values);
+            free(above);
+            return error_getCode(ERR_MEMORY);
+        }
+        errcode = c_get_watched(n, objTypes, indices, attributes, units, values);
+        if ( errcode )
+        {
+            free(values);
+            free(above);
+            return errcode;
+        }
+        for ( i = 0; i < n; i++ ) above[i] = (values[i] > thresholds[i]);
+    }
+
+    // --- step until the target time, the end of the simulation or an event
+    for (;;)
+    {
+        errcode = swmm_step_r(ph, elapsedTime);
+        if ( errcode || *elapsedTime == 0.0 ) break;
+        if ( n > 0 )
+        {
+            errcode = c_get_watched(n, objTypes, indices, attributes,
+                                    units, values);
+            if ( errcode ) break;
+            for ( k = 0; k < n; k++ )
+            {
+                if ( (values[k] > thresholds[k]) != above[k] ) break;
+            }
+            if ( k < n )
+            {
+                *event = k;
+                break;
+            }
+        }
+        if ( *elapsedTime >= targetElapsedTime ) break;
+    }
+    free(values);
+    free(above);
+    return errcode;
+}
+
+//=============================================================================
+
 void execRouting()                                                             //(5.1.011)
 //
 //  Input:   none                                                              //(5.1.011)
@@ -538,6 +729,14 @@ void execRouting()                                                             /
         // --- if no runoff analysis, update climate state (for evaporation)
         else climate_setState(getDateTime(NewRoutingTime));
   
+        // --- let a native controller change link settings
+        if ( DoRouting && Controller &&
+             (StepCount - 1) % ControllerInterval == 0 )
+        {
+            runController(routingStep);
+            if ( ErrorCode ) return;
+        }
+
         // --- route flows & pollutants through drainage system                //(5.1.008)
         //     (while updating NewRoutingTime)                                 //(5.1.008)
         if ( DoRouting ) routing_execute(RouteModel, routingStep);
@@ -557,13 +756,16 @@ void execRouting()                                                             /
 
 //=============================================================================
 
-int DLLEXPORT swmm_end(void)
+int DLLEXPORT swmm_end_r(SWMM_Project ph)
 //
-//  Input:   none
+//  Input:   ph = project handle
 //  Output:  none
 //  Purpose: ends a SWMM simulation.
 //
 {
+    if ( ph == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
+
     // --- check that project opened and run started
     if ( !IsOpenFlag )
     {
@@ -586,6 +788,7 @@ int DLLEXPORT swmm_end(void)
         // --- close all computing systems
         stats_close();
         massbal_close();
+        workers_close();
         if ( !IgnoreRainfall ) rain_close();
         if ( DoRunoff ) runoff_close();
         if ( DoRouting ) routing_close(RouteModel);
@@ -597,13 +800,16 @@ int DLLEXPORT swmm_end(void)
 
 //=============================================================================
 
-int DLLEXPORT swmm_report()
+int DLLEXPORT swmm_report_r(SWMM_Project ph)
 //
-//  Input:   none
+//  Input:   ph = project handle
 //  Output:  returns an error code
 //  Purpose: writes simulation results to report file.
 //
 {
+    if ( ph == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
+
     if ( Fout.mode == SCRATCH_FILE ) output_checkFileSize();
     if ( ErrorCode ) report_writeErrorCode();
     else
@@ -616,13 +822,16 @@ int DLLEXPORT swmm_report()
 
 //=============================================================================
 
-int DLLEXPORT swmm_close()
+int DLLEXPORT swmm_close_r(SWMM_Project ph)
 //
-//  Input:   none
+//  Input:   ph = project handle
 //  Output:  returns an error code
 //  Purpose: closes a SWMM project.
 //
 {
+    if ( ph == NULL ) return 0;
+    Project = (TProject *)ph;
+
     if ( Fout.file ) output_close();
     if ( IsOpenFlag ) project_close();
     report_writeSysTime();
@@ -640,10 +849,10 @@ int DLLEXPORT swmm_close()
 
 //=============================================================================
 
-int  DLLEXPORT swmm_getMassBalErr(float* runoffErr, float* flowErr,
-                                  float* qualErr)
+int  DLLEXPORT swmm_getMassBalErr_r(SWMM_Project ph, float* runoffErr,
+                                    float* flowErr, float* qualErr)
 //
-//  Input:   none
+//  Input:   ph = project handle
 //  Output:  runoffErr = runoff mass balance error (percent)
 //           flowErr   = flow routing mass balance error (percent)
 //           qualErr   = quality routing mass balance error (percent)
@@ -654,6 +863,8 @@ int  DLLEXPORT swmm_getMassBalErr(float* runoffErr, float* flowErr,
     *runoffErr = 0.0;
     *flowErr   = 0.0;
     *qualErr   = 0.0;
+    if ( ph == NULL ) return 0;
+    Project = (TProject *)ph;
 
     if ( IsOpenFlag && !IsStartedFlag)
     {
@@ -682,12 +893,14 @@ int  DLLEXPORT swmm_getVersion(void)
 
 ////  New function added to release 5.1.011.  ////                             //(5.1.011)
 
-int DLLEXPORT swmm_getWarnings(void)
+int DLLEXPORT swmm_getWarnings_r(SWMM_Project ph)
 //
-//  Input:  none
+//  Input:  ph = project handle
 //  Output: returns number of warning messages issued.
 //  Purpose: retireves number of warning messages issued during an analysis.
 {
+    if ( ph == NULL ) return 0;
+    Project = (TProject *)ph;
     return Warnings;
 }
 
@@ -695,9 +908,10 @@ int DLLEXPORT swmm_getWarnings(void)
 
 ////  New function added to release 5.1.011.  ////                             //(5.1.011)
 
-int  DLLEXPORT swmm_getError(char* errMsg, int msgLen)
+int  DLLEXPORT swmm_getError_r(SWMM_Project ph, char* errMsg, int msgLen)
 //
-//  Input:   errMsg = character array to hold error message text
+//  Input:   ph = project handle
+//           errMsg = character array to hold error message text
 //           msgLen = maximum size of errMsg
 //  Output:  returns error message code number and text of error message.
 //  Purpose: retrieves the code number and text of the error condition that
@@ -705,6 +919,9 @@ int  DLLEXPORT swmm_getError(char* errMsg, int msgLen)
 {
     size_t errMsgLen = msgLen;
 
+    if ( ph == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
+
     // --- copy text of last error message into errMsg
     if ( ErrorCode > 0 && strlen(ErrorMsg) == 0 ) sstrncpy(errMsg, "", 1);
     else
@@ -718,36 +935,837 @@ int  DLLEXPORT swmm_getError(char* errMsg, int msgLen)
     return error_getCode(ErrorCode);                                           //(5.1.011)
 }
 
-/*************************************************************************
-************************** COSIMULATION **********************************
-*************************************************************************/
+//=============================================================================
 
-// GETTERS
-double DLLEXPORT swmm_get( char* id, int attribute, int units )
+int DLLEXPORT swmm_createProject(SWMM_Project* ph)
+//
+//  Input:   none
+//  Output:  ph = handle of a new, empty project;
+//           returns an error code
+//  Purpose: creates a project that can be analyzed independently of (and
+//           concurrently with) any other project.
+//
 {
-    return  c_get( id, attribute, units );
+    TProject* project;
+
+    if ( ph == NULL ) return error_getCode(ERR_MEMORY);
+    project = (TProject *) calloc(1, sizeof(TProject));
+    *ph = (SWMM_Project)project;
+    if ( project == NULL ) return error_getCode(ERR_MEMORY);
+    return 0;
 }
-double DLLEXPORT swmm_get_from_input(char* filename, char *id, int attribute)
+
+//=============================================================================
+
+int DLLEXPORT swmm_deleteProject(SWMM_Project ph)
+//
+//  Input:   ph = project handle
+//  Output:  returns an error code
+//  Purpose: ends and closes a project if necessary and frees its memory.
+//
 {
-    return c_get_from_input(filename, id, attribute);
+    if ( ph == NULL || ph == (SWMM_Project)&DefaultProject ) return 0;
+    Project = (TProject *)ph;
+    if ( IsStartedFlag ) swmm_end_r(ph);
+    if ( IsOpenFlag ) swmm_close_r(ph);
+    closeControllerLibrary();
+    free(ph);
+    Project = &DefaultProject;
+    return 0;
 }
-int DLLEXPORT swmm_save_all(char* input_file, int object_type, int attribute)
+
+//=============================================================================
+
+int DLLEXPORT swmm_saveState_r(SWMM_Project ph, SWMM_State* state)
+//
+//  Input:   ph = project handle
+//           state = state to overwrite (or NULL to create a new one)
+//  Output:  state = in-memory copy of the simulation's current state;
+//           returns an error code
+//  Purpose: saves the state of a running simulation so that it can later
+//           be returned to with swmm_restoreState.
+//
 {
-    return c_look4all(input_file, object_type, attribute);
+    if ( ph == NULL || state == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
+    if ( ErrorCode ) return error_getCode(ErrorCode);
+    if ( !IsOpenFlag || !IsStartedFlag ) return error_getCode(ERR_NOT_OPEN);
+    return error_getCode(hotstart_saveState(state));
 }
-// SETTERS
-int DLLEXPORT swmm_modify_setting(char* id, double new_setting, double tstep)
+
+//=============================================================================
+
+int DLLEXPORT swmm_restoreState_r(SWMM_Project ph, SWMM_State state)
+//
+//  Input:   ph = project handle
+//           state = a state saved by swmm_saveState during the current run
+//  Output:  returns an error code
+//  Purpose: returns a running simulation to a previously saved state.
+//
 {
-    return c_modify_setting(id, new_setting, tstep);
+    if ( ph == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
+    if ( ErrorCode ) return error_getCode(ErrorCode);
+    if ( !IsOpenFlag || !IsStartedFlag ) return error_getCode(ERR_NOT_OPEN);
+    return error_getCode(hotstart_restoreState(state));
 }
-int DLLEXPORT swmm_modify_input(char* input_file, char *id, int attribute, double value)
+
+//=============================================================================
+
+int DLLEXPORT swmm_deleteState(SWMM_State state)
+//
+//  Input:   state = a state saved by swmm_saveState
+//  Output:  returns an error code
+//  Purpose: frees the memory used by a saved state.
+//
 {
-    return c_modify_input_value(input_file, id, attribute, value);
+    hotstart_deleteState(state);
+    return 0;
 }
-int DLLEXPORT swmm_save_results()
+
+//=============================================================================
+//   Single-project API (operates on a built-in default project)
+//=============================================================================
+
+int DLLEXPORT swmm_run(char* f1, char* f2, char* f3)
+//
+//  Input:   f1 = name of input file
+//           f2 = name of report file
+//           f3 = name of binary output file
+//  Output:  returns error code
+//  Purpose: same as swmm_run_r for the default project.
+//
 {
-    return c_saveResults();
+    return swmm_run_r(&DefaultProject, f1, f2, f3);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_open(char* f1, char* f2, char* f3)
+//
+//  Input:   f1 = name of input file
+//           f2 = name of report file
+//           f3 = name of binary output file
+//  Output:  returns error code
+//  Purpose: same as swmm_open_r for the default project.
+//
+{
+    return swmm_open_r(&DefaultProject, f1, f2, f3);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_openFromBuffer(const char* inpText, size_t len, char* f2,
+                                  char* f3)
+//
+//  Input:   inpText = contents of an input file
+//           len = number of characters in inpText
+//           f2 = name of report file (NULL or "" for a temporary file)
+//           f3 = name of binary output file (NULL or "" for a scratch file)
+//  Output:  returns error code
+//  Purpose: same as swmm_openFromBuffer_r for the default project.
+//
+{
+    return swmm_openFromBuffer_r(&DefaultProject, inpText, len, f2, f3);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_start(int saveResults)
+//
+//  Input:   saveResults = TRUE if simulation results saved to binary file
+//  Output:  returns an error code
+//  Purpose: same as swmm_start_r for the default project.
+//
+{
+    return swmm_start_r(&DefaultProject, saveResults);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_step(double* elapsedTime)
+//
+//  Input:   elapsedTime = current elapsed time in decimal days
+//  Output:  updated value of elapsedTime,
+//           returns error code
+//  Purpose: same as swmm_step_r for the default project.
+//
+{
+    return swmm_step_r(&DefaultProject, elapsedTime);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_stepUntil(double targetElapsedTime, double* elapsedTime)
+//
+//  Input:   targetElapsedTime = elapsed time to advance to (decimal days)
+//  Output:  elapsedTime = elapsed time reached (0 if the simulation ended),
+//           returns error code
+//  Purpose: same as swmm_stepUntil_r for the default project.
+//
+{
+    return swmm_stepUntil_r(&DefaultProject, targetElapsedTime, elapsedTime);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_stepUntilEvent(double targetElapsedTime, int n,
+    int* objTypes, int* indices, int* attributes, double* thresholds,
+    int units, double* elapsedTime, int* event)
+//
+//  Input:   targetElapsedTime = elapsed time to advance to (decimal days)
+//           n = number of watched quantities
+//           objTypes = object type of each watch (NODE, LINK or SUBCATCH)
+//           indices = object index of each watch (as from swmm_get_index)
+//           attributes = cosimulation attribute of each watch (C_DEPTH,
+//                        C_FLOW, C_FLOODING, ...)
+//           thresholds = threshold of each watch
+//           units = unit system of the thresholds (SI/US)
+//  Output:  elapsedTime = elapsed time reached (0 if the simulation ended),
+//           event = index of the watch that stopped the simulation or -1,
+//           returns error code
+//  Purpose: same as swmm_stepUntilEvent_r for the default project.
+//
+{
+    return swmm_stepUntilEvent_r(&DefaultProject, targetElapsedTime, n,
+        objTypes, indices, attributes, thresholds, units, elapsedTime, event);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_end(void)
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: same as swmm_end_r for the default project.
+//
+{
+    return swmm_end_r(&DefaultProject);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_report(void)
+//
+//  Input:   none
+//  Output:  returns an error code
+//  Purpose: same as swmm_report_r for the default project.
+//
+{
+    return swmm_report_r(&DefaultProject);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_close(void)
+//
+//  Input:   none
+//  Output:  returns an error code
+//  Purpose: same as swmm_close_r for the default project.
+//
+{
+    return swmm_close_r(&DefaultProject);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_getMassBalErr(float* runoffErr, float* flowErr,
+                                 float* qualErr)
+//
+//  Input:   none
+//  Output:  runoffErr = runoff mass balance error (percent)
+//           flowErr   = flow routing mass balance error (percent)
+//           qualErr   = quality routing mass balance error (percent)
+//           returns an error code
+//  Purpose: same as swmm_getMassBalErr_r for the default project.
+//
+{
+    return swmm_getMassBalErr_r(&DefaultProject, runoffErr, flowErr, qualErr);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_getWarnings(void)
+//
+//  Input:   none
+//  Output:  returns number of warning messages issued.
+//  Purpose: same as swmm_getWarnings_r for the default project.
+//
+{
+    return swmm_getWarnings_r(&DefaultProject);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_getError(char* errMsg, int msgLen)
+//
+//  Input:   errMsg = character array to hold error message text
+//           msgLen = maximum size of errMsg
+//  Output:  returns error message code number and text of error message.
+//  Purpose: same as swmm_getError_r for the default project.
+//
+{
+    return swmm_getError_r(&DefaultProject, errMsg, msgLen);
 }
+
+//=============================================================================
+
+int DLLEXPORT swmm_saveState(SWMM_State* state)
+//
+//  Input:   state = state to overwrite (or NULL to create a new one)
+//  Output:  state = in-memory copy of the simulation's current state;
+//           returns an error code
+//  Purpose: same as swmm_saveState_r for the default project.
+//
+{
+    return swmm_saveState_r(&DefaultProject, state);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_restoreState(SWMM_State state)
+//
+//  Input:   state = a state saved by swmm_saveState during the current run
+//  Output:  returns an error code
+//  Purpose: same as swmm_restoreState_r for the default project.
+//
+{
+    return swmm_restoreState_r(&DefaultProject, state);
+}
+
+/*************************************************************************
+************************** COSIMULATION **********************************
+*************************************************************************/
+
+// GETTERS
+double DLLEXPORT swmm_get_r(SWMM_Project ph, char* id, int attribute, int units)
+//
+//  Input:   ph = project handle
+//           id = ID name of a node, link or subcatchment
+//           attribute = cosimulation attribute (C_DEPTH, C_FLOW, ...)
+//           units = unit system of the value (SI/US)
+//  Output:  returns the attribute's value or an error code
+//  Purpose: retrieves an attribute of an object of a running simulation.
+//
+{
+    if ( ph == NULL ) return C_ERROR_NFOUND;
+    Project = (TProject *)ph;
+    return  c_get( id, attribute, units );
+}
+
+//=============================================================================
+
+double DLLEXPORT swmm_get( char* id, int attribute, int units )
+//
+//  Input:   id = ID name of a node, link or subcatchment
+//           attribute = cosimulation attribute (C_DEPTH, C_FLOW, ...)
+//           units = unit system of the value (SI/US)
+//  Output:  returns the attribute's value or an error code
+//  Purpose: same as swmm_get_r for the default project.
+//
+{
+    return swmm_get_r(&DefaultProject, id, attribute, units);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_get_index_r(SWMM_Project ph, char* id, int* objType)
+//
+//  Input:   ph = project handle
+//           id = ID name of an object
+//           objType = type of the object (NODE, LINK or SUBCATCH) or -1
+//                     if not known
+//  Output:  objType = type of the object found;
+//           returns the object's index or an error code
+//  Purpose: finds the index of an object from its ID name.
+//
+{
+    if ( ph == NULL ) return C_ERROR_NFOUND;
+    Project = (TProject *)ph;
+    return c_get_index(id, objType);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_get_index(char* id, int* objType)
+//
+//  Input:   id = ID name of an object
+//           objType = type of the object (NODE, LINK or SUBCATCH) or -1
+//                     if not known
+//  Output:  objType = type of the object found;
+//           returns the object's index or an error code
+//  Purpose: same as swmm_get_index_r for the default project.
+//
+{
+    return swmm_get_index_r(&DefaultProject, id, objType);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_get_many_r(SWMM_Project ph, int objType, int* idx, int n,
+                              int attribute, int units, double* out)
+//
+//  Input:   ph = project handle
+//           objType = type of the objects (NODE, LINK or SUBCATCH)
+//           idx = indices of the objects (as from swmm_get_index)
+//           n = number of objects
+//           attribute = cosimulation attribute (C_DEPTH, C_FLOW, ...)
+//           units = unit system of the values (SI/US)
+//  Output:  out = value of the attribute for each object;
+//           returns an error code
+//  Purpose: retrieves the same attribute of several objects at once.
+//
+{
+    if ( ph == NULL ) return C_ERROR_NFOUND;
+    Project = (TProject *)ph;
+    return c_get_many(objType, idx, n, attribute, units, out);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_get_many(int objType, int* idx, int n, int attribute,
+                            int units, double* out)
+//
+//  Input:   objType = type of the objects (NODE, LINK or SUBCATCH)
+//           idx = indices of the objects (as from swmm_get_index)
+//           n = number of objects
+//           attribute = cosimulation attribute (C_DEPTH, C_FLOW, ...)
+//           units = unit system of the values (SI/US)
+//  Output:  out = value of the attribute for each object;
+//           returns an error code
+//  Purpose: same as swmm_get_many_r for the default project.
+//
+{
+    return swmm_get_many_r(&DefaultProject, objType, idx, n, attribute, units, out);
+}
+
+//=============================================================================
+
+double DLLEXPORT swmm_get_from_input(char* filename, char *id, int attribute)
+//
+//  Input:   filename = name of an input file
+//           id = ID name of an object
+//           attribute = cosimulation attribute
+//  Output:  returns the attribute's value in the file or an error code
+//  Purpose: reads an attribute of an object from an input file.
+//
+{
+    return c_get_from_input(filename, id, attribute);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_save_all(char* input_file, int object_type, int attribute)
+//
+//  Input:   input_file = name of an input file
+//           object_type = type of the objects (NODE, LINK or SUBCATCH)
+//           attribute = cosimulation attribute
+//  Output:  returns an error code
+//  Purpose: writes the attribute of every object of a type in an input
+//           file to the file info.dat.
+//
+{
+    return c_look4all(input_file, object_type, attribute);
+}
+
+// SETTERS
+int DLLEXPORT swmm_modify_setting_r(SWMM_Project ph, char* id,
+                                    double new_setting, double tstep)
+//
+//  Input:   ph = project handle
+//           id = ID name of an orifice, weir, outlet or pump
+//           new_setting = new setting of the link
+//           tstep = time over which the setting is adjusted (sec)
+//  Output:  returns an error code
+//  Purpose: changes the setting of a control actuator.
+//
+{
+    if ( ph == NULL ) return C_ERROR_NFOUND;
+    Project = (TProject *)ph;
+    return c_modify_setting(id, new_setting, tstep);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_modify_setting(char* id, double new_setting, double tstep)
+//
+//  Input:   id = ID name of an orifice, weir, outlet or pump
+//           new_setting = new setting of the link
+//           tstep = time over which the setting is adjusted (sec)
+//  Output:  returns an error code
+//  Purpose: same as swmm_modify_setting_r for the default project.
+//
+{
+    return swmm_modify_setting_r(&DefaultProject, id, new_setting, tstep);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_modify_settings_r(SWMM_Project ph, int* idx, double* settings,
+                                     int n, double tstep)
+//
+//  Input:   ph = project handle
+//           idx = indices of the links (as from swmm_get_index)
+//           settings = new setting of each link
+//           n = number of links
+//           tstep = time over which the settings are adjusted (sec)
+//  Output:  returns an error code
+//  Purpose: changes the settings of several control actuators at once
+//           (none are changed if any index or setting is invalid).
+//
+{
+    if ( ph == NULL ) return C_ERROR_NFOUND;
+    Project = (TProject *)ph;
+    return c_modify_settings(idx, settings, n, tstep);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_modify_settings(int* idx, double* settings, int n, double tstep)
+//
+//  Input:   idx = indices of the links (as from swmm_get_index)
+//           settings = new setting of each link
+//           n = number of links
+//           tstep = time over which the settings are adjusted (sec)
+//  Output:  returns an error code
+//  Purpose: same as swmm_modify_settings_r for the default project.
+//
+{
+    return swmm_modify_settings_r(&DefaultProject, idx, settings, n, tstep);
+}
+
+// NATIVE CONTROLLER
+int DLLEXPORT swmm_set_controller_r(SWMM_Project ph, SWMM_Controller controller,
+                                    void* userData, int interval)
+//
+//  Input:   ph = project handle
+//           controller = function called inside swmm_step (NULL to remove)
+//           userData = pointer passed back to the controller
+//           interval = number of routing steps between controller calls
+//  Output:  returns an error code
+//  Purpose: registers a native controller that is called before each
+//           routing step it is due, with direct access to the project.
+//
+{
+    if ( ph == NULL ) return C_ERROR_NFOUND;
+    Project = (TProject *)ph;
+    if ( controller != NULL && interval < 1 ) return C_ERROR_INCOHERENT;
+    closeControllerLibrary();
+    Controller = controller;
+    ControllerData = userData;
+    ControllerInterval = interval;
+    return 0;
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_set_controller(SWMM_Controller controller, void* userData,
+                                  int interval)
+//
+//  Input:   controller = function called inside swmm_step (NULL to remove)
+//           userData = pointer passed back to the controller
+//           interval = number of routing steps between controller calls
+//  Output:  returns an error code
+//  Purpose: same as swmm_set_controller_r for the default project.
+//
+{
+    return swmm_set_controller_r(&DefaultProject, controller, userData, interval);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_load_controller_r(SWMM_Project ph, char* library,
+                                     char* function, int interval)
+//
+//  Input:   ph = project handle
+//           library = path of a shared library
+//           function = name of the controller function in the library
+//           interval = number of routing steps between controller calls
+//  Output:  returns an error code
+//  Purpose: registers a native controller found in a shared library (its
+//           user data pointer is NULL).
+//
+{
+    void* handle;
+    SWMM_Controller controller;
+
+    if ( ph == NULL ) return C_ERROR_NFOUND;
+    Project = (TProject *)ph;
+    if ( library == NULL || function == NULL ) return C_ERROR_PATH;
+    if ( interval < 1 ) return C_ERROR_INCOHERENT;
+
+#ifdef WINDOWS
+    handle = (void *)LoadLibraryA(library);
+    if ( handle == NULL ) return C_ERROR_PATH;
+    controller = (SWMM_Controller)GetProcAddress((HMODULE)handle, function);
+    if ( controller == NULL )
+    {
+        FreeLibrary((HMODULE)handle);
+        return C_ERROR_NFOUND;
+    }
+#else
+    handle = dlopen(library, RTLD_NOW);
+    if ( handle == NULL ) return C_ERROR_PATH;
+    *(void **)(&controller) = dlsym(handle, function);
+    if ( controller == NULL )
+    {
+        dlclose(handle);
+        return C_ERROR_NFOUND;
+    }
+#endif
+
+    swmm_set_controller_r(ph, controller, NULL, interval);
+    ControllerLibrary = handle;
+    return 0;
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_load_controller(char* library, char* function, int interval)
+//
+//  Input:   library = path of a shared library
+//           function = name of the controller function in the library
+//           interval = number of routing steps between controller calls
+//  Output:  returns an error code
+//  Purpose: same as swmm_load_controller_r for the default project.
+//
+{
+    return swmm_load_controller_r(&DefaultProject, library, function, interval);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_modify_input(char* input_file, char *id, int attribute, double value)
+//
+//  Input:   input_file = name of an input file
+//           id = ID name of an object
+//           attribute = cosimulation attribute
+//           value = new value of the attribute
+//  Output:  returns an error code
+//  Purpose: changes the value of an object's attribute in an input file.
+//
+{
+    return c_modify_input_value(input_file, id, attribute, value);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_save_results_r(SWMM_Project ph)
+//
+//  Input:   ph = project handle
+//  Output:  returns an error code
+//  Purpose: writes the results of a finished simulation to text files
+//           in the Subcatchments, Nodes, Links and Time folders.
+//
+{
+    if ( ph == NULL ) return C_ERROR_NFOUND;
+    Project = (TProject *)ph;
+    return c_saveResults();
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_save_results()
+//
+//  Input:   none
+//  Output:  returns an error code
+//  Purpose: same as swmm_save_results_r for the default project.
+//
+{
+    return swmm_save_results_r(&DefaultProject);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_save_results_columns_r(SWMM_Project ph, char* path)
+//
+//  Input:   ph = project handle
+//           path = name of the columnar file to create
+//  Output:  returns an error code
+//  Purpose: writes the results of a finished simulation to a binary
+//           file holding each variable's time series contiguously.
+//
+{
+    if ( ph == NULL ) return error_getCode(ERR_NOT_OPEN);
+    Project = (TProject *)ph;
+    return error_getCode(c_saveResultsColumns(path));
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_save_results_columns(char* path)
+//
+//  Input:   path = name of the columnar file to create
+//  Output:  returns an error code
+//  Purpose: same as swmm_save_results_columns_r for the default project.
+//
+{
+    return swmm_save_results_columns_r(&DefaultProject, path);
+}
+
+// Results file reader
+int DLLEXPORT swmm_open_results(char* outFile, SWMM_Results* rh)
+//
+//  Input:   outFile = name of a binary output file
+//  Output:  rh = handle of a new results reader;
+//           returns an error code
+//  Purpose: opens a binary output file for reading.
+//
+{
+    return outreader_open(outFile, (TOutReader **)rh);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_close_results(SWMM_Results rh)
+//
+//  Input:   rh = a results reader
+//  Output:  returns an error code
+//  Purpose: closes a results reader.
+//
+{
+    outreader_close((TOutReader *)rh);
+    return 0;
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_results_info(SWMM_Results rh, int* nPeriods, int* reportStep, double* startDate)
+//
+//  Input:   rh = a results reader
+//  Output:  nPeriods = number of reporting periods
+//           reportStep = reporting time step (sec)
+//           startDate = date of the period before the first one;
+//           returns an error code
+//  Purpose: retrieves the reporting times of a results file.
+//
+{
+    return outreader_getInfo((TOutReader *)rh, nPeriods, reportStep, startDate);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_results_count(SWMM_Results rh, int objType)
+//
+//  Input:   rh = a results reader
+//           objType = SUBCATCH, NODE or LINK
+//  Output:  returns number of reported objects of the type or an
+//           error code
+//  Purpose: retrieves the number of objects with results in the file.
+//
+{
+    return outreader_getCount((TOutReader *)rh, objType);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_results_index(SWMM_Results rh, int objType, char* id)
+//
+//  Input:   rh = a results reader
+//           objType = SUBCATCH, NODE or LINK
+//           id = ID name of an object
+//  Output:  returns index of the object in the file or an error code
+//  Purpose: finds the position of an object among the reported
+//           objects of its type.
+//
+{
+    return outreader_getIndex((TOutReader *)rh, objType, id);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_results_dates(SWMM_Results rh, int first, int n, double* dates)
+//
+//  Input:   rh = a results reader
+//           first = index of the first period (starting from 0)
+//           n = number of periods
+//  Output:  dates = date/time of each period;
+//           returns an error code
+//  Purpose: retrieves the dates of a range of reporting periods.
+//
+{
+    return outreader_getDates((TOutReader *)rh, first, n, dates);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_results_series(SWMM_Results rh, int objType, int index, int variable, int first, int n, float* values)
+//
+//  Input:   rh = a results reader
+//           objType = SUBCATCH, NODE or LINK
+//           index = index of the object in the file
+//           variable = index of the output variable
+//           first = index of the first period (starting from 0)
+//           n = number of periods
+//  Output:  values = value of the variable in each period;
+//           returns an error code
+//  Purpose: retrieves the time series of an object's variable.
+//
+{
+    return outreader_getSeries((TOutReader *)rh, objType, index, variable, first, n, values);
+}
+
+//=============================================================================
+
+int DLLEXPORT swmm_results_view(SWMM_Results rh, int objType, int index, int variable, float** values, int* stride)
+//
+//  Input:   rh = a results reader
+//           objType = SUBCATCH, NODE or LINK
+//           index = index of the object in the file
+//           variable = index of the output variable
+//  Output:  values = address of the value in the first period
+//           stride = number of floats between consecutive periods;
+//           returns an error code
+//  Purpose: gives zero-copy access to the time series of an object's
+//           variable (valid until the reader is closed).
+//
+{
+    return outreader_getView((TOutReader *)rh, objType, index, variable, values, stride);
+}
+//=============================================================================
+
+void runController(double routingStep)
+//
+//  Input:   routingStep = routing time step about to be taken (sec)
+//  Output:  none
+//  Purpose: calls the project's native controller.
+//
+{
+    TProject* project = Project;
+    char      s[32];
+    int       result;
+
+    result = Controller((SWMM_Project)project, NewRoutingTime / MSECperDAY,
+                        routingStep, ControllerData);
+
+    // --- the controller may have worked on other projects
+    Project = project;
+    if ( result != 0 )
+    {
+        sprintf(s, "%d", result);
+        report_writeErrorMsg(ERR_CONTROLLER, s);
+    }
+}
+
+//=============================================================================
+
+void closeControllerLibrary()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: unloads the library a native controller was loaded from.
+//
+{
+    if ( ControllerLibrary == NULL ) return;
+#ifdef WINDOWS
+    FreeLibrary((HMODULE)ControllerLibrary);
+#else
+    dlclose(ControllerLibrary);
+#endif
+    ControllerLibrary = NULL;
+    Controller = NULL;
+}
+
 //=============================================================================
 //   General purpose functions
 //=============================================================================
@@ -31,16 +31,50 @@
   #define DLLEXPORT
 #endif
 
+#include <stddef.h>                    // size_t
+
 // --- use "C" linkage for C++ programs
 
 #ifdef __cplusplus
 extern "C" { 
 #endif 
 
+// --- opaque handle to an independent SWMM project
+
+typedef void* SWMM_Project;
+
+// --- opaque handle to the binary output file of a finished run
+
+typedef void* SWMM_Results;
+
+// --- opaque handle to an in-memory copy of a running simulation's state
+
+typedef void* SWMM_State;
+
+// --- native controller called inside swmm_step before each routing step it
+//     is due, with the project's handle, the elapsed time (days), the routing
+//     step about to be taken (sec) and the registered user data; it can read
+//     the project's state with swmm_get_many_r and change link settings with
+//     swmm_modify_settings_r, and returns 0 to let the simulation continue
+
+typedef int (*SWMM_Controller)(SWMM_Project ph, double elapsedTime,
+                               double routingStep, void* userData);
+
 int  DLLEXPORT   swmm_run(char* f1, char* f2, char* f3);
 int  DLLEXPORT   swmm_open(char* f1, char* f2, char* f3);
+int  DLLEXPORT   swmm_openFromBuffer(const char* inpText, size_t len,
+                 char* f2, char* f3);
 int  DLLEXPORT   swmm_start(int saveFlag);
 int  DLLEXPORT   swmm_step(double* elapsedTime);
+// swmm_stepUntil & swmm_stepUntilEvent always take at least one routing
+// step, even if targetElapsedTime has already been reached. The n watched
+// values (whose objTypes, indices, attributes & thresholds arrays must not
+// be NULL if n > 0) are checked against their thresholds after each step.
+int  DLLEXPORT   swmm_stepUntil(double targetElapsedTime, double* elapsedTime);
+int  DLLEXPORT   swmm_stepUntilEvent(double targetElapsedTime, int n,
+                 int* objTypes, int* indices, int* attributes,
+                 double* thresholds, int units, double* elapsedTime,
+                 int* event);
 int  DLLEXPORT   swmm_end(void);
 int  DLLEXPORT   swmm_report(void);
 int  DLLEXPORT   swmm_getMassBalErr(float* runoffErr, float* flowErr,
@@ -49,15 +83,70 @@ int  DLLEXPORT   swmm_close(void);
 int  DLLEXPORT   swmm_getVersion(void);
 int  DLLEXPORT   swmm_getError(char* errMsg, int msgLen);                      //(5.1.011)
 int  DLLEXPORT   swmm_getWarnings(void);                                       //(5.1.011)
+int  DLLEXPORT   swmm_saveState(SWMM_State* state);
+int  DLLEXPORT   swmm_restoreState(SWMM_State state);
+int  DLLEXPORT   swmm_deleteState(SWMM_State state);
+
+// Re-entrant versions that operate on a project created by swmm_createProject
+// (a given project may only be used by one thread at a time)
+int  DLLEXPORT   swmm_createProject(SWMM_Project* ph);
+int  DLLEXPORT   swmm_deleteProject(SWMM_Project ph);
+int  DLLEXPORT   swmm_run_r(SWMM_Project ph, char* f1, char* f2, char* f3);
+int  DLLEXPORT   swmm_open_r(SWMM_Project ph, char* f1, char* f2, char* f3);
+int  DLLEXPORT   swmm_openFromBuffer_r(SWMM_Project ph, const char* inpText,
+                 size_t len, char* f2, char* f3);
+int  DLLEXPORT   swmm_start_r(SWMM_Project ph, int saveFlag);
+int  DLLEXPORT   swmm_step_r(SWMM_Project ph, double* elapsedTime);
+int  DLLEXPORT   swmm_stepUntil_r(SWMM_Project ph, double targetElapsedTime,
+                 double* elapsedTime);
+int  DLLEXPORT   swmm_stepUntilEvent_r(SWMM_Project ph,
+                 double targetElapsedTime, int n, int* objTypes,
+                 int* indices, int* attributes, double* thresholds,
+                 int units, double* elapsedTime, int* event);
+int  DLLEXPORT   swmm_end_r(SWMM_Project ph);
+int  DLLEXPORT   swmm_report_r(SWMM_Project ph);
+int  DLLEXPORT   swmm_getMassBalErr_r(SWMM_Project ph, float* runoffErr,
+                 float* flowErr, float* qualErr);
+int  DLLEXPORT   swmm_close_r(SWMM_Project ph);
+int  DLLEXPORT   swmm_getError_r(SWMM_Project ph, char* errMsg, int msgLen);
+int  DLLEXPORT   swmm_getWarnings_r(SWMM_Project ph);
+int  DLLEXPORT   swmm_saveState_r(SWMM_Project ph, SWMM_State* state);
+int  DLLEXPORT   swmm_restoreState_r(SWMM_Project ph, SWMM_State state);
 
 // Cosimulation getters
 double DLLEXPORT swmm_get( char* id, int attribute, int units );
 double DLLEXPORT swmm_get_from_input(char* filename, char *id, int attribute);
 int DLLEXPORT swmm_save_all(char* input_file, int object_type, int attribute);
+int DLLEXPORT swmm_get_index(char* id, int* objType);
+int DLLEXPORT swmm_get_many(int objType, int* idx, int n, int attribute, int units, double* out);
 // Cosimulation setters
 int DLLEXPORT swmm_modify_setting(char* id, double new_setting, double tstep);
+int DLLEXPORT swmm_modify_settings(int* idx, double* settings, int n, double tstep);
 int DLLEXPORT swmm_modify_input(char* input_file, char *id, int attribute, double value);
+// Native controller called inside swmm_step
+int DLLEXPORT swmm_set_controller(SWMM_Controller controller, void* userData, int interval);
+int DLLEXPORT swmm_load_controller(char* library, char* function, int interval);
 int DLLEXPORT swmm_save_results();
+int DLLEXPORT swmm_save_results_columns(char* path);
+// Re-entrant cosimulation functions
+double DLLEXPORT swmm_get_r(SWMM_Project ph, char* id, int attribute, int units);
+int DLLEXPORT swmm_get_index_r(SWMM_Project ph, char* id, int* objType);
+int DLLEXPORT swmm_get_many_r(SWMM_Project ph, int objType, int* idx, int n, int attribute, int units, double* out);
+int DLLEXPORT swmm_modify_setting_r(SWMM_Project ph, char* id, double new_setting, double tstep);
+int DLLEXPORT swmm_modify_settings_r(SWMM_Project ph, int* idx, double* settings, int n, double tstep);
+int DLLEXPORT swmm_set_controller_r(SWMM_Project ph, SWMM_Controller controller, void* userData, int interval);
+int DLLEXPORT swmm_load_controller_r(SWMM_Project ph, char* library, char* function, int interval);
+int DLLEXPORT swmm_save_results_r(SWMM_Project ph);
+int DLLEXPORT swmm_save_results_columns_r(SWMM_Project ph, char* path);
+// Memory-mapped reader of a binary output file (does not need an open project)
+int DLLEXPORT swmm_open_results(char* outFile, SWMM_Results* rh);
+int DLLEXPORT swmm_close_results(SWMM_Results rh);
+int DLLEXPORT swmm_results_info(SWMM_Results rh, int* nPeriods, int* reportStep, double* startDate);
+int DLLEXPORT swmm_results_count(SWMM_Results rh, int objType);
+int DLLEXPORT swmm_results_index(SWMM_Results rh, int objType, char* id);
+int DLLEXPORT swmm_results_dates(SWMM_Results rh, int first, int n, double* dates);
+int DLLEXPORT swmm_results_series(SWMM_Results rh, int objType, int index, int variable, int first, int n, float* values);
+int DLLEXPORT swmm_results_view(SWMM_Results rh, int objType, int index, int variable, float** values, int* stride);
 
 #ifdef __cplusplus 
 }   // matches the linkage specification from above */ 
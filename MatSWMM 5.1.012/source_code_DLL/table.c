@@ -13,6 +13,14 @@
 //   Curve and Time Series objects in SWMM 5 are both modeled with
 //   TTable data structures.
 //
+//   A table's x and y values are stored in a pair of arrays. A time series
+//   whose data come from an external file is read into these arrays when it
+//   is validated. Curve lookups locate x (or y, for inverse lookups on
+//   y-values that never decrease) by binary search and the areas under a
+//   curve are tabulated once when it is validated. Time series
+//   lookups keep a cursor on the current time bracket so that advancing
+//   time usually moves it by a single entry.
+//
 //   The table_getFirstEntry and table_getNextEntry functions, as well as the
 //   Time Series functions that use them, are not thread safe.
 //
@@ -30,9 +38,16 @@
 #include <string.h>
 #include "headers.h"
 
+//-----------------------------------------------------------------------------
+//  Constants
+//-----------------------------------------------------------------------------
+static const int INIT_POINTS = 16;     // initial size of a table's arrays
+
 //-----------------------------------------------------------------------------
 //  Local functions
 //-----------------------------------------------------------------------------
+static int setAreas(TTable* table);
+static int findEntry(double* v, int first, int last, double x);
 int    table_getNextFileEntry(TTable* table, double* x, double* y);
 int    table_parseFileLine(char* line, TTable* table, double* x, double* y);
 double table_interpolate(double x, double x1, double y1, double x2, double y2);//(5.1.008)
@@ -203,15 +218,28 @@ int table_addEntry(TTable* table, double x, double y)
 //  Purpose: adds a new x/y entry to a table.
 //
 {
-    TTableEntry *entry;
-    entry = (TTableEntry *) malloc(sizeof(TTableEntry));
-    if ( !entry ) return FALSE;
-    entry->x = x;
-    entry->y = y;
-    entry->next = NULL;
-    if ( table->firstEntry == NULL )  table->firstEntry = entry;
-    else table->lastEntry->next = entry;
-    table->lastEntry = entry;
+    int     n;
+    double* xData;
+    double* yData;
+
+    // --- enlarge the table's data arrays if they are full
+    if ( table->nPoints == table->maxPoints )
+    {
+        n = MAX(2*table->maxPoints, INIT_POINTS);
+        xData = (double *) realloc(table->xData, n * sizeof(double));
+        if ( !xData ) return FALSE;
+        table->xData = xData;
+        yData = (double *) realloc(table->yData, n * sizeof(double));
+        if ( !yData ) return FALSE;
+        table->yData = yData;
+        table->maxPoints = n;
+    }
+
+    // --- append the new entry
+    n = table->nPoints;
+    table->xData[n] = x;
+    table->yData[n] = y;
+    table->nPoints++;
     return TRUE;
 }
 
@@ -224,18 +252,14 @@ void   table_deleteEntries(TTable *table)
 //  Purpose: deletes all x/y entries in a table.
 //
 {
-    TTableEntry *entry;
-    TTableEntry *nextEntry;
-    entry = table->firstEntry;
-    while (entry)
-    {
-        nextEntry = entry->next;
-        free(entry);
-        entry = nextEntry;
-    }
-    table->firstEntry = NULL;
-    table->lastEntry  = NULL;
-    table->thisEntry  = NULL;
+    FREE(table->xData);
+    FREE(table->yData);
+    FREE(table->areas);
+    FREE(table->invAreas);
+    table->nPoints = 0;
+    table->maxPoints = 0;
+    table->thisEntry = -1;
+    table->yAscending = FALSE;
 
     if (table->file.file)
     { 
@@ -255,9 +279,14 @@ void   table_init(TTable *table)
 {
     table->ID = NULL;
     table->refersTo = -1;
-    table->firstEntry = NULL;
-    table->lastEntry = NULL;
-    table->thisEntry = table->firstEntry;
+    table->nPoints = 0;
+    table->maxPoints = 0;
+    table->thisEntry = -1;
+    table->yAscending = FALSE;
+    table->xData = NULL;
+    table->yData = NULL;
+    table->areas = NULL;
+    table->invAreas = NULL;
     table->lastDate = 0.0;
     table->x1 = 0.0;
     table->x2 = 0.0;
@@ -277,27 +306,35 @@ int   table_validate(TTable *table)
 //  Output:  returns error code
 //  Purpose: checks that table's x-values are in ascending order.
 //
+//  NOTE: the data of a time series stored in an external file are read
+//        into the table here, after which the file is closed.
+//
 {
-    int    result;
-    double x1, x2, y1, y2;
+    int    i;
+    double x, y;
+    double x1, x2;
     double dx, dxMin = BIG;
 
-    // --- open external file if used as the table's data source
+    // --- read all data from the external file used as the table's source
     if ( table->file.mode == USE_FILE )
     {
         table->file.file = fopen(table->file.name, "rt");
         if ( table->file.file == NULL ) return ERR_TABLE_FILE_OPEN;
-    }
-
-    // --- retrieve the first data entry in the table
-    result = table_getFirstEntry(table, &x1, &y1);
+        table->nPoints = 0;
+        while ( table_getNextFileEntry(table, &x, &y) )
+        {
+            if ( !table_addEntry(table, x, y) ) return ERR_MEMORY;
+        }
 
-    // --- return error condition if external file has no valid data
-    if ( !result && table->file.mode == USE_FILE ) return ERR_TABLE_FILE_READ;
+        // --- return error condition if external file has no valid data
+        if ( table->nPoints == 0 ) return ERR_TABLE_FILE_READ;
+    }
 
-    // --- retrieve successive table entries and check for non-increasing x-values
-    while ( table_getNextEntry(table, &x2, &y2) )
+    // --- check successive table entries for non-increasing x-values
+    for ( i = 1; i < table->nPoints; i++ )
     {
+        x1 = table->xData[i-1];
+        x2 = table->xData[i];
         dx = x2 - x1;
         if ( dx <= 0.0 )
         {
@@ -305,18 +342,116 @@ int   table_validate(TTable *table)
             return ERR_CURVE_SEQUENCE;
         }
         dxMin = MIN(dxMin, dx);
-        x1 = x2;
     }
     table->dxMin = dxMin;
 
+    // --- note if the y-values never decrease (so that table_inverseLookup
+    //     can search them by bisection)
+    table->yAscending = TRUE;
+    for ( i = 1; i < table->nPoints; i++ )
+    {
+        if ( table->yData[i] < table->yData[i-1] )
+        {
+            table->yAscending = FALSE;
+            break;
+        }
+    }
+
     // --- return error if external file could not be read completely
-    if ( table->file.mode == USE_FILE && !feof(table->file.file) )
-        return ERR_TABLE_FILE_READ;
+    if ( table->file.mode == USE_FILE )
+    {
+        if ( !feof(table->file.file) ) return ERR_TABLE_FILE_READ;
+        fclose(table->file.file);
+        table->file.file = NULL;
+    }
+
+    // --- tabulate the areas under a curve
+    if ( table->curveType >= 0 && table->nPoints > 0 )
+    {
+        if ( !setAreas(table) ) return ERR_MEMORY;
+    }
     return 0;
 }
 
 //=============================================================================
 
+int setAreas(TTable *table)
+//
+//  Input:   table = pointer to a TTable structure
+//  Output:  returns TRUE if successful, FALSE if not
+//  Purpose: tabulates the area under a curve up to each of its data points
+//           for use by table_getArea and table_getInverseArea.
+//
+//  NOTE: the areas are summed exactly as the area functions would sum them
+//        when walking the table from its first entry.
+//
+{
+    int     i;
+    int     n = table->nPoints;
+    double* x = table->xData;
+    double* y = table->yData;
+    double* a;
+    double* b;
+    double  dx, dy;
+
+    a = (double *) calloc(n, sizeof(double));
+    b = (double *) calloc(n, sizeof(double));
+    if ( !a || !b )
+    {
+        FREE(a);
+        FREE(b);
+        return FALSE;
+    }
+    a[0] = y[0]*x[0]/2.0;
+    b[0] = a[0];
+    for ( i = 1; i < n; i++ )
+    {
+        dx = x[i] - x[i-1];
+        dy = y[i] - y[i-1];
+        a[i] = a[i-1] + (y[i-1] + y[i]) * dx / 2.0;
+        b[i] = b[i-1] + y[i-1]*dx + dy*dx/2.0;
+    }
+
+    // --- a search on the areas summed for the inverse lookup requires
+    //     that they never decrease
+    for ( i = 1; i < n; i++ )
+    {
+        if ( b[i] < b[i-1] )
+        {
+            FREE(b);
+            break;
+        }
+    }
+    table->areas = a;
+    table->invAreas = b;
+    return TRUE;
+}
+
+//=============================================================================
+
+int findEntry(double* v, int first, int last, double x)
+//
+//  Input:   v = array of non-decreasing values
+//           first = index of first entry searched
+//           last = index one past the last entry searched
+//           x = value being located
+//  Output:  returns index of first entry in v[first..last-1] that is >= x,
+//           or last if there is none
+//  Purpose: locates a value in an ordered array by binary search.
+//
+{
+    int k;
+    while ( first < last )
+    {
+        k = first + (last - first) / 2;
+        if ( x <= v[k] ) last = k;
+        else first = k + 1;
+    }
+    return first;
+}
+
+//=============================================================================
+
 int table_getFirstEntry(TTable *table, double *x, double *y)
 //
 //  Input:   table = pointer to a TTable structure
@@ -328,26 +463,13 @@ int table_getFirstEntry(TTable *table, double *x, double *y)
 //  NOTE: also moves the current position pointer (thisEntry) to the 1st entry.
 //
 {
-    TTableEntry *entry;
     *x = 0;
     *y = 0.0;
-
-    if ( table->file.mode == USE_FILE )
-    {
-        if ( table->file.file == NULL ) return FALSE;
-        rewind(table->file.file);
-        return table_getNextFileEntry(table, x, y);
-    }
-
-    entry = table->firstEntry;
-    if ( entry )
-    {
-        *x = entry->x;
-        *y = entry->y;
-        table->thisEntry = entry;
-        return TRUE;
-    }
-    else return FALSE;
+    if ( table->nPoints == 0 ) return FALSE;
+    *x = table->xData[0];
+    *y = table->yData[0];
+    table->thisEntry = 0;
+    return TRUE;
 }
 
 //=============================================================================
@@ -363,20 +485,12 @@ int table_getNextEntry(TTable *table, double *x, double *y)
 //  NOTE: also updates the current position pointer (thisEntry).
 //
 {
-    TTableEntry *entry;
-
-    if ( table->file.mode == USE_FILE )
-        return table_getNextFileEntry(table, x, y);
-    
-    entry = table->thisEntry->next;
-    if ( entry )
-    {
-        *x = entry->x;
-        *y = entry->y;
-        table->thisEntry = entry;
-        return TRUE;
-    }
-    else return FALSE;
+    int k = table->thisEntry + 1;
+    if ( k >= table->nPoints ) return FALSE;
+    *x = table->xData[k];
+    *y = table->yData[k];
+    table->thisEntry = k;
+    return TRUE;
 }
 
 //=============================================================================
@@ -396,24 +510,16 @@ double table_lookup(TTable *table, double x)
 //        returned.
 //
 {
-    double x1,y1,x2,y2;
-    TTableEntry* entry;
-
-    entry = table->firstEntry;
-    if ( entry == NULL ) return 0.0;
-    x1 = entry->x;
-    y1 = entry->y;
-    if ( x <= x1 ) return y1;
-    while ( entry->next )
-    {
-        entry = entry->next;
-        x2 = entry->x;
-        y2 = entry->y;
-        if ( x <= x2 ) return table_interpolate(x, x1, y1, x2, y2);
-        x1 = x2;
-        y1 = y2;
-    }
-    return y1;
+    int     k;
+    int     n = table->nPoints;
+    double* xData = table->xData;
+    double* yData = table->yData;
+
+    if ( n == 0 ) return 0.0;
+    if ( x <= xData[0] ) return yData[0];
+    k = findEntry(xData, 1, n, x);
+    if ( k == n ) return yData[n-1];
+    return table_interpolate(x, xData[k-1], yData[k-1], xData[k], yData[k]);
 }
 
 //=============================================================================
@@ -428,28 +534,18 @@ double table_getSlope(TTable *table, double x)
 //  Purpose: retrieves the slope of the curve at the line segment containing x.
 //
 {
-    double x1,y1,x2,y2;
-    double dx;
-    TTableEntry* entry;
-
-    entry = table->firstEntry;
-    if ( entry == NULL ) return 0.0;
-    x1 = entry->x;
-    y1 = entry->y;
-    x2 = x1;
-    y2 = y1;
-    while ( entry->next )
-    {
-        entry = entry->next;
-        x2 = entry->x;
-        y2 = entry->y;
-        if ( x <= x2 ) break;
-        x1 = x2;
-        y1 = y2;
-    }
-    dx = x2 - x1;
+    int     k;
+    int     n = table->nPoints;
+    double* xData = table->xData;
+    double* yData = table->yData;
+    double  dx;
+
+    if ( n < 2 ) return 0.0;
+    k = findEntry(xData, 1, n, x);
+    if ( k == n ) return 0.0;
+    dx = xData[k] - xData[k-1];
     if ( dx == 0.0 ) return 0.0;
-    return (y2 - y1) / dx;
+    return (yData[k] - yData[k-1]) / dx;
 }
 
 //=============================================================================
@@ -466,29 +562,29 @@ double table_lookupEx(TTable *table, double x)
 //           extrapolation outside of the table.
 //
 {
-    double x1,y1,x2,y2;
-    double s = 0.0;
-    TTableEntry* entry;
-
-    entry = table->firstEntry;
-    if (entry == NULL ) return 0.0;
-    x1 = entry->x;
-    y1 = entry->y;
+    int     k;
+    int     n = table->nPoints;
+    double* xData = table->xData;
+    double* yData = table->yData;
+    double  x1, y1;
+    double  s = 0.0;
+
+    if ( n == 0 ) return 0.0;
+    x1 = xData[0];
+    y1 = yData[0];
     if ( x <= x1 )
     {
         if (x1 > 0.0 ) return x/x1*y1;
         else return y1;
     }
-    while ( entry->next )
-    {
-        entry = entry->next;
-        x2 = entry->x;
-        y2 = entry->y;
-        if ( x2 != x1 ) s = (y2 - y1) / (x2 - x1);
-        if ( x <= x2 ) return table_interpolate(x, x1, y1, x2, y2);
-        x1 = x2;
-        y1 = y2;
-    }
+    k = findEntry(xData, 1, n, x);
+    if ( k < n )
+        return table_interpolate(x, xData[k-1], yData[k-1], xData[k], yData[k]);
+
+    // --- extrapolate along the last segment of the table
+    x1 = xData[n-1];
+    y1 = yData[n-1];
+    if ( n > 1 && x1 != xData[n-2] ) s = (y1 - yData[n-2]) / (x1 - xData[n-2]);
     if ( s < 0.0 ) s = 0.0;
     return y1 + s*(x - x1);
 }
@@ -506,17 +602,19 @@ double table_intervalLookup(TTable *table, double x)
 //           whose x-value is > x.
 //
 {
-    TTableEntry* entry;
+    int     first = 0;
+    int     last = table->nPoints;
+    int     k;
+    double* xData = table->xData;
 
-    entry = table->firstEntry;
-    if (entry == NULL ) return 0.0;
-    if ( x < entry->x ) return entry->y;
-    while ( entry->next )
+    if ( last == 0 ) return 0.0;
+    while ( first < last )
     {
-        entry = entry->next;
-        if ( x < entry->x ) return entry->y;
+        k = first + (last - first) / 2;
+        if ( x < xData[k] ) last = k;
+        else first = k + 1;
     }
-    return entry->y;
+    return table->yData[MIN(first, table->nPoints-1)];
 }
 
 //=============================================================================
@@ -536,24 +634,20 @@ double table_inverseLookup(TTable *table, double y)
 //        returned.
 //
 {
-    double x1,y1,x2,y2;
-    TTableEntry* entry;
-
-    entry = table->firstEntry;
-    if (entry == NULL ) return 0.0;
-    x1 = entry->x;
-    y1 = entry->y;
-    if ( y <= y1 ) return x1;
-    while ( entry->next )
-    {
-        entry = entry->next;
-        x2 = entry->x;
-        y2 = entry->y;
-        if ( y <= y2 ) return table_interpolate(y, y1, x1, y2, x2);
-        x1 = x2;
-        y1 = y2;
-    }
-    return x1;
+    int     k;
+    int     n = table->nPoints;
+    double* xData = table->xData;
+    double* yData = table->yData;
+
+    if ( n == 0 ) return 0.0;
+    if ( y <= yData[0] ) return xData[0];
+
+    // --- find the first entry whose y-value is at or above y (by
+    //     bisection if the y-values never decrease)
+    if ( table->yAscending ) k = findEntry(yData, 1, n, y);
+    else for ( k = 1; k < n && y > yData[k]; k++ );
+    if ( k == n ) return xData[n-1];
+    return table_interpolate(y, yData[k-1], xData[k-1], yData[k], xData[k]);
 }
 
 //=============================================================================
@@ -569,16 +663,15 @@ double  table_getMaxY(TTable *table, double x)
 //           portion of a table that appear before value x.
 //
 {
-    double ymax;
-    TTableEntry* entry;
+    int     k;
+    double  ymax;
 
-    entry = table->firstEntry;
-    ymax = entry->y;
-    while ( x > entry->x && entry->next )
+    if ( table->nPoints == 0 ) return 0.0;
+    ymax = table->yData[0];
+    for ( k = 1; k < table->nPoints && x > table->xData[k-1]; k++ )
     {
-        entry = entry->next;
-        if ( entry->y < ymax ) return ymax;
-        ymax = entry->y;
+        if ( table->yData[k] < ymax ) return ymax;
+        ymax = table->yData[k];
     }
     return 0.0;
 }
@@ -605,42 +698,46 @@ double  table_getArea(TTable* table, double x)
 //     a(i) = y(i)*dx + s*dx*dx/2
 //
 {
-    double x1, x2;
-    double y1, y2;
-    double dx = 0.0, dy = 0.0;
-    double a, s = 0.0;
-    TTableEntry* entry;
-
-    // --- get area up to first table entry
-    //     and see if x-value lies in this interval
-    entry = table->firstEntry;
-    if (entry == NULL ) return 0.0;
-    x1 = entry->x;
-    y1 = entry->y;
+    int     k;
+    int     n = table->nPoints;
+    double* xData = table->xData;
+    double* yData = table->yData;
+    double  x1, x2;
+    double  y1, y2;
+    double  dx = 0.0, dy = 0.0;
+    double  a, s = 0.0;
+
+    // --- see if x-value lies below the first table entry
+    if ( n == 0 || table->areas == NULL ) return 0.0;
+    x1 = xData[0];
+    y1 = yData[0];
     if ( x1 > 0.0 ) s = y1/x1;
     if ( x <= x1 ) return s*x*x/2.0;
-    a = y1*x1/2.0;
-    
-    // --- add next table entry to area until target x-value is bracketed
-    while ( entry->next )
+
+    // --- add area within the interval that brackets x to that up to
+    //     the start of the interval
+    k = findEntry(xData, 1, n, x);
+    if ( k < n )
     {
-        entry = entry->next;
-        x2 = entry->x;
-        y2 = entry->y;
-        dx = x2 - x1;
-        dy = y2 - y1;
-        if ( x <= x2 )
-        {
-            if ( dx <= 0.0 ) return a;
-            y2 = table_interpolate(x, x1, y1, x2, y2);
-            return a + (x - x1) * (y1 + y2) / 2.0;
-        }
-        a += (y1 + y2) * dx / 2.0;
-        x1 = x2;
-        y1 = y2;
+        x1 = xData[k-1];
+        y1 = yData[k-1];
+        x2 = xData[k];
+        y2 = yData[k];
+        a = table->areas[k-1];
+        if ( x2 - x1 <= 0.0 ) return a;
+        y2 = table_interpolate(x, x1, y1, x2, y2);
+        return a + (x - x1) * (y1 + y2) / 2.0;
     }
 
     // --- extrapolate area if table limit exceeded
+    x1 = xData[n-1];
+    y1 = yData[n-1];
+    a = table->areas[n-1];
+    if ( n > 1 )
+    {
+        dx = x1 - xData[n-2];
+        dy = y1 - yData[n-2];
+    }
     if ( dx > 0.0 ) s = dy/dx;
     else s = 0.0;
     dx = x - x1;
@@ -661,17 +758,20 @@ double  table_getInverseArea(TTable* table, double a)
 //  Refer to table_getArea function to see how area is computed.
 //
 {
-    double x1, x2;
-    double y1, y2;
-    double dx = 0.0, dy = 0.0;
-    double a1, a2, s;
-    TTableEntry* entry;
+    int     k;
+    int     n = table->nPoints;
+    double* xData = table->xData;
+    double* yData = table->yData;
+    double* invAreas = table->invAreas;
+    double  x1, x2;
+    double  y1, y2;
+    double  dx = 0.0, dy = 0.0;
+    double  a1, a2, s;
 
     // --- see if target area is below that of 1st table entry
-    entry = table->firstEntry;
-    if (entry == NULL ) return 0.0;
-    x1 = entry->x;
-    y1 = entry->y;
+    if ( n == 0 ) return 0.0;
+    x1 = xData[0];
+    y1 = yData[0];
     a1 = y1*x1/2.0;
     if ( a <= a1 )
     {
@@ -679,42 +779,65 @@ double  table_getInverseArea(TTable* table, double a)
         else return 0.0;
     }
 
-    // --- add next table entry to area until target area is bracketed
-    while ( entry->next )
+    // --- find the table interval that brackets the target area
+    if ( invAreas ) k = findEntry(invAreas, 1, n, a);
+    else
+    {
+        a2 = a1;
+        for ( k = 1; k < n; k++ )
+        {
+            a1 = a2;
+            dx = xData[k] - xData[k-1];
+            dy = yData[k] - yData[k-1];
+            a2 = a2 + yData[k-1]*dx + dy*dx/2.0;
+            if ( a <= a2 ) break;
+        }
+    }
+
+    // --- interpolate within the interval
+    if ( k < n )
     {
-        entry = entry->next;
-        x2 = entry->x;
-        y2 = entry->y;
+        x1 = xData[k-1];
+        y1 = yData[k-1];
+        x2 = xData[k];
+        y2 = yData[k];
         dx = x2 - x1;
         dy = y2 - y1;
-        a2 = a1 + y1*dx + dy*dx/2.0;
-        if ( a <= a2 )
+        if ( invAreas )
         {
-            if ( dx <= 0.0 ) return x1;
-            if ( dy == 0.0 )
-            {
-                if ( a2 == a1 ) return x1;
-                else return x1 + dx * (a - a1) / (a2 - a1);
-            }
-
-            // --- if y decreases with x then replace point 1 with point 2
-            if ( dy < 0.0 )
-            {
-                x1 = x2;
-                y1 = y2;
-                a1 = a2;
-            }
+            a1 = invAreas[k-1];
+            a2 = invAreas[k];
+        }
+        if ( dx <= 0.0 ) return x1;
+        if ( dy == 0.0 )
+        {
+            if ( a2 == a1 ) return x1;
+            else return x1 + dx * (a - a1) / (a2 - a1);
+        }
 
-            s = dy/dx;
-            dx = (sqrt(y1*y1 + 2.0*s*(a-a1)) - y1) / s;
-            return x1 + dx;
+        // --- if y decreases with x then replace point 1 with point 2
+        if ( dy < 0.0 )
+        {
+            x1 = x2;
+            y1 = y2;
+            a1 = a2;
         }
-        x1 = x2;
-        y1 = y2;
-        a1 = a2;
+
+        s = dy/dx;
+        dx = (sqrt(y1*y1 + 2.0*s*(a-a1)) - y1) / s;
+        return x1 + dx;
     }
 
     // --- extrapolate area if table limit exceeded
+    x1 = xData[n-1];
+    y1 = yData[n-1];
+    if ( n > 1 )
+    {
+        dx = x1 - xData[n-2];
+        dy = y1 - yData[n-2];
+    }
+    if ( invAreas ) a1 = invAreas[n-1];
+    else a1 = a2;
     if ( dx == 0.0 || dy == 0.0 )
     {
         if ( y1 > 0.0 ) dx = (a - a1) / y1;
@@ -760,44 +883,56 @@ double table_tseriesLookup(TTable *table, double x, char extend)
 //        returned.
 //
 {
+    int     k;
+    int     n = table->nPoints;
+    double* xData = table->xData;
+    double* yData = table->yData;
+
     // --- x lies within current time bracket
     if ( table->x1 <= x
     &&   table->x2 >= x
     &&   table->x1 != table->x2 )
     return table_interpolate(x, table->x1, table->y1, table->x2, table->y2);
 
-    // --- x lies before current time bracket:
-    //     move to start of time series
-    if ( table->x1 == table->x2 || x < table->x1 )
+    // --- x lies before start of time series
+    if ( n == 0 ) return 0.0;
+    if ( x < xData[0] )
     {
-        table_getFirstEntry(table, &(table->x1), &(table->y1));
-        if ( x < table->x1 )
-        {
-            if ( extend == TRUE ) return table->y1;
-            else return 0;
-        }
+        if ( extend == TRUE ) return yData[0];
+        else return 0.0;
     }
 
-    // --- x lies beyond current time bracket:
-    //     update start of next time bracket
-    table->x1 = table->x2;
-    table->y1 = table->y2;
-
-    // --- get end of next time bracket
-    while ( table_getNextEntry(table, &(table->x2), &(table->y2)) )
+    // --- find the entry that ends the time bracket containing x, looking
+    //     first at the one after the current bracket (the usual case when
+    //     time advances) and otherwise searching the part of the series
+    //     on the side of the current bracket where x lies
+    k = table->thisEntry;
+    if ( k < 0 || k >= n ) k = findEntry(xData, 1, n, x);
+    else if ( x > xData[k] )
     {
-        // --- x lies within the bracket
-        if ( x <= table->x2 )
-            return table_interpolate(x, table->x1, table->y1,
-                                        table->x2, table->y2);
-        // --- otherwise move to next time bracket
-        table->x1 = table->x2;
-        table->y1 = table->y2;
+        if ( k+1 < n && x <= xData[k+1] ) k = k+1;
+        else k = findEntry(xData, k+1, n, x);
     }
+    else k = findEntry(xData, 1, k+1, x);
 
     // --- return last value or 0 if beyond last data value
-    if ( extend == TRUE ) return table->y1;
-    else return 0.0;
+    if ( k >= n || n == 1 )
+    {
+        table->x1 = table->x2 = xData[n-1];
+        table->y1 = table->y2 = yData[n-1];
+        table->thisEntry = n-1;
+        if ( extend == TRUE ) return yData[n-1];
+        else return 0.0;
+    }
+
+    // --- update the time bracket and interpolate within it
+    k = MAX(k, 1);
+    table->x1 = xData[k-1];
+    table->y1 = yData[k-1];
+    table->x2 = xData[k];
+    table->y2 = yData[k];
+    table->thisEntry = k;
+    return table_interpolate(x, table->x1, table->y1, table->x2, table->y2);
 }
 
 //=============================================================================
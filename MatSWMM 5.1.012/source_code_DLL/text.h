@@ -103,6 +103,13 @@
 #define  w_IGNORE_RDII       "IGNORE_RDII"                                     //(5.1.004)
 #define  w_MIN_ROUTE_STEP    "MINIMUM_STEP"                                    //(5.1.008)
 #define  w_NUM_THREADS       "THREADS"                                         //(5.1.008)
+#define  w_DYNWAVE_METHOD    "DYNWAVE_METHOD"
+#define  w_STEP_CLASSES      "STEP_CLASSES"
+#define  w_XSECT_TABLES      "XSECT_TABLES"
+#define  w_RENUMBERING       "RENUMBERING"
+#define  w_ACTIVE_SET_TOL    "ACTIVE_SET_TOL"
+#define  w_DYNWAVE_PREDICTOR "DYNWAVE_PREDICTOR"
+#define  w_EXPORT_BUFFER     "EXPORT_BUFFER"
 
 // Flow Units
 #define  w_CFS               "CFS"
@@ -234,6 +241,18 @@
 #define  w_H_W               "H-W"
 #define  w_D_W               "D-W" 
 
+// Dynamic Wave Solution Methods
+#define  w_PICARD            "PICARD"
+#define  w_NEWTON            "NEWTON"
+#define  w_ANDERSON          "ANDERSON"
+
+// Dynamic Wave Predictors
+#define  w_LINEAR            "LINEAR"
+#define  w_QUADRATIC         "QUADRATIC"
+
+// Node & Link Renumbering Methods
+#define  w_RCM               "RCM"
+
 // Link Offset Options
 #define  w_ELEVATION         "ELEVATION"
 
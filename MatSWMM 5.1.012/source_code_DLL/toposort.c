@@ -7,6 +7,12 @@
 //   Author:   L. Rossman
 //
 //   Topological sorting of conveyance network links
+//
+//   For Steady Flow and Kinematic Wave routing the sorted links are also
+//   grouped into a level schedule. Each node is placed one level below
+//   the lowest of the nodes that drain to it, so the nodes on a level
+//   (and the links leaving them) can be routed independently of one
+//   another once all of the levels above them have been.
 //-----------------------------------------------------------------------------
 #define _CRT_SECURE_NO_DEPRECATE
 
@@ -21,25 +27,27 @@ enum AdjListType {UNDIRECTED, DIRECTED};    // type of nodal adjacency list
 //-----------------------------------------------------------------------------
 //  Shared variables
 //-----------------------------------------------------------------------------
-static int* InDegree;                  // number of incoming links to each node
-static int* StartPos;                  // start of a node's outlinks in AdjList
-static int* AdjList;                   // list of outlink indexes for each node
-static int* Stack;                     // array of nodes "reached" during sorting
-static int  First;                     // position of first node in stack
-static int  Last;                      // position of last node added to stack
-
-static char* Examined;                 // TRUE if node included in spanning tree
-static char* InTree;                   // state of each link in spanning tree:
+static THREADLOCAL int* InDegree;                  // number of incoming links to each node
+static THREADLOCAL int* StartPos;                  // start of a node's outlinks in AdjList
+static THREADLOCAL int* AdjList;                   // list of outlink indexes for each node
+static THREADLOCAL int* Stack;                     // array of nodes "reached" during sorting
+static THREADLOCAL int  First;                     // position of first node in stack
+static THREADLOCAL int  Last;                      // position of last node added to stack
+
+static THREADLOCAL char* Examined;                 // TRUE if node included in spanning tree
+static THREADLOCAL char* InTree;                   // state of each link in spanning tree:
                                        // 0 = unexamined,
                                        // 1 = in spanning tree,
                                        // 2 = chord of spanning tree
-static int*  LoopLinks;                // list of links which forms a loop
-static int   LoopLinksLast;            // number of links in a loop
+static THREADLOCAL int*  LoopLinks;                // list of links which forms a loop
+static THREADLOCAL int   LoopLinksLast;            // number of links in a loop
 
 //-----------------------------------------------------------------------------
 //  External functions (declared in funcs.h)   
 //-----------------------------------------------------------------------------
-//  toposort_sortLinks (called by routing_open)
+//  toposort_sortLinks   (called by routing_open)
+//  toposort_findLevels  (called by routing_open)
+//  toposort_freeLevels  (called by routing_close)
 
 //-----------------------------------------------------------------------------
 //  Local functions
@@ -136,6 +144,108 @@ void toposort_sortLinks(int sortedLinks[])
 
 //=============================================================================
 
+int toposort_findLevels(int sortedLinks[], TLinkLevels* levels)
+//
+//  Input:   sortedLinks = array of link indexes in sorted order
+//  Output:  levels = level schedule of the sorted links;
+//           returns FALSE if memory could not be allocated
+//  Purpose: groups the nodes of a tree-like network into levels that can
+//           each be routed in parallel.
+//
+{
+    int  i, j, k, n;
+    int  nNodes = Nobjects[NODE];
+    int  nLinks = Nobjects[LINK];
+    int* level;                        // level of each node
+    int* next;                         // next free position in a list
+
+    levels->nLevels = 0;
+    levels->nodes = (int *) calloc(nNodes + 1, sizeof(int));
+    levels->outletStart = (int *) calloc(nNodes + 1, sizeof(int));
+    levels->outletCount = (int *) calloc(nNodes + 1, sizeof(int));
+    levels->inletStart = (int *) calloc(nNodes + 1, sizeof(int));
+    levels->inlets = (int *) calloc(nLinks + 1, sizeof(int));
+    levels->levelStart = (int *) calloc(nNodes + 2, sizeof(int));
+    levels->steps = (double *) calloc(nNodes + 1, sizeof(double));
+    level = (int *) calloc(nNodes + 1, sizeof(int));
+    next = (int *) calloc(nNodes + 1, sizeof(int));
+    if ( !levels->nodes || !levels->outletStart || !levels->outletCount ||
+         !levels->inletStart || !levels->inlets || !levels->levelStart ||
+         !levels->steps || !level || !next )
+    {
+        FREE(level);
+        FREE(next);
+        return FALSE;
+    }
+
+    // --- a node's outlet links are next to each other in the sorted list
+    for (k = nLinks - 1; k >= 0; k--)
+    {
+        n = Link[sortedLinks[k]].node1;
+        levels->outletStart[n] = k;
+        levels->outletCount[n]++;
+    }
+
+    // --- list the links entering each node in sorted order and place each
+    //     node one level below the lowest node draining to it
+    for (k = 0; k < nLinks; k++)
+    {
+        levels->inletStart[Link[sortedLinks[k]].node2 + 1]++;
+    }
+    for (n = 0; n < nNodes; n++)
+    {
+        levels->inletStart[n+1] += levels->inletStart[n];
+        next[n] = levels->inletStart[n];
+    }
+    for (k = 0; k < nLinks; k++)
+    {
+        j = sortedLinks[k];
+        n = Link[j].node2;
+        levels->inlets[next[n]++] = j;
+        level[n] = MAX(level[n], level[Link[j].node1] + 1);
+    }
+
+    // --- order the nodes by level
+    for (n = 0; n < nNodes; n++)
+    {
+        levels->nLevels = MAX(levels->nLevels, level[n] + 1);
+        levels->levelStart[level[n] + 1]++;
+    }
+    for (i = 0; i < levels->nLevels; i++)
+    {
+        levels->levelStart[i+1] += levels->levelStart[i];
+        next[i] = levels->levelStart[i];
+    }
+    for (n = 0; n < nNodes; n++)
+    {
+        levels->nodes[next[level[n]]++] = n;
+    }
+    free(level);
+    free(next);
+    return TRUE;
+}
+
+//=============================================================================
+
+void toposort_freeLevels(TLinkLevels* levels)
+//
+//  Input:   levels = level schedule of sorted links
+//  Output:  none
+//  Purpose: frees the memory used by a level schedule.
+//
+{
+    FREE(levels->levelStart);
+    FREE(levels->nodes);
+    FREE(levels->outletStart);
+    FREE(levels->outletCount);
+    FREE(levels->inletStart);
+    FREE(levels->inlets);
+    FREE(levels->steps);
+    levels->nLevels = 0;
+}
+
+//=============================================================================
+
 void createAdjList(int listType)
 //
 //  Input:   lsitType = DIRECTED or UNDIRECTED
@@ -12,11 +12,16 @@
 //   Build 5.1.008:
 //   - A bug in evaluating recursive calls to treatment functions was fixed. 
 //
+//   Nodes whose treatment of a pollutant uses identical equations have them
+//   evaluated together in batches once all nodes have been mixed (see
+//   treatmnt_evalBatches), instead of one node at a time.
+//
 //-----------------------------------------------------------------------------
 #define _CRT_SECURE_NO_DEPRECATE
 
 #include <stdlib.h>
 #include <string.h>
+#include <omp.h>
 #include "headers.h"
 
 //-----------------------------------------------------------------------------
@@ -28,17 +33,33 @@ enum   ProcessVarType {pvHRT,          // hydraulic residence time
                        pvFLOW,         // flow rate
                        pvDEPTH,        // water height above invert
                        pvAREA};        // storage surface area
+static const int BatchSize = 64;       // max. nodes in a treatment batch
+
+//-----------------------------------------------------------------------------
+//  Data Structures
+//-----------------------------------------------------------------------------
+typedef struct TTreatBatch             // nodes whose treatment of a pollutant
+{                                      //   uses the same equation
+    int     pollut;                    // pollutant index
+    int     start;                     // first entry in TreatBatchNodes
+    int     count;                     // number of nodes in the batch
+} TTreatBatch;
 
 //-----------------------------------------------------------------------------
 //  Shared variables
 //-----------------------------------------------------------------------------
-static int     ErrCode;                // treatment error code
-static int     J;                      // index of node being analyzed
-static double  Dt;                     // curent time step (sec)
-static double  Q;                      // node inflow (cfs)
-static double  V;                      // node volume (ft3)
-static double* R;                      // array of pollut. removals
-static double* Cin;                    // node inflow concentrations
+static THREADLOCAL int     ErrCode;                // treatment error code
+static THREADLOCAL int     J;                      // index of node being analyzed
+static THREADLOCAL double  Dt;                     // curent time step (sec)
+static THREADLOCAL double  Q;                      // node inflow (cfs)
+static THREADLOCAL double* R;           // array of pollut. removals
+#define TreatRemovals    (Project->TreatRemovals)    // pollut. removals of each thread
+#define TreatInflows     (Project->TreatInflows)     // treated node inflows
+#define TreatBatches     (Project->TreatBatches)     // batches of treatment eqns.
+#define TreatBatchCount  (Project->TreatBatchCount)  // number of batches
+#define TreatBatchNodes  (Project->TreatBatchNodes)  // nodes of each batch
+#define TreatBatchSlots  (Project->TreatBatchSlots)  // most variables in a batch eqn.
+#define TreatBatchValues (Project->TreatBatchValues) // batch variables & results
 //static TTreatment* Treatment; // defined locally in treatmnt_treat()         //(5.1.008)
 
 //-----------------------------------------------------------------------------
@@ -49,15 +70,20 @@ static double* Cin;                    // node inflow concentrations
 //  treatmnt_readExpression (called from parseLine in input.c)
 //  treatmnt_delete         (called from deleteObjects in project.c)
 //  treatmnt_setInflow      (called from qualrout_execute)
-//  treatmnt_treat          (called from findNodeQual in qualrout.c)
+//  treatmnt_evalBatches    (called from qualrout_execute)
+//  treatmnt_treat          (called from qualrout_execute)
 
 //-----------------------------------------------------------------------------
 //  Local functions
 //-----------------------------------------------------------------------------
 static int    createTreatment(int node);
+static int    createBatches(void);
+static int    isBatchable(int node, int pollut);
+static void   setNode(int node, double tStep);
 static double getRemoval(int pollut);
 static int    getVariableIndex(char* s);
 static double getVariableValue(int varCode);
+static void   setThreadArrays(void);
 
 
 //=============================================================================
@@ -68,19 +94,42 @@ int  treatmnt_open(void)
 //  Output:  returns TRUE if successful, FALSE if not
 //  Purpose: allocates memory for computing pollutant removals by treatment.
 //
+//  NOTE: nodes are treated in parallel during water quality routing, so
+//        each thread gets its own removal array.
+//
 {
-    R = NULL;
-    Cin = NULL;
+    int j;
+    int n = MAX(NumThreads, 1) * Nobjects[POLLUT];
+
+    TreatRemovals = NULL;
+    TreatInflows = NULL;
+    TreatBatches = NULL;
+    TreatBatchCount = 0;
+    TreatBatchNodes = NULL;
+    TreatBatchSlots = 0;
+    TreatBatchValues = NULL;
     if ( Nobjects[POLLUT] > 0 )
     {
-        R = (double *) calloc(Nobjects[POLLUT], sizeof(double));
-        Cin = (double *) calloc(Nobjects[POLLUT], sizeof(double));
-        if ( R == NULL || Cin == NULL)
+        TreatRemovals = (double *) calloc(n, sizeof(double));
+        if ( TreatRemovals == NULL )
         {
             report_writeErrorMsg(ERR_MEMORY, "");
             return FALSE;
         }
     }
+
+    // --- inflows & batches are only needed if some node has treatment
+    for (j = 0; j < Nobjects[NODE]; j++)
+    {
+        if ( Node[j].treatment ) break;
+    }
+    if ( j == Nobjects[NODE] ) return TRUE;
+    TreatInflows = (double *) calloc(Nobjects[NODE], sizeof(double));
+    if ( TreatInflows == NULL || !createBatches() )
+    {
+        report_writeErrorMsg(ERR_MEMORY, "");
+        return FALSE;
+    }
     return TRUE;
 }
 
@@ -93,8 +142,12 @@ void treatmnt_close(void)
 //  Purpose: frees memory used for computing pollutant removals by treatment.
 //
 {
-    FREE(R);
-    FREE(Cin);
+    FREE(TreatRemovals);
+    FREE(TreatInflows);
+    FREE(TreatBatches);
+    FREE(TreatBatchNodes);
+    FREE(TreatBatchValues);
+    TreatBatchCount = 0;
 }
 
 //=============================================================================
@@ -177,7 +230,7 @@ void treatmnt_delete(int j)
 
 //=============================================================================
 
-void  treatmnt_setInflow(double qIn, double wIn[])
+void  treatmnt_setInflow(int j, double qIn, double wIn[])
 //
 //  Input:   j = node index
 //           qIn = flow inflow rate (cfs)
@@ -187,36 +240,92 @@ void  treatmnt_setInflow(double qIn, double wIn[])
 //
 {
     int    p;
+    TTreatment* treatment = Node[j].treatment;
+
+    if ( treatment == NULL ) return;
+    TreatInflows[j] = qIn;
     if ( qIn > 0.0 )
-        for (p = 0; p < Nobjects[POLLUT]; p++) Cin[p] = wIn[p]/qIn;
+        for (p = 0; p < Nobjects[POLLUT]; p++) treatment[p].cIn = wIn[p]/qIn;
     else
-        for (p = 0; p < Nobjects[POLLUT]; p++) Cin[p] = 0.0;
+        for (p = 0; p < Nobjects[POLLUT]; p++) treatment[p].cIn = 0.0;
 }
 
 //=============================================================================
 
-void  treatmnt_treat(int j, double q, double v, double tStep)
+void  treatmnt_evalBatches(double tStep)
+//
+//  Input:   tStep = routing time step (sec)
+//  Output:  none
+//  Purpose: evaluates the treatment equations that nodes share, a batch of
+//           nodes at a time.
+//
+//  NOTE: must be called by every thread of qualrout_execute's parallel
+//        region (which divide the batches between them) after the inflow
+//        of each treated node has been saved and its quality mixed.
+//
+{
+    int    b, i, j, k, n, p, nSlots;
+    double *values, *results;
+    MathExpr* equation;
+    TTreatBatch* batch;
+
+    if ( TreatBatchCount == 0 ) return;
+    values = TreatBatchValues +
+             omp_get_thread_num() * BatchSize * (TreatBatchSlots + 1);
+
+    #pragma omp for schedule(static)
+    for (b = 0; b < TreatBatchCount; b++)
+    {
+        batch = &TreatBatches[b];
+        p = batch->pollut;
+        n = batch->count;
+        equation = Node[TreatBatchNodes[batch->start]].treatment[p].equation;
+        nSlots = mathexpr_getSlotCount(equation);
+        results = values + nSlots * n;
+
+        // --- gather the values of the equation's variables at each node
+        for (i = 0; i < n; i++)
+        {
+            setNode(TreatBatchNodes[batch->start + i], tStep);
+            for (k = 0; k < nSlots; k++)
+            {
+                values[k*n + i] =
+                    getVariableValue(mathexpr_getSlotVariable(equation, k));
+            }
+        }
+
+        // --- evaluate the equation for all nodes at once
+        mathexpr_evalBatch(equation, n, values, results);
+        for (i = 0; i < n; i++)
+        {
+            j = TreatBatchNodes[batch->start + i];
+            Node[j].treatment[p].value = results[i];
+        }
+    }
+}
+
+//=============================================================================
+
+void  treatmnt_treat(int j, double tStep)
 //
 //  Input:   j     = node index
-//           q     = inflow to node (cfs)
-//           v     = volume of node (ft3)
 //           tStep = routing time step (sec)
 //  Output:  none
 //  Purpose: updates pollutant concentrations at a node after treatment.
 //
 {
     int    p;                          // pollutant index
+    double q;                          // inflow to node (cfs)
     double cOut;                       // concentration after treatment
     double massLost;                   // mass lost by treatment per time step
     TTreatment* treatment;             // pointer to treatment object          //(5.1.008)
 
     // --- set locally shared variables for node j
     if ( Node[j].treatment == NULL ) return;
+    setThreadArrays();
     ErrCode = 0;
-    J  = j;                            // current node
-    Dt = tStep;                        // current time step
-    Q  = q;                            // current inflow rate
-    V  = v;                            // current node volume
+    setNode(j, tStep);
+    q = Q;
 
     // --- initialze each removal to indicate no value 
     for ( p = 0; p < Nobjects[POLLUT]; p++) R[p] = -1.0;
@@ -238,6 +347,7 @@ void  treatmnt_treat(int j, double q, double v, double tStep)
     // --- check for error condition
     if ( ErrCode == ERR_CYCLIC_TREATMENT )
     {
+         #pragma omp critical
          report_writeErrorMsg(ERR_CYCLIC_TREATMENT, Node[J].ID);
     }
 
@@ -252,10 +362,10 @@ void  treatmnt_treat(int j, double q, double v, double tStep)
         if ( treatment->treatType == REMOVAL )                                 //(5.1.008)
         {
             // --- if no pollutant in inflow then cOut is current nodal concen.
-            if ( Cin[p] == 0.0 ) cOut = Node[j].newQual[p];
+            if ( treatment->cIn == 0.0 ) cOut = Node[j].newQual[p];
 
             // ---  otherwise apply removal to influent concen.
-            else cOut = (1.0 - R[p]) * Cin[p];
+            else cOut = (1.0 - R[p]) * treatment->cIn;
 
             // --- cOut can't be greater than mixture concen. at node
             //     (i.e., in case node is a storage unit) 
@@ -269,7 +379,7 @@ void  treatmnt_treat(int j, double q, double v, double tStep)
         }
 
         // --- mass lost must account for any initial mass in storage 
-        massLost = (Cin[p]*q*tStep + Node[j].oldQual[p]*Node[j].oldVolume - 
+        massLost = (treatment->cIn*q*tStep + Node[j].oldQual[p]*Node[j].oldVolume - 
                    cOut*(q*tStep + Node[j].oldVolume)) / tStep; 
         massLost = MAX(0.0, massLost); 
 
@@ -382,7 +492,7 @@ double getVariableValue(int varCode)
     {
         p = varCode - PVMAX;
         treatment = &Node[J].treatment[p];                                     //(5.1.008)
-        if ( treatment->treatType == REMOVAL ) return Cin[p];                  //(5.1.008)
+        if ( treatment->treatType == REMOVAL ) return treatment->cIn;          //(5.1.008)
         return Node[J].newQual[p];
     }
 
@@ -430,9 +540,11 @@ double  getRemoval(int p)
         return 0.0;
     }
 
-    // --- apply treatment eqn.
+    // --- apply treatment eqn. (batched eqns. were already evaluated
+    //     by treatmnt_evalBatches)
     treatment = &Node[J].treatment[p];                                         //(5.1.008)
-    r = mathexpr_eval(treatment->equation, getVariableValue);                  //(5.1.008)
+    if ( treatment->batched ) r = treatment->value;
+    else r = mathexpr_eval(treatment->equation, getVariableValue);             //(5.1.008)
     r = MAX(0.0, r);
 
     // --- case where treatment eqn. is for removal
@@ -452,3 +564,161 @@ double  getRemoval(int p)
 }
 
 //=============================================================================
+
+void setThreadArrays()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: points the removal array to the one belonging to the calling
+//           thread.
+//
+{
+    int k = omp_get_thread_num() * Nobjects[POLLUT];
+    R = TreatRemovals + k;
+}
+
+//=============================================================================
+
+void setNode(int j, double tStep)
+//
+//  Input:   j = node index
+//           tStep = routing time step (sec)
+//  Output:  none
+//  Purpose: makes node j the one whose treatment variables are evaluated.
+//
+{
+    J  = j;                            // current node
+    Dt = tStep;                        // current time step
+    Q  = TreatInflows[j];              // current inflow rate
+}
+
+//=============================================================================
+
+int isBatchable(int j, int p)
+//
+//  Input:   j = node index
+//           p = pollutant index
+//  Output:  returns TRUE if node j's treatment eqn. for pollutant p can be
+//           evaluated in a batch
+//
+//  NOTE: eqns. that use other pollutants' removals are left out since
+//        those removals are only known as each node is treated.
+//
+{
+    int k, n;
+    MathExpr* equation;
+
+    if ( Node[j].treatment == NULL ) return FALSE;
+    equation = Node[j].treatment[p].equation;
+    n = mathexpr_getSlotCount(equation);
+    if ( n < 0 ) return FALSE;
+    for (k = 0; k < n; k++)
+    {
+        if ( mathexpr_getSlotVariable(equation, k) >= PVMAX + Nobjects[POLLUT] )
+            return FALSE;
+    }
+    return TRUE;
+}
+
+//=============================================================================
+
+int createBatches()
+//
+//  Input:   none
+//  Output:  returns FALSE if memory could not be allocated
+//  Purpose: groups the nodes whose treatment of a pollutant uses the same
+//           equation into batches of up to BatchSize nodes.
+//
+{
+    int    j, p, g, k, n, nGroups, nSlots, ok;
+    int    nNodes = Nobjects[NODE];
+    int*   leader;                     // first node of each group
+    int*   size;                       // number of nodes in each group
+    int*   group;                      // group of each node (-1 if none)
+    MathExpr* equation;
+
+    // --- count the eqns. that could be batched
+    n = 0;
+    for (j = 0; j < nNodes; j++)
+    {
+        if ( Node[j].treatment == NULL ) continue;
+        for (p = 0; p < Nobjects[POLLUT]; p++)
+        {
+            Node[j].treatment[p].batched = FALSE;
+            if ( isBatchable(j, p) ) n++;
+        }
+    }
+    if ( n == 0 ) return TRUE;
+
+    // --- there can't be more batches than batched eqns.
+    TreatBatchNodes = (int *) calloc(n, sizeof(int));
+    TreatBatches = (TTreatBatch *) calloc(n, sizeof(TTreatBatch));
+    leader = (int *) calloc(nNodes, sizeof(int));
+    size = (int *) calloc(nNodes, sizeof(int));
+    group = (int *) calloc(nNodes, sizeof(int));
+    ok = ( TreatBatchNodes && TreatBatches && leader && size && group );
+    if ( ok )
+    {
+        n = 0;
+        for (p = 0; p < Nobjects[POLLUT]; p++)
+        {
+            // --- assign each node to the group of the first node with
+            //     the same equation
+            nGroups = 0;
+            for (j = 0; j < nNodes; j++)
+            {
+                group[j] = -1;
+                if ( !isBatchable(j, p) ) continue;
+                equation = Node[j].treatment[p].equation;
+                for (g = 0; g < nGroups; g++)
+                {
+                    if ( mathexpr_isEqual(Node[leader[g]].treatment[p].equation,
+                                          equation) ) break;
+                }
+                if ( g == nGroups )
+                {
+                    leader[g] = j;
+                    size[g] = 0;
+                    nGroups++;
+                }
+                group[j] = g;
+                size[g]++;
+            }
+
+            // --- list the nodes of each group shared by several nodes
+            //     and split them into batches
+            for (g = 0; g < nGroups; g++)
+            {
+                if ( size[g] < 2 ) continue;
+                k = n;
+                for (j = leader[g]; j < nNodes; j++)
+                {
+                    if ( group[j] != g ) continue;
+                    Node[j].treatment[p].batched = TRUE;
+                    TreatBatchNodes[n++] = j;
+                }
+                nSlots = mathexpr_getSlotCount(Node[leader[g]].treatment[p].equation);
+                TreatBatchSlots = MAX(TreatBatchSlots, nSlots);
+                for (; k < n; k += BatchSize)
+                {
+                    TreatBatches[TreatBatchCount].pollut = p;
+                    TreatBatches[TreatBatchCount].start = k;
+                    TreatBatches[TreatBatchCount].count = MIN(BatchSize, n - k);
+                    TreatBatchCount++;
+                }
+            }
+        }
+    }
+    FREE(leader);
+    FREE(size);
+    FREE(group);
+    if ( !ok ) return FALSE;
+    if ( TreatBatchCount == 0 ) return TRUE;
+
+    // --- each thread gets its own variable values & results
+    n = MAX(NumThreads, 1) * BatchSize * (TreatBatchSlots + 1);
+    TreatBatchValues = (double *) calloc(n, sizeof(double));
+    return ( TreatBatchValues != NULL );
+}
+
+//=============================================================================
@@ -0,0 +1,253 @@
+//-----------------------------------------------------------------------------
+//   workers.c
+//
+//   Project:  EPA SWMM5
+//   Version:  5.1
+//
+//   Thread count selection for the parallel phases of a simulation.
+//
+//   The OpenMP team used by the parallel phases (subcatchment runoff,
+//   flow routing, water quality routing and flow statistics) is started
+//   once when the simulation begins and is then reused by every phase and
+//   time step.
+//   Each phase chooses its own number of threads, up to NumThreads: the
+//   first calls of a phase are timed with 1, 2, 4, ... threads and the
+//   count giving the least time per item is kept. Since the work done per
+//   item changes over a run (e.g., dry versus wet weather) the trials are
+//   repeated every RETRIAL_CALLS calls, and sooner once the number of
+//   items per call (e.g., nodes & links left in the active set) has grown
+//   or shrunk by more than a factor of ITEM_CHANGE since the last choice.
+//   The choice never affects computed results, only how fast they are
+//   obtained. The chosen configuration is listed in the report file.
+//-----------------------------------------------------------------------------
+#define _CRT_SECURE_NO_DEPRECATE
+
+#include <stdlib.h>
+#include <omp.h>
+#include "headers.h"
+
+//-----------------------------------------------------------------------------
+//  Constants
+//-----------------------------------------------------------------------------
+static const int    TRIAL_CALLS = 8;      // calls timed for each trial count
+static const int    RETRIAL_CALLS = 4000; // calls made before trials repeat
+static const double ITEM_CHANGE = 2.0;    // change in items per call that
+                                          //   makes trials repeat
+
+//-----------------------------------------------------------------------------
+//  Shared variables
+//-----------------------------------------------------------------------------
+#define WorkerPhases   (Project->WorkerPhases)   // thread use by each phase
+#define WorkerOverhead (Project->WorkerOverhead) // cost of a parallel region (sec)
+
+//-----------------------------------------------------------------------------
+//  External functions (declared in funcs.h)
+//-----------------------------------------------------------------------------
+//  workers_open    (called from swmm_start in swmm5.c)
+//  workers_close   (called from swmm_end in swmm5.c)
+//  workers_begin   (called by the parallel phases of runoff, routing & stats)
+//  workers_end     (called by the parallel phases of runoff, routing & stats)
+//  workers_report  (called from stats_report)
+
+//-----------------------------------------------------------------------------
+//  Local functions
+//-----------------------------------------------------------------------------
+static int  getTrialThreads(int trial);
+static void startTrials(TWorkerPhase* w);
+
+//=============================================================================
+
+int workers_open()
+//
+//  Input:   none
+//  Output:  returns error code
+//  Purpose: starts the team of worker threads and initializes the thread
+//           counts used by each parallel phase.
+//
+{
+    int    i;
+    double t;
+    TProject* project = Project;
+
+    for (i = 0; i < MAX_WORKER_PHASES; i++)
+    {
+        WorkerPhases[i].items = 0;
+        WorkerPhases[i].threads = 1;
+        WorkerPhases[i].trial = 0;
+        WorkerPhases[i].calls = 0;
+        WorkerPhases[i].choices = 0;
+        WorkerPhases[i].chosenItems = 0;
+        WorkerPhases[i].start = 0.0;
+        WorkerPhases[i].time = 0.0;
+        WorkerPhases[i].timedItems = 0.0;
+        WorkerPhases[i].bestTime = 0.0;
+        WorkerPhases[i].bestThreads = 1;
+    }
+    WorkerOverhead = 0.0;
+    if ( NumThreads <= 1 ) return ErrorCode;
+
+    // --- the first parallel region creates the worker threads; later
+    //     regions reuse them, so time a few more to find their overhead
+#pragma omp parallel num_threads(NumThreads)
+{
+    Project = project;                 // worker threads share this project
+}
+    t = omp_get_wtime();
+    for (i = 0; i < TRIAL_CALLS; i++)
+    {
+#pragma omp parallel num_threads(NumThreads)
+{
+        Project = project;
+}
+    }
+    WorkerOverhead = (omp_get_wtime() - t) / TRIAL_CALLS;
+
+    // --- the thread count of every phase is found by timing trials
+    for (i = 0; i < MAX_WORKER_PHASES; i++) WorkerPhases[i].threads = 0;
+    return ErrorCode;
+}
+
+//=============================================================================
+
+void workers_close()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: resets the thread counts used by each parallel phase.
+//
+{
+    int i;
+    for (i = 0; i < MAX_WORKER_PHASES; i++) WorkerPhases[i].threads = 1;
+}
+
+//=============================================================================
+
+int workers_begin(int phase, int items)
+//
+//  Input:   phase = a parallel phase (see WorkerPhaseType)
+//           items = number of items (objects) the phase will process
+//  Output:  returns number of threads to use for this call of the phase
+//  Purpose: chooses how many threads a parallel phase uses.
+//
+{
+    TWorkerPhase* w = &WorkerPhases[phase];
+
+    w->items = items;
+    if ( NumThreads <= 1 ) return 1;
+
+    // --- keep the chosen count unless it is time to repeat the trials
+    if ( w->threads > 0 )
+    {
+        w->calls++;
+        if ( w->calls < RETRIAL_CALLS &&
+             items <= ITEM_CHANGE * w->chosenItems &&
+             items * ITEM_CHANGE >= w->chosenItems ) return w->threads;
+        startTrials(w);
+    }
+    w->start = omp_get_wtime();
+    return getTrialThreads(w->trial);
+}
+
+//=============================================================================
+
+void workers_end(int phase)
+//
+//  Input:   phase = a parallel phase (see WorkerPhaseType)
+//  Output:  none
+//  Purpose: times a call of a parallel phase while its thread count is
+//           still being chosen.
+//
+{
+    int    n;
+    double t;
+    TWorkerPhase* w = &WorkerPhases[phase];
+
+    if ( w->threads > 0 || w->items == 0 ) return;
+    w->time += omp_get_wtime() - w->start;
+    w->timedItems += w->items;
+    w->calls++;
+    if ( w->calls < TRIAL_CALLS ) return;
+
+    // --- compare time per item with the best trial so far
+    n = getTrialThreads(w->trial);
+    t = w->time / w->timedItems;
+    if ( w->trial == 0 || t < w->bestTime )
+    {
+        w->bestTime = t;
+        w->bestThreads = n;
+    }
+    w->time = 0.0;
+    w->timedItems = 0.0;
+    w->calls = 0;
+
+    // --- move on to the next trial count or keep the best one
+    if ( n < NumThreads ) w->trial++;
+    else
+    {
+        w->threads = w->bestThreads;
+        w->chosenItems = w->items;
+        w->choices++;
+    }
+}
+
+//=============================================================================
+
+void startTrials(TWorkerPhase* w)
+//
+//  Input:   w = thread use of a parallel phase
+//  Output:  none
+//  Purpose: starts timing a phase's calls with each trial thread count.
+//
+{
+    w->threads = 0;
+    w->trial = 0;
+    w->calls = 0;
+    w->time = 0.0;
+    w->timedItems = 0.0;
+}
+
+//=============================================================================
+
+int getTrialThreads(int trial)
+//
+//  Input:   trial = index of a trial
+//  Output:  returns number of threads timed in a trial
+//  Purpose: finds the thread count of a trial (1, 2, 4, ..., NumThreads).
+//
+{
+    int n = 1;
+    while ( trial > 0 && n < NumThreads )
+    {
+        n *= 2;
+        trial--;
+    }
+    return MIN(n, NumThreads);
+}
+
+//=============================================================================
+
+void workers_report()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: writes the thread count chosen for each parallel phase to the
+//           report file.
+//
+{
+    int i;
+
+    if ( NumThreads <= 1 ) return;
+
+    // --- phases with unfinished trials use their best count so far
+    for (i = 0; i < MAX_WORKER_PHASES; i++)
+    {
+        if ( WorkerPhases[i].threads == 0 )
+        {
+            WorkerPhases[i].threads = WorkerPhases[i].bestThreads;
+            WorkerPhases[i].choices++;
+        }
+    }
+    report_writeWorkerStats(WorkerPhases, WorkerOverhead);
+}
+
+//=============================================================================
@@ -25,15 +25,36 @@
 //      R = hyd. radius
 //      S = section factor = A*R^(2/3)
 //
+//   A conduit's xsection can also point to a table of A, R, W and S,
+//   normalized by their full values, at N_XSECT_TBL equally spaced depths.
+//   The rows are stored one after another and are shared by all xsections
+//   of similar shape. Dynamic wave routing interpolates these tables
+//   instead of calling the functions above (see the XSECT_TABLES option).
+//   A second table of S and critical flow at the same depths replaces the
+//   root finding used for critical and normal depths: it is bisected for
+//   the interval holding a given flow, so the depth found is within one
+//   interval of the exact depth.
+//
 //   Build 5.1.012:
 //   - Height at max. width for Modified Baskethandle shape corrected.
 //-----------------------------------------------------------------------------
 #define _CRT_SECURE_NO_DEPRECATE
 
+#include <stdlib.h>
 #include <math.h>
 #include "headers.h"
 #include "findroot.h"
 
+#define  XSECT_TBL_TOL      1.0e-10   // rel. tolerance for sharing geometry tables
+
+//-----------------------------------------------------------------------------
+//  Shared variables
+//-----------------------------------------------------------------------------
+#define  GeomTables         (Project->GeomTables)   // shared geometry tables
+#define  NGeomTables        (Project->NGeomTables)  // number of shared tables
+#define  DepthTables        (Project->DepthTables)  // shared depth tables
+#define  NDepthTables       (Project->NDepthTables) // number of depth tables
+
 #define  RECT_ALFMAX        0.97
 #define  RECT_TRIANG_ALFMAX 0.98
 #define  RECT_ROUND_ALFMAX  0.98
@@ -99,6 +120,10 @@ typedef struct
 //  xsect_getRofY
 //  xsect_getWofY
 //  xsect_getYcrit
+//  xsect_createTable
+//  xsect_deleteTables
+//  xsect_getYofS
+//  xsect_getTableValues
 
 //-----------------------------------------------------------------------------
 //  Local functions
@@ -188,6 +213,13 @@ static double getQcritical(double yc, void* p);
 static double getYcritEnum(TXsect* xsect, double q, double y0);
 static double getYcritRidder(TXsect* xsect, double q, double y0);
 
+static void   getTableScale(TXsect* xsect, double scale[]);
+static double* addSharedTable(double*** tables, int* nTables, double* table,
+               int size);
+static int    isSameTable(double* table1, double* table2, int size);
+static double getYcritOfTable(TXsect* xsect, double q);
+static double interpDepth(TXsect* xsect, double* table, int k, double x);
+
 //=============================================================================
 
 int xsect_isOpen(int type)
@@ -1271,6 +1303,13 @@ double xsect_getYcrit(TXsect* xsect, double q)
         break;
 
       default:
+        // --- look up yCritical in the cross section's table if it has one
+        if ( xsect->depthTbl )
+        {
+            y = getYcritOfTable(xsect, q);
+            break;
+        }
+
         // --- first estimate yCritical for an equivalent circular conduit
         //     using 1.01 * (q2g / yFull)^(1/4)
         y = 1.01 * pow(q2g / xsect->yFull, 1./4.);
@@ -1294,6 +1333,351 @@ double xsect_getYcrit(TXsect* xsect, double q)
 
 //=============================================================================
 
+int xsect_createTable(TXsect* xsect)
+//
+//  Input:   xsect = ptr. to a cross section data structure
+//  Output:  returns FALSE if memory could not be allocated
+//  Purpose: assigns a cross section a table of its normalized area, hyd.
+//           radius, top width and section factor at equally spaced depths
+//           and a table used to find its critical and normal depths.
+//
+//  NOTE: cross sections of similar shape (e.g., all circular pipes) share
+//        the same tables, keeping the tables of a network small enough to
+//        stay in cache. Shapes whose geometry is a simple polynomial of
+//        depth are no faster to look up and get no geometry table.
+{
+    int     i;
+    double  y, a, w;
+    double  scale[XT_COLUMNS];
+    double* row;
+    double* table;
+    double* sTbl;
+    double* qTbl;
+
+    xsect->geomTbl = NULL;
+    xsect->depthTbl = NULL;
+    getTableScale(xsect, scale);
+
+    // --- build the cross section's geometry table normalized by its
+    //     full values
+    switch ( xsect->type )
+    {
+      case RECT_CLOSED:
+      case RECT_OPEN:
+      case TRAPEZOIDAL:
+      case TRIANGULAR:
+      case RECT_TRIANG:
+        break;
+
+      default:
+        table = (double *) calloc(N_XSECT_TBL * XT_COLUMNS, sizeof(double));
+        if ( table == NULL ) return FALSE;
+        for (i = 0; i < N_XSECT_TBL; i++)
+        {
+            y = xsect->yFull * i / (N_XSECT_TBL - 1);
+            a = xsect_getAofY(xsect, y);
+            row = table + i * XT_COLUMNS;
+            row[XT_AREA] = a / scale[XT_AREA];
+            row[XT_WIDTH] = xsect_getWofY(xsect, y) / scale[XT_WIDTH];
+            if ( i > 0 )
+            {
+                row[XT_HRAD] = xsect_getRofY(xsect, y) / scale[XT_HRAD];
+                row[XT_SFACT] = xsect_getSofA(xsect, a) / scale[XT_SFACT];
+            }
+        }
+        xsect->geomTbl = addSharedTable(&GeomTables, &NGeomTables, table,
+                                        N_XSECT_TBL * XT_COLUMNS);
+        if ( xsect->geomTbl == NULL ) return FALSE;
+    }
+
+    // --- build the cross section's table of normalized section factor
+    //     and critical flow at the same depths
+    table = (double *) calloc(2 * N_XSECT_TBL, sizeof(double));
+    if ( table == NULL ) return FALSE;
+    sTbl = table;
+    qTbl = table + N_XSECT_TBL;
+    for (i = 1; i < N_XSECT_TBL; i++)
+    {
+        y = xsect->yFull * i / (N_XSECT_TBL - 1);
+        a = xsect_getAofY(xsect, y);
+        w = xsect_getWofY(xsect, y);
+        sTbl[i] = xsect_getSofA(xsect, a) / scale[XT_SFACT];
+
+        // --- critical flow a*sqrt(g*a/w) normalized by its value for
+        //     aFull & wMax; it is kept from decreasing where the top
+        //     width of a closed shape vanishes
+        a /= scale[XT_AREA];
+        w /= scale[XT_WIDTH];
+        qTbl[i] = qTbl[i-1];
+        if ( w > 0.0 ) qTbl[i] = MAX(qTbl[i], a * sqrt(a / w));
+    }
+    xsect->depthTbl = addSharedTable(&DepthTables, &NDepthTables, table,
+                                     2 * N_XSECT_TBL);
+    if ( xsect->depthTbl == NULL ) return FALSE;
+    return TRUE;
+}
+
+//=============================================================================
+
+void xsect_deleteTables()
+//
+//  Input:   none
+//  Output:  none
+//  Purpose: frees the shared geometry tables of all cross sections.
+//
+{
+    int k;
+    for (k = 0; k < NGeomTables; k++) FREE(GeomTables[k]);
+    FREE(GeomTables);
+    NGeomTables = 0;
+    for (k = 0; k < NDepthTables; k++) FREE(DepthTables[k]);
+    FREE(DepthTables);
+    NDepthTables = 0;
+}
+
+//=============================================================================
+
+double xsect_getYofS(TXsect* xsect, double s)
+//
+//  Input:   xsect = ptr. to a cross section data structure
+//           s = section factor (ft^8/3)
+//  Output:  returns flow depth (ft)
+//  Purpose: finds the flow depth with a given section factor (i.e., the
+//           normal depth for a given flow).
+//
+//  NOTE: a table lookup returns a depth within one table interval
+//        (yFull/(N_XSECT_TBL-1)) of the exact one. Section factors at or
+//        above sFull, which closed shapes reach at two depths, and those of
+//        irregular & custom shapes, which can have several maxima, are
+//        always solved for exactly.
+{
+    int     k, k1, k2;
+    double  sn;
+    double  scale[XT_COLUMNS];
+    double* sTbl = xsect->depthTbl;
+
+    if ( s <= 0.0 ) return 0.0;
+    if ( sTbl == NULL || xsect->type == IRREGULAR || xsect->type == CUSTOM ||
+         s >= xsect->sFull )
+        return xsect_getYofA(xsect, xsect_getAofS(xsect, s));
+    getTableScale(xsect, scale);
+    sn = s / scale[XT_SFACT];
+
+    // --- bisect for the first entry at or above sn
+    //     (entries below sFull only increase with depth)
+    k1 = 0;
+    k2 = N_XSECT_TBL - 1;
+    while ( k2 - k1 > 1 )
+    {
+        k = (k1 + k2) / 2;
+        if ( sTbl[k] < sn ) k1 = k;
+        else k2 = k;
+    }
+    return interpDepth(xsect, sTbl, k1, sn);
+}
+
+//=============================================================================
+
+void xsect_getTableValues(TXsect* xsect, int n, double y[], double v[])
+//
+//  Input:   xsect = ptr. to a cross section data structure
+//           n = number of depths
+//           y = array of n flow depths (ft)
+//  Output:  v = array of n rows of XT_COLUMNS geometry values
+//  Purpose: interpolates the area, hyd. radius, top width and section factor
+//           at several depths from a cross section's geometry table.
+//
+//  NOTE: uses the same interpolation as lookup(), including its quadratic
+//        correction over the first two segments of the table.
+{
+    int     i, k, m;
+    double  x;                         // depth in table intervals
+    double  f;                         // fraction of interval
+    double  g;                         // quadratic correction weight
+    double  z;                         // corrected value
+    double  *r0, *r1, *r2;             // rows at start & end of interval
+    double  *out;
+    double  scale[XT_COLUMNS];         // full values of each column
+
+    getTableScale(xsect, scale);
+    for (i = 0; i < n; i++)
+    {
+        out = v + i * XT_COLUMNS;
+        x = y[i] / xsect->yFull * (N_XSECT_TBL - 1);
+        k = (int)x;
+        if ( x <= 0.0 ) k = 0;
+        if ( k >= N_XSECT_TBL - 1 )
+        {
+            r0 = xsect->geomTbl + (N_XSECT_TBL - 1) * XT_COLUMNS;
+            for (m = 0; m < XT_COLUMNS; m++) out[m] = r0[m] * scale[m];
+            continue;
+        }
+        f = x - k;
+        r0 = xsect->geomTbl + k * XT_COLUMNS;
+        r1 = r0 + XT_COLUMNS;
+
+        // --- linearly interpolate all columns of the row at once
+        for (m = 0; m < XT_COLUMNS; m++) out[m] = r0[m] + f * (r1[m] - r0[m]);
+
+        // --- use quadratic interpolation for low depths
+        if ( k < 2 )
+        {
+            r2 = r1 + XT_COLUMNS;
+            g = f * (f - 1.0);
+            for (m = 0; m < XT_COLUMNS; m++)
+            {
+                z = out[m] + g * (r0[m]/2.0 - r1[m] + r2[m]/2.0);
+                if ( z > 0.0 ) out[m] = z;
+            }
+        }
+
+        // --- convert normalized values to actual ones
+        for (m = 0; m < XT_COLUMNS; m++) out[m] *= scale[m];
+    }
+}
+
+//=============================================================================
+
+void getTableScale(TXsect* xsect, double scale[])
+//
+//  Input:   xsect = ptr. to a cross section data structure
+//  Output:  scale = full values that normalize each column of a geometry table
+//  Purpose: finds the values that a cross section's geometry table entries
+//           are normalized by.
+//
+{
+    int m;
+    scale[XT_AREA]  = xsect->aFull;
+    scale[XT_HRAD]  = xsect->rFull;
+    scale[XT_WIDTH] = xsect->wMax;
+    scale[XT_SFACT] = xsect->sFull;
+    for (m = 0; m < XT_COLUMNS; m++)
+    {
+        if ( scale[m] <= 0.0 ) scale[m] = 1.0;
+    }
+}
+
+//=============================================================================
+
+double* addSharedTable(double*** tables, int* nTables, double* table,
+                       int size)
+//
+//  Input:   tables = ptr. to array of shared tables
+//           nTables = ptr. to number of shared tables
+//           table = newly built table
+//           size = number of entries in table
+//  Output:  returns the shared table to use in place of table (or NULL if
+//           memory could not be allocated)
+//  Purpose: replaces a new table with an existing one holding the same
+//           values or adds it to the shared tables.
+//
+{
+    int      k;
+    double** newTables;
+
+    // --- use an existing table if it has the same values
+    for (k = 0; k < *nTables; k++)
+    {
+        if ( isSameTable((*tables)[k], table, size) )
+        {
+            free(table);
+            return (*tables)[k];
+        }
+    }
+
+    // --- otherwise add the new table to the shared tables
+    newTables = (double **) realloc(*tables, (*nTables + 1) * sizeof(double *));
+    if ( newTables == NULL )
+    {
+        free(table);
+        return NULL;
+    }
+    *tables = newTables;
+    (*tables)[*nTables] = table;
+    (*nTables)++;
+    return table;
+}
+
+//=============================================================================
+
+int isSameTable(double* table1, double* table2, int size)
+//
+//  Input:   table1, table2 = normalized tables
+//           size = number of entries in each table
+//  Output:  returns TRUE if the tables hold the same values
+//  Purpose: checks if two cross sections can share a table.
+//
+{
+    int    i;
+    double d, tol;
+
+    for (i = 0; i < size; i++)
+    {
+        d = fabs(table1[i] - table2[i]);
+        tol = XSECT_TBL_TOL * MAX(fabs(table1[i]), fabs(table2[i]));
+        if ( d > tol ) return FALSE;
+    }
+    return TRUE;
+}
+
+//=============================================================================
+
+double getYcritOfTable(TXsect* xsect, double q)
+//
+//  Input:   xsect = ptr. to cross section data structure
+//           q = critical flow rate (cfs)
+//  Output:  returns critical depth (ft)
+//  Purpose: finds critical depth from a cross section's table of critical
+//           flow v. depth.
+//
+//  NOTE: the critical flow table never decreases with depth, so the depth
+//        found lies within one table interval of the exact one.
+{
+    int     k, k1, k2;
+    double  qn;
+    double  scale[XT_COLUMNS];
+    double* qTbl = xsect->depthTbl + N_XSECT_TBL;
+
+    // --- normalize q by critical flow for aFull & wMax
+    getTableScale(xsect, scale);
+    qn = scale[XT_AREA] * sqrt(GRAVITY * scale[XT_AREA] / scale[XT_WIDTH]);
+    qn = q / qn;
+    if ( qn >= qTbl[N_XSECT_TBL-1] ) return xsect->yFull;
+
+    // --- bisect for the first entry at or above qn
+    k1 = 0;
+    k2 = N_XSECT_TBL - 1;
+    while ( k2 - k1 > 1 )
+    {
+        k = (k1 + k2) / 2;
+        if ( qTbl[k] < qn ) k1 = k;
+        else k2 = k;
+    }
+    return interpDepth(xsect, qTbl, k1, qn);
+}
+
+//=============================================================================
+
+double interpDepth(TXsect* xsect, double* table, int k, double x)
+//
+//  Input:   xsect = ptr. to cross section data structure
+//           table = table of values at equally spaced depths
+//           k = table interval that brackets x
+//           x = value being looked up
+//  Output:  returns depth (ft)
+//  Purpose: linearly interpolates the depth at which a table reaches a value.
+//
+{
+    double d = table[k+1] - table[k];
+    double f = 0.0;
+
+    if ( d != 0.0 ) f = (x - table[k]) / d;
+    f = MAX(0.0, MIN(f, 1.0));
+    return (k + f) * xsect->yFull / (N_XSECT_TBL - 1);
+}
+
+//=============================================================================
+
 double generic_getAofS(TXsect* xsect, double s)
 //
 //  Input:   xsect = ptr. to a cross section data structure
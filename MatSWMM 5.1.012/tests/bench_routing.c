@@ -0,0 +1,120 @@
+//-----------------------------------------------------------------------------
+//   bench_routing.c
+//
+//   Project: EPA SWMM5
+//   Version: 5.1
+//
+//   Times dynamic wave routing of a synthetic grid network built in memory.
+//
+//   Usage: bench_routing [side [hours [threads]]]
+//
+//   The network has side x side junctions, each drained by conduits to its
+//   right and lower neighbours and all draining to a single outfall. Every
+//   junction receives a constant dry weather flow and the first row receives
+//   a storm hydrograph, so most of the network stays wet. The elapsed wall
+//   time of swmm_start..swmm_end is printed with the number of routing steps.
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "swmm5.h"
+
+static double wallTime(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+static char* buildNetwork(int side, int hours, int threads)
+{
+    size_t size = 4096 + (size_t)side * side * 200;
+    char*  s = malloc(size);
+    size_t n = 0;
+    int    r, c;
+
+    if ( s == NULL ) return NULL;
+    n += sprintf(s+n,
+        "[OPTIONS]\n"
+        "FLOW_UNITS CFS\nFLOW_ROUTING DYNWAVE\nLINK_OFFSETS DEPTH\n"
+        "START_DATE 01/01/2020\nSTART_TIME 00:00:00\n"
+        "REPORT_START_DATE 01/01/2020\nREPORT_START_TIME 00:00:00\n"
+        "END_DATE 01/01/2020\nEND_TIME %02d:00:00\n"
+        "REPORT_STEP 00:15:00\nWET_STEP 00:05:00\nDRY_STEP 01:00:00\n"
+        "ROUTING_STEP 0:00:10\nVARIABLE_STEP 0.75\nMAX_TRIALS 8\n"
+        "HEAD_TOLERANCE 0.005\nTHREADS %d\n\n", hours, threads);
+
+    n += sprintf(s+n, "[JUNCTIONS]\n");
+    for (r = 0; r < side; r++)
+        for (c = 0; c < side; c++)
+            n += sprintf(s+n, "J%d_%d %.2f 12 0 0 0\n", r, c,
+                         100.0 - 0.5 * (r + c));
+    n += sprintf(s+n, "\n[OUTFALLS]\nOUT %.2f FREE NO\n\n",
+                 100.0 - side - 0.5);
+
+    n += sprintf(s+n, "[CONDUITS]\n");
+    for (r = 0; r < side; r++)
+        for (c = 0; c < side; c++)
+        {
+            if ( c+1 < side ) n += sprintf(s+n,
+                "R%d_%d J%d_%d J%d_%d 100 0.013 0 0 0 0\n", r, c, r, c, r, c+1);
+            if ( r+1 < side ) n += sprintf(s+n,
+                "D%d_%d J%d_%d J%d_%d 100 0.013 0 0 0 0\n", r, c, r, c, r+1, c);
+        }
+    n += sprintf(s+n, "L J%d_%d OUT 100 0.013 0 0 0 0\n\n", side-1, side-1);
+
+    n += sprintf(s+n, "[XSECTIONS]\n");
+    for (r = 0; r < side; r++)
+        for (c = 0; c < side; c++)
+        {
+            if ( c+1 < side ) n += sprintf(s+n,
+                "R%d_%d CIRCULAR 2 0 0 0 1\n", r, c);
+            if ( r+1 < side ) n += sprintf(s+n,
+                "D%d_%d CIRCULAR 2 0 0 0 1\n", r, c);
+        }
+    n += sprintf(s+n, "L CIRCULAR 6 0 0 0 1\n\n");
+
+    n += sprintf(s+n, "[TIMESERIES]\nSTORM 0:00 0\nSTORM 0:30 2\n"
+                      "STORM 1:00 0.5\nSTORM 2:00 0\n\n[INFLOWS]\n");
+    for (c = 0; c < side; c++)
+        n += sprintf(s+n, "J0_%d FLOW STORM FLOW 1.0 1.0\n", c);
+    n += sprintf(s+n, "\n[DWF]\n");
+    for (r = 0; r < side; r++)
+        for (c = 0; c < side; c++)
+            n += sprintf(s+n, "J%d_%d FLOW 0.02\n", r, c);
+    return s;
+}
+
+int main(int argc, char* argv[])
+{
+    int    side    = argc > 1 ? atoi(argv[1]) : 60;
+    int    hours   = argc > 2 ? atoi(argv[2]) : 3;
+    int    threads = argc > 3 ? atoi(argv[3]) : 1;
+    int    steps = 0, err;
+    double elapsed = 0.0, t0, t1;
+    char*  inp = buildNetwork(side, hours, threads);
+
+    if ( inp == NULL ) return 1;
+    err = swmm_openFromBuffer(inp, strlen(inp), "bench_routing.rpt",
+                              "bench_routing.out");
+    free(inp);
+    if ( !err ) err = swmm_start(0);
+    t0 = wallTime();
+    if ( !err ) do
+    {
+        err = swmm_step(&elapsed);
+        steps++;
+    } while ( !err && elapsed > 0.0 );
+    t1 = wallTime();
+    swmm_end();
+    swmm_close();
+    if ( err )
+    {
+        printf("error %d\n", err);
+        return 1;
+    }
+    printf("%d nodes, %d routing steps, %.3f s (%.1f usec/step)\n",
+           side * side + 1, steps, t1 - t0, 1.0e6 * (t1 - t0) / steps);
+    return 0;
+}
@@ -0,0 +1,200 @@
+//-----------------------------------------------------------------------------
+//   test_export_columns.c
+//
+//   Project: EPA SWMM5
+//   Version: 5.1
+//
+//   Checks that the columnar results file is the same however many chunks
+//   the binary output file is read in.
+//
+//   Usage: test_export_columns
+//
+//   A grid network with a pollutant is run three times, with the default
+//   EXPORT_BUFFER (the whole output file is one chunk) and with buffers of
+//   64 KB and 1 KB (several periods and a single period per chunk). The
+//   columnar files written by swmm_save_results_columns must be identical,
+//   and the flow of the outfall link must match that of the output file.
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swmm5.h"
+
+#define SIDE 8
+#define LINK 3                         // object type code of links
+
+static char* buildNetwork(int exportBuffer)
+{
+    size_t size = 4096 + (size_t)SIDE * SIDE * 300;
+    char*  s = malloc(size);
+    size_t n = 0;
+    int    r, c;
+
+    if ( s == NULL ) return NULL;
+    n += sprintf(s+n,
+        "[OPTIONS]\n"
+        "FLOW_UNITS CFS\nFLOW_ROUTING DYNWAVE\nLINK_OFFSETS DEPTH\n"
+        "START_DATE 01/01/2020\nSTART_TIME 00:00:00\n"
+        "REPORT_START_DATE 01/01/2020\nREPORT_START_TIME 00:00:00\n"
+        "END_DATE 01/01/2020\nEND_TIME 03:00:00\n"
+        "REPORT_STEP 00:05:00\nROUTING_STEP 0:00:10\nVARIABLE_STEP 0\n");
+    if ( exportBuffer > 0 )
+        n += sprintf(s+n, "EXPORT_BUFFER %d\n", exportBuffer);
+    n += sprintf(s+n, "\n[REPORT]\nNODES ALL\nLINKS ALL\n\n"
+                      "[POLLUTANTS]\nTSS MG/L 0 0 0 0\n\n");
+
+    n += sprintf(s+n, "[JUNCTIONS]\n");
+    for (r = 0; r < SIDE; r++)
+        for (c = 0; c < SIDE; c++)
+            n += sprintf(s+n, "J%d_%d %.2f 12 0 0 0\n", r, c,
+                         100.0 - 0.5 * (r + c));
+    n += sprintf(s+n, "\n[OUTFALLS]\nOUT %.2f FREE NO\n\n",
+                 100.0 - SIDE - 0.5);
+
+    n += sprintf(s+n, "[CONDUITS]\n");
+    for (r = 0; r < SIDE; r++)
+        for (c = 0; c < SIDE; c++)
+        {
+            if ( c+1 < SIDE ) n += sprintf(s+n,
+                "R%d_%d J%d_%d J%d_%d 100 0.013 0 0 0 0\n", r, c, r, c, r, c+1);
+            if ( r+1 < SIDE ) n += sprintf(s+n,
+                "D%d_%d J%d_%d J%d_%d 100 0.013 0 0 0 0\n", r, c, r, c, r+1, c);
+        }
+    n += sprintf(s+n, "L J%d_%d OUT 100 0.013 0 0 0 0\n\n", SIDE-1, SIDE-1);
+
+    n += sprintf(s+n, "[XSECTIONS]\n");
+    for (r = 0; r < SIDE; r++)
+        for (c = 0; c < SIDE; c++)
+        {
+            if ( c+1 < SIDE ) n += sprintf(s+n,
+                "R%d_%d CIRCULAR 2 0 0 0 1\n", r, c);
+            if ( r+1 < SIDE ) n += sprintf(s+n,
+                "D%d_%d CIRCULAR 2 0 0 0 1\n", r, c);
+        }
+    n += sprintf(s+n, "L CIRCULAR 4 0 0 0 1\n\n");
+
+    n += sprintf(s+n, "[TIMESERIES]\nSTORM 0:00 0\nSTORM 0:30 1\n"
+                      "STORM 1:00 0.3\nSTORM 2:00 0\n\n[INFLOWS]\n");
+    for (c = 0; c < SIDE; c++)
+        n += sprintf(s+n, "J0_%d FLOW STORM FLOW 1.0 1.0\n", c);
+    n += sprintf(s+n, "\n[DWF]\n");
+    for (r = 0; r < SIDE; r++)
+        for (c = 0; c < SIDE; c++)
+        {
+            n += sprintf(s+n, "J%d_%d FLOW 0.02\n", r, c);
+            n += sprintf(s+n, "J%d_%d TSS %d\n", r, c, 50 + 10 * (c % 5));
+        }
+    return s;
+}
+
+static char* readFile(const char* path, size_t* len)
+{
+    FILE*  f = fopen(path, "rb");
+    char*  s = NULL;
+    long   n;
+
+    *len = 0;
+    if ( f == NULL ) return NULL;
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if ( n > 0 ) s = malloc(n);
+    if ( s && fread(s, 1, n, f) == (size_t)n ) *len = n;
+    else
+    {
+        free(s);
+        s = NULL;
+    }
+    fclose(f);
+    return s;
+}
+
+static int runModel(int exportBuffer, char** cols, size_t* colsLen)
+{
+    double elapsed = 0.0;
+    int    err;
+    char*  inp = buildNetwork(exportBuffer);
+
+    if ( inp == NULL ) return -1;
+    err = swmm_openFromBuffer(inp, strlen(inp), "test_export_columns.rpt",
+                              "test_export_columns.out");
+    free(inp);
+    if ( !err ) err = swmm_start(1);
+    while ( !err )
+    {
+        err = swmm_step(&elapsed);
+        if ( elapsed <= 0.0 ) break;
+    }
+    if ( !err ) err = swmm_end();
+    if ( !err ) err = swmm_save_results_columns("test_export_columns.col");
+    swmm_close();
+    *cols = readFile("test_export_columns.col", colsLen);
+    if ( !err && *cols == NULL ) err = -1;
+    return err;
+}
+
+// Compares the first variable (flow) of link L in a columnar file with
+// its time series in the binary output file of the last run.
+static int checkLinkFlow(const char* cols, size_t colsLen)
+{
+    SWMM_Results rh = NULL;
+    const int* header = (const int *)cols;
+    int    nPeriods, link, failed = 1;
+    size_t pos;
+    float* flow;
+
+    if ( colsLen < 14 * sizeof(int) ) return 1;
+    if ( swmm_open_results("test_export_columns.out", &rh) ) return 1;
+    nPeriods = header[2];
+    link = swmm_results_index(rh, LINK, "L");
+    flow = (float *) malloc(nPeriods * sizeof(float));
+    if ( link >= 0 && flow &&
+         swmm_results_series(rh, LINK, link, 0, 0, nPeriods, flow) == 0 )
+    {
+        // --- dates, then subcatchment, node & link variable blocks
+        pos = header[13] + (size_t)nPeriods * sizeof(double) +
+              ((size_t)header[4] * header[5] + (size_t)header[6] * header[7] +
+               link) * nPeriods * sizeof(float);
+        if ( pos + nPeriods * sizeof(float) <= colsLen )
+            failed = memcmp(cols + pos, flow, nPeriods * sizeof(float)) != 0;
+    }
+    free(flow);
+    swmm_close_results(rh);
+    return failed;
+}
+
+int main(void)
+{
+    static const int buffers[2] = {64, 1};
+    char*  ref = NULL;
+    char*  cols = NULL;
+    size_t refLen = 0, colsLen = 0;
+    int    err, k;
+    int    failed = 0;
+
+    err = runModel(0, &ref, &refLen);
+    if ( !err && checkLinkFlow(ref, refLen) )
+    {
+        printf("flow of link L differs from the output file\n");
+        failed = 1;
+    }
+    for (k = 0; k < 2 && !err; k++)
+    {
+        err = runModel(buffers[k], &cols, &colsLen);
+        if ( !err && (colsLen != refLen || memcmp(cols, ref, refLen)) )
+        {
+            printf("EXPORT_BUFFER %d KB gives a different file\n", buffers[k]);
+            failed = 1;
+        }
+        free(cols);
+    }
+    free(ref);
+    if ( err )
+    {
+        printf("error %d\nFAILED\n", err);
+        return 1;
+    }
+    printf("columnar file of %lu bytes\n", (unsigned long)refLen);
+    printf(failed ? "FAILED\n" : "PASSED\n");
+    return failed;
+}
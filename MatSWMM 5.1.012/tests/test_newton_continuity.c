@@ -0,0 +1,100 @@
+//-----------------------------------------------------------------------------
+//   test_newton_continuity.c
+//
+//   Project: EPA SWMM5
+//   Version: 5.1
+//
+//   Checks that the flow routing continuity error of DYNWAVE_METHOD NEWTON
+//   is not materially worse than that of Picard iterations.
+//
+//   Usage: test_newton_continuity [inpFile]
+//
+//   The default input file is the RedChicoSur_V05 model of release 5.1.009,
+//   a network with no inflows whose conduits mostly run dry. NEWTON fails
+//   if its error exceeds both twice the Picard error and the Picard error
+//   plus one percentage point.
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "swmm5.h"
+
+#define DEFAULT_INP \
+    "../../MatSWMM 5.1.009/Matlab module/SWMM Matlab/swmm_files/RedChicoSur_V05.inp"
+
+static char* readFile(const char* path, size_t* len)
+{
+    FILE*  f = fopen(path, "rb");
+    char*  s = NULL;
+    long   n;
+
+    if ( f == NULL ) return NULL;
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if ( n > 0 ) s = malloc(n + 64);
+    if ( s && fread(s, 1, n, f) == (size_t)n ) *len = n;
+    else
+    {
+        free(s);
+        s = NULL;
+    }
+    fclose(f);
+    return s;
+}
+
+static int runMethod(char* inp, size_t len, const char* method, float* flowErr)
+{
+    float  runoffErr, qualErr;
+    double elapsed = 0.0;
+    int    err;
+    size_t n = len + sprintf(inp + len, "\n[OPTIONS]\nDYNWAVE_METHOD %s\n",
+                             method);
+
+    err = swmm_openFromBuffer(inp, n, "test_newton_continuity.rpt",
+                              "test_newton_continuity.out");
+    if ( !err ) err = swmm_start(0);
+    while ( !err )
+    {
+        err = swmm_step(&elapsed);
+        if ( elapsed <= 0.0 ) break;
+    }
+    swmm_end();
+    swmm_getMassBalErr(&runoffErr, flowErr, &qualErr);
+    swmm_close();
+    return err;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = argc > 1 ? argv[1] : DEFAULT_INP;
+    size_t len = 0;
+    float  picardErr = 0.0f, newtonErr = 0.0f;
+    char*  inp = readFile(path, &len);
+    int    err;
+
+    if ( inp == NULL )
+    {
+        printf("cannot read %s\nFAILED\n", path);
+        return 1;
+    }
+    err = runMethod(inp, len, "PICARD", &picardErr);
+    if ( !err ) err = runMethod(inp, len, "NEWTON", &newtonErr);
+    free(inp);
+    if ( err )
+    {
+        printf("error %d\nFAILED\n", err);
+        return 1;
+    }
+    printf("flow continuity error: PICARD %.3f%%, NEWTON %.3f%%\n",
+           picardErr, newtonErr);
+    if ( fabs(newtonErr) > 2.0 * fabs(picardErr) &&
+         fabs(newtonErr) > fabs(picardErr) + 1.0 )
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("PASSED\n");
+    return 0;
+}
@@ -0,0 +1,105 @@
+//-----------------------------------------------------------------------------
+//   test_restore_pid.c
+//
+//   Project: EPA SWMM5
+//   Version: 5.1
+//
+//   Checks that swmm_restoreState returns PID controlled runs to the state
+//   they were saved in.
+//
+//   Usage: test_restore_pid
+//
+//   A storage tank with a varying inflow drains through an orifice whose
+//   setting a PID rule adjusts to hold the tank at a set depth. After an
+//   hour the state is saved; the run is then stepped ahead, restored and
+//   stepped ahead again twice. The orifice settings and tank depths of all
+//   three rollouts must be identical.
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include "swmm5.h"
+#include "source_code_DLL/cosimulation.h"
+
+#define MAX_STEPS 100000
+
+static const char* Model =
+    "[OPTIONS]\n"
+    "FLOW_UNITS CFS\nFLOW_ROUTING DYNWAVE\n"
+    "START_DATE 01/01/2020\nSTART_TIME 00:00:00\n"
+    "REPORT_START_DATE 01/01/2020\nREPORT_START_TIME 00:00:00\n"
+    "END_DATE 01/01/2020\nEND_TIME 04:00:00\n"
+    "REPORT_STEP 00:15:00\nROUTING_STEP 0:00:10\nVARIABLE_STEP 0\n\n"
+    "[STORAGE]\nT1 100 10 1 FUNCTIONAL 1000 0 0 0 0\n\n"
+    "[OUTFALLS]\nOUT 95 FREE NO\n\n"
+    "[ORIFICES]\nO1 T1 OUT SIDE 0 0.65 NO 0\n\n"
+    "[XSECTIONS]\nO1 RECT_CLOSED 2 2 0 0\n\n"
+    "[TIMESERIES]\nQIN 0:00 5\nQIN 1:00 20\nQIN 2:00 5\nQIN 3:00 15\n"
+    "QIN 4:00 2\n\n"
+    "[INFLOWS]\nT1 FLOW QIN FLOW 1.0 1.0\n\n"
+    "[CONTROLS]\nRULE R1\nIF NODE T1 DEPTH <> 1.2\n"
+    "THEN ORIFICE O1 SETTING = PID -0.5 5 0.1\n";
+
+static double Setting[3][MAX_STEPS];
+static double Depth[3][MAX_STEPS];
+
+static int rollout(int k, double tEnd, int* nSteps)
+{
+    double elapsed = 0.0;
+    int    err = 0, n = 0;
+
+    while ( !err && n < MAX_STEPS )
+    {
+        err = swmm_step(&elapsed);
+        if ( err || elapsed <= 0.0 || elapsed >= tEnd ) break;
+        Setting[k][n] = swmm_get("O1", C_SETTING, 0);
+        Depth[k][n] = swmm_get("T1", C_DEPTH, 0);
+        n++;
+    }
+    *nSteps = n;
+    return err;
+}
+
+int main(void)
+{
+    SWMM_State state = NULL;
+    double elapsed = 0.0;
+    int    err, k, i, n[3] = {0, 0, 0};
+    int    failed = 0;
+
+    err = swmm_openFromBuffer(Model, strlen(Model), "test_restore_pid.rpt",
+                              "test_restore_pid.out");
+    if ( !err ) err = swmm_start(0);
+    while ( !err && elapsed < 1.0 / 24.0 ) err = swmm_step(&elapsed);
+    if ( !err ) err = swmm_saveState(&state);
+    for (k = 0; k < 3 && !err; k++)
+    {
+        if ( k > 0 ) err = swmm_restoreState(state);
+        if ( !err ) err = rollout(k, 3.0 / 24.0, &n[k]);
+    }
+    swmm_deleteState(state);
+    swmm_end();
+    swmm_close();
+    if ( err )
+    {
+        printf("error %d\nFAILED\n", err);
+        return 1;
+    }
+
+    for (k = 1; k < 3; k++)
+    {
+        if ( n[k] != n[0] ) failed = 1;
+        for (i = 0; i < n[0] && !failed; i++)
+        {
+            if ( Setting[k][i] != Setting[0][i] || Depth[k][i] != Depth[0][i] )
+            {
+                printf("rollout %d differs at step %d: setting %g vs %g\n",
+                       k + 1, i + 1, Setting[k][i], Setting[0][i]);
+                failed = 1;
+            }
+        }
+    }
+    printf("%d steps per rollout, settings %g .. %g\n", n[0],
+           Setting[0][0], Setting[0][n[0] > 0 ? n[0]-1 : 0]);
+    printf(failed ? "FAILED\n" : "PASSED\n");
+    return failed;
+}
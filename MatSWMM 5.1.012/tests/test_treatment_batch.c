@@ -0,0 +1,201 @@
+//-----------------------------------------------------------------------------
+//   test_treatment_batch.c
+//
+//   Project: EPA SWMM5
+//   Version: 5.1
+//
+//   Checks that treatment equations evaluated in batches give the same
+//   results as ones evaluated a node at a time.
+//
+//   Usage: test_treatment_batch
+//
+//   A grid of junctions carrying two pollutants has the same removal and
+//   concentration treatment equations at every node, which are evaluated
+//   in batches. A second run adds "0*R_x" terms to the equations, which
+//   keeps them from being batched without changing their values. Both runs
+//   are made with 1 and 4 threads; their output files and quality
+//   continuity errors must be identical, and must differ from a run with
+//   no treatment.
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swmm5.h"
+
+#define SIDE 12
+
+static char* buildNetwork(int threads, int treated, int batched)
+{
+    size_t size = 4096 + (size_t)SIDE * SIDE * 400;
+    char*  s = malloc(size);
+    size_t n = 0;
+    int    r, c;
+
+    if ( s == NULL ) return NULL;
+    n += sprintf(s+n,
+        "[OPTIONS]\n"
+        "FLOW_UNITS CFS\nFLOW_ROUTING DYNWAVE\nLINK_OFFSETS DEPTH\n"
+        "START_DATE 01/01/2020\nSTART_TIME 00:00:00\n"
+        "REPORT_START_DATE 01/01/2020\nREPORT_START_TIME 00:00:00\n"
+        "END_DATE 01/01/2020\nEND_TIME 03:00:00\n"
+        "REPORT_STEP 00:05:00\nROUTING_STEP 0:00:10\nVARIABLE_STEP 0\n"
+        "THREADS %d\n\n"
+        "[REPORT]\nNODES ALL\nLINKS ALL\n\n"
+        "[POLLUTANTS]\nTSS MG/L 0 0 0 0\nBOD MG/L 0 0 0 0\n\n", threads);
+
+    n += sprintf(s+n, "[JUNCTIONS]\n");
+    for (r = 0; r < SIDE; r++)
+        for (c = 0; c < SIDE; c++)
+            n += sprintf(s+n, "J%d_%d %.2f 12 0 0 0\n", r, c,
+                         100.0 - 0.5 * (r + c));
+    n += sprintf(s+n, "\n[OUTFALLS]\nOUT %.2f FREE NO\n\n",
+                 100.0 - SIDE - 0.5);
+
+    n += sprintf(s+n, "[CONDUITS]\n");
+    for (r = 0; r < SIDE; r++)
+        for (c = 0; c < SIDE; c++)
+        {
+            if ( c+1 < SIDE ) n += sprintf(s+n,
+                "R%d_%d J%d_%d J%d_%d 100 0.013 0 0 0 0\n", r, c, r, c, r, c+1);
+            if ( r+1 < SIDE ) n += sprintf(s+n,
+                "D%d_%d J%d_%d J%d_%d 100 0.013 0 0 0 0\n", r, c, r, c, r+1, c);
+        }
+    n += sprintf(s+n, "L J%d_%d OUT 100 0.013 0 0 0 0\n\n", SIDE-1, SIDE-1);
+
+    n += sprintf(s+n, "[XSECTIONS]\n");
+    for (r = 0; r < SIDE; r++)
+        for (c = 0; c < SIDE; c++)
+        {
+            if ( c+1 < SIDE ) n += sprintf(s+n,
+                "R%d_%d CIRCULAR 2 0 0 0 1\n", r, c);
+            if ( r+1 < SIDE ) n += sprintf(s+n,
+                "D%d_%d CIRCULAR 2 0 0 0 1\n", r, c);
+        }
+    n += sprintf(s+n, "L CIRCULAR 4 0 0 0 1\n\n");
+
+    n += sprintf(s+n, "[TIMESERIES]\nSTORM 0:00 0\nSTORM 0:30 1\n"
+                      "STORM 1:00 0.3\nSTORM 2:00 0\n\n[INFLOWS]\n");
+    for (c = 0; c < SIDE; c++)
+        n += sprintf(s+n, "J0_%d FLOW STORM FLOW 1.0 1.0\n", c);
+    n += sprintf(s+n, "\n[DWF]\n");
+    for (r = 0; r < SIDE; r++)
+        for (c = 0; c < SIDE; c++)
+        {
+            n += sprintf(s+n, "J%d_%d FLOW 0.02\n", r, c);
+            n += sprintf(s+n, "J%d_%d TSS %d\n", r, c, 50 + 10 * (c % 5));
+            n += sprintf(s+n, "J%d_%d BOD %d\n", r, c, 20 + 5 * (r % 3));
+        }
+
+    if ( !treated ) return s;
+    n += sprintf(s+n, "\n[TREATMENT]\n");
+    for (r = 0; r < SIDE; r++)
+        for (c = 0; c < SIDE; c++)
+        {
+            n += sprintf(s+n, "J%d_%d TSS R = 0.6 * (1 - exp(-FLOW/0.5))"
+                         " * TSS / (TSS + 20)%s\n", r, c,
+                         batched ? "" : " + 0*R_BOD");
+            n += sprintf(s+n, "J%d_%d BOD C = BOD * (0.9 - 0.2*step(DEPTH-0.3))"
+                         " + 0.001*TSS%s\n", r, c,
+                         batched ? "" : " + 0*R_TSS");
+        }
+    return s;
+}
+
+static char* readFile(const char* path, size_t* len)
+{
+    FILE*  f = fopen(path, "rb");
+    char*  s = NULL;
+    long   n;
+
+    *len = 0;
+    if ( f == NULL ) return NULL;
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if ( n > 0 ) s = malloc(n);
+    if ( s && fread(s, 1, n, f) == (size_t)n ) *len = n;
+    else
+    {
+        free(s);
+        s = NULL;
+    }
+    fclose(f);
+    return s;
+}
+
+static int runModel(int threads, int treated, int batched, char** out,
+                    size_t* outLen, float* qualErr)
+{
+    float  runoffErr, flowErr;
+    double elapsed = 0.0;
+    int    err;
+    char*  inp = buildNetwork(threads, treated, batched);
+
+    if ( inp == NULL ) return -1;
+    err = swmm_openFromBuffer(inp, strlen(inp), "test_treatment_batch.rpt",
+                              "test_treatment_batch.out");
+    free(inp);
+    if ( !err ) err = swmm_start(1);
+    while ( !err )
+    {
+        err = swmm_step(&elapsed);
+        if ( elapsed <= 0.0 ) break;
+    }
+    swmm_end();
+    swmm_getMassBalErr(&runoffErr, &flowErr, qualErr);
+    swmm_close();
+    *out = readFile("test_treatment_batch.out", outLen);
+    if ( !err && *out == NULL ) err = -1;
+    return err;
+}
+
+int main(void)
+{
+    static const int threads[2] = {1, 4};
+    char*  ref = NULL;
+    char*  out = NULL;
+    size_t refLen = 0, outLen = 0;
+    float  refErr = 0.0f, qualErr = 0.0f;
+    int    err, k, batched;
+    int    failed = 0;
+
+    err = runModel(1, 1, 1, &ref, &refLen, &refErr);
+    for (k = 0; k < 2 && !err; k++)
+    {
+        for (batched = 0; batched <= 1 && !err; batched++)
+        {
+            if ( k == 0 && batched ) continue;
+            err = runModel(threads[k], 1, batched, &out, &outLen, &qualErr);
+            if ( !err && (outLen != refLen || memcmp(out, ref, refLen) ||
+                          qualErr != refErr) )
+            {
+                printf("%s equations with %d threads differ\n",
+                       batched ? "batched" : "unbatched", threads[k]);
+                failed = 1;
+            }
+            free(out);
+            out = NULL;
+        }
+    }
+
+    // --- treatment must have changed the results
+    if ( !err )
+    {
+        err = runModel(1, 0, 0, &out, &outLen, &qualErr);
+        if ( !err && outLen == refLen && memcmp(out, ref, refLen) == 0 )
+        {
+            printf("treatment had no effect\n");
+            failed = 1;
+        }
+        free(out);
+    }
+    free(ref);
+    if ( err )
+    {
+        printf("error %d\nFAILED\n", err);
+        return 1;
+    }
+    printf("quality continuity error %.3f%%\n", refErr);
+    printf(failed ? "FAILED\n" : "PASSED\n");
+    return failed;
+}